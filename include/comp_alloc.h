@@ -0,0 +1,70 @@
+#ifndef COMP_ALLOC_H
+#define COMP_ALLOC_H
+
+#include <stddef.h>
+#include <setjmp.h>
+
+/*
+ * Compressor memory allocator
+ *  - blocks up to COMP_SMALL_MAX come from power-of-two size classes carved
+ *    out of slabs; each thread keeps a small cache per class, so most
+ *    allocations and frees take no lock
+ *  - larger blocks use malloc, and from COMP_MMAP_THRESHOLD up a private
+ *    mapping (optionally backed by transparent huge pages)
+ *  - comp_free hands pointers it did not allocate to free(), so buffers
+ *    from read_file or the malloc-based codecs may be released through it
+ *  - arenas give one job O(1) bump allocation and release it all at once
+ */
+
+#define COMP_SMALL_MAX (32 * 1024)
+#define COMP_MMAP_THRESHOLD (256 * 1024)
+
+void* comp_malloc(size_t size);
+void* comp_calloc(size_t count, size_t size);
+/* Pointers it did not allocate are passed on to realloc() */
+void* comp_realloc(void* ptr, size_t size);
+void comp_free(void* ptr);
+
+/* Bytes held now, and the most held since the last reset: every live block
+ * plus the external memory noted below */
+size_t comp_alloc_in_use(void);
+size_t comp_alloc_peak(void);
+void comp_alloc_reset_peak(void);
+
+/* Count memory that does not come from comp_malloc (an input mapping,
+ * third-party codec state) for as long as it is held */
+void comp_alloc_note_external(size_t bytes);
+void comp_alloc_drop_external(size_t bytes);
+
+/* Ask for transparent huge pages on mappings of 2 MiB and up (Linux only) */
+void comp_alloc_set_huge_pages(int enable);
+
+/* Report live allocations; registered with atexit by the CLI */
+void comp_check_leaks(void);
+
+/* Print allocator state and longjmp to g_panic_buf */
+void comp_panic(const char* message);
+extern jmp_buf g_panic_buf;
+
+/* Legacy names for comp_malloc / comp_free */
+void* tracked_malloc(size_t size);
+void tracked_free(void* ptr, size_t size);
+
+#define COMP_MALLOC(size) comp_malloc(size)
+#define COMP_FREE(ptr) comp_free(ptr)
+
+/*
+ * Arena: bump allocation for one job, not shared between threads. Blocks
+ * are 16-byte aligned and are released only by reset or destroy; reset
+ * keeps a single chunk big enough for everything the job used, so a
+ * repeated job of the same shape allocates nothing new.
+ */
+typedef struct CompArena CompArena;
+
+/* chunk_size is the first chunk's size (0 selects 1 MiB) */
+CompArena* comp_arena_create(size_t chunk_size);
+void* comp_arena_alloc(CompArena* arena, size_t size);
+void comp_arena_reset(CompArena* arena);
+void comp_arena_destroy(CompArena* arena);
+
+#endif /* COMP_ALLOC_H */
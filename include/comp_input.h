@@ -0,0 +1,45 @@
+#ifndef COMP_INPUT_H
+#define COMP_INPUT_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+/*
+ * Read-only input mapping shared by the file readers
+ *  - regular files are mmap'd, so codecs run straight over the page cache
+ *    and a file compressed again is not read again
+ *  - pipes, devices and platforms without mmap fall back to one buffered
+ *    read into a heap buffer
+ *  - the data is read-only either way; a codec that rewrites its input
+ *    works on a copy
+ */
+
+typedef enum {
+    COMP_INPUT_SEQUENTIAL,  /* one front-to-back pass (MADV_SEQUENTIAL) */
+    COMP_INPUT_RANDOM,      /* all of it, in any order or several passes (MADV_WILLNEED) */
+    COMP_INPUT_SPARSE       /* a few scattered ranges, e.g. one block of an index (MADV_RANDOM) */
+} CompInputAccess;
+
+typedef struct {
+    const unsigned char* data;
+    size_t size;
+    void* map;              /* mapping base, NULL when data is heap-backed */
+    size_t map_size;
+    unsigned char* heap;
+} CompInput;
+
+/* Map (or read) path; returns 0, or -1 with errno set. An empty file gives
+ * size 0 and a non-NULL data pointer. */
+int comp_input_open(const char* path, CompInputAccess access, CompInput* in);
+
+/* Same for an open descriptor, which stays owned by the caller */
+int comp_input_open_fd(int fd, CompInputAccess access, CompInput* in);
+
+/* Unmap or free; in is left empty, and closing twice is harmless */
+void comp_input_close(CompInput* in);
+
+/* The buffered fallback on its own: everything left in f as one malloc'd
+ * buffer. Returns 0 or -1. */
+int comp_input_read_all(FILE* f, unsigned char** buffer, size_t* size);
+
+#endif /* COMP_INPUT_H */
@@ -0,0 +1,69 @@
+#ifndef COMP_STREAM_H
+#define COMP_STREAM_H
+
+#include "compressor.h"
+#include <stdio.h>
+#include <stdint.h>
+
+/*
+ * Streaming compression with bounded memory
+ *  - input is fed in pieces of any size and output is written to a FILE*
+ *    as it is produced; nothing is seeked back, so stdout or a pipe works
+ *  - ALGO_DEFLATE keeps one tdefl/tinfl state (32 KiB window); ALGO_LZ77
+ *    and ALGO_BLOCKWISE gather input into fixed-size chunks and write each
+ *    as self-contained frames
+ *  - memory depends on the algorithm, level and worker count, never on
+ *    the input size
+ *
+ * Stream layout (big-endian):
+ *  - header[8] : "CSTR", version, algorithm, level, reserved
+ *  - DEFLATE   : one zlib stream
+ *  - LZ77, blockwise: frames [algo 1][orig_size 4][comp_size 4][crc32 4]
+ *    [payload], closed by a frame header with orig_size 0
+ *  - trailer[8]: total original size
+ */
+
+#define COMP_STREAM_MAGIC "CSTR"
+#define COMP_STREAM_VERSION 1
+#define COMP_STREAM_HEADER_SIZE 8
+#define COMP_STREAM_FRAME_HEADER 13
+#define COMP_STREAM_TRAILER_SIZE 8
+
+// Input gathered per frame run: LZ77 matches its widest window, blockwise
+// leaves room for several blocks per worker
+#define COMP_STREAM_LZ77_CHUNK (1024 * 1024)
+#define COMP_STREAM_BLOCKWISE_CHUNK (8 * 1024 * 1024)
+// Largest frame a decoder accepts, so a corrupt size cannot grow its buffers
+#define COMP_STREAM_MAX_FRAME COMP_STREAM_BLOCKWISE_CHUNK
+// Read size of comp_stream_file / decomp_stream_file
+#define COMP_STREAM_IO_CHUNK (64 * 1024)
+
+typedef struct CompStream CompStream;
+typedef struct DecompStream DecompStream;
+
+// Start a stream on out (header written at once). algo is ALGO_DEFLATE,
+// ALGO_LZ77 or ALGO_BLOCKWISE; file_type steers blockwise candidates;
+// threads as for compress_file_with_level. NULL on bad parameters or
+// allocation failure.
+CompStream* comp_stream_init(FILE* out, CompressionAlgorithm algo, CompressionLevel level,
+                             FileType file_type, int threads);
+// Add input; output is written whenever a chunk fills
+CompResult comp_stream_feed(CompStream* s, const unsigned char* data, size_t size);
+// Write out everything fed so far and fflush out (costs some ratio)
+CompResult comp_stream_flush(CompStream* s);
+// Close the stream and free s; totals are optional. On error the output
+// is incomplete but s is still freed.
+CompResult comp_stream_finish(CompStream* s, uint64_t* total_in, uint64_t* total_out);
+
+// Decoder: any CSTR stream, output written to out as frames complete
+DecompStream* decomp_stream_init(FILE* out);
+CompResult decomp_stream_feed(DecompStream* s, const unsigned char* data, size_t size);
+// Fails with COMP_ERR_INVALID_FORMAT if the stream ended early; frees s
+CompResult decomp_stream_finish(DecompStream* s, uint64_t* total_out);
+
+// Whole FILE* to FILE* in COMP_STREAM_IO_CHUNK reads; stats is optional
+CompResult comp_stream_file(FILE* in, FILE* out, CompressionAlgorithm algo, CompressionLevel level,
+                            FileType file_type, int threads, CompressionStats* stats);
+CompResult decomp_stream_file(FILE* in, FILE* out, CompressionStats* stats);
+
+#endif /* COMP_STREAM_H */
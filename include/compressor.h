@@ -2,6 +2,7 @@
 #define COMPRESSOR_H
 
 #include "comp_result.h"
+#include "comp_alloc.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -97,35 +98,102 @@ HuffmanNode* create_huffman_node(unsigned char data, unsigned int frequency);
 HuffmanNode* build_huffman_tree(unsigned int* frequencies);
 void generate_huffman_codes(HuffmanNode* root, char codes[256][256], char* current_code, int depth);
 CompResult huffman_compress(const unsigned char* input, long input_size, unsigned char** output, long* output_size);
+long huffman_compress_bound(long input_size);
+size_t huffman_memory_cost(long input_size);
+// Four-stream variant for large blocks; huffman_decompress reads both formats
+#define HUFFMAN_4X_MIN_BLOCK (64 * 1024)
+CompResult huffman_compress_4x(const unsigned char* input, long input_size, unsigned char** output, long* output_size);
 CompResult huffman_decompress(const unsigned char* input, long input_size, unsigned char** output, long* output_size);
+// Into-buffer forms: encoders need dst_cap >= huffman_compress_bound(input_size),
+// the decoder room for the original size; *written receives the bytes produced
+CompResult huffman_compress_into(const unsigned char* input, long input_size, unsigned char* dst, long dst_cap, long* written);
+CompResult huffman_compress_4x_into(const unsigned char* input, long input_size, unsigned char* dst, long dst_cap, long* written);
+CompResult huffman_decompress_into(const unsigned char* input, long input_size, unsigned char* dst, long dst_cap, long* written);
+CompResult huffman_decompress_bitwise(const unsigned char* input, long input_size, unsigned char** output, long* output_size);
+// Optimal code lengths for symbols [0, nsym), nsym <= 258, capped at
+// max_len <= 15 bits; unused symbols get length 0
+void huffman_limited_lengths(const unsigned int* frequencies, int nsym, int max_len, unsigned char* lens);
 void free_huffman_tree(HuffmanNode* root);
 
 // LZ77 compression
 int lz77_compress(const unsigned char* input, long input_size, unsigned char** output, long* output_size);
+int lz77_compress_level(const unsigned char* input, long input_size, unsigned char** output, long* output_size, CompressionLevel level);
+int lz77_compress_reference(const unsigned char* input, long input_size, unsigned char** output, long* output_size);
+// Wide-window v2 stream (64 KiB-1 MiB window by level); lz77_decompress reads v1 and v2
+int lz77_compress_v2(const unsigned char* input, long input_size, unsigned char** output, long* output_size, CompressionLevel level);
 int lz77_decompress(const unsigned char* input, long input_size, unsigned char** output, long* output_size);
+// Into-buffer forms of the v2 encoder (dst_cap >= lz77_compress_bound) and of
+// the decoder (dst_cap >= lz77_decompressed_size, which is -1 for a bad header)
+// The decoder copies in 16-byte chunks and may overwrite any byte of dst up
+// to dst_cap, not only the first *written
+long lz77_compress_bound(long input_size);
+size_t lz77_memory_cost(long input_size);
+size_t lz77_v2_memory_cost(long input_size, CompressionLevel level);
+int lz77_compress_into(const unsigned char* input, long input_size, unsigned char* dst, long dst_cap, long* written, CompressionLevel level);
+// Encoder with its match-finder tables in arena (kept until the arena is reset)
+int lz77_compress_into_arena(const unsigned char* input, long input_size, unsigned char* dst, long dst_cap, long* written, CompressionLevel level, CompArena* arena);
+long lz77_decompressed_size(const unsigned char* input, long input_size);
+int lz77_decompress_into(const unsigned char* input, long input_size, unsigned char* dst, long dst_cap, long* written);
 
 // LZW compression
 int lzw_compress(const unsigned char* input, long input_size, unsigned char** output, long* output_size);
 int lzw_decompress(const unsigned char* input, long input_size, unsigned char** output, long* output_size);
+size_t lzw_memory_cost(long input_size);
+
+// Memory budgets. Each codec's *_memory_cost gives the most bytes its
+// encoder allocates beyond the input; codec_memory_cost picks the one for an
+// algorithm and level. max_memory caps what a compression call allocates,
+// the input buffer included (0 = no limit): the hardcore upgrade is skipped
+// and codecs that would not fit hand over to the blockwise path, whose block
+// size, workers and candidates are chosen to fit. Calls fail with
+// COMP_ERR_MEMORY when not even that fits.
+size_t codec_memory_cost(CompressionAlgorithm algo, CompressionLevel level, long input_size);
 
 // Main compression/decompression functions
 CompResult compress_file(const char* input_path, const char* output_path, CompressionAlgorithm algo, CompressionStats* stats);
-CompResult compress_file_with_level(const char* input_path, const char* output_path, CompressionAlgorithm algo, CompressionLevel level, CompressionStats* stats);
-CompResult compress_file_intelligent(const char* input_path, const char* output_path, CompressionLevel level, CompressionStats* stats);
+// threads: workers for ALGO_BLOCKWISE (<= 0 uses every CPU, 1 runs on the caller)
+CompResult compress_file_with_level(const char* input_path, const char* output_path, CompressionAlgorithm algo, CompressionLevel level, int threads, size_t max_memory, CompressionStats* stats);
+CompResult compress_file_intelligent(const char* input_path, const char* output_path, CompressionLevel level, size_t max_memory, CompressionStats* stats);
 CompResult decompress_file(const char* input_path, const char* output_path, CompressionStats* stats);
 
-// Blockwise intelligent compression (v4 container)
+// Blockwise intelligent compression (seekable v5 container); block
+// boundaries follow changes in the content, and blocks are compressed on
+// `threads` workers and written in order, so the file does not depend on it
 CompResult compress_file_blockwise(const unsigned char* input_buffer, long input_size,
                             const char* output_path, FileType file_type,
-                            CompressionLevel level, CompressionStats* stats);
+                            CompressionLevel level, int threads, size_t max_memory, CompressionStats* stats);
+// Bytes [offset, offset + length) of a v5 blockwise file, decoding only the
+// blocks that cover them; the range is clipped at the end of the data and
+// *output is released with comp_free
+CompResult decompress_file_range(const char* input_path, uint64_t offset, uint64_t length,
+                                 unsigned char** output, long* output_size);
+
+// Building blocks of the blockwise path for callers that bring their own
+// container (see comp_stream.h). A sink receives the blocks of a run in
+// order: the original bytes and the chosen codec's payload; anything but
+// COMP_SUCCESS stops the run.
+struct ThreadPool;
+typedef CompResult (*BlockwiseSink)(void* ctx, const unsigned char* block, long block_size,
+                                    CompressionAlgorithm algo, const unsigned char* payload, long payload_size);
+// Largest block the blockwise path cuts for a file type
+long blockwise_max_block(FileType file_type);
+// Segment and compress one buffer on pool (NULL = the calling thread)
+CompResult blockwise_compress_chunk(const unsigned char* input, long input_size, FileType file_type,
+                                    CompressionLevel level, struct ThreadPool* pool,
+                                    BlockwiseSink sink, void* sink_ctx);
+// Decode one block payload into dst (exactly orig_size bytes)
+CompResult blockwise_decode_block_into(unsigned char algo, const unsigned char* payload, long comp_size,
+                                       unsigned char* dst, long orig_size);
 
 // Advanced audio compression functions
 int audio_compress(const unsigned char* input, long input_size, unsigned char** output, long* output_size, int level);
 int audio_decompress(const unsigned char* input, long input_size, unsigned char** output, long* output_size);
+size_t audio_memory_cost(long input_size);
 
 // Advanced image compression functions
 int image_compress(const unsigned char* input, long input_size, unsigned char** output, long* output_size, int level);
 int image_decompress(const unsigned char* input, long input_size, unsigned char** output, long* output_size);
+size_t image_memory_cost(long input_size);
 
 // Utility functions
 void print_compression_stats(const CompressionStats* stats);
@@ -148,29 +216,30 @@ int delete_file(const char* filepath);
 // Hardcore multi-stage compression (40-60% compression ratio)
 int hardcore_compress(const unsigned char* input, long input_size, unsigned char** output, long* output_size);
 int hardcore_decompress(const unsigned char* input, long input_size, unsigned char** output, long* output_size);
+size_t hardcore_memory_cost(long input_size);
+size_t hardcore_decompress_memory_cost(long original_size);
 
-// BWT+MTF+Huffman optimized compression
+// BWT+MTF+Huffman optimized compression. Inputs larger than
+// BWT_DEFAULT_BLOCK_SIZE are split into independent blocks that are
+// transformed in parallel; the decoder handles both layouts.
+#define BWT_DEFAULT_BLOCK_SIZE (900L * 1024)
 int bwt_mtf_huffman_compress(const unsigned char* input, long input_size, unsigned char** output, long* output_size);
 int bwt_mtf_huffman_decompress(const unsigned char* input, long input_size, unsigned char** output, long* output_size);
-
-// Memory tracking functions
-void* tracked_malloc(size_t size);
-void tracked_free(void* ptr, size_t size);
-
-// Memory pool management functions
-int comp_init_memory_pool(void);
-void comp_cleanup_memory_pool(void);
-void* comp_malloc(size_t size);
-void comp_free(void* ptr);
-void comp_check_leaks(void);
-void comp_panic(const char* message);
-
-// Memory pool macros
-#define COMP_MALLOC(size) comp_malloc(size)
-#define COMP_FREE(ptr) comp_free(ptr)
-
-// Global panic buffer for error recovery
-extern jmp_buf g_panic_buf;
+// threads as for the blocked form below
+size_t bwt_mtf_huffman_memory_cost(long input_size, int threads);
+size_t bwt_mtf_huffman_decode_memory_cost(long original_size);
+// Blocked form with an explicit block size (<= 0 selects the default) and
+// worker count (<= 0 selects one per CPU); the output is the same for any
+// thread count
+int bwt_mtf_huffman_compress_blocks(const unsigned char* input, long input_size, unsigned char** output, long* output_size,
+                                    long block_size, int threads);
+
+// Order-0 rANS entropy coder (four interleaved states, table-driven
+// decode); each 256 KiB chunk is stored, coded with its own table, or
+// coded adaptively, whichever is smallest
+int rans_compress(const unsigned char* input, long input_size, unsigned char** output, long* output_size);
+int rans_decompress(const unsigned char* input, long input_size, unsigned char** output, long* output_size);
+size_t rans_memory_cost(long input_size);
 
 // Optimized decompression
 CompResult huffman_decompress_optimized(const unsigned char* input, long input_size, unsigned char** output, long* output_size);
@@ -0,0 +1,77 @@
+#ifndef RT_IO_H
+#define RT_IO_H
+
+#include <stddef.h>
+#include "comp_input.h"
+
+/*
+ * I/O engine of the realtime server (Linux)
+ *  - built with liburing (HAVE_LIBURING) on a kernel with sparse fixed-file
+ *    tables (5.19+), files are opened straight into the ring's fixed-file
+ *    table and read and written through registered buffers, and socket
+ *    accept/recv/send go through the ring too: an open, read and close is
+ *    one submission. The buffers are registered only when the engine's
+ *    share of RLIMIT_MEMLOCK covers them.
+ *  - otherwise, or when the ring cannot be set up, every call takes the
+ *    blocking path: read/write on the socket, a comp_input mapping for the
+ *    input and an O_DIRECT write for the output
+ *  - inputs are read into RT_IO_SLOTS buffers, so the read of the next
+ *    request can be in flight while the current one is compressed
+ *  - one engine per process or thread; an engine is not thread-safe
+ */
+
+#define RT_IO_SLOTS 2
+// Registered buffer per input slot; larger inputs are mapped instead
+#define RT_IO_INPUT_BUF (1024 * 1024)
+// Registered output buffer, page-aligned so it also suits O_DIRECT
+#define RT_IO_OUTPUT_BUF (2 * 1024 * 1024 + 4096)
+// Longest input path read_begin takes, NUL included
+#define RT_IO_PATH_MAX 4096
+
+typedef struct RtIo RtIo;
+
+/* Create an engine, on io_uring when possible; NULL only if out of memory.
+ * engines is how many the process creates in all, which share the
+ * RLIMIT_MEMLOCK that registered buffers are pinned against. */
+RtIo* rt_io_create(int engines);
+void rt_io_destroy(RtIo* io);
+
+/* "io_uring" or "blocking" */
+const char* rt_io_backend(const RtIo* io);
+
+/* O_DIRECT alignment, and size rounded up to it */
+size_t rt_io_direct_align(void);
+size_t rt_io_direct_size(size_t size);
+
+/* Accept one connection on listen_fd; the new fd, or -1 with errno set */
+int rt_io_accept(RtIo* io, int listen_fd);
+
+/* Make fd the connection used by recv/send/ready (one at a time). The fd
+ * stays owned by the caller; detach before closing it. Detach also waits
+ * for input reads still in flight. */
+int rt_io_attach(RtIo* io, int fd);
+void rt_io_detach(RtIo* io);
+
+/* Exactly len bytes; 0, or -1 on error or EOF */
+int rt_io_recv_full(RtIo* io, void* buf, size_t len);
+int rt_io_send_full(RtIo* io, const void* buf, size_t len);
+
+/* Nonzero when data or EOF is waiting on the connection; never blocks */
+int rt_io_conn_ready(RtIo* io);
+
+/* Queue the read of path into slot (path is copied). read_end waits for it
+ * and fills in: data in the slot's buffer, valid until the slot is reused,
+ * or a mapping for inputs too large for it. Close in with comp_input_close
+ * either way. read_end returns 0, or -1 with errno set. */
+int rt_io_read_begin(RtIo* io, int slot, const char* path);
+int rt_io_read_end(RtIo* io, int slot, CompInput* in);
+
+/* The registered output buffer (RT_IO_OUTPUT_BUF bytes) */
+unsigned char* rt_io_output_buffer(RtIo* io, size_t* cap);
+
+/* Create or truncate path and write size bytes of buf. buf must be aligned
+ * to rt_io_direct_align(); buf_cap >= rt_io_direct_size(size) allows the
+ * blocking path to use O_DIRECT. Returns 0 or -1. */
+int rt_io_write_file(RtIo* io, const char* path, unsigned char* buf, size_t size, size_t buf_cap);
+
+#endif /* RT_IO_H */
@@ -0,0 +1,38 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+/*
+ * Fixed-size worker pool (pthreads)
+ *  - tasks run in submission order on whichever worker is free
+ *  - thread_pool_parallel_for splits an index range across the workers and
+ *    the calling thread, so it is safe to call from inside a task
+ *  - a NULL pool runs everything on the calling thread
+ */
+
+typedef struct ThreadPool ThreadPool;
+
+typedef void (*ThreadPoolTask)(void* arg);
+typedef void (*ThreadPoolForFn)(void* ctx, long index);
+
+/* Number of online CPUs (at least 1) */
+int thread_pool_cpu_count(void);
+
+/* Create a pool with num_threads workers (<= 0 selects thread_pool_cpu_count) */
+ThreadPool* thread_pool_create(int num_threads);
+
+/* Wait for queued tasks, stop the workers and free the pool */
+void thread_pool_destroy(ThreadPool* pool);
+
+/* Number of workers */
+int thread_pool_size(const ThreadPool* pool);
+
+/* Queue fn(arg); returns 0 on success, -1 if the task could not be queued */
+int thread_pool_submit(ThreadPool* pool, ThreadPoolTask fn, void* arg);
+
+/* Block until every task submitted so far has finished */
+void thread_pool_wait(ThreadPool* pool);
+
+/* Run fn(ctx, i) for i in [0, count) and return when all calls are done */
+void thread_pool_parallel_for(ThreadPool* pool, long count, ThreadPoolForFn fn, void* ctx);
+
+#endif /* THREAD_POOL_H */
@@ -80,7 +80,7 @@ int compress_audio_advanced(const unsigned char* input, long input_size,
     
     // Allocate output buffer
     long max_output_size = input_size + 1024; // Header + compressed data
-    *output = (unsigned char*)malloc(max_output_size);
+    *output = (unsigned char*)comp_malloc(max_output_size);
     *output_size = 0;
     
     // Write compression header
@@ -182,7 +182,7 @@ int decompress_audio_advanced(const unsigned char* input, long input_size,
     
     // Allocate output buffer
     *output_size = sizeof(WAVHeader) + header->data_size * 2; // Estimate
-    *output = (unsigned char*)malloc(*output_size);
+    *output = (unsigned char*)comp_malloc(*output_size);
     
     // Copy WAV header
     memcpy(*output, header, sizeof(WAVHeader));
@@ -248,6 +248,12 @@ int audio_compress(const unsigned char* input, long input_size,
                                  (AudioCompressionLevel)level);
 }
 
+// Peak bytes audio_compress allocates beyond the input (its output buffer)
+size_t audio_memory_cost(long input_size) {
+    if (input_size <= 0) return 0;
+    return (size_t)input_size + 1024;
+}
+
 // Main audio decompression interface
 int audio_decompress(const unsigned char* input, long input_size,
                     unsigned char** output, long* output_size) {
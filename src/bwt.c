@@ -1,61 +1,304 @@
 // BWT + MTF + Huffman pipeline implementation (lossless)
 #include "../include/compressor.h"
+#include "../include/thread_pool.h"
+#include "mtf.h"
 
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-// Simple suffix comparator for BWT (rotation-based)
-typedef struct {
-    const unsigned char* data;
-    long n;
-    long idx;
-} Suffix;
-
-static int suffix_cmp(const void* a, const void* b) {
-    const Suffix* sa = (const Suffix*)a;
-    const Suffix* sb = (const Suffix*)b;
-    long n = sa->n;
-    long ia = sa->idx;
-    long ib = sb->idx;
-    for (long k = 0; k < n; ++k) {
-        unsigned char ca = sa->data[(ia + k) % n];
-        unsigned char cb = sb->data[(ib + k) % n];
-        if (ca < cb) return -1;
-        if (ca > cb) return 1;
+// ===== Suffix array construction (SA-IS) =====
+// Nong, Zhang & Chan's induced sorting: classify suffixes as S/L type, sort
+// the LMS substrings by induction, recurse on their names if they are not
+// unique, then induce the full order from the sorted LMS suffixes. Text
+// symbols are read through sais_chr so one routine serves the 16-bit level-0
+// text (bytes + 1, sentinel 0) and the 32-bit reduced strings.
+
+#define SAIS_TGET(t, i) (((t)[(i) >> 3] >> ((i) & 7)) & 1)
+#define SAIS_TSET(t, i, b) ((b) ? ((t)[(i) >> 3] |= (unsigned char)(1 << ((i) & 7))) \
+                                : ((t)[(i) >> 3] &= (unsigned char)~(1 << ((i) & 7))))
+#define SAIS_IS_LMS(t, i) ((i) > 0 && SAIS_TGET(t, i) && !SAIS_TGET(t, (i) - 1))
+
+static inline int32_t sais_chr(const void* s, int cs, int32_t i) {
+    return (cs == 2) ? (int32_t)((const uint16_t*)s)[i] : ((const int32_t*)s)[i];
+}
+
+static void sais_buckets(const void* s, int cs, int32_t* bkt, int32_t n, int32_t k, int end) {
+    int32_t sum = 0;
+    memset(bkt, 0, sizeof(int32_t) * (k + 1));
+    for (int32_t i = 0; i < n; i++) bkt[sais_chr(s, cs, i)]++;
+    for (int32_t i = 0; i <= k; i++) {
+        sum += bkt[i];
+        bkt[i] = end ? sum : sum - bkt[i];
+    }
+}
+
+static void sais_induce_l(const unsigned char* t, int32_t* sa, const void* s, int cs, int32_t* bkt, int32_t n, int32_t k) {
+    sais_buckets(s, cs, bkt, n, k, 0);
+    for (int32_t i = 0; i < n; i++) {
+        int32_t j = sa[i] - 1;
+        if (j >= 0 && !SAIS_TGET(t, j)) sa[bkt[sais_chr(s, cs, j)]++] = j;
+    }
+}
+
+static void sais_induce_s(const unsigned char* t, int32_t* sa, const void* s, int cs, int32_t* bkt, int32_t n, int32_t k) {
+    sais_buckets(s, cs, bkt, n, k, 1);
+    for (int32_t i = n - 1; i >= 0; i--) {
+        int32_t j = sa[i] - 1;
+        if (j >= 0 && SAIS_TGET(t, j)) sa[--bkt[sais_chr(s, cs, j)]] = j;
+    }
+}
+
+// Suffix array of s[0..n), whose last symbol is a unique smallest sentinel 0;
+// symbols are in [0, k]. Scratch comes from arena and lives until its reset.
+static int sais_core(const void* s, int cs, int32_t* sa, int32_t n, int32_t k, CompArena* arena) {
+    unsigned char* t = (unsigned char*)comp_arena_alloc(arena, (size_t)n / 8 + 1);
+    int32_t* bkt = (int32_t*)comp_arena_alloc(arena, sizeof(int32_t) * (k + 1));
+    if (!t || !bkt) return -1;
+    memset(t, 0, (size_t)n / 8 + 1);
+
+    // Classify: the sentinel is S, the symbol before it L
+    SAIS_TSET(t, n - 1, 1);
+    if (n >= 2) SAIS_TSET(t, n - 2, 0);
+    for (int32_t i = n - 3; i >= 0; i--) {
+        int32_t a = sais_chr(s, cs, i), b = sais_chr(s, cs, i + 1);
+        SAIS_TSET(t, i, (a < b || (a == b && SAIS_TGET(t, i + 1))));
+    }
+
+    // Stage 1: sort LMS substrings by induction
+    sais_buckets(s, cs, bkt, n, k, 1);
+    for (int32_t i = 0; i < n; i++) sa[i] = -1;
+    for (int32_t i = 1; i < n; i++) {
+        if (SAIS_IS_LMS(t, i)) sa[--bkt[sais_chr(s, cs, i)]] = i;
+    }
+    sais_induce_l(t, sa, s, cs, bkt, n, k);
+    sais_induce_s(t, sa, s, cs, bkt, n, k);
+
+    // Compact the sorted LMS substrings and name them
+    int32_t n1 = 0;
+    for (int32_t i = 0; i < n; i++) {
+        if (SAIS_IS_LMS(t, sa[i])) sa[n1++] = sa[i];
+    }
+    for (int32_t i = n1; i < n; i++) sa[i] = -1;
+    int32_t name = 0, prev = -1;
+    for (int32_t i = 0; i < n1; i++) {
+        int32_t pos = sa[i];
+        int diff = 0;
+        for (int32_t d = 0; d < n; d++) {
+            if (prev == -1 || sais_chr(s, cs, pos + d) != sais_chr(s, cs, prev + d) ||
+                SAIS_TGET(t, pos + d) != SAIS_TGET(t, prev + d)) {
+                diff = 1;
+                break;
+            }
+            if (d > 0 && (SAIS_IS_LMS(t, pos + d) || SAIS_IS_LMS(t, prev + d))) break;
+        }
+        if (diff) { name++; prev = pos; }
+        sa[n1 + pos / 2] = name - 1;
+    }
+    for (int32_t i = n - 1, j = n - 1; i >= n1; i--) {
+        if (sa[i] >= 0) sa[j--] = sa[i];
+    }
+
+    // Stage 2: order the LMS suffixes, recursing while names repeat
+    int32_t* sa1 = sa;
+    int32_t* s1 = sa + n - n1;
+    if (name < n1) {
+        if (sais_core(s1, 4, sa1, n1, name - 1, arena) != 0) return -1;
+    } else {
+        for (int32_t i = 0; i < n1; i++) sa1[s1[i]] = i;
+    }
+
+    // Stage 3: induce the full suffix array from the sorted LMS suffixes
+    sais_buckets(s, cs, bkt, n, k, 1);
+    for (int32_t i = 1, j = 0; i < n; i++) {
+        if (SAIS_IS_LMS(t, i)) s1[j++] = i;
+    }
+    for (int32_t i = 0; i < n1; i++) sa1[i] = s1[sa1[i]];
+    for (int32_t i = n1; i < n; i++) sa[i] = -1;
+    for (int32_t i = n1 - 1; i >= 0; i--) {
+        int32_t j = sa[i];
+        sa[i] = -1;
+        sa[--bkt[sais_chr(s, cs, j)]] = j;
     }
+    sais_induce_l(t, sa, s, cs, bkt, n, k);
+    sais_induce_s(t, sa, s, cs, bkt, n, k);
     return 0;
 }
 
-// Burrows-Wheeler Transform
-static int bwt_transform_impl(const unsigned char* in, long n, unsigned char** out, long* out_n, long* primary_index) {
-    if (n <= 0) return -1;
-    Suffix* sa = (Suffix*)tracked_malloc(sizeof(Suffix) * n);
-    if (!sa) return -1;
-    for (long i = 0; i < n; ++i) {
-        sa[i].data = in;
-        sa[i].n = n;
-        sa[i].idx = i;
+// Primary indices with this bit set mark the sentinel BWT below; older
+// streams hold a rotation BWT and a plain index
+#define BWT_SENTINEL_FLAG 0x80000000L
+// Set when the primary index is followed by a stream count byte and the
+// start rows of streams 1..count-1 (BE32 each)
+#define BWT_STREAMS_FLAG 0x40000000L
+
+// Independent LF walks the decoder can interleave. Stream k starts at
+// input offset k * ceil(n / streams); small blocks use a single walk.
+#define BWT_MAX_STREAMS 8
+#define BWT_STREAMS 4
+#define BWT_STREAMS_MIN_BLOCK (64L * 1024)
+
+// Largest block the block stream and the run coder accept
+#define BWT_MAX_BLOCK_SIZE (64L * 1024 * 1024)
+
+// Rows that fit the packed inverse: (next row << 8) | symbol in 32 bits
+#define BWT_PACKED_MAX_ROWS (1L << 24)
+
+// Burrows-Wheeler Transform of in + sentinel via its suffix array. The
+// sentinel's row is left out of L; *primary_index is that row (1..n),
+// tagged with BWT_SENTINEL_FLAG. starts[k] receives the row of the suffix
+// at offset k * ceil(n / streams) (starts[0] is the primary row).
+static int bwt_transform_impl(const unsigned char* in, long n, unsigned char** out, long* out_n, long* primary_index,
+                              long* starts, int streams) {
+    if (n <= 0 || n >= INT32_MAX - 1) return -1;
+    int32_t m = (int32_t)n + 1;
+    // One arena holds the text, the suffix array and every SA-IS level's
+    // scratch; its first chunk is sized so the common case needs no second
+    CompArena* arena = comp_arena_create((sizeof(uint16_t) + sizeof(int32_t)) * (size_t)m + (size_t)m / 4 + 4096);
+    uint16_t* text = arena ? (uint16_t*)comp_arena_alloc(arena, sizeof(uint16_t) * m) : NULL;
+    int32_t* sa = arena ? (int32_t*)comp_arena_alloc(arena, sizeof(int32_t) * m) : NULL;
+    unsigned char* L = (unsigned char*)comp_malloc(n);
+    if (!text || !sa || !L) {
+        comp_arena_destroy(arena);
+        if (L) comp_free(L);
+        return -1;
+    }
+    for (long i = 0; i < n; ++i) text[i] = (uint16_t)(in[i] + 1);
+    text[n] = 0;
+    if (sais_core(text, 2, sa, m, 256, arena) != 0) {
+        comp_arena_destroy(arena);
+        comp_free(L);
+        return -1;
     }
-    qsort(sa, n, sizeof(Suffix), suffix_cmp);
 
-    unsigned char* L = (unsigned char*)tracked_malloc(n);
-    if (!L) { tracked_free(sa, sizeof(Suffix) * n); return -1; }
-    *primary_index = -1;
-    for (long i = 0; i < n; ++i) {
-        long j = sa[i].idx;
-        long prev = (j + n - 1) % n;
-        L[i] = in[prev];
-        if (j == 0) *primary_index = i;
+    // Row 0 is the sentinel suffix, preceded by the last input byte
+    long pos = 0;
+    long primary = -1;
+    long seg = (n + streams - 1) / streams;
+    for (int32_t r = 0; r < m; ++r) {
+        int32_t j = sa[r];
+        if (j == 0) {
+            primary = r;
+            continue;
+        }
+        if (streams > 1 && j < n && j % seg == 0) starts[j / seg] = r;
+        L[pos++] = in[j - 1];
     }
-    if (*primary_index < 0) { tracked_free(L, n); tracked_free(sa, sizeof(Suffix) * n); return -1; }
+    starts[0] = primary;
+    comp_arena_destroy(arena);
     *out = L;
     *out_n = n;
-    tracked_free(sa, sizeof(Suffix) * n);
+    *primary_index = primary | BWT_SENTINEL_FLAG;
+    return 0;
+}
+
+// Inverse of the sentinel BWT: L is the last column of the n + 1 sorted
+// suffixes with the sentinel's entry (row primary) removed
+static int bwt_inverse_sentinel(const unsigned char* L, long n, long primary, unsigned char** out, long* out_n) {
+    if (n <= 0 || primary < 1 || primary > n) return -1;
+    long count[256];
+    memset(count, 0, sizeof(count));
+    for (long i = 0; i < n; ++i) count[L[i]]++;
+    long start[256];
+    long sum = 1;   // the sentinel sorts first
+    for (int c = 0; c < 256; ++c) { start[c] = sum; sum += count[c]; }
+
+    // LF over the n + 1 rows; row primary holds the sentinel and is never visited
+    int32_t* T = (int32_t*)COMP_MALLOC(sizeof(int32_t) * (n + 1));
+    if (!T) return -1;
+    for (long r = 0, i = 0; r <= n; ++r) {
+        if (r == primary) continue;
+        T[r] = (int32_t)start[L[i]]++;
+        i++;
+    }
+
+    unsigned char* outbuf = (unsigned char*)comp_malloc(n);
+    if (!outbuf) { COMP_FREE(T); return -1; }
+    long r = 0;
+    for (long k = n - 1; k >= 0; --k) {
+        if (r == primary) { comp_free(outbuf); COMP_FREE(T); return -1; }
+        outbuf[k] = L[r < primary ? r : r - 1];
+        r = T[r];
+    }
+    COMP_FREE(T);
+    *out = outbuf;
+    *out_n = n;
     return 0;
 }
 
-// Inverse BWT using LF-mapping
+// Packed inverse of the sentinel BWT for blocks below BWT_PACKED_MAX_ROWS.
+// Walking forward from a suffix's row, the next suffix's row is where the
+// same occurrence of its first symbol sits in L, so each row stores
+// (next row << 8) | first symbol and one load yields both the output byte
+// and the next position. The streams walks start at starts[] and are
+// stepped in lockstep so their cache misses overlap.
+static int bwt_inverse_packed(const unsigned char* L, long n, const long* starts, int streams,
+                              unsigned char** out, long* out_n) {
+    long primary = starts[0];
+    long count[256];
+    memset(count, 0, sizeof(count));
+    for (long i = 0; i < n; ++i) count[L[i]]++;
+    long start[256];
+    long sum = 1;   // row 0 holds the sentinel suffix and is never visited
+    for (int c = 0; c < 256; ++c) { start[c] = sum; sum += count[c]; }
+
+    uint32_t* T = (uint32_t*)COMP_MALLOC(sizeof(uint32_t) * (n + 1));
+    if (!T) return -1;
+    T[0] = 0;
+    for (long r = 0, i = 0; r <= n; ++r) {
+        if (r == primary) continue;
+        unsigned char c = L[i++];
+        T[start[c]++] = ((uint32_t)r << 8) | c;
+    }
+
+    unsigned char* outbuf = (unsigned char*)comp_malloc(n);
+    if (!outbuf) { COMP_FREE(T); return -1; }
+
+    long seg = (n + streams - 1) / streams;
+    uint32_t row[BWT_MAX_STREAMS];
+    unsigned char* dst[BWT_MAX_STREAMS];
+    for (int k = 0; k < streams; ++k) {
+        row[k] = (uint32_t)starts[k];
+        dst[k] = outbuf + k * seg;
+    }
+    // Every stream but the last is seg bytes long; the last is shortest
+    long common = n - (long)(streams - 1) * seg;
+    if (streams == 4) {
+        uint32_t r0 = row[0], r1 = row[1], r2 = row[2], r3 = row[3];
+        for (long i = 0; i < common; ++i) {
+            uint32_t e0 = T[r0], e1 = T[r1], e2 = T[r2], e3 = T[r3];
+            dst[0][i] = (unsigned char)e0; r0 = e0 >> 8;
+            dst[1][i] = (unsigned char)e1; r1 = e1 >> 8;
+            dst[2][i] = (unsigned char)e2; r2 = e2 >> 8;
+            dst[3][i] = (unsigned char)e3; r3 = e3 >> 8;
+        }
+        row[0] = r0; row[1] = r1; row[2] = r2; row[3] = r3;
+    } else {
+        for (long i = 0; i < common; ++i) {
+            for (int k = 0; k < streams; ++k) {
+                uint32_t e = T[row[k]];
+                dst[k][i] = (unsigned char)e;
+                row[k] = e >> 8;
+            }
+        }
+    }
+    for (int k = 0; k < streams - 1; ++k) {
+        uint32_t r = row[k];
+        for (long i = common; i < seg; ++i) {
+            uint32_t e = T[r];
+            dst[k][i] = (unsigned char)e;
+            r = e >> 8;
+        }
+    }
+    COMP_FREE(T);
+    *out = outbuf;
+    *out_n = n;
+    return 0;
+}
+
+// Inverse rotation BWT using LF-mapping (streams written before the
+// sentinel transform)
 static int bwt_inverse_impl(const unsigned char* L, long n, long primary_index, unsigned char** out, long* out_n) {
     if (n <= 0 || primary_index < 0 || primary_index >= n) return -1;
     int count[256];
@@ -68,15 +311,15 @@ static int bwt_inverse_impl(const unsigned char* L, long n, long primary_index,
 
     int occ[256];
     memset(occ, 0, sizeof(occ));
-    int* T = (int*)tracked_malloc(sizeof(int) * n);
+    int* T = (int*)COMP_MALLOC(sizeof(int) * n);
     if (!T) return -1;
     for (long i = 0; i < n; ++i) {
         unsigned char c = L[i];
         T[i] = start[c] + occ[c]++; // LF-mapping
     }
 
-    unsigned char* outbuf = (unsigned char*)tracked_malloc(n);
-    if (!outbuf) { tracked_free(T, sizeof(int) * n); return -1; }
+    unsigned char* outbuf = (unsigned char*)comp_malloc(n);
+    if (!outbuf) { COMP_FREE(T); return -1; }
     long p = primary_index;
     for (long i = n - 1; i >= 0; --i) { // reconstruct original
         outbuf[i] = L[p];
@@ -85,106 +328,723 @@ static int bwt_inverse_impl(const unsigned char* L, long n, long primary_index,
 
     *out = outbuf;
     *out_n = n;
-    tracked_free(T, sizeof(int) * n);
+    COMP_FREE(T);
     return 0;
 }
 
-// Move-To-Front encode
-static int mtf_encode_impl(const unsigned char* in, long n, unsigned char** out, long* out_n) {
-    unsigned char list[256];
-    for (int i = 0; i < 256; ++i) list[i] = (unsigned char)i;
-    unsigned char* enc = (unsigned char*)tracked_malloc(n);
-    if (!enc) return -1;
-    for (long i = 0; i < n; ++i) {
-        unsigned char c = in[i];
-        int idx = 0;
-        while (list[idx] != c) idx++;
-        enc[i] = (unsigned char)idx;
-        // move to front
-        memmove(&list[1], &list[0], idx);
-        list[0] = c;
-    }
-    *out = enc;
+// Move-To-Front decode (Huffman-coded blocks written before the run coder)
+static int mtf_decode_impl(const unsigned char* in, long n, unsigned char** out, long* out_n) {
+    unsigned char* dec = (unsigned char*)comp_malloc(n);
+    if (!dec) return -1;
+    mtf_decode_bytes(in, n, dec);
+    *out = dec;
     *out_n = n;
     return 0;
 }
 
-// Move-To-Front decode
-static int mtf_decode_impl(const unsigned char* in, long n, unsigned char** out, long* out_n) {
+static void put_be32(unsigned char* p, unsigned long v) {
+    p[0] = (unsigned char)(v >> 24);
+    p[1] = (unsigned char)(v >> 16);
+    p[2] = (unsigned char)(v >> 8);
+    p[3] = (unsigned char)v;
+}
+
+static unsigned long get_be32(const unsigned char* p) {
+    return ((unsigned long)p[0] << 24) | ((unsigned long)p[1] << 16) | ((unsigned long)p[2] << 8) | p[3];
+}
+
+// Primary index (BE32) followed, when BWT_STREAMS_FLAG is set, by the stream
+// count and the start rows of streams 1..count-1 (BE32 each)
+static long bwt_put_primary(unsigned char* out, long primary_idx, const long* starts, int streams) {
+    if (streams <= 1) {
+        put_be32(out, (unsigned long)primary_idx);
+        return 4;
+    }
+    put_be32(out, (unsigned long)(primary_idx | BWT_STREAMS_FLAG));
+    out[4] = (unsigned char)streams;
+    for (int k = 1; k < streams; ++k) put_be32(out + 5 + 4 * (k - 1), (unsigned long)starts[k]);
+    return 5 + 4L * (streams - 1);
+}
+
+// Returns the bytes consumed, or -1; *primary_idx keeps BWT_SENTINEL_FLAG
+static long bwt_get_primary(const unsigned char* in, long size, long* primary_idx, long* starts, int* streams) {
+    if (size < 4) return -1;
+    long primary = (long)get_be32(in);
+    long head = 4;
+    *streams = 1;
+    if ((primary & BWT_SENTINEL_FLAG) && (primary & BWT_STREAMS_FLAG)) {
+        if (size < 5) return -1;
+        int count = in[4];
+        head = 5 + 4L * (count - 1);
+        if (count < 2 || count > BWT_MAX_STREAMS || size < head) return -1;
+        for (int k = 1; k < count; ++k) starts[k] = (long)get_be32(in + 5 + 4 * (k - 1));
+        primary &= ~BWT_STREAMS_FLAG;
+        *streams = count;
+    }
+    starts[0] = primary & ~BWT_SENTINEL_FLAG;
+    *primary_idx = primary;
+    return head;
+}
+
+// Undo the transform with whichever inverse fits the block
+static int bwt_invert(const unsigned char* L, long n, long primary_idx, const long* starts, int streams,
+                      unsigned char** out, long* out_n) {
+    // Every stream must cover at least one byte
+    int packed = (primary_idx & BWT_SENTINEL_FLAG) && n < BWT_PACKED_MAX_ROWS - 1 &&
+                 (long)(streams - 1) * ((n + streams - 1) / streams) < n;
+    for (int k = 0; k < streams && packed; ++k) {
+        if (starts[k] < 1 || starts[k] > n) packed = 0;
+    }
+    if (packed) return bwt_inverse_packed(L, n, starts, streams, out, out_n);
+    if (streams != 1) return -1;
+    return (primary_idx & BWT_SENTINEL_FLAG)
+        ? bwt_inverse_sentinel(L, n, starts[0], out, out_n)
+        : bwt_inverse_impl(L, n, primary_idx, out, out_n);
+}
+
+// ===== Run-length + multi-table Huffman block coding =====
+// bzip2-style entropy stage for the MTF ranks. MTF runs over the bytes that
+// occur in the block, runs of rank 0 become RUNA/RUNB digits (bijective
+// base 2, least significant first) and rank r >= 1 becomes symbol r + 1.
+// Symbols are coded in groups of 50, each with whichever of 2-6 Huffman
+// tables is cheapest for it:
+//   "BWR1" | block size (BE32) | primary index [+ stream starts]
+//   | symbol count (BE32) | used-byte bitmap (32 bytes) | table count
+//   | bits: per table a 5-bit first length then delta-coded lengths
+//     (10 = +1, 11 = -1, 0 = next symbol); one unary MTF-coded selector
+//     per group; the symbols
+
+#define BWT_RUN_MAGIC "BWR1"
+#define BWT_RUNA 0
+#define BWT_RUNB 1
+#define BWT_GROUP_SIZE 50
+#define BWT_MAX_TABLES 6
+#define BWT_TABLE_ITERS 4
+#define BWT_CODE_MAX_LEN 15
+#define BWT_MAX_ALPHA 257
+#define BWT_LOOKUP_BITS 10
+
+typedef struct {
+    unsigned char* out;
+    long pos;
+    uint64_t acc;
+    int bits;
+} BWTBitWriter;
+
+// MSB-first; n <= 32
+static inline void bwt_put_bits(BWTBitWriter* bw, uint32_t v, int n) {
+    bw->acc = (bw->acc << n) | v;
+    bw->bits += n;
+    while (bw->bits >= 8) {
+        bw->bits -= 8;
+        bw->out[bw->pos++] = (unsigned char)(bw->acc >> bw->bits);
+    }
+}
+
+typedef struct {
+    const unsigned char* in;
+    long pos;
+    long size;
+    uint64_t acc;   // next bits left-aligned
+    int bits;
+} BWTBitReader;
+
+// Reads past the end yield zeros; bwt_bits_overrun reports them
+static inline void bwt_refill(BWTBitReader* br) {
+    while (br->bits <= 56) {
+        uint64_t b = br->pos < br->size ? br->in[br->pos] : 0;
+        br->pos++;
+        br->acc |= b << (56 - br->bits);
+        br->bits += 8;
+    }
+}
+
+static inline uint32_t bwt_get_bits(BWTBitReader* br, int n) {
+    if (br->bits < n) bwt_refill(br);
+    uint32_t v = (uint32_t)(br->acc >> (64 - n));
+    br->acc <<= n;
+    br->bits -= n;
+    return v;
+}
+
+static inline int bwt_bits_overrun(const BWTBitReader* br) {
+    return br->pos * 8 - br->bits > br->size * 8;
+}
+
+// Append a run of `run` rank-0 symbols
+static long bwt_put_run(uint16_t* syms, long nsyms, long run) {
+    run--;
+    for (;;) {
+        syms[nsyms++] = (run & 1) ? BWT_RUNB : BWT_RUNA;
+        if (run < 2) break;
+        run = (run - 2) >> 1;
+    }
+    return nsyms;
+}
+
+static void bwt_canonical_codes(const unsigned char* lens, int alpha, uint32_t* codes) {
+    int count[BWT_CODE_MAX_LEN + 1] = {0};
+    uint32_t next[BWT_CODE_MAX_LEN + 1];
+    for (int s = 0; s < alpha; ++s) count[lens[s]]++;
+    count[0] = 0;
+    uint32_t code = 0;
+    for (int len = 1; len <= BWT_CODE_MAX_LEN; ++len) {
+        code = (code + count[len - 1]) << 1;
+        next[len] = code;
+    }
+    for (int s = 0; s < alpha; ++s) codes[s] = lens[s] ? next[lens[s]]++ : 0;
+}
+
+// Pick selectors and table lengths: start from tables that each favour a
+// slice of the alphabet with about equal total frequency, then alternately
+// assign every group to its cheapest table and rebuild the tables from
+// the groups they won
+static void bwt_build_tables(const uint16_t* syms, long nsyms, int alpha, int nt,
+                             unsigned char lens[][BWT_MAX_ALPHA], unsigned char* sel) {
+    unsigned int total[BWT_MAX_ALPHA];
+    memset(total, 0, sizeof(total));
+    for (long i = 0; i < nsyms; ++i) total[syms[i]]++;
+
+    long remaining = nsyms;
+    int lo = 0;
+    for (int t = nt; t > 0; --t) {
+        long target = remaining / t;
+        long acc = 0;
+        int hi = lo - 1;
+        while (acc < target && hi < alpha - 1) acc += total[++hi];
+        if (hi > lo && t != nt && t != 1 && ((nt - t) & 1)) acc -= total[hi--];
+        for (int s = 0; s < alpha; ++s) lens[nt - t][s] = (s >= lo && s <= hi) ? 0 : BWT_CODE_MAX_LEN;
+        lo = hi + 1;
+        remaining -= acc;
+    }
+
+    unsigned int freq[BWT_MAX_TABLES][BWT_MAX_ALPHA];
+    long ngroups = (nsyms + BWT_GROUP_SIZE - 1) / BWT_GROUP_SIZE;
+    for (int iter = 0; iter < BWT_TABLE_ITERS; ++iter) {
+        memset(freq, 0, sizeof(freq));
+        for (long g = 0; g < ngroups; ++g) {
+            long start = g * BWT_GROUP_SIZE;
+            long end = start + BWT_GROUP_SIZE < nsyms ? start + BWT_GROUP_SIZE : nsyms;
+            unsigned int cost[BWT_MAX_TABLES] = {0};
+            for (long i = start; i < end; ++i) {
+                for (int t = 0; t < nt; ++t) cost[t] += lens[t][syms[i]];
+            }
+            int best = 0;
+            for (int t = 1; t < nt; ++t) {
+                if (cost[t] < cost[best]) best = t;
+            }
+            sel[g] = (unsigned char)best;
+            for (long i = start; i < end; ++i) freq[best][syms[i]]++;
+        }
+        // Every symbol keeps a code so any table can code any group
+        for (int t = 0; t < nt; ++t) {
+            for (int s = 0; s < alpha; ++s) {
+                if (freq[t][s] == 0) freq[t][s] = 1;
+            }
+            huffman_limited_lengths(freq[t], alpha, BWT_CODE_MAX_LEN, lens[t]);
+        }
+    }
+}
+
+// One BWT block, run-length and multi-table Huffman coded (format above)
+static int bwt_block_compress(const unsigned char* input, long input_size, unsigned char** output, long* output_size) {
+    unsigned char* L;
+    long n;
+    long primary_idx;
+    long starts[BWT_MAX_STREAMS];
+    int streams = (input_size >= BWT_STREAMS_MIN_BLOCK && input_size < BWT_PACKED_MAX_ROWS) ? BWT_STREAMS : 1;
+    if (bwt_transform_impl(input, input_size, &L, &n, &primary_idx, starts, streams) != 0) return -1;
+
+    // MTF runs over the bytes present, so ranks stay below their count
+    unsigned char used[256];
     unsigned char list[256];
-    for (int i = 0; i < 256; ++i) list[i] = (unsigned char)i;
-    unsigned char* dec = (unsigned char*)tracked_malloc(n);
-    if (!dec) return -1;
+    memset(used, 0, sizeof(used));
+    memset(list, 0, sizeof(list));
+    for (long i = 0; i < n; ++i) used[L[i]] = 1;
+    int nuse = 0;
+    for (int c = 0; c < 256; ++c) {
+        if (used[c]) list[nuse++] = (unsigned char)c;
+    }
+    int alpha = nuse + 1;   // RUNA, RUNB, ranks 1..nuse-1
+
+    uint16_t* syms = (uint16_t*)comp_malloc(sizeof(uint16_t) * (size_t)n);
+    long nsyms = 0;
+    if (!syms) { comp_free(L); return -1; }
+    long run = 0;
     for (long i = 0; i < n; ++i) {
-        int idx = in[i];
-        unsigned char c = list[idx];
-        dec[i] = c;
-        memmove(&list[1], &list[0], idx);
-        list[0] = c;
+        unsigned char c = L[i];
+        if (list[0] == c) {
+            run++;
+            continue;
+        }
+        if (run) {
+            nsyms = bwt_put_run(syms, nsyms, run);
+            run = 0;
+        }
+        int rank = mtf_find_rank(list, c);
+        mtf_promote(list, rank);
+        syms[nsyms++] = (uint16_t)(rank + 1);
     }
-    *out = dec;
-    *out_n = n;
+    if (run) nsyms = bwt_put_run(syms, nsyms, run);
+    comp_free(L);
+
+    int nt = nsyms < 200 ? 2 : nsyms < 600 ? 3 : nsyms < 1200 ? 4 : nsyms < 2400 ? 5 : 6;
+    long ngroups = (nsyms + BWT_GROUP_SIZE - 1) / BWT_GROUP_SIZE;
+    unsigned char lens[BWT_MAX_TABLES][BWT_MAX_ALPHA];
+    unsigned char* sel = (unsigned char*)comp_malloc((size_t)ngroups);
+    // Header, lengths (< 30 bits per symbol per table), unary selectors and
+    // codes of at most 15 bits
+    long cap = 80 + BWT_MAX_TABLES * 1000 + ngroups + nsyms * 2;
+    unsigned char* out = (unsigned char*)comp_malloc((size_t)cap);
+    if (!sel || !out) { comp_free(syms); comp_free(sel); comp_free(out); return -1; }
+    bwt_build_tables(syms, nsyms, alpha, nt, lens, sel);
+
+    memcpy(out, BWT_RUN_MAGIC, 4);
+    put_be32(out + 4, (unsigned long)n);
+    long pos = 8 + bwt_put_primary(out + 8, primary_idx, starts, streams);
+    put_be32(out + pos, (unsigned long)nsyms);
+    pos += 4;
+    for (int b = 0; b < 32; ++b) {
+        unsigned char bits = 0;
+        for (int k = 0; k < 8; ++k) bits = (unsigned char)(bits | (used[b * 8 + k] << k));
+        out[pos++] = bits;
+    }
+    out[pos++] = (unsigned char)nt;
+
+    BWTBitWriter bw = { out, pos, 0, 0 };
+    uint32_t codes[BWT_MAX_TABLES][BWT_MAX_ALPHA];
+    for (int t = 0; t < nt; ++t) {
+        int cur = lens[t][0];
+        bwt_put_bits(&bw, (uint32_t)cur, 5);
+        for (int s = 0; s < alpha; ++s) {
+            while (cur < lens[t][s]) { bwt_put_bits(&bw, 2, 2); cur++; }
+            while (cur > lens[t][s]) { bwt_put_bits(&bw, 3, 2); cur--; }
+            bwt_put_bits(&bw, 0, 1);
+        }
+        bwt_canonical_codes(lens[t], alpha, codes[t]);
+    }
+    unsigned char sel_list[BWT_MAX_TABLES];
+    for (int t = 0; t < BWT_MAX_TABLES; ++t) sel_list[t] = (unsigned char)t;
+    for (long g = 0; g < ngroups; ++g) {
+        int r = 0;
+        while (sel_list[r] != sel[g]) r++;
+        mtf_promote(sel_list, r);
+        bwt_put_bits(&bw, ((1u << r) - 1) << 1, r + 1);
+    }
+    for (long g = 0; g < ngroups; ++g) {
+        const unsigned char* len = lens[sel[g]];
+        const uint32_t* code = codes[sel[g]];
+        long end = (g + 1) * BWT_GROUP_SIZE < nsyms ? (g + 1) * BWT_GROUP_SIZE : nsyms;
+        for (long i = g * BWT_GROUP_SIZE; i < end; ++i) bwt_put_bits(&bw, code[syms[i]], len[syms[i]]);
+    }
+    if (bw.bits > 0) out[bw.pos++] = (unsigned char)(bw.acc << (8 - bw.bits));
+    comp_free(syms);
+    comp_free(sel);
+
+    *output = out;
+    *output_size = bw.pos;
     return 0;
 }
 
-int bwt_mtf_huffman_compress(const unsigned char* input, long input_size, unsigned char** output, long* output_size) {
-    if (!input || input_size <= 0 || !output || !output_size) return -1;
-    unsigned char* bwt;
-    long bwt_n;
+// Canonical decoder for one table: codes of up to BWT_LOOKUP_BITS resolve in
+// one lookup, longer ones by comparing against each length's first code
+typedef struct {
+    uint16_t lookup[1 << BWT_LOOKUP_BITS];   // symbol << 4 | length, 0 = long code
+    uint32_t first_code[BWT_CODE_MAX_LEN + 1];
+    int first_index[BWT_CODE_MAX_LEN + 1];
+    int count[BWT_CODE_MAX_LEN + 1];
+    uint16_t sorted[BWT_MAX_ALPHA];
+} BWTDecodeTable;
+
+static int bwt_build_decode_table(const unsigned char* lens, int alpha, BWTDecodeTable* dt) {
+    memset(dt->count, 0, sizeof(dt->count));
+    for (int s = 0; s < alpha; ++s) dt->count[lens[s]]++;
+    long kraft = 0;
+    for (int len = 1; len <= BWT_CODE_MAX_LEN; ++len) kraft += (long)dt->count[len] << (BWT_CODE_MAX_LEN - len);
+    if (kraft > (1L << BWT_CODE_MAX_LEN)) return -1;
+
+    uint32_t code = 0;
+    int index = 0;
+    for (int len = 1; len <= BWT_CODE_MAX_LEN; ++len) {
+        code = (code + (len > 1 ? dt->count[len - 1] : 0)) << 1;
+        dt->first_code[len] = code;
+        dt->first_index[len] = index;
+        index += dt->count[len];
+    }
+    int fill[BWT_CODE_MAX_LEN + 1];
+    memcpy(fill, dt->first_index, sizeof(fill));
+    for (int s = 0; s < alpha; ++s) {
+        if (lens[s]) dt->sorted[fill[lens[s]]++] = (uint16_t)s;
+    }
+
+    memset(dt->lookup, 0, sizeof(dt->lookup));
+    for (int len = 1; len <= BWT_LOOKUP_BITS; ++len) {
+        for (int k = 0; k < dt->count[len]; ++k) {
+            uint32_t c = dt->first_code[len] + (uint32_t)k;
+            int sym = dt->sorted[dt->first_index[len] + k];
+            int shift = BWT_LOOKUP_BITS - len;
+            for (uint32_t e = 0; e < (1u << shift); ++e) {
+                dt->lookup[(c << shift) | e] = (uint16_t)((sym << 4) | len);
+            }
+        }
+    }
+    return 0;
+}
+
+// Decode one symbol; -1 for a bit pattern no code covers
+static inline int bwt_decode_symbol(BWTBitReader* br, const BWTDecodeTable* dt) {
+    if (br->bits < BWT_CODE_MAX_LEN) bwt_refill(br);
+    uint16_t e = dt->lookup[br->acc >> (64 - BWT_LOOKUP_BITS)];
+    if (e) {
+        br->acc <<= (e & 15);
+        br->bits -= (e & 15);
+        return e >> 4;
+    }
+    uint32_t peek = (uint32_t)(br->acc >> (64 - BWT_CODE_MAX_LEN));
+    for (int len = BWT_LOOKUP_BITS + 1; len <= BWT_CODE_MAX_LEN; ++len) {
+        uint32_t c = peek >> (BWT_CODE_MAX_LEN - len);
+        if (c - dt->first_code[len] < (uint32_t)dt->count[len]) {
+            br->acc <<= len;
+            br->bits -= len;
+            return dt->sorted[dt->first_index[len] + (int)(c - dt->first_code[len])];
+        }
+    }
+    return -1;
+}
+
+static int bwt_run_block_decompress(const unsigned char* input, long input_size, unsigned char** output, long* output_size) {
+    if (input_size < 8) return -1;
+    long n = (long)get_be32(input + 4);
+    if (n <= 0 || n > BWT_MAX_BLOCK_SIZE) return -1;
     long primary_idx;
-    if (bwt_transform_impl(input, input_size, &bwt, &bwt_n, &primary_idx) != 0) return -1;
-
-    unsigned char* mtf;
-    long mtf_n;
-    if (mtf_encode_impl(bwt, bwt_n, &mtf, &mtf_n) != 0) { tracked_free(bwt, bwt_n); return -1; }
-
-    // prepend 4-byte primary index (big-endian) before Huffman encoding
-    unsigned char* payload = (unsigned char*)tracked_malloc(mtf_n + 4);
-    if (!payload) { tracked_free(bwt, bwt_n); tracked_free(mtf, mtf_n); return -1; }
-    payload[0] = (unsigned char)((primary_idx >> 24) & 0xFF);
-    payload[1] = (unsigned char)((primary_idx >> 16) & 0xFF);
-    payload[2] = (unsigned char)((primary_idx >> 8) & 0xFF);
-    payload[3] = (unsigned char)(primary_idx & 0xFF);
-    memcpy(payload + 4, mtf, mtf_n);
-
-    unsigned char* huff_out = NULL;
-    long huff_n = 0;
-    CompResult rc = huffman_compress(payload, mtf_n + 4, &huff_out, &huff_n);
-    tracked_free(payload, mtf_n + 4);
-    tracked_free(bwt, bwt_n);
-    tracked_free(mtf, mtf_n);
-    if (rc != COMP_SUCCESS) return -1;
-
-    *output = huff_out;
-    *output_size = huff_n;
+    long starts[BWT_MAX_STREAMS];
+    int streams;
+    long head = bwt_get_primary(input + 8, input_size - 8, &primary_idx, starts, &streams);
+    if (head < 0) return -1;
+    long pos = 8 + head;
+    if (input_size < pos + 4 + 32 + 1) return -1;
+    long nsyms = (long)get_be32(input + pos);
+    pos += 4;
+    unsigned char list[256];
+    memset(list, 0, sizeof(list));
+    int nuse = 0;
+    for (int c = 0; c < 256; ++c) {
+        if ((input[pos + (c >> 3)] >> (c & 7)) & 1) list[nuse++] = (unsigned char)c;
+    }
+    pos += 32;
+    int nt = input[pos++];
+    int alpha = nuse + 1;
+    if (nuse == 0 || nsyms <= 0 || nsyms > n || nt < 2 || nt > BWT_MAX_TABLES) return -1;
+
+    long ngroups = (nsyms + BWT_GROUP_SIZE - 1) / BWT_GROUP_SIZE;
+    BWTDecodeTable* tables = (BWTDecodeTable*)comp_malloc(sizeof(BWTDecodeTable) * nt);
+    unsigned char* sel = (unsigned char*)comp_malloc((size_t)ngroups);
+    unsigned char* L = (unsigned char*)comp_malloc((size_t)n);
+    if (!tables || !sel || !L) goto fail;
+
+    BWTBitReader br = { input, pos, input_size, 0, 0 };
+    for (int t = 0; t < nt; ++t) {
+        unsigned char lens[BWT_MAX_ALPHA];
+        int cur = (int)bwt_get_bits(&br, 5);
+        for (int s = 0; s < alpha; ++s) {
+            for (;;) {
+                if (cur < 1 || cur > BWT_CODE_MAX_LEN) goto fail;
+                if (!bwt_get_bits(&br, 1)) break;
+                cur += bwt_get_bits(&br, 1) ? -1 : 1;
+            }
+            lens[s] = (unsigned char)cur;
+        }
+        if (bwt_build_decode_table(lens, alpha, &tables[t]) != 0) goto fail;
+    }
+    unsigned char sel_list[BWT_MAX_TABLES];
+    for (int t = 0; t < BWT_MAX_TABLES; ++t) sel_list[t] = (unsigned char)t;
+    for (long g = 0; g < ngroups; ++g) {
+        int r = 0;
+        while (bwt_get_bits(&br, 1)) {
+            if (++r >= nt) goto fail;
+        }
+        mtf_promote(sel_list, r);
+        sel[g] = sel_list[0];
+    }
+    if (bwt_bits_overrun(&br)) goto fail;
+
+    long lpos = 0;
+    long run = 0;
+    int digit = 0;
+    for (long g = 0; g < ngroups; ++g) {
+        const BWTDecodeTable* dt = &tables[sel[g]];
+        long end = (g + 1) * BWT_GROUP_SIZE < nsyms ? (g + 1) * BWT_GROUP_SIZE : nsyms;
+        for (long i = g * BWT_GROUP_SIZE; i < end; ++i) {
+            int sym = bwt_decode_symbol(&br, dt);
+            if (sym < 0) goto fail;
+            if (sym <= BWT_RUNB) {
+                if (digit > 30) goto fail;
+                run += (long)(sym + 1) << digit++;
+                if (run > n - lpos) goto fail;
+                continue;
+            }
+            if (run) {
+                memset(L + lpos, list[0], (size_t)run);
+                lpos += run;
+                run = 0;
+                digit = 0;
+            }
+            int rank = sym - 1;
+            if (rank >= nuse || lpos >= n) goto fail;
+            mtf_promote(list, rank);
+            L[lpos++] = list[0];
+        }
+    }
+    if (run) {
+        memset(L + lpos, list[0], (size_t)run);
+        lpos += run;
+    }
+    if (lpos != n || bwt_bits_overrun(&br)) goto fail;
+    comp_free(tables);
+    comp_free(sel);
+
+    unsigned char* outbuf = NULL;
+    long out_n = 0;
+    int rc = bwt_invert(L, n, primary_idx, starts, streams, &outbuf, &out_n);
+    comp_free(L);
+    if (rc != 0) return -1;
+    *output = outbuf;
+    *output_size = out_n;
     return 0;
+
+fail:
+    comp_free(tables);
+    comp_free(sel);
+    comp_free(L);
+    return -1;
 }
 
-int bwt_mtf_huffman_decompress(const unsigned char* input, long input_size, unsigned char** output, long* output_size) {
-    if (!input || input_size <= 0 || !output || !output_size) return -1;
+// Blocks written before the run coder: huffman(primary index [+ stream
+// starts] + MTF of the BWT)
+static int bwt_huffman_block_decompress(const unsigned char* input, long input_size, unsigned char** output, long* output_size) {
     unsigned char* payload = NULL;
     long payload_n = 0;
     {
-        CompResult drc = huffman_decompress_optimized(input, input_size, &payload, &payload_n);
+        CompResult drc = huffman_decompress(input, input_size, &payload, &payload_n);
         if (drc != COMP_SUCCESS) return -1;
     }
-    if (payload_n < 4) { tracked_free(payload, payload_n); return -1; }
-    long primary_idx = (payload[0] << 24) | (payload[1] << 16) | (payload[2] << 8) | payload[3];
-    unsigned char* mtf_data = payload + 4;
-    long mtf_n = payload_n - 4;
+    long primary_idx;
+    long starts[BWT_MAX_STREAMS];
+    int streams;
+    long head = bwt_get_primary(payload, payload_n, &primary_idx, starts, &streams);
+    if (head < 0 || payload_n - head <= 0) { comp_free(payload); return -1; }
 
     unsigned char* bwt_data = NULL;
     long bwt_n = 0;
-    if (mtf_decode_impl(mtf_data, mtf_n, &bwt_data, &bwt_n) != 0) { tracked_free(payload, payload_n); return -1; }
+    if (mtf_decode_impl(payload + head, payload_n - head, &bwt_data, &bwt_n) != 0) { comp_free(payload); return -1; }
 
     unsigned char* outbuf = NULL;
     long out_n = 0;
-    int rc = bwt_inverse_impl(bwt_data, bwt_n, primary_idx, &outbuf, &out_n);
-    tracked_free(payload, payload_n);
-    tracked_free(bwt_data, bwt_n);
+    int rc = bwt_invert(bwt_data, bwt_n, primary_idx, starts, streams, &outbuf, &out_n);
+    comp_free(payload);
+    comp_free(bwt_data);
     if (rc != 0) return -1;
 
     *output = outbuf;
     *output_size = out_n;
     return 0;
-}
\ No newline at end of file
+}
+
+static int bwt_block_decompress(const unsigned char* input, long input_size, unsigned char** output, long* output_size) {
+    if (input_size >= 4 && memcmp(input, BWT_RUN_MAGIC, 4) == 0) {
+        return bwt_run_block_decompress(input, input_size, output, output_size);
+    }
+    return bwt_huffman_block_decompress(input, input_size, output, output_size);
+}
+
+// ===== Block stream =====
+// Large inputs are split into independent blocks, bzip2 style, so each
+// block carries its own primary index and Huffman tables and blocks can be
+// transformed on separate threads:
+//   "BWB1" | block size (BE32) | block count (BE32) | original size (BE64)
+//   | compressed size of each block (BE32) | block payloads in order
+// Single-block streams start with the run coder's magic or, for older
+// streams, the Huffman header.
+
+#define BWT_BLOCK_MAGIC "BWB1"
+#define BWT_BLOCK_HEADER 20
+
+typedef struct {
+    const unsigned char* input;
+    long input_size;
+    long block_size;
+    unsigned char** parts;
+    long* part_sizes;
+    int* status;
+} BWTBlockJob;
+
+static void bwt_block_compress_task(void* ctx, long index) {
+    BWTBlockJob* job = (BWTBlockJob*)ctx;
+    long start = index * job->block_size;
+    long len = job->input_size - start < job->block_size ? job->input_size - start : job->block_size;
+    job->status[index] = bwt_block_compress(job->input + start, len, &job->parts[index], &job->part_sizes[index]);
+}
+
+int bwt_mtf_huffman_compress_blocks(const unsigned char* input, long input_size, unsigned char** output, long* output_size,
+                                    long block_size, int threads) {
+    if (!input || input_size <= 0 || !output || !output_size) return -1;
+    if (block_size <= 0) block_size = BWT_DEFAULT_BLOCK_SIZE;
+    if (block_size > BWT_MAX_BLOCK_SIZE) block_size = BWT_MAX_BLOCK_SIZE;
+    long count = (input_size + block_size - 1) / block_size;
+
+    BWTBlockJob job;
+    job.input = input;
+    job.input_size = input_size;
+    job.block_size = block_size;
+    job.parts = (unsigned char**)comp_calloc((size_t)count, sizeof(unsigned char*));
+    job.part_sizes = (long*)comp_calloc((size_t)count, sizeof(long));
+    job.status = (int*)comp_calloc((size_t)count, sizeof(int));
+    int rc = -1;
+    if (!job.parts || !job.part_sizes || !job.status) goto done;
+
+    ThreadPool* pool = (count > 1 && threads != 1) ? thread_pool_create(threads) : NULL;
+    thread_pool_parallel_for(pool, count, bwt_block_compress_task, &job);
+    thread_pool_destroy(pool);
+
+    // Blocks are joined in input order, so the output does not depend on
+    // the thread count
+    long total = BWT_BLOCK_HEADER + count * 4;
+    for (long b = 0; b < count; b++) {
+        if (job.status[b] != 0 || job.part_sizes[b] > 0xFFFFFFFFL) goto done;
+        total += job.part_sizes[b];
+    }
+    unsigned char* out = (unsigned char*)comp_malloc((size_t)total);
+    if (!out) goto done;
+    memcpy(out, BWT_BLOCK_MAGIC, 4);
+    put_be32(out + 4, (unsigned long)block_size);
+    put_be32(out + 8, (unsigned long)count);
+    put_be32(out + 12, (unsigned long)((uint64_t)input_size >> 32));
+    put_be32(out + 16, (unsigned long)(input_size & 0xFFFFFFFFL));
+    long pos = BWT_BLOCK_HEADER;
+    for (long b = 0; b < count; b++, pos += 4) put_be32(out + pos, (unsigned long)job.part_sizes[b]);
+    for (long b = 0; b < count; b++) {
+        memcpy(out + pos, job.parts[b], (size_t)job.part_sizes[b]);
+        pos += job.part_sizes[b];
+    }
+    *output = out;
+    *output_size = total;
+    rc = 0;
+
+done:
+    if (job.parts) {
+        for (long b = 0; b < count; b++) comp_free(job.parts[b]);
+    }
+    comp_free(job.parts);
+    comp_free(job.part_sizes);
+    comp_free(job.status);
+    return rc;
+}
+
+typedef struct {
+    const unsigned char* input;
+    const long* offsets;    // count + 1 payload offsets into input
+    unsigned char* out;
+    long out_size;
+    long block_size;
+    int* status;
+} BWTBlockDecodeJob;
+
+static void bwt_block_decompress_task(void* ctx, long index) {
+    BWTBlockDecodeJob* job = (BWTBlockDecodeJob*)ctx;
+    long start = index * job->block_size;
+    long expect = job->out_size - start < job->block_size ? job->out_size - start : job->block_size;
+    unsigned char* block = NULL;
+    long block_n = 0;
+    if (bwt_block_decompress(job->input + job->offsets[index], job->offsets[index + 1] - job->offsets[index],
+                             &block, &block_n) != 0) {
+        job->status[index] = -1;
+        return;
+    }
+    if (block_n == expect) memcpy(job->out + start, block, (size_t)block_n);
+    job->status[index] = (block_n == expect) ? 0 : -1;
+    comp_free(block);
+}
+
+static int bwt_decompress_blocks(const unsigned char* input, long input_size, unsigned char** output, long* output_size) {
+    if (input_size < BWT_BLOCK_HEADER) return -1;
+    long block_size = (long)get_be32(input + 4);
+    long count = (long)get_be32(input + 8);
+    uint64_t size = ((uint64_t)get_be32(input + 12) << 32) | get_be32(input + 16);
+    if (block_size <= 0 || block_size > BWT_MAX_BLOCK_SIZE || count <= 0 || size == 0 || size > (uint64_t)LONG_MAX) {
+        return -1;
+    }
+    if ((uint64_t)(count - 1) * (uint64_t)block_size >= size || (uint64_t)count * (uint64_t)block_size < size) return -1;
+    if (count > (input_size - BWT_BLOCK_HEADER) / 4) return -1;
+
+    long* offsets = (long*)comp_malloc(sizeof(long) * (size_t)(count + 1));
+    int* status = (int*)comp_calloc((size_t)count, sizeof(int));
+    unsigned char* out = NULL;
+    int rc = -1;
+    if (!offsets || !status) goto done;
+    offsets[0] = BWT_BLOCK_HEADER + count * 4;
+    for (long b = 0; b < count; b++) {
+        long n = (long)get_be32(input + BWT_BLOCK_HEADER + b * 4);
+        if (n <= 0 || n > input_size - offsets[b]) goto done;
+        offsets[b + 1] = offsets[b] + n;
+    }
+    if (offsets[count] != input_size) goto done;
+
+    out = (unsigned char*)comp_malloc((size_t)size);
+    if (!out) goto done;
+    BWTBlockDecodeJob job = { input, offsets, out, (long)size, block_size, status };
+    ThreadPool* pool = count > 1 ? thread_pool_create(0) : NULL;
+    thread_pool_parallel_for(pool, count, bwt_block_decompress_task, &job);
+    thread_pool_destroy(pool);
+    for (long b = 0; b < count; b++) {
+        if (status[b] != 0) goto done;
+    }
+    *output = out;
+    *output_size = (long)size;
+    out = NULL;
+    rc = 0;
+
+done:
+    comp_free(out);
+    comp_free(offsets);
+    comp_free(status);
+    return rc;
+}
+
+int bwt_mtf_huffman_compress(const unsigned char* input, long input_size, unsigned char** output, long* output_size) {
+    if (!input || input_size <= 0 || !output || !output_size) return -1;
+    if (input_size > BWT_DEFAULT_BLOCK_SIZE) {
+        return bwt_mtf_huffman_compress_blocks(input, input_size, output, output_size, BWT_DEFAULT_BLOCK_SIZE, 0);
+    }
+    return bwt_block_compress(input, input_size, output, output_size);
+}
+
+// Peak bytes bwt_mtf_huffman_compress allocates beyond the input. A block
+// holds its SA-IS arena (16-bit text and suffix array), the last column,
+// the symbol stream and its output, about eight bytes per block byte; with
+// several blocks, up to `threads` of them are in flight and the finished
+// parts are joined into a second copy of the output.
+size_t bwt_mtf_huffman_memory_cost(long input_size, int threads) {
+    if (input_size <= 0) return 0;
+    if (input_size <= BWT_DEFAULT_BLOCK_SIZE) return 8 * (size_t)input_size + 64 * 1024;
+    long count = (input_size + BWT_DEFAULT_BLOCK_SIZE - 1) / BWT_DEFAULT_BLOCK_SIZE;
+    long active = (threads > 0) ? threads : thread_pool_cpu_count();
+    if (active > count) active = count;
+    return (size_t)active * (8 * (size_t)BWT_DEFAULT_BLOCK_SIZE + 64 * 1024) +
+           2 * ((size_t)input_size + (size_t)input_size / 8) + (size_t)count * 64;
+}
+
+// Peak bytes bwt_mtf_huffman_decompress allocates for a single-block
+// stream of original_size bytes: the last column, the inverse links and
+// the output
+size_t bwt_mtf_huffman_decode_memory_cost(long original_size) {
+    if (original_size <= 0) return 0;
+    return 7 * (size_t)original_size + 64 * 1024;
+}
+
+int bwt_mtf_huffman_decompress(const unsigned char* input, long input_size, unsigned char** output, long* output_size) {
+    if (!input || input_size <= 0 || !output || !output_size) return -1;
+    if (input_size >= 4 && memcmp(input, BWT_BLOCK_MAGIC, 4) == 0) {
+        return bwt_decompress_blocks(input, input_size, output, output_size);
+    }
+    return bwt_block_decompress(input, input_size, output, output_size);
+}
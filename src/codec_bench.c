@@ -0,0 +1,530 @@
+// Codec micro-benchmarks on synthetic corpora
+// Usage: codec_bench.exe [size_kb] [section]
+//   size_kb  corpus size per run (default 4096)
+//   section  run only one section, e.g. "huffman"
+#include "../include/compressor.h"
+#include "../include/thread_pool.h"
+#include "mtf.h"
+#include "range_coder.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef struct {
+    const char* name;
+    unsigned char* data;
+    long size;
+} BenchCorpus;
+
+static unsigned int g_seed = 12345u;
+
+static unsigned int bench_rand(void) {
+    g_seed = g_seed * 1103515245u + 12345u;
+    return (g_seed >> 16) & 0x7FFF;
+}
+
+static double bench_now_sec(void) {
+    return (double)clock() / (double)CLOCKS_PER_SEC;
+}
+
+// Wall-clock time, for the multithreaded sections where clock() sums CPUs
+static double bench_wall_sec(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static double bench_mbps(long bytes, double seconds) {
+    if (seconds <= 0.0) seconds = 1e-9;
+    return (double)bytes / (1024.0 * 1024.0) / seconds;
+}
+
+// English-like text from a small vocabulary
+static void fill_text(unsigned char* buf, long size) {
+    static const char* words[] = {
+        "the", "quick", "brown", "fox", "jumps", "over", "lazy", "dog", "compression",
+        "stream", "block", "window", "match", "literal", "request", "server", "latency",
+        "error", "warning", "info", "user", "session", "value", "record", "index"
+    };
+    const int nwords = (int)(sizeof(words) / sizeof(words[0]));
+    long pos = 0;
+    while (pos < size) {
+        const char* w = words[bench_rand() % nwords];
+        for (int i = 0; w[i] && pos < size; i++) buf[pos++] = (unsigned char)w[i];
+        if (pos < size) buf[pos++] = (bench_rand() % 12 == 0) ? '\n' : ' ';
+    }
+}
+
+// CSV rows with repeating columns and numeric fields
+static void fill_csv(unsigned char* buf, long size) {
+    static const char* cities[] = { "New York", "Los Angeles", "Chicago", "Houston", "Phoenix" };
+    long pos = 0;
+    long row = 0;
+    char line[128];
+    while (pos < size) {
+        int n = snprintf(line, sizeof(line), "%ld,%s,%u,%u.%02u\n", row++,
+                         cities[bench_rand() % 5], 18 + bench_rand() % 60,
+                         bench_rand() % 1000, bench_rand() % 100);
+        for (int i = 0; i < n && pos < size; i++) buf[pos++] = (unsigned char)line[i];
+    }
+}
+
+// Structured binary: little-endian records with slowly drifting fields
+static void fill_binary(unsigned char* buf, long size) {
+    unsigned int a = 0, b = 0;
+    for (long pos = 0; pos < size; pos++) {
+        switch (pos & 7) {
+            case 0: a += bench_rand() & 3; buf[pos] = (unsigned char)a; break;
+            case 1: buf[pos] = (unsigned char)(a >> 8); break;
+            case 2: b = bench_rand(); buf[pos] = (unsigned char)b; break;
+            case 3: buf[pos] = (unsigned char)(b & 0x0F); break;
+            default: buf[pos] = 0; break;
+        }
+    }
+}
+
+// Long repeats: random 64 KiB of source, copied out in runs of 256-4096
+// bytes at offsets of 1-64 KiB with an occasional literal between them
+static void fill_repeats(unsigned char* buf, long size) {
+    long seed = size < 65536 ? size : 65536;
+    for (long i = 0; i < seed; i++) buf[i] = (unsigned char)bench_rand();
+    long pos = seed;
+    while (pos < size) {
+        long len = 256 + (long)(bench_rand() % 3841);
+        long offset = 1 + (long)(bench_rand() % 65536);
+        if (offset > pos) offset = pos;
+        for (long i = 0; i < len && pos < size; i++, pos++) buf[pos] = buf[pos - offset];
+        if (pos < size) buf[pos++] = (unsigned char)bench_rand();
+    }
+}
+
+// Skewed runs, the shape hardcore routes to rANS (entropy under 4 bits,
+// over 30% repeats): runs of 1-8 bytes, mostly zeros, then a second value
+// that changes every 16 KiB, then noise
+static void fill_runs(unsigned char* buf, long size) {
+    long pos = 0;
+    while (pos < size) {
+        unsigned int r = bench_rand() % 100;
+        unsigned char v = r < 70 ? 0 : r < 85 ? (unsigned char)((pos >> 14) * 37 | 0x80)
+                                             : (unsigned char)(bench_rand() % 32 + 1);
+        long len = 1 + (long)(bench_rand() % 8);
+        for (long i = 0; i < len && pos < size; i++) buf[pos++] = v;
+    }
+}
+
+static int make_corpora(BenchCorpus* corpora, long size) {
+    corpora[0].name = "text";
+    corpora[1].name = "csv";
+    corpora[2].name = "binary";
+    for (int i = 0; i < 3; i++) {
+        corpora[i].data = (unsigned char*)comp_malloc(size);
+        corpora[i].size = size;
+        if (!corpora[i].data) return -1;
+    }
+    fill_text(corpora[0].data, size);
+    fill_csv(corpora[1].data, size);
+    fill_binary(corpora[2].data, size);
+    return 0;
+}
+
+// Time `decode` over `iters` runs and verify the result once
+typedef CompResult (*HuffDecodeFn)(const unsigned char*, long, unsigned char**, long*);
+
+static double time_huffman_decode(HuffDecodeFn decode, const unsigned char* comp, long comp_size,
+                                  const BenchCorpus* c, int iters, int* ok) {
+    double t0 = bench_now_sec();
+    *ok = 1;
+    for (int i = 0; i < iters; i++) {
+        unsigned char* out = NULL;
+        long out_size = 0;
+        if (decode(comp, comp_size, &out, &out_size) != COMP_SUCCESS ||
+            out_size != c->size || memcmp(out, c->data, c->size) != 0) {
+            *ok = 0;
+        }
+        comp_free(out);
+    }
+    return bench_mbps(c->size * (long)iters, bench_now_sec() - t0);
+}
+
+static void bench_huffman(const BenchCorpus* corpora, int count) {
+    printf("\n[huffman] encode, and decode: bit-serial reference vs table-driven vs four-stream\n");
+    printf("%-8s %10s %12s %12s %12s %8s %10s %12s\n", "corpus", "ratio%", "enc MB/s", "bit MB/s", "table MB/s",
+           "speedup", "4x ratio%", "4x MB/s");
+    for (int i = 0; i < count; i++) {
+        const BenchCorpus* c = &corpora[i];
+        unsigned char* comp = NULL;
+        long comp_size = 0;
+        double t0 = bench_now_sec();
+        for (int k = 0; k < 3; k++) {
+            comp_free(comp);
+            comp = NULL;
+            if (huffman_compress(c->data, c->size, &comp, &comp_size) != COMP_SUCCESS) break;
+        }
+        double enc = bench_mbps(c->size * 3L, bench_now_sec() - t0);
+        if (!comp) {
+            printf("%-8s compression failed\n", c->name);
+            continue;
+        }
+        int ok_bit = 0, ok_table = 0;
+        double bit = time_huffman_decode(huffman_decompress_bitwise, comp, comp_size, c, 3, &ok_bit);
+        double table = time_huffman_decode(huffman_decompress, comp, comp_size, c, 3, &ok_table);
+
+        unsigned char* comp4 = NULL;
+        long comp4_size = 0;
+        int ok_4x = 0;
+        double fourx = 0.0;
+        if (huffman_compress_4x(c->data, c->size, &comp4, &comp4_size) == COMP_SUCCESS) {
+            fourx = time_huffman_decode(huffman_decompress, comp4, comp4_size, c, 3, &ok_4x);
+        }
+        printf("%-8s %10.2f %12.1f %12.1f %12.1f %7.2fx %10.2f %12.1f%s\n", c->name,
+               (double)comp_size / (double)c->size * 100.0, enc, bit, table, table / bit,
+               (double)comp4_size / (double)c->size * 100.0, fourx,
+               (ok_bit && ok_table && ok_4x) ? "" : "  MISMATCH");
+        comp_free(comp);
+        comp_free(comp4);
+    }
+}
+
+static void bench_lz77(const BenchCorpus* corpora, int count) {
+    static const struct { const char* name; CompressionLevel level; } levels[] = {
+        { "fast", COMPRESSION_LEVEL_FAST }, { "normal", COMPRESSION_LEVEL_NORMAL },
+        { "high", COMPRESSION_LEVEL_HIGH }, { "ultra", COMPRESSION_LEVEL_ULTRA }
+    };
+    printf("\n[lz77] encode: exhaustive window search vs hash-chain (v1) vs wide-window v2\n");
+    printf("%-8s %-9s %10s %12s %8s\n", "corpus", "finder", "ratio%", "enc MB/s", "speedup");
+    for (int i = 0; i < count; i++) {
+        const BenchCorpus* c = &corpora[i];
+        // The exhaustive search is slow; time it on a 256 KiB prefix
+        long ref_size = c->size < 256 * 1024 ? c->size : 256 * 1024;
+        unsigned char* comp = NULL;
+        long comp_size = 0;
+        double t0 = bench_now_sec();
+        int rc = lz77_compress_reference(c->data, ref_size, &comp, &comp_size);
+        double ref = bench_mbps(ref_size, bench_now_sec() - t0);
+        if (rc == 0) {
+            printf("%-8s %-9s %10.2f %12.1f %7.2fx\n", c->name, "exhaust",
+                   (double)comp_size / (double)ref_size * 100.0, ref, 1.0);
+        }
+        comp_free(comp);
+
+        for (int l = 0; l < 8; l++) {
+            int v2 = (l >= 4);
+            CompressionLevel level = levels[l & 3].level;
+            char name[16];
+            snprintf(name, sizeof(name), "%s%s", v2 ? "v2 " : "", levels[l & 3].name);
+            comp = NULL;
+            t0 = bench_now_sec();
+            rc = v2 ? lz77_compress_v2(c->data, c->size, &comp, &comp_size, level)
+                    : lz77_compress_level(c->data, c->size, &comp, &comp_size, level);
+            double enc = bench_mbps(c->size, bench_now_sec() - t0);
+            int ok = 0;
+            unsigned char* out = NULL;
+            long out_size = 0;
+            if (rc == 0 && lz77_decompress(comp, comp_size, &out, &out_size) == 0) {
+                ok = (out_size == c->size && memcmp(out, c->data, c->size) == 0);
+            }
+            printf("%-8s %-9s %10.2f %12.1f %7.2fx%s\n", c->name, name,
+                   (double)comp_size / (double)c->size * 100.0, enc, enc / ref, ok ? "" : "  MISMATCH");
+            comp_free(comp);
+            tracked_free(out, 0);
+        }
+    }
+}
+
+// Decode throughput of v1 and v2 streams, with memcpy of the same output
+// size as the ceiling. The last row is a long-match corpus, where the
+// decoder spends its time in match copies rather than token parsing.
+static void bench_lz77_decode(const BenchCorpus* corpora, int count) {
+    printf("\n[lz77-decode] decode MB/s (output bytes)\n");
+    printf("%-8s %12s %12s %12s\n", "corpus", "v1 MB/s", "v2 MB/s", "memcpy MB/s");
+    const int iters = 20;
+    for (int i = 0; i <= count; i++) {
+        BenchCorpus repeats = { "repeats", NULL, corpora[0].size };
+        const BenchCorpus* c = &corpora[i < count ? i : 0];
+        if (i == count) {
+            repeats.data = (unsigned char*)comp_malloc(repeats.size);
+            if (!repeats.data) break;
+            fill_repeats(repeats.data, repeats.size);
+            c = &repeats;
+        }
+        double rate[2] = {0.0, 0.0};
+        int ok = 1;
+        for (int v = 0; v < 2; v++) {
+            unsigned char* comp = NULL;
+            long comp_size = 0;
+            int rc = v ? lz77_compress_v2(c->data, c->size, &comp, &comp_size, COMPRESSION_LEVEL_NORMAL)
+                       : lz77_compress_level(c->data, c->size, &comp, &comp_size, COMPRESSION_LEVEL_NORMAL);
+            if (rc != 0) {
+                ok = 0;
+                continue;
+            }
+            double t0 = bench_now_sec();
+            for (int k = 0; k < iters; k++) {
+                unsigned char* out = NULL;
+                long out_size = 0;
+                if (lz77_decompress(comp, comp_size, &out, &out_size) != 0 ||
+                    out_size != c->size || (k == 0 && memcmp(out, c->data, c->size) != 0)) {
+                    ok = 0;
+                }
+                tracked_free(out, 0);
+            }
+            rate[v] = bench_mbps(c->size * (long)iters, bench_now_sec() - t0);
+            comp_free(comp);
+        }
+
+        unsigned char* copy = (unsigned char*)comp_malloc(c->size);
+        double t0 = bench_now_sec();
+        for (int k = 0; k < iters && copy; k++) {
+            memcpy(copy, c->data, c->size);
+            copy[k % c->size] ^= 1;   // keep the copies observable
+        }
+        double mc = bench_mbps(c->size * (long)iters, bench_now_sec() - t0);
+        comp_free(copy);
+        printf("%-8s %12.1f %12.1f %12.1f%s\n", c->name, rate[0], rate[1], mc, ok ? "" : "  MISMATCH");
+        comp_free(repeats.data);
+    }
+}
+
+// Blocked BWT+MTF+Huffman: one worker vs one per CPU; both must produce
+// the same bytes
+static void bench_bwt(const BenchCorpus* corpora, int count) {
+    int cpus = thread_pool_cpu_count();
+    printf("\n[bwt] 900 KiB blocks, encode/decode wall MB/s, 1 thread vs %d\n", cpus);
+    printf("%-8s %10s %12s %12s %8s %12s\n", "corpus", "ratio%", "enc 1T", "enc NT", "speedup", "dec MB/s");
+    for (int i = 0; i < count; i++) {
+        const BenchCorpus* c = &corpora[i];
+        unsigned char* one = NULL;
+        unsigned char* many = NULL;
+        long one_size = 0, many_size = 0;
+        double t0 = bench_wall_sec();
+        int rc1 = bwt_mtf_huffman_compress_blocks(c->data, c->size, &one, &one_size, BWT_DEFAULT_BLOCK_SIZE, 1);
+        double enc1 = bench_mbps(c->size, bench_wall_sec() - t0);
+        t0 = bench_wall_sec();
+        int rcn = bwt_mtf_huffman_compress_blocks(c->data, c->size, &many, &many_size, BWT_DEFAULT_BLOCK_SIZE, 0);
+        double encn = bench_mbps(c->size, bench_wall_sec() - t0);
+        if (rc1 != 0 || rcn != 0) {
+            printf("%-8s compression failed\n", c->name);
+            comp_free(one);
+            comp_free(many);
+            continue;
+        }
+        int ok = (one_size == many_size && memcmp(one, many, one_size) == 0);
+
+        unsigned char* out = NULL;
+        long out_size = 0;
+        t0 = bench_wall_sec();
+        if (bwt_mtf_huffman_decompress(many, many_size, &out, &out_size) != 0 ||
+            out_size != c->size || memcmp(out, c->data, c->size) != 0) {
+            ok = 0;
+        }
+        double dec = bench_mbps(c->size, bench_wall_sec() - t0);
+        comp_free(out);
+        printf("%-8s %10.2f %12.1f %12.1f %7.2fx %12.1f%s\n", c->name,
+               (double)many_size / (double)c->size * 100.0, enc1, encn, encn / enc1, dec, ok ? "" : "  MISMATCH");
+        comp_free(one);
+        comp_free(many);
+    }
+}
+
+// Order-0 adaptive binary range coder, 8 decisions per byte down a bit
+// tree. Decoding runs hardcore's range_decode_bit (range_coder.h); the
+// tree has no encoder for it, so this one mirrors its model and refill
+// bound. Baseline for the rANS section.
+typedef struct {
+    uint64_t low;
+    uint32_t range;
+    unsigned char cache;
+    long cache_size;
+    unsigned char* out;
+    long pos;
+} BenchRcEncoder;
+
+static void brc_shift_low(BenchRcEncoder* rc) {
+    if ((uint32_t)rc->low < 0xFF000000u || (rc->low >> 32) != 0) {
+        unsigned char carry = (unsigned char)(rc->low >> 32);
+        unsigned char c = rc->cache;
+        do {
+            rc->out[rc->pos++] = (unsigned char)(c + carry);
+            c = 0xFF;
+        } while (--rc->cache_size != 0);
+        rc->cache = (unsigned char)(rc->low >> 24);
+    }
+    rc->cache_size++;
+    rc->low = (rc->low & 0x00FFFFFFu) << 8;
+}
+
+static long brc_compress(const unsigned char* in, long n, unsigned char* out) {
+    uint16_t probs[256];
+    for (int i = 0; i < 256; i++) probs[i] = RC_BIT_MODEL_TOTAL / 2;
+    BenchRcEncoder rc = { 0, 0xFFFFFFFFu, 0, 1, out, 0 };
+    for (long i = 0; i < n; i++) {
+        int node = 1;
+        for (int b = 7; b >= 0; b--) {
+            int bit = (in[i] >> b) & 1;
+            uint16_t* p = &probs[node];
+            uint32_t bound = (rc.range >> RC_MODEL_TOTAL_BITS) * *p;
+            if (!bit) {
+                rc.range = bound;
+                *p += (RC_BIT_MODEL_TOTAL - *p) >> RC_MOVE_BITS;
+            } else {
+                rc.low += bound;
+                rc.range -= bound;
+                *p -= *p >> RC_MOVE_BITS;
+            }
+            while (rc.range < RC_BOT_VALUE) {
+                rc.range <<= 8;
+                brc_shift_low(&rc);
+            }
+            node = (node << 1) | bit;
+        }
+    }
+    for (int i = 0; i < 5; i++) brc_shift_low(&rc);
+    return rc.pos;
+}
+
+static void brc_decompress(const unsigned char* in, long size, unsigned char* out, long n) {
+    RangeBitModel probs[256];
+    for (int i = 0; i < 256; i++) probs[i].prob = RC_BIT_MODEL_TOTAL / 2;
+    RangeDecoder rd;
+    range_decoder_init(&rd, in, size);
+    for (long i = 0; i < n; i++) {
+        int node = 1;
+        for (int b = 0; b < 8; b++) node = (node << 1) | range_decode_bit(&rd, &probs[node]);
+        out[i] = (unsigned char)node;
+    }
+}
+
+// rANS round trip on one input; 0 on success
+static int rans_round_trip(const unsigned char* in, long n) {
+    unsigned char* comp = NULL;
+    unsigned char* out = NULL;
+    long comp_size = 0, out_size = 0;
+    int ok = rans_compress(in, n, &comp, &comp_size) == 0 &&
+             rans_decompress(comp, comp_size, &out, &out_size) == 0 &&
+             out_size == n && memcmp(out, in, (size_t)n) == 0;
+    comp_free(comp);
+    comp_free(out);
+    return ok ? 0 : -1;
+}
+
+// Small chunks, where the frequency table outweighs the data: 1-64 bytes
+// of one to four distinct values, of distinct values, and of all 256
+static void check_rans_small(void) {
+    unsigned char buf[512];
+    int cases = 0, failed = 0;
+    for (long n = 1; n <= 64; n++) {
+        for (int distinct = 1; distinct <= 4; distinct++) {
+            for (long i = 0; i < n; i++) buf[i] = (unsigned char)(bench_rand() % distinct * 37);
+            failed += rans_round_trip(buf, n) != 0;
+            cases++;
+        }
+        for (long i = 0; i < n; i++) buf[i] = (unsigned char)i;
+        failed += rans_round_trip(buf, n) != 0;
+        cases++;
+    }
+    for (long i = 0; i < 512; i++) buf[i] = (unsigned char)i;
+    failed += rans_round_trip(buf, 256) != 0;
+    failed += rans_round_trip(buf, 512) != 0;
+    cases += 2;
+    printf("small    %d inputs of 1-512 bytes%s\n", cases, failed ? "  MISMATCH" : " round-trip");
+}
+
+// Entropy stages alone: rANS vs four-stream Huffman vs the binary range
+// coder, on the raw corpora, on MTF ranks of the text corpus (the shape of
+// the BWT pipeline's input to its entropy stage) and on skewed runs
+static void bench_rans(const BenchCorpus* corpora, int count) {
+    printf("\n[rans] order-0 entropy coders: ratio%% and decode MB/s\n");
+    printf("%-8s %10s %10s %10s %12s %12s %12s\n", "corpus", "rans%", "huff4x%", "binrc%",
+           "rans MB/s", "huff MB/s", "binrc MB/s");
+    const int iters = 5;
+    for (int i = 0; i < count + 2; i++) {
+        BenchCorpus extra = { i == count ? "mtf" : "runs", NULL, corpora[0].size };
+        const BenchCorpus* c = &corpora[i < count ? i : 0];
+        if (i >= count) {
+            extra.data = (unsigned char*)comp_malloc(extra.size);
+            if (!extra.data) break;
+            if (i == count) {
+                mtf_encode_bytes(c->data, c->size, extra.data);
+            } else {
+                fill_runs(extra.data, extra.size);
+            }
+            c = &extra;
+        }
+        int ok = 1;
+
+        unsigned char* rcomp = NULL;
+        long rsize = 0;
+        double rans_rate = 0.0;
+        if (rans_compress(c->data, c->size, &rcomp, &rsize) == 0) {
+            double t0 = bench_now_sec();
+            for (int k = 0; k < iters; k++) {
+                unsigned char* out = NULL;
+                long out_size = 0;
+                if (rans_decompress(rcomp, rsize, &out, &out_size) != 0 ||
+                    out_size != c->size || memcmp(out, c->data, c->size) != 0) {
+                    ok = 0;
+                }
+                comp_free(out);
+            }
+            rans_rate = bench_mbps(c->size * (long)iters, bench_now_sec() - t0);
+        } else {
+            ok = 0;
+        }
+
+        unsigned char* hcomp = NULL;
+        long hsize = 0;
+        double huff_rate = 0.0;
+        int ok_huff = 0;
+        if (huffman_compress_4x(c->data, c->size, &hcomp, &hsize) == COMP_SUCCESS) {
+            huff_rate = time_huffman_decode(huffman_decompress, hcomp, hsize, c, iters, &ok_huff);
+        }
+        ok = ok && ok_huff;
+
+        unsigned char* bcomp = (unsigned char*)comp_malloc(c->size + c->size / 2 + 16);
+        unsigned char* bout = (unsigned char*)comp_malloc(c->size);
+        long bsize = 0;
+        double brc_rate = 0.0;
+        if (bcomp && bout) {
+            bsize = brc_compress(c->data, c->size, bcomp);
+            double t0 = bench_now_sec();
+            for (int k = 0; k < iters; k++) brc_decompress(bcomp, bsize, bout, c->size);
+            brc_rate = bench_mbps(c->size * (long)iters, bench_now_sec() - t0);
+            if (memcmp(bout, c->data, c->size) != 0) ok = 0;
+        }
+
+        printf("%-8s %10.2f %10.2f %10.2f %12.1f %12.1f %12.1f%s\n", c->name,
+               (double)rsize / (double)c->size * 100.0, (double)hsize / (double)c->size * 100.0,
+               (double)bsize / (double)c->size * 100.0, rans_rate, huff_rate, brc_rate,
+               ok ? "" : "  MISMATCH");
+        comp_free(rcomp);
+        comp_free(hcomp);
+        comp_free(bcomp);
+        comp_free(bout);
+        comp_free(extra.data);
+    }
+    check_rans_small();
+}
+
+int main(int argc, char* argv[]) {
+    long size_kb = (argc > 1) ? atol(argv[1]) : 4096;
+    const char* only = (argc > 2) ? argv[2] : NULL;
+    if (size_kb <= 0) size_kb = 4096;
+
+    BenchCorpus corpora[3];
+    memset(corpora, 0, sizeof(corpora));
+    if (make_corpora(corpora, size_kb * 1024) != 0) {
+        printf("Error: cannot allocate %ld KB corpora\n", size_kb);
+        return 1;
+    }
+    printf("Codec benchmark: %ld KB per corpus\n", size_kb);
+
+    if (!only || strcmp(only, "huffman") == 0) bench_huffman(corpora, 3);
+    if (!only || strcmp(only, "lz77") == 0) bench_lz77(corpora, 3);
+    if (!only || strcmp(only, "lz77-decode") == 0) bench_lz77_decode(corpora, 3);
+    if (!only || strcmp(only, "bwt") == 0) bench_bwt(corpora, 3);
+    if (!only || strcmp(only, "rans") == 0) bench_rans(corpora, 3);
+
+    for (int i = 0; i < 3; i++) comp_free(corpora[i].data);
+    return 0;
+}
@@ -0,0 +1,616 @@
+// Compressor memory allocator: size-class slabs with per-thread caches for
+// small blocks, malloc or private mappings for large ones, bump arenas
+#define _GNU_SOURCE
+#include "../include/comp_alloc.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+// Global panic recovery point
+jmp_buf g_panic_buf;
+
+#define COMP_ALIGN 16
+#define COMP_NUM_CLASSES 12                // 16 B .. COMP_SMALL_MAX
+#define COMP_SLAB_SIZE (256 * 1024)
+#define COMP_REGION_SLABS 32               // 8 MiB per region
+#define COMP_REGION_SIZE ((size_t)COMP_SLAB_SIZE * COMP_REGION_SLABS)
+#define COMP_MAX_REGIONS 512               // 4 GiB of small blocks
+#define COMP_CACHE_MAX 64                  // blocks per class in a thread cache
+#define COMP_CACHE_BATCH 32                // blocks moved per refill or spill
+#define COMP_HUGE_PAGE (2 * 1024 * 1024)
+#define COMP_MAP_GRANULE (64 * 1024)       // mapping sizes round up to this
+#define COMP_MAP_CACHE 32                  // freed mappings kept for reuse
+#define COMP_MAP_CACHE_BYTES (256 * 1024 * 1024)
+#define COMP_ARENA_CHUNK (1024 * 1024)
+#define COMP_SLAB_SHIFT 18                 // log2(COMP_SLAB_SIZE)
+#define COMP_MAP_LEAF_SHIFT 14             // slabs per slab-map leaf (4 GiB)
+#define COMP_MAP_ROOT_SHIFT 15             // leaves: 2^47 bytes of address space
+
+// ===== Accounting =====
+// Bytes are counted at block granularity (the class size for small blocks),
+// so the peak is the memory the caller actually held, not what was asked for
+
+static atomic_size_t g_in_use;
+static atomic_size_t g_peak;
+static atomic_long g_live_blocks;
+static atomic_int g_huge_pages;
+
+static void account_bytes(size_t bytes) {
+    size_t now = atomic_fetch_add_explicit(&g_in_use, bytes, memory_order_relaxed) + bytes;
+    size_t peak = atomic_load_explicit(&g_peak, memory_order_relaxed);
+    while (now > peak && !atomic_compare_exchange_weak_explicit(&g_peak, &peak, now, memory_order_relaxed,
+                                                                memory_order_relaxed)) {
+    }
+}
+
+static void account_alloc(size_t bytes) {
+    account_bytes(bytes);
+    atomic_fetch_add_explicit(&g_live_blocks, 1, memory_order_relaxed);
+}
+
+static void account_free(size_t bytes) {
+    atomic_fetch_sub_explicit(&g_in_use, bytes, memory_order_relaxed);
+    atomic_fetch_sub_explicit(&g_live_blocks, 1, memory_order_relaxed);
+}
+
+// Memory held outside the allocator (input mappings, third-party state)
+// counts towards in-use and peak bytes but not towards live blocks
+void comp_alloc_note_external(size_t bytes) {
+    account_bytes(bytes);
+}
+
+void comp_alloc_drop_external(size_t bytes) {
+    atomic_fetch_sub_explicit(&g_in_use, bytes, memory_order_relaxed);
+}
+
+size_t comp_alloc_in_use(void) {
+    return atomic_load(&g_in_use);
+}
+
+size_t comp_alloc_peak(void) {
+    return atomic_load(&g_peak);
+}
+
+void comp_alloc_reset_peak(void) {
+    atomic_store(&g_peak, atomic_load(&g_in_use));
+}
+
+void comp_alloc_set_huge_pages(int enable) {
+    atomic_store(&g_huge_pages, enable ? 1 : 0);
+}
+
+// ===== OS mappings =====
+
+static void* os_map(size_t size) {
+#ifdef _WIN32
+    return VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+    void* p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) return NULL;
+#ifdef MADV_HUGEPAGE
+    if (size >= COMP_HUGE_PAGE && atomic_load(&g_huge_pages)) (void)madvise(p, size, MADV_HUGEPAGE);
+#endif
+    return p;
+#endif
+}
+
+static void os_unmap(void* p, size_t size) {
+#ifdef _WIN32
+    (void)size;
+    VirtualFree(p, 0, MEM_RELEASE);
+#else
+    munmap(p, size);
+#endif
+}
+
+// ===== Small blocks =====
+// Regions are mapped once and never returned; each of their slabs serves a
+// single size class. A two-level map indexed by slab number records the
+// class of every slab handed out, so comp_free finds a pointer's class
+// with two loads. Leaves are published with a release store and written
+// before any block of their slabs is handed out, so lookups need no lock.
+
+typedef struct FreeBlock {
+    struct FreeBlock* next;
+} FreeBlock;
+
+typedef struct {
+    uintptr_t base;                          // slab-aligned start
+    void* map;                               // what os_map returned
+    int slabs_used;
+} Region;
+
+static Region g_regions[COMP_MAX_REGIONS];
+static int g_region_count;
+static pthread_mutex_t g_region_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Slab map: class + 1 per slab, 0 for memory that is not a slab of ours
+typedef unsigned char SlabLeaf[1 << COMP_MAP_LEAF_SHIFT];
+static SlabLeaf* _Atomic g_slab_map[1 << COMP_MAP_ROOT_SHIFT];
+
+// Blocks returned by threads, per class
+static FreeBlock* g_free_lists[COMP_NUM_CLASSES];
+static pthread_mutex_t g_free_lock = PTHREAD_MUTEX_INITIALIZER;
+
+typedef struct {
+    FreeBlock* head[COMP_NUM_CLASSES];
+    int count[COMP_NUM_CLASSES];
+    int registered;
+} ThreadCache;
+
+static _Thread_local ThreadCache t_cache;
+static pthread_key_t g_cache_key;
+static pthread_once_t g_cache_once = PTHREAD_ONCE_INIT;
+
+static int class_index(size_t size) {
+    if (size <= COMP_ALIGN) return 0;
+    return 64 - __builtin_clzll((unsigned long long)(size - 1)) - 4;
+}
+
+static size_t class_size(int cls) {
+    return (size_t)COMP_ALIGN << cls;
+}
+
+static int small_class_of(const void* ptr) {
+    uint64_t slab = (uint64_t)(uintptr_t)ptr >> COMP_SLAB_SHIFT;
+    uint64_t root = slab >> COMP_MAP_LEAF_SHIFT;
+    if (root >= ((uint64_t)1 << COMP_MAP_ROOT_SHIFT)) return -1;
+    SlabLeaf* leaf = atomic_load_explicit(&g_slab_map[root], memory_order_acquire);
+    if (!leaf) return -1;
+    return (int)(*leaf)[slab & ((1u << COMP_MAP_LEAF_SHIFT) - 1)] - 1;
+}
+
+// Called with g_region_lock held: record slab's class; -1 when the slab
+// lies outside the mapped address range or a leaf cannot be allocated
+static int slab_map_set(uintptr_t slab_start, int cls) {
+    uint64_t slab = (uint64_t)slab_start >> COMP_SLAB_SHIFT;
+    uint64_t root = slab >> COMP_MAP_LEAF_SHIFT;
+    if (root >= ((uint64_t)1 << COMP_MAP_ROOT_SHIFT)) return -1;
+    SlabLeaf* leaf = atomic_load_explicit(&g_slab_map[root], memory_order_relaxed);
+    if (!leaf) {
+        leaf = (SlabLeaf*)calloc(1, sizeof(SlabLeaf));
+        if (!leaf) return -1;
+        atomic_store_explicit(&g_slab_map[root], leaf, memory_order_release);
+    }
+    (*leaf)[slab & ((1u << COMP_MAP_LEAF_SHIFT) - 1)] = (unsigned char)(cls + 1);
+    return 0;
+}
+
+// Take a fresh slab for cls; returns its start or NULL when out of regions
+static unsigned char* new_slab(int cls) {
+    pthread_mutex_lock(&g_region_lock);
+    int n = g_region_count;
+    Region* r = n > 0 ? &g_regions[n - 1] : NULL;
+    if (!r || r->slabs_used == COMP_REGION_SLABS) {
+        void* map = (n < COMP_MAX_REGIONS) ? os_map(COMP_REGION_SIZE + COMP_SLAB_SIZE) : NULL;
+        if (!map) {
+            pthread_mutex_unlock(&g_region_lock);
+            return NULL;
+        }
+        r = &g_regions[n];
+        r->map = map;
+        r->base = ((uintptr_t)map + COMP_SLAB_SIZE - 1) & ~(uintptr_t)(COMP_SLAB_SIZE - 1);
+        r->slabs_used = 0;
+        g_region_count = n + 1;
+    }
+    uintptr_t start = r->base + (uintptr_t)r->slabs_used * COMP_SLAB_SIZE;
+    if (slab_map_set(start, cls) != 0) {
+        pthread_mutex_unlock(&g_region_lock);
+        return NULL;
+    }
+    r->slabs_used++;
+    pthread_mutex_unlock(&g_region_lock);
+    return (unsigned char*)start;
+}
+
+// Hand a thread's cached blocks back to the global lists (thread exit)
+static void cache_flush(void* arg) {
+    ThreadCache* c = (ThreadCache*)arg;
+    pthread_mutex_lock(&g_free_lock);
+    for (int cls = 0; cls < COMP_NUM_CLASSES; cls++) {
+        while (c->head[cls]) {
+            FreeBlock* b = c->head[cls];
+            c->head[cls] = b->next;
+            b->next = g_free_lists[cls];
+            g_free_lists[cls] = b;
+        }
+        c->count[cls] = 0;
+    }
+    pthread_mutex_unlock(&g_free_lock);
+    c->registered = 0;
+}
+
+static void cache_key_create(void) {
+    pthread_key_create(&g_cache_key, cache_flush);
+}
+
+// Fill an empty cache slot from the global list, or from a new slab
+static int cache_refill(ThreadCache* c, int cls) {
+    if (!c->registered) {
+        pthread_once(&g_cache_once, cache_key_create);
+        pthread_setspecific(g_cache_key, c);
+        c->registered = 1;
+    }
+
+    pthread_mutex_lock(&g_free_lock);
+    while (g_free_lists[cls] && c->count[cls] < COMP_CACHE_BATCH) {
+        FreeBlock* b = g_free_lists[cls];
+        g_free_lists[cls] = b->next;
+        b->next = c->head[cls];
+        c->head[cls] = b;
+        c->count[cls]++;
+    }
+    pthread_mutex_unlock(&g_free_lock);
+    if (c->head[cls]) return 0;
+
+    unsigned char* slab = new_slab(cls);
+    if (!slab) return -1;
+    // The first blocks go to this thread, the rest to the global list
+    size_t bsize = class_size(cls);
+    long blocks = (long)(COMP_SLAB_SIZE / bsize);
+    long mine = blocks < COMP_CACHE_BATCH ? blocks : COMP_CACHE_BATCH;
+    for (long i = mine - 1; i >= 0; i--) {
+        FreeBlock* b = (FreeBlock*)(slab + (size_t)i * bsize);
+        b->next = c->head[cls];
+        c->head[cls] = b;
+    }
+    c->count[cls] = (int)mine;
+    if (blocks > mine) {
+        FreeBlock* first = (FreeBlock*)(slab + (size_t)mine * bsize);
+        for (long i = mine; i < blocks - 1; i++) {
+            ((FreeBlock*)(slab + (size_t)i * bsize))->next = (FreeBlock*)(slab + (size_t)(i + 1) * bsize);
+        }
+        FreeBlock* last = (FreeBlock*)(slab + (size_t)(blocks - 1) * bsize);
+        pthread_mutex_lock(&g_free_lock);
+        last->next = g_free_lists[cls];
+        g_free_lists[cls] = first;
+        pthread_mutex_unlock(&g_free_lock);
+    }
+    return 0;
+}
+
+static void cache_spill(ThreadCache* c, int cls) {
+    FreeBlock* first = c->head[cls];
+    FreeBlock* last = first;
+    for (int i = 1; i < COMP_CACHE_BATCH; i++) last = last->next;
+    c->head[cls] = last->next;
+    c->count[cls] -= COMP_CACHE_BATCH;
+    pthread_mutex_lock(&g_free_lock);
+    last->next = g_free_lists[cls];
+    g_free_lists[cls] = first;
+    pthread_mutex_unlock(&g_free_lock);
+}
+
+// ===== Large blocks =====
+// Blocks above COMP_SMALL_MAX are kept in an open-addressing table keyed by
+// address, which tells comp_free both that a pointer is ours and its size.
+// A few freed mappings are kept and handed out again, since block-sized
+// buffers come and go once per block and fresh mappings fault every page.
+
+typedef struct {
+    void* ptr;
+    size_t size;
+} LargeEntry;
+
+static LargeEntry* g_large;
+static size_t g_large_cap;
+static size_t g_large_count;
+static pthread_mutex_t g_large_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static LargeEntry g_map_cache[COMP_MAP_CACHE];
+static int g_map_cached;
+static size_t g_map_cached_bytes;
+
+static size_t large_slot(const void* ptr, size_t cap) {
+    uint64_t h = (uint64_t)(uintptr_t)ptr * 0x9E3779B97F4A7C15ULL;
+    return (size_t)(h >> 32) & (cap - 1);
+}
+
+static void large_put(LargeEntry* table, size_t cap, void* ptr, size_t size) {
+    size_t i = large_slot(ptr, cap);
+    while (table[i].ptr) i = (i + 1) & (cap - 1);
+    table[i].ptr = ptr;
+    table[i].size = size;
+}
+
+// Called with g_large_lock held; the table stays at most half full
+static int large_insert(void* ptr, size_t size) {
+    if ((g_large_count + 1) * 2 > g_large_cap) {
+        size_t cap = g_large_cap ? g_large_cap * 2 : 256;
+        LargeEntry* table = (LargeEntry*)calloc(cap, sizeof(LargeEntry));
+        if (!table) return -1;
+        for (size_t i = 0; i < g_large_cap; i++) {
+            if (g_large[i].ptr) large_put(table, cap, g_large[i].ptr, g_large[i].size);
+        }
+        free(g_large);
+        g_large = table;
+        g_large_cap = cap;
+    }
+    large_put(g_large, g_large_cap, ptr, size);
+    g_large_count++;
+    return 0;
+}
+
+// Called with g_large_lock held; backward-shift deletion keeps probe chains intact
+static int large_remove(const void* ptr, size_t* size) {
+    if (!g_large_cap) return 0;
+    size_t mask = g_large_cap - 1;
+    size_t i = large_slot(ptr, g_large_cap);
+    while (g_large[i].ptr != ptr) {
+        if (!g_large[i].ptr) return 0;
+        i = (i + 1) & mask;
+    }
+    *size = g_large[i].size;
+    size_t hole = i;
+    for (size_t j = (i + 1) & mask; g_large[j].ptr; j = (j + 1) & mask) {
+        size_t home = large_slot(g_large[j].ptr, g_large_cap);
+        // Move j into the hole unless its home lies cyclically in (hole, j]
+        if (((j - home) & mask) >= ((j - hole) & mask)) {
+            g_large[hole] = g_large[j];
+            hole = j;
+        }
+    }
+    g_large[hole].ptr = NULL;
+    g_large_count--;
+    return 1;
+}
+
+// Called with g_large_lock held: size of a large block, 0 if not ours
+static size_t large_size(const void* ptr) {
+    if (!g_large_cap) return 0;
+    size_t mask = g_large_cap - 1;
+    for (size_t i = large_slot(ptr, g_large_cap); g_large[i].ptr; i = (i + 1) & mask) {
+        if (g_large[i].ptr == ptr) return g_large[i].size;
+    }
+    return 0;
+}
+
+// Called with g_large_lock held: a cached mapping of size..size + size / 4
+static void* map_cache_take(size_t size) {
+    for (int i = 0; i < g_map_cached; i++) {
+        if (g_map_cache[i].size >= size && g_map_cache[i].size - size <= size / 4) {
+            void* p = g_map_cache[i].ptr;
+            g_map_cached_bytes -= g_map_cache[i].size;
+            g_map_cache[i] = g_map_cache[--g_map_cached];
+            return p;
+        }
+    }
+    return NULL;
+}
+
+// Called with g_large_lock held; returns 0 when the cache is full
+static int map_cache_put(void* ptr, size_t size) {
+    if (g_map_cached == COMP_MAP_CACHE || g_map_cached_bytes + size > COMP_MAP_CACHE_BYTES) return 0;
+    g_map_cache[g_map_cached].ptr = ptr;
+    g_map_cache[g_map_cached].size = size;
+    g_map_cached++;
+    g_map_cached_bytes += size;
+    return 1;
+}
+
+static void* large_alloc(size_t size) {
+    int mapped = size >= COMP_MMAP_THRESHOLD;
+    void* p = NULL;
+    if (mapped) {
+        size = (size + COMP_MAP_GRANULE - 1) & ~(size_t)(COMP_MAP_GRANULE - 1);
+        pthread_mutex_lock(&g_large_lock);
+        p = map_cache_take(size);
+        pthread_mutex_unlock(&g_large_lock);
+        if (!p) p = os_map(size);
+    } else {
+        p = malloc(size);
+    }
+    if (!p) return NULL;
+    pthread_mutex_lock(&g_large_lock);
+    int rc = large_insert(p, size);
+    pthread_mutex_unlock(&g_large_lock);
+    if (rc != 0) {
+        if (mapped) os_unmap(p, size);
+        else free(p);
+        return NULL;
+    }
+    account_alloc(size);
+    return p;
+}
+
+// ===== Public entry points =====
+
+void* comp_malloc(size_t size) {
+    if (size == 0) return NULL;
+    if (size > COMP_SMALL_MAX) return large_alloc(size);
+
+    int cls = class_index(size);
+    ThreadCache* c = &t_cache;
+    if (!c->head[cls] && cache_refill(c, cls) != 0) {
+        return large_alloc(size);   // out of regions; the large path still works
+    }
+    FreeBlock* b = c->head[cls];
+    c->head[cls] = b->next;
+    c->count[cls]--;
+    account_alloc(class_size(cls));
+    return b;
+}
+
+void comp_free(void* ptr) {
+    if (!ptr) return;
+
+    int cls = small_class_of(ptr);
+    if (cls >= 0) {
+        ThreadCache* c = &t_cache;
+        FreeBlock* b = (FreeBlock*)ptr;
+        b->next = c->head[cls];
+        c->head[cls] = b;
+        c->count[cls]++;
+        account_free(class_size(cls));
+        if (c->count[cls] > COMP_CACHE_MAX) cache_spill(c, cls);
+        return;
+    }
+
+    size_t size = 0;
+    pthread_mutex_lock(&g_large_lock);
+    int found = large_remove(ptr, &size);
+    int cached = found && size >= COMP_MMAP_THRESHOLD && map_cache_put(ptr, size);
+    pthread_mutex_unlock(&g_large_lock);
+    if (found) {
+        if (!cached) {
+            if (size >= COMP_MMAP_THRESHOLD) os_unmap(ptr, size);
+            else free(ptr);
+        }
+        account_free(size);
+        return;
+    }
+    // Not ours: a malloc'd buffer from read_file or one of the codecs
+    free(ptr);
+}
+
+void* comp_calloc(size_t count, size_t size) {
+    if (size && count > (size_t)-1 / size) return NULL;
+    void* p = comp_malloc(count * size);
+    if (p) memset(p, 0, count * size);
+    return p;
+}
+
+void* comp_realloc(void* ptr, size_t size) {
+    if (!ptr) return comp_malloc(size);
+    if (size == 0) {
+        comp_free(ptr);
+        return NULL;
+    }
+    size_t old = 0;
+    int cls = small_class_of(ptr);
+    if (cls >= 0) {
+        old = class_size(cls);
+    } else {
+        pthread_mutex_lock(&g_large_lock);
+        old = large_size(ptr);
+        pthread_mutex_unlock(&g_large_lock);
+        // Not ours: leave it with the C library
+        if (!old) return realloc(ptr, size);
+    }
+    if (size <= old && (cls >= 0 ? class_index(size) == cls : size > old / 2)) return ptr;
+    void* p = comp_malloc(size);
+    if (!p) return NULL;
+    memcpy(p, ptr, size < old ? size : old);
+    comp_free(ptr);
+    return p;
+}
+
+// Legacy compatibility (deprecated)
+void* tracked_malloc(size_t size) {
+    return COMP_MALLOC(size);
+}
+
+void tracked_free(void* ptr, size_t size) {
+    (void)size; // Ignore size parameter in new implementation
+    COMP_FREE(ptr);
+}
+
+// Panic handler for unrecoverable states
+void comp_panic(const char* message) {
+    fprintf(stderr, "PANIC: %s\n", message);
+    fprintf(stderr, "Allocator stats - In use: %zu, Peak: %zu, Live blocks: %ld\n",
+            comp_alloc_in_use(), comp_alloc_peak(), atomic_load(&g_live_blocks));
+
+    // Jump to recovery point
+    longjmp(g_panic_buf, 1);
+}
+
+// Leak detector - call on exit
+void comp_check_leaks(void) {
+    long live = atomic_load(&g_live_blocks);
+    if (live > 0) {
+        fprintf(stderr, "LEAK: %zu bytes in %ld blocks\n", comp_alloc_in_use(), live);
+    }
+}
+
+// ===== Arenas =====
+
+typedef struct ArenaChunk {
+    struct ArenaChunk* next;
+    size_t size;
+    size_t used;
+} ArenaChunk;
+
+#define ARENA_HEADER ((sizeof(ArenaChunk) + COMP_ALIGN - 1) & ~(size_t)(COMP_ALIGN - 1))
+
+struct CompArena {
+    ArenaChunk* head;        // chunk being bumped; older chunks follow
+    size_t chunk_size;
+    size_t job_bytes;        // bytes handed out since the last reset
+};
+
+static ArenaChunk* arena_chunk(size_t size) {
+    ArenaChunk* chunk = (ArenaChunk*)comp_malloc(ARENA_HEADER + size);
+    if (!chunk) return NULL;
+    chunk->next = NULL;
+    chunk->size = size;
+    chunk->used = 0;
+    return chunk;
+}
+
+CompArena* comp_arena_create(size_t chunk_size) {
+    CompArena* arena = (CompArena*)comp_malloc(sizeof(CompArena));
+    if (!arena) return NULL;
+    arena->head = NULL;
+    arena->chunk_size = chunk_size ? chunk_size : COMP_ARENA_CHUNK;
+    arena->job_bytes = 0;
+    return arena;
+}
+
+void* comp_arena_alloc(CompArena* arena, size_t size) {
+    if (!arena || size == 0) return NULL;
+    size = (size + COMP_ALIGN - 1) & ~(size_t)(COMP_ALIGN - 1);
+    ArenaChunk* chunk = arena->head;
+    if (!chunk || chunk->size - chunk->used < size) {
+        // Chunks at least double, so a job needs O(log n) of them
+        size_t cap = arena->chunk_size;
+        if (chunk && cap < chunk->size * 2) cap = chunk->size * 2;
+        if (cap < size) cap = size;
+        ArenaChunk* fresh = arena_chunk(cap);
+        if (!fresh) return NULL;
+        fresh->next = chunk;
+        arena->head = chunk = fresh;
+    }
+    void* p = (unsigned char*)chunk + ARENA_HEADER + chunk->used;
+    chunk->used += size;
+    arena->job_bytes += size;
+    return p;
+}
+
+void comp_arena_reset(CompArena* arena) {
+    if (!arena) return;
+    ArenaChunk* chunk = arena->head;
+    if (chunk && chunk->next) {
+        // Several chunks: replace them with one that holds the whole job
+        size_t cap = arena->job_bytes > arena->chunk_size ? arena->job_bytes : arena->chunk_size;
+        while (chunk) {
+            ArenaChunk* next = chunk->next;
+            comp_free(chunk);
+            chunk = next;
+        }
+        arena->head = arena_chunk(cap);
+    } else if (chunk) {
+        chunk->used = 0;
+    }
+    arena->job_bytes = 0;
+}
+
+void comp_arena_destroy(CompArena* arena) {
+    if (!arena) return;
+    ArenaChunk* chunk = arena->head;
+    while (chunk) {
+        ArenaChunk* next = chunk->next;
+        comp_free(chunk);
+        chunk = next;
+    }
+    comp_free(arena);
+}
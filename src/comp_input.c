@@ -0,0 +1,149 @@
+#define _GNU_SOURCE
+#include "../include/comp_input.h"
+#include "../include/comp_alloc.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <io.h>
+#define read _read
+#define close _close
+#define open _open
+#define fstat _fstat
+#define stat _stat
+#define COMP_INPUT_OPEN_FLAGS (O_RDONLY | O_BINARY)
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#define COMP_INPUT_OPEN_FLAGS (O_RDONLY | O_CLOEXEC)
+#endif
+
+// First buffer for input of unknown size; doubles from there
+#define COMP_INPUT_PIPE_CHUNK (64 * 1024)
+
+// Stand-in data pointer for empty inputs
+static const unsigned char comp_input_empty[1] = { 0 };
+
+// Read fd to EOF into a heap buffer; size_hint is the expected size (0 if unknown)
+static int comp_input_read_fd(int fd, size_t size_hint, CompInput* in) {
+    size_t cap = size_hint ? size_hint + 1 : COMP_INPUT_PIPE_CHUNK;
+    unsigned char* buf = (unsigned char*)comp_malloc(cap);
+    if (!buf) { errno = ENOMEM; return -1; }
+    size_t len = 0;
+    for (;;) {
+        if (len == cap) {
+            unsigned char* grown = (unsigned char*)comp_realloc(buf, cap * 2);
+            if (!grown) { comp_free(buf); errno = ENOMEM; return -1; }
+            buf = grown;
+            cap *= 2;
+        }
+        size_t want = cap - len;
+        if (want > (1u << 30)) want = 1u << 30;
+        long n = (long)read(fd, buf + len, (unsigned)want);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            comp_free(buf);
+            return -1;
+        }
+        if (n == 0) break;
+        len += (size_t)n;
+    }
+    in->data = buf;
+    in->size = len;
+    in->heap = buf;
+    return 0;
+}
+
+int comp_input_open_fd(int fd, CompInputAccess access, CompInput* in) {
+    if (!in || fd < 0) { errno = EINVAL; return -1; }
+    memset(in, 0, sizeof(*in));
+    struct stat st;
+    if (fstat(fd, &st) != 0) return -1;
+    int regular = (st.st_mode & S_IFMT) == S_IFREG;
+    if (regular && st.st_size == 0) {
+        in->data = comp_input_empty;
+        return 0;
+    }
+#ifndef _WIN32
+    if (regular && (unsigned long long)st.st_size <= (size_t)-1) {
+        size_t size = (size_t)st.st_size;
+        void* map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+            int advice = (access == COMP_INPUT_SEQUENTIAL) ? MADV_SEQUENTIAL
+                       : (access == COMP_INPUT_RANDOM)     ? MADV_WILLNEED : MADV_RANDOM;
+            (void)madvise(map, size, advice);
+            in->data = (const unsigned char*)map;
+            in->size = size;
+            in->map = map;
+            in->map_size = size;
+            // Counted with the heap, since codecs hold it like a buffer
+            comp_alloc_note_external(size);
+            return 0;
+        }
+        // Filesystems without mmap support take the buffered path
+    }
+#else
+    (void)access;
+#endif
+    return comp_input_read_fd(fd, regular ? (size_t)st.st_size : 0, in);
+}
+
+int comp_input_open(const char* path, CompInputAccess access, CompInput* in) {
+    if (!path || !in) { errno = EINVAL; return -1; }
+    memset(in, 0, sizeof(*in));
+    int fd = open(path, COMP_INPUT_OPEN_FLAGS);
+    if (fd < 0) return -1;
+    int r = comp_input_open_fd(fd, access, in);
+    int saved = errno;
+    close(fd);  // a mapping outlives its descriptor
+    errno = saved;
+    return r;
+}
+
+void comp_input_close(CompInput* in) {
+    if (!in) return;
+#ifndef _WIN32
+    if (in->map) {
+        munmap(in->map, in->map_size);
+        comp_alloc_drop_external(in->map_size);
+    }
+#endif
+    comp_free(in->heap);
+    memset(in, 0, sizeof(*in));
+}
+
+int comp_input_read_all(FILE* f, unsigned char** buffer, size_t* size) {
+    if (!f || !buffer || !size) return -1;
+    *buffer = NULL;
+    *size = 0;
+    // Regular files are read in one go at their current size
+    size_t cap = COMP_INPUT_PIPE_CHUNK;
+    struct stat st;
+    if (fstat(fileno(f), &st) == 0 && (st.st_mode & S_IFMT) == S_IFREG) {
+        long pos = ftell(f);
+        if (pos >= 0 && (long long)st.st_size >= pos) cap = (size_t)(st.st_size - pos) + 1;
+    }
+    unsigned char* buf = (unsigned char*)malloc(cap);
+    if (!buf) return -1;
+    size_t len = 0;
+    for (;;) {
+        if (len == cap) {
+            unsigned char* grown = (unsigned char*)realloc(buf, cap * 2);
+            if (!grown) { free(buf); return -1; }
+            buf = grown;
+            cap *= 2;
+        }
+        size_t n = fread(buf + len, 1, cap - len, f);
+        len += n;
+        if (n == 0 || len < cap) {
+            if (ferror(f)) { free(buf); return -1; }
+            if (feof(f)) break;
+        }
+    }
+    *buffer = buf;
+    *size = len;
+    return 0;
+}
@@ -0,0 +1,449 @@
+#include "../include/comp_stream.h"
+#include "../include/thread_pool.h"
+#include <stdint.h>
+#include <time.h>
+
+// Streaming DEFLATE (deflate_wrapper.c)
+typedef int (*deflate_put_fn)(const void* buf, int len, void* user);
+typedef struct deflate_stream deflate_stream;
+typedef struct inflate_stream inflate_stream;
+deflate_stream* deflate_stream_create(int level, deflate_put_fn put, void* user);
+int deflate_stream_write(deflate_stream* s, const uint8_t* in, size_t len, int flush);
+void deflate_stream_destroy(deflate_stream* s);
+inflate_stream* inflate_stream_create(deflate_put_fn put, void* user);
+int inflate_stream_write(inflate_stream* s, const uint8_t* in, size_t len, size_t* consumed);
+void inflate_stream_destroy(inflate_stream* s);
+
+uint32_t CRC32_Calculate(const uint8_t* data, size_t size);
+
+static void put_be32(unsigned char* p, uint32_t v) {
+    p[0] = (unsigned char)(v >> 24); p[1] = (unsigned char)(v >> 16);
+    p[2] = (unsigned char)(v >> 8); p[3] = (unsigned char)v;
+}
+
+static void put_be64(unsigned char* p, uint64_t v) {
+    put_be32(p, (uint32_t)(v >> 32)); put_be32(p + 4, (uint32_t)v);
+}
+
+static uint32_t get_be32(const unsigned char* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static uint64_t get_be64(const unsigned char* p) {
+    return ((uint64_t)get_be32(p) << 32) | get_be32(p + 4);
+}
+
+static double stream_time_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+// ===== Compression =====
+
+struct CompStream {
+    FILE* out;
+    CompressionAlgorithm algo;
+    CompressionLevel level;
+    FileType file_type;
+    ThreadPool* pool;           // blockwise workers, NULL = calling thread
+    deflate_stream* deflate;
+    unsigned char* chunk;       // LZ77 / blockwise input gathered so far
+    long chunk_cap;
+    long chunk_size;
+    unsigned char* lz_out;      // LZ77 payload, lz77_compress_bound(chunk_cap)
+    long lz_out_cap;
+    uint64_t total_in;
+    uint64_t total_out;
+    int failed;
+};
+
+static CompResult stream_write(CompStream* s, const void* data, size_t size) {
+    if (size && fwrite(data, 1, size, s->out) != size) return COMP_ERR_FILE_WRITE;
+    s->total_out += size;
+    return COMP_SUCCESS;
+}
+
+static int stream_deflate_put(const void* buf, int len, void* user) {
+    return stream_write((CompStream*)user, buf, (size_t)len) == COMP_SUCCESS;
+}
+
+static CompResult stream_write_frame(CompStream* s, CompressionAlgorithm algo, const unsigned char* block,
+                                     long block_size, const unsigned char* payload, long payload_size) {
+    unsigned char hdr[COMP_STREAM_FRAME_HEADER];
+    hdr[0] = (unsigned char)algo;
+    put_be32(hdr + 1, (uint32_t)block_size);
+    put_be32(hdr + 5, (uint32_t)payload_size);
+    put_be32(hdr + 9, CRC32_Calculate(block, (size_t)block_size));
+    CompResult r = stream_write(s, hdr, sizeof(hdr));
+    if (r == COMP_SUCCESS) r = stream_write(s, payload, (size_t)payload_size);
+    return r;
+}
+
+static CompResult stream_block_sink(void* ctx, const unsigned char* block, long block_size,
+                                    CompressionAlgorithm algo, const unsigned char* payload, long payload_size) {
+    return stream_write_frame((CompStream*)ctx, algo, block, block_size, payload, payload_size);
+}
+
+// Compress the gathered chunk into frames and empty it
+static CompResult stream_emit_chunk(CompStream* s) {
+    if (s->chunk_size == 0) return COMP_SUCCESS;
+    CompResult r;
+    if (s->algo == ALGO_BLOCKWISE) {
+        r = blockwise_compress_chunk(s->chunk, s->chunk_size, s->file_type, s->level, s->pool,
+                                     stream_block_sink, s);
+    } else {
+        // Input LZ77 cannot shrink is stored, the same way blockwise marks it
+        long written = 0;
+        int lz = lz77_compress_into(s->chunk, s->chunk_size, s->lz_out, s->lz_out_cap, &written, s->level);
+        if (lz == 0 && written < s->chunk_size) {
+            r = stream_write_frame(s, ALGO_LZ77, s->chunk, s->chunk_size, s->lz_out, written);
+        } else {
+            r = stream_write_frame(s, ALGO_HUFFMAN, s->chunk, s->chunk_size, s->chunk, s->chunk_size);
+        }
+    }
+    s->chunk_size = 0;
+    return r;
+}
+
+CompStream* comp_stream_init(FILE* out, CompressionAlgorithm algo, CompressionLevel level,
+                             FileType file_type, int threads) {
+    if (!out || (algo != ALGO_DEFLATE && algo != ALGO_LZ77 && algo != ALGO_BLOCKWISE)) return NULL;
+    CompStream* s = (CompStream*)comp_calloc(1, sizeof(CompStream));
+    if (!s) return NULL;
+    s->out = out;
+    s->algo = algo;
+    s->level = level;
+    s->file_type = file_type;
+
+    int ok = 1;
+    if (algo == ALGO_DEFLATE) {
+        // Levels 1-4 map onto miniz levels 1, 6, 9 and 10 (uber)
+        static const int deflate_levels[] = { 6, 1, 6, 9, 10 };
+        int lvl = (level >= COMPRESSION_LEVEL_FAST && level <= COMPRESSION_LEVEL_ULTRA) ? deflate_levels[level] : 6;
+        s->deflate = deflate_stream_create(lvl, stream_deflate_put, s);
+        ok = s->deflate != NULL;
+    } else {
+        s->chunk_cap = (algo == ALGO_LZ77) ? COMP_STREAM_LZ77_CHUNK : COMP_STREAM_BLOCKWISE_CHUNK;
+        s->chunk = (unsigned char*)comp_malloc((size_t)s->chunk_cap);
+        ok = s->chunk != NULL;
+        if (ok && algo == ALGO_LZ77) {
+            s->lz_out_cap = lz77_compress_bound(s->chunk_cap);
+            s->lz_out = (unsigned char*)comp_malloc((size_t)s->lz_out_cap);
+            ok = s->lz_out != NULL;
+        }
+        if (ok && algo == ALGO_BLOCKWISE && threads != 1) {
+            s->pool = thread_pool_create(threads);
+        }
+    }
+
+    unsigned char hdr[COMP_STREAM_HEADER_SIZE];
+    memcpy(hdr, COMP_STREAM_MAGIC, 4);
+    hdr[4] = COMP_STREAM_VERSION;
+    hdr[5] = (unsigned char)algo;
+    hdr[6] = (unsigned char)level;
+    hdr[7] = 0;
+    if (!ok || stream_write(s, hdr, sizeof(hdr)) != COMP_SUCCESS) {
+        s->failed = 1;
+        comp_stream_finish(s, NULL, NULL);
+        return NULL;
+    }
+    return s;
+}
+
+CompResult comp_stream_feed(CompStream* s, const unsigned char* data, size_t size) {
+    if (!s || (!data && size)) return COMP_ERR_INVALID_PARAMS;
+    if (s->failed) return COMP_ERR_COMPRESSION_FAILED;
+    s->total_in += size;
+    CompResult r = COMP_SUCCESS;
+    if (s->algo == ALGO_DEFLATE) {
+        if (size && deflate_stream_write(s->deflate, data, size, 0) != 0) r = COMP_ERR_COMPRESSION_FAILED;
+    } else {
+        while (size > 0 && r == COMP_SUCCESS) {
+            size_t take = (size_t)(s->chunk_cap - s->chunk_size);
+            if (take > size) take = size;
+            memcpy(s->chunk + s->chunk_size, data, take);
+            s->chunk_size += (long)take;
+            data += take;
+            size -= take;
+            if (s->chunk_size == s->chunk_cap) r = stream_emit_chunk(s);
+        }
+    }
+    if (r != COMP_SUCCESS) s->failed = 1;
+    return r;
+}
+
+CompResult comp_stream_flush(CompStream* s) {
+    if (!s) return COMP_ERR_INVALID_PARAMS;
+    if (s->failed) return COMP_ERR_COMPRESSION_FAILED;
+    CompResult r;
+    if (s->algo == ALGO_DEFLATE) {
+        r = (deflate_stream_write(s->deflate, NULL, 0, 1) == 0) ? COMP_SUCCESS : COMP_ERR_COMPRESSION_FAILED;
+    } else {
+        r = stream_emit_chunk(s);
+    }
+    if (r == COMP_SUCCESS && fflush(s->out) != 0) r = COMP_ERR_FILE_WRITE;
+    if (r != COMP_SUCCESS) s->failed = 1;
+    return r;
+}
+
+CompResult comp_stream_finish(CompStream* s, uint64_t* total_in, uint64_t* total_out) {
+    if (!s) return COMP_ERR_INVALID_PARAMS;
+    CompResult r = s->failed ? COMP_ERR_COMPRESSION_FAILED : COMP_SUCCESS;
+    if (r == COMP_SUCCESS) {
+        if (s->algo == ALGO_DEFLATE) {
+            if (deflate_stream_write(s->deflate, NULL, 0, 2) != 0) r = COMP_ERR_COMPRESSION_FAILED;
+        } else {
+            r = stream_emit_chunk(s);
+            unsigned char end[COMP_STREAM_FRAME_HEADER] = { 0 };
+            if (r == COMP_SUCCESS) r = stream_write(s, end, sizeof(end));
+        }
+    }
+    if (r == COMP_SUCCESS) {
+        unsigned char trailer[COMP_STREAM_TRAILER_SIZE];
+        put_be64(trailer, s->total_in);
+        r = stream_write(s, trailer, sizeof(trailer));
+    }
+    if (r == COMP_SUCCESS && fflush(s->out) != 0) r = COMP_ERR_FILE_WRITE;
+    if (total_in) *total_in = s->total_in;
+    if (total_out) *total_out = s->total_out;
+
+    thread_pool_destroy(s->pool);
+    deflate_stream_destroy(s->deflate);
+    comp_free(s->chunk);
+    comp_free(s->lz_out);
+    comp_free(s);
+    return r;
+}
+
+// ===== Decompression =====
+// Input is consumed in whatever pieces it arrives: pending collects the
+// header, each frame header and payload, and the trailer until complete.
+
+typedef enum {
+    DSTREAM_HEADER,
+    DSTREAM_DEFLATE,
+    DSTREAM_FRAME_HEADER,
+    DSTREAM_FRAME_PAYLOAD,
+    DSTREAM_TRAILER,
+    DSTREAM_DONE
+} DecompStreamState;
+
+struct DecompStream {
+    FILE* out;
+    DecompStreamState state;
+    CompressionAlgorithm algo;
+    inflate_stream* inflate;
+    unsigned char* pending;
+    size_t pending_size;
+    size_t pending_need;        // bytes that complete the current part
+    unsigned char* frame_out;   // decoded frame, COMP_STREAM_MAX_FRAME
+    unsigned char frame_algo;
+    uint32_t frame_orig;
+    uint32_t frame_crc;
+    uint64_t total_out;
+    CompResult error;
+};
+
+static int stream_inflate_put(const void* buf, int len, void* user) {
+    DecompStream* s = (DecompStream*)user;
+    if (fwrite(buf, 1, (size_t)len, s->out) != (size_t)len) return 0;
+    s->total_out += (uint64_t)len;
+    return 1;
+}
+
+// Act on a completed header, frame header, payload or trailer in pending
+static CompResult decomp_stream_part(DecompStream* s) {
+    const unsigned char* p = s->pending;
+    switch (s->state) {
+        case DSTREAM_HEADER:
+            if (memcmp(p, COMP_STREAM_MAGIC, 4) != 0 || p[4] != COMP_STREAM_VERSION) return COMP_ERR_INVALID_FORMAT;
+            s->algo = (CompressionAlgorithm)p[5];
+            if (s->algo == ALGO_DEFLATE) {
+                s->inflate = inflate_stream_create(stream_inflate_put, s);
+                if (!s->inflate) return COMP_ERR_MEMORY;
+                s->state = DSTREAM_DEFLATE;
+                s->pending_need = 0;
+            } else if (s->algo == ALGO_LZ77 || s->algo == ALGO_BLOCKWISE) {
+                // Frame buffers: the largest payload the frame header check lets through
+                unsigned char* grown = (unsigned char*)comp_realloc(s->pending, (size_t)lz77_compress_bound(COMP_STREAM_MAX_FRAME));
+                if (!grown) return COMP_ERR_MEMORY;
+                s->pending = grown;
+                s->frame_out = (unsigned char*)comp_malloc(COMP_STREAM_MAX_FRAME);
+                if (!s->frame_out) return COMP_ERR_MEMORY;
+                s->state = DSTREAM_FRAME_HEADER;
+                s->pending_need = COMP_STREAM_FRAME_HEADER;
+            } else {
+                return COMP_ERR_UNSUPPORTED_FORMAT;
+            }
+            return COMP_SUCCESS;
+        case DSTREAM_FRAME_HEADER: {
+            s->frame_algo = p[0];
+            s->frame_orig = get_be32(p + 1);
+            uint32_t comp = get_be32(p + 5);
+            s->frame_crc = get_be32(p + 9);
+            if (s->frame_orig == 0) {
+                s->state = DSTREAM_TRAILER;
+                s->pending_need = COMP_STREAM_TRAILER_SIZE;
+                return COMP_SUCCESS;
+            }
+            if (s->frame_orig > COMP_STREAM_MAX_FRAME || comp == 0 ||
+                comp > (uint32_t)lz77_compress_bound(COMP_STREAM_MAX_FRAME)) {
+                return COMP_ERR_INVALID_FORMAT;
+            }
+            s->state = DSTREAM_FRAME_PAYLOAD;
+            s->pending_need = comp;
+            return COMP_SUCCESS;
+        }
+        case DSTREAM_FRAME_PAYLOAD: {
+            CompResult r = blockwise_decode_block_into(s->frame_algo, p, (long)s->pending_need,
+                                                       s->frame_out, (long)s->frame_orig);
+            if (r != COMP_SUCCESS) return r;
+            if (CRC32_Calculate(s->frame_out, s->frame_orig) != s->frame_crc) return COMP_ERR_CHECKSUM_FAILED;
+            if (fwrite(s->frame_out, 1, s->frame_orig, s->out) != s->frame_orig) return COMP_ERR_FILE_WRITE;
+            s->total_out += s->frame_orig;
+            s->state = DSTREAM_FRAME_HEADER;
+            s->pending_need = COMP_STREAM_FRAME_HEADER;
+            return COMP_SUCCESS;
+        }
+        case DSTREAM_TRAILER:
+            if (get_be64(p) != s->total_out) return COMP_ERR_INVALID_SIZE;
+            s->state = DSTREAM_DONE;
+            s->pending_need = 0;
+            return COMP_SUCCESS;
+        default:
+            return COMP_ERR_INTERNAL;
+    }
+}
+
+DecompStream* decomp_stream_init(FILE* out) {
+    if (!out) return NULL;
+    DecompStream* s = (DecompStream*)comp_calloc(1, sizeof(DecompStream));
+    if (!s) return NULL;
+    s->out = out;
+    s->state = DSTREAM_HEADER;
+    s->pending_need = COMP_STREAM_HEADER_SIZE;
+    // Header and trailer only; frame streams grow this once the header is read
+    s->pending = (unsigned char*)comp_malloc(COMP_STREAM_FRAME_HEADER);
+    if (!s->pending) {
+        comp_free(s);
+        return NULL;
+    }
+    return s;
+}
+
+CompResult decomp_stream_feed(DecompStream* s, const unsigned char* data, size_t size) {
+    if (!s || (!data && size)) return COMP_ERR_INVALID_PARAMS;
+    if (s->error != COMP_SUCCESS) return s->error;
+    CompResult r = COMP_SUCCESS;
+    while (size > 0 && r == COMP_SUCCESS) {
+        if (s->state == DSTREAM_DONE) {
+            r = COMP_ERR_INVALID_FORMAT;    // data after the trailer
+        } else if (s->state == DSTREAM_DEFLATE) {
+            size_t used = 0;
+            int st = inflate_stream_write(s->inflate, data, size, &used);
+            data += used;
+            size -= used;
+            if (st < 0) {
+                r = COMP_ERR_DECOMPRESSION_FAILED;
+            } else if (st == 1) {
+                s->state = DSTREAM_TRAILER;
+                s->pending_need = COMP_STREAM_TRAILER_SIZE;
+            }
+        } else {
+            size_t take = s->pending_need - s->pending_size;
+            if (take > size) take = size;
+            memcpy(s->pending + s->pending_size, data, take);
+            s->pending_size += take;
+            data += take;
+            size -= take;
+            if (s->pending_size == s->pending_need) {
+                r = decomp_stream_part(s);
+                s->pending_size = 0;
+            }
+        }
+    }
+    if (r != COMP_SUCCESS) s->error = r;
+    return r;
+}
+
+CompResult decomp_stream_finish(DecompStream* s, uint64_t* total_out) {
+    if (!s) return COMP_ERR_INVALID_PARAMS;
+    CompResult r = s->error;
+    if (r == COMP_SUCCESS && s->state != DSTREAM_DONE) r = COMP_ERR_INVALID_FORMAT;
+    if (r == COMP_SUCCESS && fflush(s->out) != 0) r = COMP_ERR_FILE_WRITE;
+    if (total_out) *total_out = s->total_out;
+    inflate_stream_destroy(s->inflate);
+    comp_free(s->pending);
+    comp_free(s->frame_out);
+    comp_free(s);
+    return r;
+}
+
+// ===== FILE* drivers =====
+
+static void stream_fill_stats(CompressionStats* stats, CompressionAlgorithm algo, CompressionLevel level,
+                              uint64_t original, uint64_t compressed, double elapsed_ms) {
+    if (!stats) return;
+    memset(stats, 0, sizeof(CompressionStats));
+    time(&stats->compression_time);
+    stats->algorithm_used = algo;
+    stats->compression_level = level;
+    stats->original_size = (long)original;
+    stats->compressed_size = (long)compressed;
+    stats->compression_ratio = original ? (double)compressed / (double)original * 100.0 : 0.0;
+    if (elapsed_ms > 0) stats->compression_speed = (original / 1024.0 / 1024.0) / (elapsed_ms / 1000.0);
+    // Peak since the driver started: the I/O chunk, the stream's buffers and
+    // codec state, all of which come from comp_malloc
+    stats->memory_usage = comp_alloc_peak() / 1024.0 / 1024.0;
+}
+
+CompResult comp_stream_file(FILE* in, FILE* out, CompressionAlgorithm algo, CompressionLevel level,
+                            FileType file_type, int threads, CompressionStats* stats) {
+    if (!in || !out) return COMP_ERR_INVALID_PARAMS;
+    double start = stream_time_ms();
+    comp_alloc_reset_peak();
+    unsigned char* buf = (unsigned char*)comp_malloc(COMP_STREAM_IO_CHUNK);
+    CompStream* s = buf ? comp_stream_init(out, algo, level, file_type, threads) : NULL;
+    if (!s) { comp_free(buf); return buf ? COMP_ERR_INVALID_PARAMS : COMP_ERR_MEMORY; }
+
+    CompResult r = COMP_SUCCESS;
+    size_t n;
+    while (r == COMP_SUCCESS && (n = fread(buf, 1, COMP_STREAM_IO_CHUNK, in)) > 0) {
+        r = comp_stream_feed(s, buf, n);
+    }
+    if (r == COMP_SUCCESS && ferror(in)) r = COMP_ERR_FILE_READ;
+    comp_free(buf);
+
+    uint64_t total_in = 0, total_out = 0;
+    CompResult fr = comp_stream_finish(s, &total_in, &total_out);
+    if (r == COMP_SUCCESS) r = fr;
+    stream_fill_stats(stats, algo, level, total_in, total_out, stream_time_ms() - start);
+    return r;
+}
+
+CompResult decomp_stream_file(FILE* in, FILE* out, CompressionStats* stats) {
+    if (!in || !out) return COMP_ERR_INVALID_PARAMS;
+    double start = stream_time_ms();
+    comp_alloc_reset_peak();
+    unsigned char* buf = (unsigned char*)comp_malloc(COMP_STREAM_IO_CHUNK);
+    DecompStream* s = buf ? decomp_stream_init(out) : NULL;
+    if (!s) { comp_free(buf); return COMP_ERR_MEMORY; }
+
+    CompResult r = COMP_SUCCESS;
+    uint64_t total_in = 0;
+    size_t n;
+    while (r == COMP_SUCCESS && (n = fread(buf, 1, COMP_STREAM_IO_CHUNK, in)) > 0) {
+        total_in += n;
+        r = decomp_stream_feed(s, buf, n);
+    }
+    if (r == COMP_SUCCESS && ferror(in)) r = COMP_ERR_FILE_READ;
+    comp_free(buf);
+
+    CompressionAlgorithm algo = s->algo;
+    uint64_t total_out = 0;
+    CompResult fr = decomp_stream_finish(s, &total_out);
+    if (r == COMP_SUCCESS) r = fr;
+    stream_fill_stats(stats, algo, COMPRESSION_LEVEL_NORMAL, total_out, total_in, stream_time_ms() - start);
+    return r;
+}
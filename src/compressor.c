@@ -6,11 +6,20 @@ size_t deflate_compress(const uint8_t* in, size_t in_len, uint8_t* out, size_t o
 // Forward declarations for decompression wrappers
 size_t deflate_decompress(const uint8_t* in, size_t in_len, uint8_t* out, size_t out_cap);
 size_t lzma_decompress(const uint8_t* in, size_t in_len, uint8_t* out, size_t out_cap);
+// Encoder working sets, for the memory budget
+size_t deflate_memory_cost(size_t in_len);
+size_t lzma_memory_cost(size_t in_len);
+// CRC32 (IEEE) from crc32.c, used for the v5 block index
+uint32_t CRC32_Calculate(const uint8_t* data, size_t size);
 #include <sys/time.h>
 #include <setjmp.h>
 #include <stdatomic.h>
 #include <stdbool.h>
+#include <limits.h>
+#include <pthread.h>
 #include "img_lossless.h"
+#include "../include/thread_pool.h"
+#include "../include/comp_input.h"
 
 // Performance monitoring
 static double get_time_ms() {
@@ -19,210 +28,18 @@ static double get_time_ms() {
     return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
 }
 
-// Global panic recovery point
-jmp_buf g_panic_buf;
-
-// Lock-free memory pool constants
-#define CHUNK_SIZE (64 * 1024)           // 64 KiB chunks
-#define MAX_POOL_SIZE (512 * 1024 * 1024) // 512 MiB total
-#define MAX_CHUNKS (MAX_POOL_SIZE / CHUNK_SIZE) // 8192 chunks max
-#define ALIGNMENT 16                      // 16-byte alignment
-
-// Memory chunk structure
-typedef struct MemChunk {
-    void* data;                          // Pointer to chunk data
-    size_t size;                         // Size of allocation within chunk
-    size_t offset;                       // Current offset in chunk
-    atomic_bool in_use;                  // Lock-free usage flag
-    struct MemChunk* next;               // Next chunk in free list
-} MemChunk;
-
-// Memory pool structure
-typedef struct {
-    MemChunk chunks[MAX_CHUNKS];         // Pre-allocated chunk descriptors
-    atomic_int free_head;                // Head of free chunk list (index)
-    atomic_size_t total_allocated;      // Total bytes allocated
-    atomic_size_t peak_usage;            // Peak memory usage
-    atomic_int active_blocks;            // Number of active allocations
-    atomic_size_t total_blocks;          // Total number of allocations made
-} MemoryPool;
-
-// Global memory pool instance
-static MemoryPool g_memory_pool = {0};
-static atomic_bool g_pool_initialized = false;
-
-// Initialize memory pool
-static void init_memory_pool(void) {
-    if (atomic_exchange(&g_pool_initialized, true)) {
-        return; // Already initialized
-    }
-    
-    // Initialize chunk descriptors
-    for (int i = 0; i < MAX_CHUNKS; i++) {
-        g_memory_pool.chunks[i].data = NULL;
-        g_memory_pool.chunks[i].size = 0;
-        g_memory_pool.chunks[i].offset = 0;
-        atomic_store(&g_memory_pool.chunks[i].in_use, false);
-        g_memory_pool.chunks[i].next = (i < MAX_CHUNKS - 1) ? &g_memory_pool.chunks[i + 1] : NULL;
-    }
-    
-    atomic_store(&g_memory_pool.free_head, 0);
-    atomic_store(&g_memory_pool.total_allocated, 0);
-    atomic_store(&g_memory_pool.peak_usage, 0);
-    atomic_store(&g_memory_pool.active_blocks, 0);
-    atomic_store(&g_memory_pool.total_blocks, 0);
-}
-
-// Panic handler for allocation failures
-void comp_panic(const char* message) {
-    fprintf(stderr, "PANIC: %s\n", message);
-    fprintf(stderr, "Memory pool stats - Total: %zu, Peak: %zu, Active blocks: %d\n",
-            atomic_load(&g_memory_pool.total_allocated),
-            atomic_load(&g_memory_pool.peak_usage),
-            atomic_load(&g_memory_pool.active_blocks));
-    
-    // Jump to recovery point
-    longjmp(g_panic_buf, 1);
-}
-
-// Align size to ALIGNMENT boundary
-static size_t align_size(size_t size) {
-    return (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
-}
-
-// Find or allocate a chunk for the given size
-static MemChunk* find_chunk(size_t size) {
-    size_t aligned_size = align_size(size);
-    
-    // First, try to find an existing chunk with enough space
-    for (int i = 0; i < MAX_CHUNKS; i++) {
-        MemChunk* chunk = &g_memory_pool.chunks[i];
-        bool expected = false;
-        
-        if (atomic_compare_exchange_weak(&chunk->in_use, &expected, true)) {
-            if (chunk->data != NULL && (chunk->offset + aligned_size <= CHUNK_SIZE)) {
-                return chunk; // Found suitable chunk
-            }
-            atomic_store(&chunk->in_use, false); // Release if not suitable
-        }
+// Map a whole input file, with read_file's messages; empty files are rejected
+static int open_input_file(const char* path, CompInputAccess access, CompInput* in) {
+    if (comp_input_open(path, access, in) != 0) {
+        printf("Error: Cannot open file '%s' for reading.\n", path);
+        return -1;
     }
-    
-    // Need to allocate a new chunk
-    for (int i = 0; i < MAX_CHUNKS; i++) {
-        MemChunk* chunk = &g_memory_pool.chunks[i];
-        bool expected = false;
-        
-        if (atomic_compare_exchange_weak(&chunk->in_use, &expected, true)) {
-            if (chunk->data == NULL) {
-                // Check if we would exceed pool limit
-                size_t current_total = atomic_load(&g_memory_pool.total_allocated);
-                if (current_total + CHUNK_SIZE > MAX_POOL_SIZE) {
-                    atomic_store(&chunk->in_use, false);
-                    comp_panic("Memory pool exhausted");
-                    return NULL;
-                }
-                
-                // Allocate new chunk (use system malloc for pool chunks)
-                chunk->data = malloc(CHUNK_SIZE);
-                if (!chunk->data) {
-                    atomic_store(&chunk->in_use, false);
-                    comp_panic("System malloc failed");
-                    return NULL;
-                }
-                
-                chunk->offset = 0;
-                atomic_fetch_add(&g_memory_pool.total_allocated, CHUNK_SIZE);
-                
-                size_t new_total = atomic_load(&g_memory_pool.total_allocated);
-                size_t current_peak = atomic_load(&g_memory_pool.peak_usage);
-                if (new_total > current_peak) {
-                    atomic_store(&g_memory_pool.peak_usage, new_total);
-                }
-                
-                return chunk;
-            }
-            atomic_store(&chunk->in_use, false);
-        }
+    if (in->size == 0 || in->size > (size_t)LONG_MAX) {
+        printf("Error: File '%s' is empty or invalid.\n", path);
+        comp_input_close(in);
+        return -1;
     }
-    
-    comp_panic("No available chunks");
-    return NULL;
-}
-
-// Memory pool allocation
-void* comp_malloc(size_t size) {
-    if (!atomic_load(&g_pool_initialized)) {
-        init_memory_pool();
-    }
-    
-    if (size == 0) return NULL;
-    if (size > CHUNK_SIZE) {
-        comp_panic("Allocation too large for pool");
-        return NULL;
-    }
-    
-    size_t aligned_size = align_size(size);
-    MemChunk* chunk = find_chunk(aligned_size);
-    if (!chunk) return NULL;
-    
-    void* ptr = (char*)chunk->data + chunk->offset;
-    chunk->offset += aligned_size;
-    chunk->size = aligned_size; // Store size for this allocation
-    
-    atomic_fetch_add(&g_memory_pool.active_blocks, 1);
-    atomic_fetch_add(&g_memory_pool.total_blocks, 1);
-    
-    // Release chunk for next allocation
-    atomic_store(&chunk->in_use, false);
-    
-    return ptr;
-}
-
-// Memory pool deallocation (simplified - marks block as freed)
-void comp_free(void* ptr) {
-    if (!ptr) return;
-    
-    // Find the chunk containing this pointer
-    for (int i = 0; i < MAX_CHUNKS; i++) {
-        MemChunk* chunk = &g_memory_pool.chunks[i];
-        if (chunk->data && ptr >= chunk->data && 
-            ptr < (char*)chunk->data + CHUNK_SIZE) {
-            atomic_fetch_sub(&g_memory_pool.active_blocks, 1);
-            return;
-        }
-    }
-}
-
-// Leak detector - call on exit
-void comp_check_leaks(void) {
-    int active_blocks = atomic_load(&g_memory_pool.active_blocks);
-    size_t total_allocated = atomic_load(&g_memory_pool.total_allocated);
-    
-    if (active_blocks > 0) {
-        fprintf(stderr, "LEAK: %zu bytes in %d blocks\n", total_allocated, active_blocks);
-    }
-    
-    // Cleanup allocated chunks (use system free for pool chunks)
-    for (int i = 0; i < MAX_CHUNKS; i++) {
-        if (g_memory_pool.chunks[i].data) {
-            free(g_memory_pool.chunks[i].data);
-            g_memory_pool.chunks[i].data = NULL;
-        }
-    }
-}
-
-// Macros for easy replacement
-#define COMP_MALLOC(size) comp_malloc(size)
-#define COMP_FREE(ptr) comp_free(ptr)
-
-// Legacy compatibility (deprecated)
-void* tracked_malloc(size_t size) {
-    return COMP_MALLOC(size);
-}
-
-void tracked_free(void* ptr, size_t size) {
-    (void)size; // Ignore size parameter in new implementation
-    COMP_FREE(ptr);
+    return 0;
 }
 
  // ===== Optimized Algorithm Selector Utilities =====
@@ -350,10 +167,70 @@ int Compressor_Test_CheckEarly(CompressionAlgorithm algo,
     return check_early_termination(algo, input, input_size, out_ratio_percent, out_partial_size);
 }
 
+// Base names of the input and output paths into the stats
+static void stats_set_filenames(CompressionStats* stats, const char* input_path, const char* output_path) {
+    const char* input_filename = strrchr(input_path, '\\');
+    if (!input_filename) input_filename = strrchr(input_path, '/');
+    if (!input_filename) input_filename = input_path;
+    else input_filename++;
+
+    const char* output_filename = strrchr(output_path, '\\');
+    if (!output_filename) output_filename = strrchr(output_path, '/');
+    if (!output_filename) output_filename = output_path;
+    else output_filename++;
+
+    strncpy(stats->original_filename, input_filename, MAX_FILENAME_LENGTH - 1);
+    strncpy(stats->compressed_filename, output_filename, MAX_FILENAME_LENGTH - 1);
+}
+
+// Refuse, before reading it, an input that alone exceeds the memory budget
+static CompResult budget_check_input(const char* input_path, size_t max_memory) {
+    if (max_memory == 0) return COMP_SUCCESS;
+    FILE* f = fopen(input_path, "rb");
+    if (!f) return COMP_ERR_FILE_READ;
+    long size = (fseek(f, 0, SEEK_END) == 0) ? ftell(f) : -1;
+    fclose(f);
+    if (size < 0) return COMP_ERR_FILE_READ;
+    if ((size_t)size >= max_memory) {
+        printf("Error: Input of %ld bytes does not fit the %zu-byte memory budget.\n", size, max_memory);
+        return COMP_ERR_MEMORY;
+    }
+    return COMP_SUCCESS;
+}
+
+// Peak memory for stats and headers, as measured since the run reset the
+// counters: codec buffers and the input mapping. Budgets are planned from
+// cost estimates, so a run that went over anyway says so.
+static size_t stats_peak_bytes(size_t max_memory) {
+    size_t peak = comp_alloc_peak();
+    if (max_memory > 0 && peak > max_memory) {
+        fprintf(stderr, "⚠️  Peak memory %.2f MB exceeded the %.2f MB budget\n",
+                peak / (1024.0 * 1024.0), max_memory / (1024.0 * 1024.0));
+    }
+    return peak;
+}
+
+// Working set of the intelligent path for this input beyond the input
+// itself; LZMA's dictionary dominates everything but small files
+static size_t intelligent_memory_cost(FileType file_type, long input_size, int preprocess) {
+    size_t n = (size_t)input_size;
+    size_t out = n + n / 4 + 65536;
+    if (file_type == FILE_TYPE_PDF) {
+        // Reflated streams are estimated at twice the input
+        size_t prep = n + n / 5 + 65536;
+        return prep + 2 * n + prep + 256 + lzma_memory_cost(prep);
+    }
+    if (file_type == FILE_TYPE_BMP || file_type == FILE_TYPE_PNG || file_type == FILE_TYPE_TGA) {
+        return out + image_memory_cost(input_size);
+    }
+    if (input_size >= 65536) return out + (preprocess ? n + 1024 : 0) + lzma_memory_cost(n);
+    return out + deflate_memory_cost(n);
+}
+
 // Intelligent compression with ratio validation and algorithm selection
-CompResult compress_file_intelligent(const char* input_path, const char* output_path, CompressionLevel level, CompressionStats* stats) {
-    unsigned char* input_buffer = NULL;
-    long input_size = 0;
+CompResult compress_file_intelligent(const char* input_path, const char* output_path, CompressionLevel level,
+                                     size_t max_memory, CompressionStats* stats) {
+    CompInput input;
     uint64_t t_start_ns = comp_now_ns();
     
     // Validate input parameters
@@ -362,18 +239,23 @@ CompResult compress_file_intelligent(const char* input_path, const char* output_
         return COMP_ERR_INVALID_PARAMS;
     }
     
-    // Memory tracking handled by g_memory_pool metrics
+    // Peak memory is reported for this run only
+    comp_alloc_reset_peak();
+    CompResult budget = budget_check_input(input_path, max_memory);
+    if (budget != COMP_SUCCESS) return budget;
     
     // Read input file
     printf("Reading input file for intelligent compression...\n");
-    if (read_file(input_path, &input_buffer, &input_size) != 0) {
+    if (open_input_file(input_path, COMP_INPUT_RANDOM, &input) != 0) {
         return COMP_ERR_FILE_READ;
     }
+    const unsigned char* input_buffer = input.data;
+    long input_size = (long)input.size;
     
     // Validate file size constraints
     if (input_size <= 0) {
         printf("Error: Invalid file size.\n");
-        COMP_FREE(input_buffer);
+        comp_input_close(&input);
         return COMP_ERR_INVALID_SIZE;
     }
     
@@ -423,23 +305,37 @@ CompResult compress_file_intelligent(const char* input_path, const char* output_
     int is_pdf = (input_size >= 4 && memcmp(input_buffer, "%PDF", 4) == 0);
     int is_wav = (input_size >= 4 && memcmp(input_buffer, "RIFF", 4) == 0);
 
+    // A path that would not fit the memory budget hands the input to the
+    // blockwise container, which sizes its blocks to the budget
+    if (max_memory > 0 &&
+        (size_t)input_size + intelligent_memory_cost(file_type, input_size, is_pdf || is_wav) > max_memory) {
+        printf("Intelligent path exceeds the memory budget; using blockwise compression\n");
+        memset(stats, 0, sizeof(CompressionStats));
+        stats_set_filenames(stats, input_path, output_path);
+        CompResult br = compress_file_blockwise(input_buffer, input_size, output_path, file_type, adaptive_level,
+                                                0, max_memory, stats);
+        stats->compression_time = time(NULL);
+        comp_input_close(&input);
+        return br;
+    }
+
     size_t comp_len = 0;
     int handled_pdf = 0;
     if (file_type == FILE_TYPE_PDF) {
         // Specialized PDF path: reflate streams, then LZMA compress preprocessed PDF regardless of size
         size_t prep_cap = (size_t)input_size + (size_t)(input_size / 5) + 65536;
         uint8_t* prep = (uint8_t*)COMP_MALLOC(prep_cap);
-        if (!prep) { COMP_FREE(input_buffer); return COMP_ERR_MEMORY; }
+        if (!prep) { comp_input_close(&input); return COMP_ERR_MEMORY; }
         size_t prep_len = pdf_compress((const uint8_t*)input_buffer, (size_t)input_size, prep, prep_cap);
         if (prep_len == 0) {
             // Fallback to generic path
             COMP_FREE(prep);
         } else {
             out_buf = (uint8_t*)COMP_MALLOC(prep_len + 256);
-            if (!out_buf) { COMP_FREE(prep); COMP_FREE(input_buffer); return COMP_ERR_MEMORY; }
+            if (!out_buf) { COMP_FREE(prep); comp_input_close(&input); return COMP_ERR_MEMORY; }
             comp_len = lzma_compress(prep, prep_len, out_buf, prep_len + 256, 9);
             COMP_FREE(prep);
-            if (comp_len == 0) { COMP_FREE(out_buf); COMP_FREE(input_buffer); return COMP_ERR_COMPRESSION_FAILED; }
+            if (comp_len == 0) { COMP_FREE(out_buf); comp_input_close(&input); return COMP_ERR_COMPRESSION_FAILED; }
             best_algo = ALGO_LZMA;
             best_output = (unsigned char*)out_buf;
             best_size = (long)comp_len;
@@ -450,7 +346,7 @@ CompResult compress_file_intelligent(const char* input_path, const char* output_
     if (!handled_pdf) {
         // Default path with image-specific advanced codec for BMP/PNG/TGA
         out_buf = (uint8_t*)COMP_MALLOC((size_t)input_size + (size_t)(input_size / 4) + 65536);
-        if (!out_buf) { COMP_FREE(input_buffer); return COMP_ERR_MEMORY; }
+        if (!out_buf) { comp_input_close(&input); return COMP_ERR_MEMORY; }
         if (file_type == FILE_TYPE_BMP || file_type == FILE_TYPE_PNG || file_type == FILE_TYPE_TGA) {
             comp_len = img_compress((const uint8_t*)input_buffer, (size_t)input_size, out_buf,
                                     (size_t)input_size + (size_t)(input_size / 4) + 65536);
@@ -494,31 +390,21 @@ CompResult compress_file_intelligent(const char* input_path, const char* output_
             }
         }
         if (pre_buf) { COMP_FREE(pre_buf); }
-        if (comp_len == 0) { COMP_FREE(out_buf); COMP_FREE(input_buffer); return COMP_ERR_COMPRESSION_FAILED; }
+        if (comp_len == 0) { COMP_FREE(out_buf); comp_input_close(&input); return COMP_ERR_COMPRESSION_FAILED; }
         best_output = (unsigned char*)out_buf;
         best_size = (long)comp_len;
         best_ratio = (double)best_size / (double)input_size * 100.0;
     }
 
     // Update statistics
-    const char* input_filename = strrchr(input_path, '\\');
-    if (!input_filename) input_filename = strrchr(input_path, '/');
-    if (!input_filename) input_filename = input_path;
-    else input_filename++;
-    
-    const char* output_filename = strrchr(output_path, '\\');
-    if (!output_filename) output_filename = strrchr(output_path, '/');
-    if (!output_filename) output_filename = output_path;
-    else output_filename++;
-    
-    strncpy(stats->original_filename, input_filename, MAX_FILENAME_LENGTH - 1);
-    strncpy(stats->compressed_filename, output_filename, MAX_FILENAME_LENGTH - 1);
+    stats_set_filenames(stats, input_path, output_path);
     stats->original_size = input_size;
     stats->compressed_size = best_size;
     stats->compression_ratio = best_ratio;
     stats->algorithm_used = best_algo;
     stats->compression_level = adaptive_level;
     stats->compression_time = time(NULL);
+    stats->memory_usage = stats_peak_bytes(max_memory) / 1024.0 / 1024.0;
     
     // Write the best compressed result
     printf("Writing compressed file with algorithm %d...\n", best_algo);
@@ -526,7 +412,7 @@ CompResult compress_file_intelligent(const char* input_path, const char* output_
     // For hardcore compression, write directly
     if (best_algo == ALGO_HARDCORE && best_size < input_size) {
         int write_result = write_file(output_path, best_output, best_size);
-        COMP_FREE(input_buffer);
+        comp_input_close(&input);
         COMP_FREE(best_output);
         return write_result;
     }
@@ -587,7 +473,7 @@ CompResult compress_file_intelligent(const char* input_path, const char* output_
     FILE* output_file = fopen(output_path, "wb");
     if (!output_file) {
         printf("Error: Cannot create output file.\n");
-        COMP_FREE(input_buffer);
+        comp_input_close(&input);
         if (best_output) COMP_FREE(best_output);
         return COMP_ERR_FILE_WRITE;
     }
@@ -597,7 +483,7 @@ CompResult compress_file_intelligent(const char* input_path, const char* output_
     if (header_written != 64) {
         printf("Error: Failed to write complete header.\n");
         fclose(output_file);
-        COMP_FREE(input_buffer);
+        comp_input_close(&input);
         if (best_output) COMP_FREE(best_output);
         return COMP_ERR_FILE_WRITE;
     }
@@ -607,7 +493,7 @@ CompResult compress_file_intelligent(const char* input_path, const char* output_
     if (data_written != best_size) {
         printf("Error: Failed to write complete compressed data.\n");
         fclose(output_file);
-        COMP_FREE(input_buffer);
+        comp_input_close(&input);
         if (best_output) COMP_FREE(best_output);
         return COMP_ERR_FILE_WRITE;
     }
@@ -621,54 +507,1073 @@ CompResult compress_file_intelligent(const char* input_path, const char* output_
     
     printf("Intelligent compression completed!\n");
     printf("Best algorithm: %d, Ratio: %.2f%%, Memory: %.2f MB\n", 
-           best_algo, best_ratio, atomic_load(&g_memory_pool.peak_usage) / (1024.0 * 1024.0));
+           best_algo, best_ratio, stats->memory_usage);
     
     // Cleanup
-    COMP_FREE(input_buffer);
+    comp_input_close(&input);
     if (best_output) COMP_FREE(best_output);
     return COMP_SUCCESS;
 }
 
-// Blockwise intelligent compression with per-block algorithm selection
-CompResult compress_file_blockwise(const unsigned char* input_buffer, long input_size,
-                            const char* output_path, FileType file_type,
-                            CompressionLevel level, CompressionStats* stats) {
-    if (!input_buffer || input_size <= 0 || !output_path || !stats) return COMP_ERR_INVALID_PARAMS;
+// ===== Blockwise candidate selection =====
+// Each candidate first compresses a sample from the middle of the block (an
+// eighth of it, at most BLOCK_TRIAL_SIZE); Huffman is estimated from the
+// order-0 entropy instead. The best estimate, plus any format-aware codec,
+// then runs on the whole block, and the runner-up joins it only when its
+// estimate is within BLOCK_RUNNER_UP_MARGIN percent. Blocks too small for a
+// BLOCK_TRIAL_MIN sample run every candidate. Trials and full runs for a
+// block are spread over the worker pool.
+#define BLOCK_TRIAL_SIZE (32 * 1024)
+#define BLOCK_TRIAL_MIN (8 * 1024)
+#define BLOCK_FULL_RUNS 2
+#define BLOCK_RUNNER_UP_MARGIN 10
+#define BLOCK_MAX_CANDIDATES 4
 
-    // Decide block size by type
-    long block_size = 256 * 1024; // default 256KB
+typedef struct {
+    const unsigned char* data;
+    long size;
+    CompressionLevel level;
+    int count;
+    CompressionAlgorithm algo[BLOCK_MAX_CANDIDATES];
+    unsigned char* out[BLOCK_MAX_CANDIDATES];
+    long out_size[BLOCK_MAX_CANDIDATES];
+    int rc[BLOCK_MAX_CANDIDATES];
+} BlockRun;
+
+static int blockwise_candidates(FileType file_type, CompressionAlgorithm* candidates) {
     switch (file_type) {
+        case FILE_TYPE_TEXT:
+        case FILE_TYPE_CSV:
+        case FILE_TYPE_JSON:
+        case FILE_TYPE_XML:
+            candidates[0] = ALGO_HARDCORE;
+            candidates[1] = ALGO_LZ77;
+            candidates[2] = ALGO_LZW;
+            candidates[3] = ALGO_HUFFMAN;
+            return 4;
         case FILE_TYPE_PDF:
         case FILE_TYPE_DOCX:
-            block_size = 64 * 1024; // finer granularity helps mixed content
-            break;
+            candidates[0] = ALGO_HARDCORE;
+            candidates[1] = ALGO_LZ77;
+            candidates[2] = ALGO_LZW;
+            return 3;
         case FILE_TYPE_IMAGE:
-            block_size = 256 * 1024;
-            break;
+            candidates[0] = ALGO_IMAGE_ADVANCED;
+            candidates[1] = ALGO_LZ77;
+            candidates[2] = ALGO_LZW;
+            candidates[3] = ALGO_HARDCORE;
+            return 4;
         case FILE_TYPE_AUDIO:
-            block_size = 512 * 1024;
-            break;
+            candidates[0] = ALGO_AUDIO_ADVANCED;
+            candidates[1] = ALGO_HARDCORE;
+            candidates[2] = ALGO_LZ77;
+            return 3;
+        default:
+            candidates[0] = ALGO_HARDCORE;
+            candidates[1] = ALGO_LZ77;
+            candidates[2] = ALGO_LZW;
+            candidates[3] = ALGO_HUFFMAN;
+            return 4;
+    }
+}
+
+static int blockwise_run_codec(CompressionAlgorithm algo, const unsigned char* blk, long size,
+                               CompressionLevel level, unsigned char** out_buf, long* out_sz) {
+    switch (algo) {
+        case ALGO_HUFFMAN:
+            return (size >= HUFFMAN_4X_MIN_BLOCK) ? huffman_compress_4x(blk, size, out_buf, out_sz)
+                                                  : huffman_compress(blk, size, out_buf, out_sz);
+        case ALGO_LZ77:
+            // Above the fast level the wide-window v2 stream is worth its extra search
+            return (level >= COMPRESSION_LEVEL_NORMAL) ? lz77_compress_v2(blk, size, out_buf, out_sz, level)
+                                                       : lz77_compress_level(blk, size, out_buf, out_sz, level);
+        case ALGO_LZW: return lzw_compress(blk, size, out_buf, out_sz);
+        case ALGO_AUDIO_ADVANCED: return audio_compress(blk, size, out_buf, out_sz, level);
+        case ALGO_IMAGE_ADVANCED: return image_compress(blk, size, out_buf, out_sz, level);
+        case ALGO_HARDCORE: return hardcore_compress(blk, size, out_buf, out_sz);
+        default: return -1;
+    }
+}
+
+// Peak bytes the codec blockwise_run_codec picks allocates beyond the input;
+// ALGO_BLOCKWISE plans its own memory and reports 0
+size_t codec_memory_cost(CompressionAlgorithm algo, CompressionLevel level, long input_size) {
+    switch (algo) {
+        case ALGO_HUFFMAN: return huffman_memory_cost(input_size);
+        case ALGO_LZ77:
+            return (level >= COMPRESSION_LEVEL_NORMAL) ? lz77_v2_memory_cost(input_size, level)
+                                                       : lz77_memory_cost(input_size);
+        case ALGO_LZW: return lzw_memory_cost(input_size);
+        case ALGO_AUDIO_ADVANCED: return audio_memory_cost(input_size);
+        case ALGO_IMAGE_ADVANCED: return image_memory_cost(input_size);
+        case ALGO_HARDCORE: return hardcore_memory_cost(input_size);
+        default: return 0;
+    }
+}
+
+// Hardcore and the image codec return pool memory; the others use malloc
+static void blockwise_free_output(CompressionAlgorithm algo, unsigned char* buf) {
+    if (!buf) return;
+    if (algo == ALGO_HARDCORE || algo == ALGO_IMAGE_ADVANCED) COMP_FREE(buf);
+    else comp_free(buf);
+}
+
+static void blockwise_run_task(void* ctx, long index) {
+    BlockRun* run = (BlockRun*)ctx;
+    run->out[index] = NULL;
+    run->out_size[index] = 0;
+    run->rc[index] = blockwise_run_codec(run->algo[index], run->data, run->size, run->level,
+                                         &run->out[index], &run->out_size[index]);
+    if (run->rc[index] == 0 && (!run->out[index] || run->out_size[index] <= 0)) run->rc[index] = -1;
+}
+
+static void blockwise_run_all(ThreadPool* pool, BlockRun* run) {
+    thread_pool_parallel_for(pool, run->count, blockwise_run_task, run);
+}
+
+static void blockwise_release(BlockRun* run) {
+    for (int i = 0; i < run->count; i++) {
+        blockwise_free_output(run->algo[i], run->out[i]);
+        run->out[i] = NULL;
+    }
+}
+
+// Huffman output size from the order-0 entropy plus its code table
+static long blockwise_entropy_estimate(const unsigned char* data, long size) {
+    unsigned long freq[256] = {0};
+    for (long i = 0; i < size; i++) freq[data[i]]++;
+    double bits = 0.0;
+    for (int c = 0; c < 256; c++) {
+        if (freq[c]) bits -= (double)freq[c] * log2((double)freq[c] / (double)size);
+    }
+    return (long)(bits / 8.0) + 160;
+}
+
+// Reduce candidates[] to the ones worth a full run; returns the new count
+static int blockwise_prune(ThreadPool* pool, const unsigned char* blk, long size, CompressionLevel level,
+                           CompressionAlgorithm* candidates, int num) {
+    long trial_size = size / 8 < BLOCK_TRIAL_SIZE ? size / 8 : BLOCK_TRIAL_SIZE;
+    if (num <= BLOCK_FULL_RUNS || trial_size < BLOCK_TRIAL_MIN) return num;
+
+    long estimate[BLOCK_MAX_CANDIDATES];
+    int aware = 0;
+    BlockRun trial;
+    memset(&trial, 0, sizeof(trial));
+    trial.data = blk + (size - trial_size) / 2;
+    trial.size = trial_size;
+    trial.level = level;
+    for (int i = 0; i < num; i++) {
+        estimate[i] = -1;
+        if (candidates[i] == ALGO_AUDIO_ADVANCED || candidates[i] == ALGO_IMAGE_ADVANCED) {
+            aware++;   // needs the whole block to parse its format
+        } else if (candidates[i] == ALGO_HUFFMAN) {
+            estimate[i] = blockwise_entropy_estimate(blk, size);
+        } else {
+            trial.algo[trial.count++] = candidates[i];
+        }
+    }
+    blockwise_run_all(pool, &trial);
+    for (int i = 0, t = 0; i < num; i++) {
+        if (t < trial.count && candidates[i] == trial.algo[t]) {
+            if (trial.rc[t] == 0) estimate[i] = (long)((double)trial.out_size[t] * size / trial.size);
+            t++;
+        }
+    }
+    blockwise_release(&trial);
+
+    // Fill the remaining slots with the smallest estimates
+    int slots = BLOCK_FULL_RUNS - aware;
+    if (slots < 1) slots = 1;
+    int keep[BLOCK_MAX_CANDIDATES] = {0};
+    int kept_general = 0;
+    long leader = 0;
+    for (int k = 0; k < slots; k++) {
+        int best = -1;
+        for (int i = 0; i < num; i++) {
+            if (keep[i] || estimate[i] < 0) continue;
+            if (best < 0 || estimate[i] < estimate[best]) best = i;
+        }
+        if (best < 0) break;
+        if (kept_general > 0 && estimate[best] * 100 > leader * (100 + BLOCK_RUNNER_UP_MARGIN)) break;
+        if (kept_general == 0) leader = estimate[best];
+        keep[best] = 1;
+        kept_general++;
+    }
+    // Without a single usable estimate, fall back to running everything
+    if (kept_general == 0) return num;
+
+    int n = 0;
+    for (int i = 0; i < num; i++) {
+        if (keep[i] || candidates[i] == ALGO_AUDIO_ADVANCED || candidates[i] == ALGO_IMAGE_ADVANCED) {
+            candidates[n++] = candidates[i];
+        }
+    }
+    return n;
+}
+
+// Run the surviving candidates on the whole block and keep the smallest
+// output. Hardcore output is round-tripped before it is accepted, so the
+// check only costs a decode when hardcore actually wins.
+static unsigned char* blockwise_select(ThreadPool* pool, const unsigned char* blk, long size, CompressionLevel level,
+                                       const CompressionAlgorithm* candidates, int num,
+                                       CompressionAlgorithm* best_alg, long* best_sz) {
+    BlockRun run;
+    memset(&run, 0, sizeof(run));
+    run.data = blk;
+    run.size = size;
+    run.level = level;
+    run.count = num;
+    for (int i = 0; i < num; i++) run.algo[i] = candidates[i];
+    blockwise_run_all(pool, &run);
+
+    unsigned char* best_out = NULL;
+    for (;;) {
+        int best = -1;
+        for (int i = 0; i < num; i++) {
+            if (run.rc[i] != 0 || run.out_size[i] > size) continue;
+            if (best < 0 || run.out_size[i] < run.out_size[best]) best = i;
+        }
+        if (best < 0) break;
+        if (run.algo[best] == ALGO_HARDCORE) {
+            unsigned char* verify_out = NULL; long verify_sz = 0;
+            int vr = hardcore_decompress(run.out[best], run.out_size[best], &verify_out, &verify_sz);
+            if (verify_out) COMP_FREE(verify_out);
+            if (vr != 0 || verify_sz != size) {
+                run.rc[best] = -1;   // reject: the payload does not decode to this block
+                continue;
+            }
+        }
+        best_out = run.out[best];
+        *best_alg = run.algo[best];
+        *best_sz = run.out_size[best];
+        run.out[best] = NULL;
+        break;
+    }
+    blockwise_release(&run);
+    return best_out;
+}
+
+// ===== Content-adaptive block boundaries =====
+// Block boundaries follow the content rather than a fixed stride. Each
+// SEGMENT_GRANULE of input is classed from its byte histogram as text
+// (mostly printable), entropic (order-0 entropy of at least
+// SEGMENT_ENTROPIC_BITS, i.e. data that is already compressed) or binary.
+// Runs of one class form a segment, runs shorter than SEGMENT_MIN_SIZE are
+// folded into the segment before them, and long segments are cut into equal
+// blocks no larger than the per-type maximum. Image and audio input is not
+// classed; their format-aware codecs see one kind of data throughout.
+#define SEGMENT_GRANULE (4 * 1024)
+#define SEGMENT_MIN_SIZE (8 * 1024)
+#define SEGMENT_TEXT_PERCENT 90
+#define SEGMENT_ENTROPIC_BITS 7.5
+
+typedef enum {
+    SEGMENT_BINARY,
+    SEGMENT_TEXT,
+    SEGMENT_ENTROPIC
+} SegmentClass;
+
+typedef struct {
+    long start;
+    long size;
+    SegmentClass kind;
+} BlockSegment;
+
+// clog[k] = k * log2(k), so a granule's entropy costs no log per symbol
+static SegmentClass blockwise_classify(const unsigned char* data, long size, const double* clog) {
+    unsigned int freq[256] = {0};
+    for (long i = 0; i < size; i++) freq[data[i]]++;
+    long printable = (long)freq['\t'] + freq['\n'] + freq['\r'];
+    for (int c = 32; c < 127; c++) printable += freq[c];
+    if (printable * 100 >= size * SEGMENT_TEXT_PERCENT) return SEGMENT_TEXT;
+
+    double sum = 0.0;
+    for (int c = 0; c < 256; c++) sum += clog[freq[c]];
+    double bits = log2((double)size) - sum / (double)size;
+    return bits >= SEGMENT_ENTROPIC_BITS ? SEGMENT_ENTROPIC : SEGMENT_BINARY;
+}
+
+// Cut the input into blocks of at most max_block bytes; returns the block
+// count with a malloc'd array in *blocks, or 0 when out of memory
+static long blockwise_segment(const unsigned char* input, long input_size, FileType file_type,
+                              long max_block, BlockSegment** blocks) {
+    long granules = (input_size + SEGMENT_GRANULE - 1) / SEGMENT_GRANULE;
+    BlockSegment* segs = (BlockSegment*)comp_malloc((size_t)granules * sizeof(BlockSegment));
+    if (!segs) return 0;
+
+    long count = 1;
+    segs[0].start = 0;
+    segs[0].size = input_size;
+    segs[0].kind = SEGMENT_BINARY;
+    if (file_type != FILE_TYPE_IMAGE && file_type != FILE_TYPE_AUDIO) {
+        double clog[SEGMENT_GRANULE + 1];
+        clog[0] = 0.0;
+        for (int k = 1; k <= SEGMENT_GRANULE; k++) clog[k] = k * log2((double)k);
+
+        // Runs of granules with one class
+        count = 0;
+        for (long g = 0; g < granules; g++) {
+            long start = g * SEGMENT_GRANULE;
+            long size = input_size - start < SEGMENT_GRANULE ? input_size - start : SEGMENT_GRANULE;
+            SegmentClass kind = blockwise_classify(input + start, size, clog);
+            if (count > 0 && segs[count - 1].kind == kind) {
+                segs[count - 1].size += size;
+                continue;
+            }
+            segs[count].start = start;
+            segs[count].size = size;
+            segs[count].kind = kind;
+            count++;
+        }
+
+        // Fold short runs into their predecessor; a short first run takes
+        // the class of the run after it
+        long merged = 0;
+        for (long r = 0; r < count; r++) {
+            BlockSegment run = segs[r];
+            if (merged > 0 && (run.size < SEGMENT_MIN_SIZE || run.kind == segs[merged - 1].kind)) {
+                segs[merged - 1].size += run.size;
+            } else if (merged > 0 && segs[merged - 1].size < SEGMENT_MIN_SIZE) {
+                segs[merged - 1].size += run.size;
+                segs[merged - 1].kind = run.kind;
+            } else {
+                segs[merged++] = run;
+            }
+        }
+        count = merged;
+    }
+
+    // Equal blocks of at most max_block bytes per segment
+    long total = 0;
+    for (long i = 0; i < count; i++) total += (segs[i].size + max_block - 1) / max_block;
+    BlockSegment* out = (BlockSegment*)comp_malloc((size_t)total * sizeof(BlockSegment));
+    if (!out) {
+        comp_free(segs);
+        return 0;
+    }
+    long n = 0;
+    for (long i = 0; i < count; i++) {
+        long parts = (segs[i].size + max_block - 1) / max_block;
+        long start = segs[i].start;
+        for (long p = 0; p < parts; p++) {
+            out[n].start = start;
+            out[n].size = segs[i].size / parts + (p < segs[i].size % parts ? 1 : 0);
+            out[n].kind = segs[i].kind;
+            start += out[n].size;
+            n++;
+        }
+    }
+    comp_free(segs);
+    *blocks = out;
+    return total;
+}
+
+// Candidates for one block: image and audio keep their format-aware list,
+// other blocks are matched on their own content class. Entropic blocks skip
+// hardcore, which cannot find structure the order-0 estimate did not.
+static int blockwise_block_candidates(FileType file_type, SegmentClass kind, CompressionAlgorithm* candidates) {
+    if (file_type == FILE_TYPE_IMAGE || file_type == FILE_TYPE_AUDIO) {
+        return blockwise_candidates(file_type, candidates);
+    }
+    switch (kind) {
+        case SEGMENT_TEXT:
+            return blockwise_candidates(FILE_TYPE_TEXT, candidates);
+        case SEGMENT_ENTROPIC:
+            candidates[0] = ALGO_LZ77;
+            candidates[1] = ALGO_HUFFMAN;
+            return 2;
         default:
-            block_size = 512 * 1024;
+            return blockwise_candidates(file_type, candidates);
+    }
+}
+
+// Memory one candidate needs on a block, counting the round trip that
+// hardcore output gets before it is accepted
+static size_t blockwise_candidate_cost(CompressionAlgorithm algo, CompressionLevel level, long size) {
+    size_t cost = codec_memory_cost(algo, level, size);
+    if (algo == ALGO_HARDCORE) cost += hardcore_decompress_memory_cost(size);
+    return cost;
+}
+
+// Candidates may all run at once and keep their outputs until one is
+// picked, so they share the block's budget; drop the most expensive until
+// the rest fit. Returns the new count, possibly 0.
+static int blockwise_fit_candidates(CompressionAlgorithm* candidates, int num, CompressionLevel level, long size,
+                                    size_t budget) {
+    while (num > 0) {
+        size_t total = 0, worst_cost = 0;
+        int worst = 0;
+        for (int i = 0; i < num; i++) {
+            size_t cost = blockwise_candidate_cost(candidates[i], level, size);
+            total += cost;
+            if (cost > worst_cost) {
+                worst_cost = cost;
+                worst = i;
+            }
+        }
+        if (total <= budget) break;
+        memmove(candidates + worst, candidates + worst + 1, (size_t)(num - worst - 1) * sizeof(*candidates));
+        num--;
+    }
+    return num;
+}
+
+// Best candidate for one block; falls back to hardcore, then LZ77, when no
+// candidate beats the block size. A nonzero budget limits the candidates
+// and fallbacks to those whose working set fits it. Returns NULL only if
+// every codec failed.
+static unsigned char* blockwise_compress_block(ThreadPool* pool, const unsigned char* blk, long size,
+                                               FileType file_type, SegmentClass kind, CompressionLevel level,
+                                               size_t budget, CompressionAlgorithm* best_alg, long* best_sz) {
+    CompressionAlgorithm candidates[BLOCK_MAX_CANDIDATES];
+    int num = blockwise_block_candidates(file_type, kind, candidates);
+    if (budget > 0) num = blockwise_fit_candidates(candidates, num, level, size, budget);
+    num = blockwise_prune(pool, blk, size, level, candidates, num);
+
+    *best_alg = ALGO_HARDCORE;
+    *best_sz = 0;
+    if (num > 0) {
+        unsigned char* best_out = blockwise_select(pool, blk, size, level, candidates, num, best_alg, best_sz);
+        if (best_out) return best_out;
+    }
+
+    /* FORCE-COMPRESS – raw storage disabled */
+    unsigned char* out_buf = NULL; long out_sz = 0;
+    int r = -1;
+    if (budget == 0 || hardcore_memory_cost(size) <= budget) {
+        r = hardcore_compress(blk, size, &out_buf, &out_sz);
+        if (r == 0 && out_buf && out_sz > 0) {
+            *best_alg = ALGO_HARDCORE; *best_sz = out_sz;
+            return out_buf;
+        }
+        if (out_buf) COMP_FREE(out_buf);
+        out_buf = NULL;
+    }
+    // As an absolute fallback, try LZ77
+    if (budget > 0 && lz77_memory_cost(size) > budget) return NULL;
+    r = lz77_compress_level(blk, size, &out_buf, &out_sz, level);
+    if (r == 0 && out_buf && out_sz > 0) {
+        *best_alg = ALGO_LZ77; *best_sz = out_sz;
+        return out_buf;
+    }
+    comp_free(out_buf);
+    return NULL;
+}
+
+// ===== Seekable blockwise container (v5) =====
+// v5 drops the descriptors that v4 interleaves with the payloads and puts a
+// block index at the end of the file, so a reader can jump to any block:
+//   header   64 bytes: "COMP", 5, ALGO_BLOCKWISE, level, file type,
+//            BE64 original size @8, BE64 payload total @16,
+//            BE32 block count @24, "BLK5" @28, BE64 index offset @32
+//   payloads block after block, starting at byte 64
+//   index    "BIDX", BE32 count, then per block (32 bytes): algo, level,
+//            2 reserved, BE32 CRC32 of the original bytes, BE64 payload
+//            offset, BE64 original size, BE64 compressed size
+//   footer   BE64 index offset, BE32 CRC32 of the index, "CIX5"
+#define BLOCK_V5_HEADER_SIZE 64
+#define BLOCK_V5_INDEX_HEADER 8
+#define BLOCK_V5_ENTRY_SIZE 32
+#define BLOCK_V5_FOOTER_SIZE 16
+
+typedef struct {
+    unsigned char algo;
+    unsigned char level;
+    uint32_t crc;
+    uint64_t data_offset;
+    uint64_t orig_size;
+    uint64_t comp_size;
+    uint64_t orig_offset;   // derived on load: where the block starts in the original
+} BlockIndexEntry;
+
+static void put_be32(unsigned char* p, uint32_t v) {
+    for (int i = 0; i < 4; i++) p[i] = (unsigned char)(v >> ((3 - i) * 8));
+}
+
+static void put_be64(unsigned char* p, uint64_t v) {
+    for (int i = 0; i < 8; i++) p[i] = (unsigned char)(v >> ((7 - i) * 8));
+}
+
+static uint32_t get_be32(const unsigned char* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static uint64_t get_be64(const unsigned char* p) {
+    uint64_t v = 0;
+    for (int i = 0; i < 8; i++) v = (v << 8) | p[i];
+    return v;
+}
+
+// Write index and footer for `count` entries at the current position
+static int blockwise_write_index(FILE* out, const BlockIndexEntry* entries, long count, uint64_t index_offset) {
+    size_t index_size = BLOCK_V5_INDEX_HEADER + (size_t)count * BLOCK_V5_ENTRY_SIZE;
+    unsigned char* index = (unsigned char*)comp_calloc(1, index_size);
+    if (!index) return -1;
+    memcpy(index, "BIDX", 4);
+    put_be32(index + 4, (uint32_t)count);
+    for (long b = 0; b < count; b++) {
+        unsigned char* e = index + BLOCK_V5_INDEX_HEADER + b * BLOCK_V5_ENTRY_SIZE;
+        e[0] = entries[b].algo;
+        e[1] = entries[b].level;
+        put_be32(e + 4, entries[b].crc);
+        put_be64(e + 8, entries[b].data_offset);
+        put_be64(e + 16, entries[b].orig_size);
+        put_be64(e + 24, entries[b].comp_size);
+    }
+    unsigned char footer[BLOCK_V5_FOOTER_SIZE];
+    put_be64(footer, index_offset);
+    put_be32(footer + 8, CRC32_Calculate(index, index_size));
+    memcpy(footer + 12, "CIX5", 4);
+
+    int ok = fwrite(index, 1, index_size, out) == index_size &&
+             fwrite(footer, 1, sizeof(footer), out) == sizeof(footer);
+    comp_free(index);
+    return ok ? 0 : -1;
+}
+
+// Check a footer against the file size; returns the index position and size
+static CompResult blockwise_parse_footer(const unsigned char* footer, uint64_t file_size, long block_count,
+                                         uint64_t* index_offset, size_t* index_size, uint32_t* index_crc) {
+    if (memcmp(footer + 12, "CIX5", 4) != 0) return COMP_ERR_INVALID_FORMAT;
+    *index_offset = get_be64(footer);
+    *index_crc = get_be32(footer + 8);
+    *index_size = BLOCK_V5_INDEX_HEADER + (size_t)block_count * BLOCK_V5_ENTRY_SIZE;
+    if (*index_offset < BLOCK_V5_HEADER_SIZE ||
+        *index_offset + *index_size + BLOCK_V5_FOOTER_SIZE != file_size) {
+        return COMP_ERR_METADATA_CORRUPT;
+    }
+    return COMP_SUCCESS;
+}
+
+// Validate the index bytes and fill entries[]; payloads must tile
+// [64, index_offset) and the original sizes must add up to original_size
+static CompResult blockwise_parse_index(const unsigned char* index, size_t index_size, uint32_t index_crc,
+                                        long block_count, uint64_t index_offset, uint64_t original_size,
+                                        BlockIndexEntry* entries) {
+    if (CRC32_Calculate(index, index_size) != index_crc) return COMP_ERR_CHECKSUM_FAILED;
+    if (memcmp(index, "BIDX", 4) != 0 || get_be32(index + 4) != (uint32_t)block_count) {
+        return COMP_ERR_METADATA_CORRUPT;
+    }
+    uint64_t data_pos = BLOCK_V5_HEADER_SIZE;
+    uint64_t orig_pos = 0;
+    for (long b = 0; b < block_count; b++) {
+        const unsigned char* e = index + BLOCK_V5_INDEX_HEADER + b * BLOCK_V5_ENTRY_SIZE;
+        BlockIndexEntry* ent = &entries[b];
+        ent->algo = e[0];
+        ent->level = e[1];
+        ent->crc = get_be32(e + 4);
+        ent->data_offset = get_be64(e + 8);
+        ent->orig_size = get_be64(e + 16);
+        ent->comp_size = get_be64(e + 24);
+        ent->orig_offset = orig_pos;
+        if (ent->data_offset != data_pos || ent->orig_size == 0 || ent->comp_size == 0 ||
+            ent->orig_size > LONG_MAX || ent->comp_size > index_offset - data_pos) {
+            return COMP_ERR_METADATA_CORRUPT;
+        }
+        data_pos += ent->comp_size;
+        orig_pos += ent->orig_size;
+    }
+    if (data_pos != index_offset || orig_pos != original_size) return COMP_ERR_METADATA_CORRUPT;
+    return COMP_SUCCESS;
+}
+
+// Decode a block with a codec that allocates its own output of exactly orig_sz bytes
+static int blockwise_decode_block(unsigned char algo, const unsigned char* blk_data, long comp_sz, long orig_sz,
+                                  unsigned char** blk_out, long* blk_out_sz) {
+    *blk_out = NULL;
+    *blk_out_sz = 0;
+    int r = 0;
+    switch (algo) {
+        case ALGO_HUFFMAN: {
+            CompResult hr = huffman_decompress(blk_data, comp_sz, blk_out, blk_out_sz);
+            r = (hr == COMP_SUCCESS) ? 0 : (int)hr;
+            break;
+        }
+        case ALGO_LZ77: r = lz77_decompress(blk_data, comp_sz, blk_out, blk_out_sz); break;
+        case ALGO_LZW: r = lzw_decompress(blk_data, comp_sz, blk_out, blk_out_sz); break;
+        case ALGO_AUDIO_ADVANCED: r = audio_decompress(blk_data, comp_sz, blk_out, blk_out_sz); break;
+        case ALGO_IMAGE_ADVANCED: r = image_decompress(blk_data, comp_sz, blk_out, blk_out_sz); break;
+        case ALGO_HARDCORE: r = hardcore_decompress(blk_data, comp_sz, blk_out, blk_out_sz); break;
+        default: r = -1; break;
+    }
+    if (r == 0 && (!*blk_out || *blk_out_sz != orig_sz)) r = -1;
+    return r;
+}
+
+// Huffman, LZW and audio decode into malloc memory; the rest use the pool
+static void blockwise_free_decoded(unsigned char algo, unsigned char* buf) {
+    if (!buf) return;
+    if (algo == ALGO_HUFFMAN || algo == ALGO_LZW || algo == ALGO_AUDIO_ADVANCED) comp_free(buf);
+    else COMP_FREE(buf);
+}
+
+// Decode an indexed block into dst (orig_size bytes). Stored, Huffman,
+// LZ77, DEFLATE and LZMA blocks are written in place; the other codecs
+// return their own buffer, which is copied and released here.
+static CompResult blockwise_decode_into(const BlockIndexEntry* e, const unsigned char* payload,
+                                        unsigned char* dst, int verify_crc) {
+    long comp_sz = (long)e->comp_size;
+    long orig_sz = (long)e->orig_size;
+    if (e->algo == ALGO_HUFFMAN && comp_sz == orig_sz) {
+        memcpy(dst, payload, (size_t)orig_sz);   // stored (no compression)
+    } else if (e->algo == ALGO_HUFFMAN || e->algo == ALGO_LZ77) {
+        long produced = 0;
+        int r = (e->algo == ALGO_HUFFMAN)
+            ? (int)huffman_decompress_into(payload, comp_sz, dst, orig_sz, &produced)
+            : lz77_decompress_into(payload, comp_sz, dst, orig_sz, &produced);
+        if (r != 0 || produced != orig_sz) return COMP_ERR_DECOMPRESSION_FAILED;
+    } else if (e->algo == ALGO_DEFLATE) {
+        if (deflate_decompress(payload, (size_t)comp_sz, dst, (size_t)orig_sz) != (size_t)orig_sz) {
+            return COMP_ERR_DECOMPRESSION_FAILED;
+        }
+#ifdef HAVE_LZMA
+    } else if (e->algo == ALGO_LZMA) {
+        if (lzma_decompress(payload, (size_t)comp_sz, dst, (size_t)orig_sz) != (size_t)orig_sz) {
+            return COMP_ERR_DECOMPRESSION_FAILED;
+        }
+#endif
+    } else {
+        unsigned char* blk = NULL; long blk_sz = 0;
+        int r = blockwise_decode_block(e->algo, payload, comp_sz, orig_sz, &blk, &blk_sz);
+        if (r == 0) memcpy(dst, blk, (size_t)orig_sz);
+        blockwise_free_decoded(e->algo, blk);
+        if (r != 0) return COMP_ERR_DECOMPRESSION_FAILED;
+    }
+    if (verify_crc && CRC32_Calculate(dst, (size_t)orig_sz) != e->crc) return COMP_ERR_CHECKSUM_FAILED;
+    return COMP_SUCCESS;
+}
+
+CompResult blockwise_decode_block_into(unsigned char algo, const unsigned char* payload, long comp_size,
+                                       unsigned char* dst, long orig_size) {
+    if (!payload || !dst || comp_size <= 0 || orig_size <= 0) return COMP_ERR_INVALID_PARAMS;
+    BlockIndexEntry e;
+    memset(&e, 0, sizeof(e));
+    e.algo = algo;
+    e.comp_size = (uint64_t)comp_size;
+    e.orig_size = (uint64_t)orig_size;
+    return blockwise_decode_into(&e, payload, dst, 0);
+}
+
+// Walk the descriptors of a v4 file (interleaved with the payloads) into an
+// index; v4 carries no CRCs, so entries[].crc stays 0
+static CompResult blockwise_table_from_v4(const unsigned char* file, long file_size, BlockIndexEntry** entries,
+                                          long* block_count, uint64_t* original_size) {
+    const unsigned char* header = file;
+    *original_size = get_be64(header + 8);
+    uint64_t compressed_total = get_be64(header + 16);
+    *block_count = (long)get_be32(header + 24);
+
+    // Position after header
+    long pos = 64;
+    if (pos + 8 > file_size || memcmp(file + pos, "BTAB", 4) != 0) {
+        printf("Error: Missing block table header.\n");
+        return COMP_ERR_INVALID_FORMAT;
+    }
+    pos += 8; // skip table header
+    if (*block_count <= 0 || *block_count > (file_size - pos) / 10) {
+        printf("Error: Invalid block count %ld.\n", *block_count);
+        return COMP_ERR_INVALID_FORMAT;
+    }
+
+    *entries = (BlockIndexEntry*)comp_calloc((size_t)*block_count, sizeof(BlockIndexEntry));
+    if (!*entries) return COMP_ERR_MEMORY;
+    CompResult r = COMP_SUCCESS;
+    uint64_t out_off = 0;
+    for (long b = 0; b < *block_count; b++) {
+        if (pos + 10 > file_size) { printf("Error: Truncated block descriptor.\n"); r = COMP_ERR_INVALID_FORMAT; break; }
+        unsigned char algo = file[pos + 0];
+        unsigned int orig_sz = get_be32(file + pos + 2);
+        unsigned int comp_sz = get_be32(file + pos + 6);
+        pos += 10;
+
+        // Validate algorithm code
+        if (algo != ALGO_HUFFMAN && algo != ALGO_LZ77 && algo != ALGO_LZW &&
+            algo != ALGO_AUDIO_ADVANCED && algo != ALGO_IMAGE_ADVANCED && algo != ALGO_HARDCORE &&
+            algo != ALGO_DEFLATE && algo != ALGO_LZMA) {
+            printf("Error: Unknown block algorithm %u at block %ld.\n", algo, b);
+            r = COMP_ERR_INVALID_ALGORITHM;
+            break;
+        }
+        // Basic size sanity
+        if (orig_sz == 0 || comp_sz == 0) {
+            printf("Error: Invalid block sizes at block %ld (orig=%u comp=%u).\n", b, orig_sz, comp_sz);
+            r = COMP_ERR_INVALID_SIZE;
+            break;
+        }
+        if (comp_sz > (unsigned long)(file_size - pos) || out_off + orig_sz > *original_size) {
+            printf("Error: Truncated block data at block %ld.\n", b);
+            r = COMP_ERR_INVALID_FORMAT;
             break;
+        }
+        BlockIndexEntry* e = &(*entries)[b];
+        e->algo = algo;
+        e->level = file[pos - 9];
+        e->data_offset = (uint64_t)pos;
+        e->orig_size = orig_sz;
+        e->comp_size = comp_sz;
+        e->orig_offset = out_off;
+        pos += comp_sz;
+        out_off += orig_sz;
+    }
+
+    // Final validations; compressed_total counts only the block payloads, not descriptors
+    if (r == COMP_SUCCESS && out_off != *original_size) {
+        printf("Error: Final output size mismatch (%llu != %llu).\n",
+               (unsigned long long)out_off, (unsigned long long)*original_size);
+        r = COMP_ERR_INVALID_SIZE;
+    }
+    long consumed_comp = pos - 64 - 8 - (10 * *block_count);
+    if (r == COMP_SUCCESS && compressed_total != 0 && (uint64_t)consumed_comp != compressed_total) {
+        printf("Error: Compressed size mismatch (%ld != %llu).\n", consumed_comp, (unsigned long long)compressed_total);
+        r = COMP_ERR_INVALID_SIZE;
+    }
+    if (r != COMP_SUCCESS) { comp_free(*entries); *entries = NULL; }
+    return r;
+}
+
+// ===== Parallel block decoding =====
+// Every block's output offset is known from the table, so blocks decode
+// independently into one output buffer; the first failure stops the
+// remaining blocks from starting.
+typedef struct {
+    const BlockIndexEntry* entries;
+    const unsigned char* file;      // payloads addressed by data_offset
+    unsigned char* output;
+    int verify_crc;
+    atomic_int failed;              // first error (CompResult), 0 while all is well
+    atomic_long failed_block;
+} BlockDecodeJob;
+
+static void blockwise_decode_task(void* ctx, long index) {
+    BlockDecodeJob* job = (BlockDecodeJob*)ctx;
+    if (atomic_load(&job->failed) != 0) return;
+    const BlockIndexEntry* e = &job->entries[index];
+    CompResult r = blockwise_decode_into(e, job->file + e->data_offset, job->output + e->orig_offset, job->verify_crc);
+    if (r != COMP_SUCCESS) {
+        int expected = 0;
+        if (atomic_compare_exchange_strong(&job->failed, &expected, (int)r)) atomic_store(&job->failed_block, index);
+    }
+}
+
+static CompResult blockwise_decode_all(const BlockIndexEntry* entries, long block_count, const unsigned char* file,
+                                       unsigned char* output, int verify_crc) {
+    BlockDecodeJob job;
+    job.entries = entries;
+    job.file = file;
+    job.output = output;
+    job.verify_crc = verify_crc;
+    atomic_init(&job.failed, 0);
+    atomic_init(&job.failed_block, -1);
+
+    ThreadPool* pool = (block_count > 1) ? thread_pool_create(0) : NULL;
+    thread_pool_parallel_for(pool, block_count, blockwise_decode_task, &job);
+    thread_pool_destroy(pool);
+
+    CompResult r = (CompResult)atomic_load(&job.failed);
+    if (r != COMP_SUCCESS) {
+        long b = atomic_load(&job.failed_block);
+        printf("Error: Block %ld failed to decode (%d), algo=%u.\n", b, (int)r, entries[b].algo);
+    }
+    return r;
+}
+
+// Block count and original size from a v5 header
+static CompResult blockwise_parse_header(const unsigned char* header, long* block_count, uint64_t* original_size) {
+    if (memcmp(header, "COMP", 4) != 0 || header[4] != 5 || header[5] != (unsigned char)ALGO_BLOCKWISE ||
+        memcmp(header + 28, "BLK5", 4) != 0) {
+        return COMP_ERR_INVALID_FORMAT;
     }
-    if (input_size < block_size) block_size = input_size;
+    *original_size = get_be64(header + 8);
+    *block_count = (long)get_be32(header + 24);
+    if (*block_count <= 0 || *original_size == 0) return COMP_ERR_METADATA_CORRUPT;
+    return COMP_SUCCESS;
+}
+
+// Load the index of a v5 file held in memory; *entries is malloc'd
+static CompResult blockwise_index_from_memory(const unsigned char* file, long file_size, BlockIndexEntry** entries,
+                                              long* block_count, uint64_t* original_size) {
+    if (file_size < BLOCK_V5_HEADER_SIZE + BLOCK_V5_FOOTER_SIZE) return COMP_ERR_INVALID_FORMAT;
+    CompResult r = blockwise_parse_header(file, block_count, original_size);
+    if (r != COMP_SUCCESS) return r;
+    uint64_t index_offset; size_t index_size; uint32_t index_crc;
+    r = blockwise_parse_footer(file + file_size - BLOCK_V5_FOOTER_SIZE, (uint64_t)file_size, *block_count,
+                               &index_offset, &index_size, &index_crc);
+    if (r != COMP_SUCCESS) return r;
+    *entries = (BlockIndexEntry*)comp_malloc((size_t)*block_count * sizeof(BlockIndexEntry));
+    if (!*entries) return COMP_ERR_MEMORY;
+    r = blockwise_parse_index(file + index_offset, index_size, index_crc, *block_count, index_offset,
+                              *original_size, *entries);
+    if (r != COMP_SUCCESS) { comp_free(*entries); *entries = NULL; }
+    return r;
+}
+
+// ===== Blockwise pipeline =====
+// The calling thread hands blocks to the pool and writes the results in
+// block order as they complete. A block's slot is reused only after it has
+// been written, so at most `window` compressed blocks are held at once.
+// Block choices do not depend on scheduling, so the output is the same for
+// any thread count.
+#define BLOCK_WINDOW_PER_THREAD 2
 
-    long block_count = (input_size + block_size - 1) / block_size;
-    printf("Blockwise compression: block_size=%ld, blocks=%ld\n", block_size, block_count);
+typedef struct BlockPipeline BlockPipeline;
+
+typedef struct {
+    BlockPipeline* pipe;
+    long index;
+    int done;
+    CompressionAlgorithm algo;
+    unsigned char* out;
+    long out_size;
+} BlockSlot;
+
+struct BlockPipeline {
+    ThreadPool* pool;
+    const unsigned char* input;
+    const BlockSegment* blocks;
+    FileType file_type;
+    CompressionLevel level;
+    size_t block_budget;    // per block in flight, 0 = unlimited
+    pthread_mutex_t lock;
+    pthread_cond_t block_done;
+};
+
+static void blockwise_block_task(void* arg) {
+    BlockSlot* slot = (BlockSlot*)arg;
+    BlockPipeline* pipe = slot->pipe;
+    const BlockSegment* blk = &pipe->blocks[slot->index];
+    CompressionAlgorithm algo = ALGO_HARDCORE;
+    long out_size = 0;
+    unsigned char* out = blockwise_compress_block(pipe->pool, pipe->input + blk->start, blk->size, pipe->file_type,
+                                                  blk->kind, pipe->level, pipe->block_budget, &algo, &out_size);
+
+    pthread_mutex_lock(&pipe->lock);
+    slot->algo = algo;
+    slot->out = out;
+    slot->out_size = out_size;
+    slot->done = 1;
+    pthread_cond_broadcast(&pipe->block_done);
+    pthread_mutex_unlock(&pipe->lock);
+}
+
+// Compress blocks[0, count) of input and hand them to sink in block order.
+// One thread (NULL pool) compresses each block just before it is handed
+// over; otherwise workers compress ahead, and candidates within a block
+// share the same pool. Stops at the first block no codec could compress
+// or the first sink error.
+static CompResult blockwise_run_pipeline(ThreadPool* pool, const unsigned char* input, const BlockSegment* blocks,
+                                         long count, FileType file_type, CompressionLevel level,
+                                         size_t block_budget, BlockwiseSink sink, void* sink_ctx) {
+    long window = pool ? (long)thread_pool_size(pool) * BLOCK_WINDOW_PER_THREAD : 1;
+    if (window > count) window = count;
+
+    BlockSlot* slots = (BlockSlot*)comp_calloc((size_t)window, sizeof(BlockSlot));
+    if (!slots) return COMP_ERR_MEMORY;
+    BlockPipeline pipe;
+    pipe.pool = pool;
+    pipe.input = input;
+    pipe.blocks = blocks;
+    pipe.file_type = file_type;
+    pipe.level = level;
+    pipe.block_budget = block_budget;
+    pthread_mutex_init(&pipe.lock, NULL);
+    pthread_cond_init(&pipe.block_done, NULL);
+
+    CompResult result = COMP_SUCCESS;
+    long next_submit = 0;
+    for (long b = 0; b < count; b++) {
+        // Keep the window full: block next_submit reuses the slot of a block already written
+        while (next_submit < count && next_submit < b + window) {
+            BlockSlot* slot = &slots[next_submit % window];
+            slot->pipe = &pipe;
+            slot->index = next_submit;
+            slot->done = 0;
+            slot->out = NULL;
+            if (thread_pool_submit(pool, blockwise_block_task, slot) != 0) blockwise_block_task(slot);
+            next_submit++;
+        }
+
+        BlockSlot* slot = &slots[b % window];
+        pthread_mutex_lock(&pipe.lock);
+        while (!slot->done) pthread_cond_wait(&pipe.block_done, &pipe.lock);
+        pthread_mutex_unlock(&pipe.lock);
+
+        if (!slot->out) {
+            printf("Error: Block %ld could not be compressed.\n", b);
+            result = COMP_ERR_COMPRESSION_FAILED;
+            break;
+        }
+        result = sink(sink_ctx, input + blocks[b].start, blocks[b].size, slot->algo, slot->out, slot->out_size);
+        blockwise_free_output(slot->algo, slot->out);
+        slot->out = NULL;
+        if (result != COMP_SUCCESS) break;
+    }
+
+    // On error, let the blocks still in flight finish before releasing them
+    thread_pool_wait(pool);
+    for (long i = 0; i < window; i++) blockwise_free_output(slots[i].algo, slots[i].out);
+    comp_free(slots);
+    pthread_mutex_destroy(&pipe.lock);
+    pthread_cond_destroy(&pipe.block_done);
+    return result;
+}
+
+long blockwise_max_block(FileType file_type) {
+    return (file_type == FILE_TYPE_IMAGE) ? 256 * 1024 : 512 * 1024;
+}
+
+CompResult blockwise_compress_chunk(const unsigned char* input, long input_size, FileType file_type,
+                                    CompressionLevel level, struct ThreadPool* pool,
+                                    BlockwiseSink sink, void* sink_ctx) {
+    if (!input || input_size <= 0 || !sink) return COMP_ERR_INVALID_PARAMS;
+    BlockSegment* blocks = NULL;
+    long block_count = blockwise_segment(input, input_size, file_type, blockwise_max_block(file_type), &blocks);
+    if (block_count == 0) return COMP_ERR_MEMORY;
+    CompResult r = blockwise_run_pipeline(pool, input, blocks, block_count, file_type, level, 0, sink, sink_ctx);
+    comp_free(blocks);
+    return r;
+}
+
+// v5 writer: payloads go straight to the file, their descriptors to the index
+typedef struct {
+    FILE* out;
+    BlockIndexEntry* entries;
+    long written;
+    CompressionLevel level;
+    long total_comp;
+} BlockFileSink;
+
+static CompResult blockwise_file_sink(void* ctx, const unsigned char* block, long block_size,
+                                      CompressionAlgorithm algo, const unsigned char* payload, long payload_size) {
+    BlockFileSink* fs = (BlockFileSink*)ctx;
+    if (fwrite(payload, 1, (size_t)payload_size, fs->out) != (size_t)payload_size) {
+        printf("Error: Failed to write block %ld.\n", fs->written);
+        return COMP_ERR_FILE_WRITE;
+    }
+    BlockIndexEntry* e = &fs->entries[fs->written++];
+    e->algo = (unsigned char)algo;
+    e->level = (unsigned char)fs->level;
+    e->crc = CRC32_Calculate(block, (size_t)block_size);
+    e->data_offset = BLOCK_V5_HEADER_SIZE + (uint64_t)fs->total_comp;
+    e->orig_size = (uint64_t)block_size;
+    e->comp_size = (uint64_t)payload_size;
+    fs->total_comp += payload_size;
+    return COMP_SUCCESS;
+}
+
+// ===== Memory budget =====
+// Under a budget the pipeline is sized so that everything live at once fits:
+// the input, the block table and index, up to one block in flight per
+// worker, and the window of finished blocks waiting to be written. A block
+// in flight is charged for every candidate of its costliest list, since
+// candidates may run together and keep their outputs until one is picked.
+// Workers are dropped first, which leaves the output unchanged, then the
+// block size is halved down to BLOCK_BUDGET_MIN; if one worker still does
+// not fit, blocks run only the candidates that do.
+#define BLOCK_BUDGET_MIN (64 * 1024)
+
+static size_t blockwise_block_cost(FileType file_type, CompressionLevel level, long size) {
+    CompressionAlgorithm candidates[BLOCK_MAX_CANDIDATES];
+    size_t worst = 0;
+    for (int kind = SEGMENT_BINARY; kind <= SEGMENT_ENTROPIC; kind++) {
+        int num = blockwise_block_candidates(file_type, (SegmentClass)kind, candidates);
+        size_t cost = 0;
+        for (int i = 0; i < num; i++) cost += blockwise_candidate_cost(candidates[i], level, size);
+        if (cost > worst) worst = cost;
+    }
+    return worst;
+}
+
+// The input, the block table and the index
+static size_t blockwise_fixed_cost(long input_size) {
+    long granules = input_size / SEGMENT_GRANULE + 1;
+    return (size_t)input_size + 64 * 1024 +
+           (size_t)granules * (2 * sizeof(BlockSegment) + sizeof(BlockIndexEntry) + BLOCK_V5_ENTRY_SIZE);
+}
+
+// A finished block waiting to be written
+static size_t blockwise_held_cost(long block) {
+    return (size_t)block + (size_t)block / 8 + 1024;
+}
+
+// Blocks in flight on t workers and the window of finished ones
+static size_t blockwise_pipeline_cost(FileType file_type, CompressionLevel level, long block, int t) {
+    size_t window = (t == 1) ? 1 : (size_t)t * BLOCK_WINDOW_PER_THREAD;
+    return (size_t)t * blockwise_block_cost(file_type, level, block) + window * blockwise_held_cost(block);
+}
+
+// Fit *max_block and *threads to max_memory and set *block_budget, the
+// share of one block in flight (0 when every candidate fits). Fails when
+// a single worker cannot run the LZ77 fallback on the smallest block.
+static CompResult blockwise_plan_budget(long input_size, FileType file_type, CompressionLevel level,
+                                        size_t max_memory, long* max_block, int* threads, size_t* block_budget) {
+    size_t fixed = blockwise_fixed_cost(input_size);
+    if (fixed >= max_memory) return COMP_ERR_MEMORY;
+    size_t avail = max_memory - fixed;
+    int workers = (*threads > 0) ? *threads : thread_pool_cpu_count();
+
+    long block = *max_block;
+    for (;;) {
+        for (int t = workers; t >= 1; t--) {
+            if (blockwise_pipeline_cost(file_type, level, block, t) <= avail) {
+                *max_block = block;
+                *threads = t;
+                *block_budget = 0;
+                return COMP_SUCCESS;
+            }
+        }
+        if (block <= BLOCK_BUDGET_MIN) break;
+        block = (block / 2 < BLOCK_BUDGET_MIN) ? BLOCK_BUDGET_MIN : block / 2;
+    }
+
+    // One worker on the smallest blocks, running what fits
+    size_t held = blockwise_held_cost(block);
+    size_t fallback = lz77_memory_cost(block);
+    size_t candidate = blockwise_candidate_cost(ALGO_LZ77, level, block);
+    if (avail < held + (candidate > fallback ? candidate : fallback)) return COMP_ERR_MEMORY;
+    *max_block = block;
+    *threads = 1;
+    *block_budget = avail - held;
+    return COMP_SUCCESS;
+}
+
+// Blockwise intelligent compression with per-block algorithm selection
+CompResult compress_file_blockwise(const unsigned char* input_buffer, long input_size,
+                            const char* output_path, FileType file_type,
+                            CompressionLevel level, int threads, size_t max_memory, CompressionStats* stats) {
+    if (!input_buffer || input_size <= 0 || !output_path || !stats) return COMP_ERR_INVALID_PARAMS;
+
+    // Largest block by type; boundaries inside that follow the content
+    long max_block = blockwise_max_block(file_type);
+
+    size_t block_budget = 0;
+    if (max_memory > 0) {
+        if (blockwise_plan_budget(input_size, file_type, level, max_memory, &max_block, &threads,
+                                  &block_budget) != COMP_SUCCESS) {
+            printf("Error: A %zu-byte memory budget cannot hold this input and one block in flight.\n", max_memory);
+            return COMP_ERR_MEMORY;
+        }
+        printf("Memory budget %.1f MB: threads=%d%s\n", max_memory / (1024.0 * 1024.0), threads,
+               block_budget ? ", candidates limited to the budget" : "");
+    }
+
+    BlockSegment* blocks = NULL;
+    long block_count = blockwise_segment(input_buffer, input_size, file_type, max_block, &blocks);
+    if (block_count == 0) return COMP_ERR_MEMORY;
+    printf("Blockwise compression: max_block=%ld, blocks=%ld\n", max_block, block_count);
 
     // Prepare output file
     FILE* out = fopen(output_path, "wb");
     if (!out) {
         printf("Error: Cannot create output file.\n");
+        comp_free(blocks);
         return COMP_ERR_FILE_WRITE;
     }
 
-    // Build v4 header (64 bytes base)
-    unsigned char header[64];
+    // Build v5 header (64 bytes); payload total and index offset are filled in at the end
+    unsigned char header[BLOCK_V5_HEADER_SIZE];
     memset(header, 0, sizeof(header));
     header[0] = 'C'; header[1] = 'O'; header[2] = 'M'; header[3] = 'P';
-    header[4] = 4; // version 4
+    header[4] = 5; // version 5
     header[5] = (unsigned char)ALGO_BLOCKWISE;
     header[6] = (unsigned char)level;
     header[7] = (unsigned char)file_type;
@@ -680,169 +1585,46 @@ CompResult compress_file_blockwise(const unsigned char* input_buffer, long input
     header[25] = (block_count >> 16) & 0xFF;
     header[26] = (block_count >> 8) & 0xFF;
     header[27] = (block_count) & 0xFF;
-    // marker for block table at 28..31: 'B','L','K','4'
-    header[28] = 'B'; header[29] = 'L'; header[30] = 'K'; header[31] = '4';
+    // marker at 28..31: 'B','L','K','5'
+    header[28] = 'B'; header[29] = 'L'; header[30] = 'K'; header[31] = '5';
 
-    size_t header_written = fwrite(header, 1, 64, out);
-    if (header_written != 64) {
+    size_t header_written = fwrite(header, 1, sizeof(header), out);
+    if (header_written != sizeof(header)) {
         printf("Error: Failed to write header.\n");
+        comp_free(blocks);
         fclose(out);
         return COMP_ERR_FILE_WRITE;
     }
 
-    // Write block table header: magic + count
-    unsigned char table_hdr[8];
-    table_hdr[0] = 'B'; table_hdr[1] = 'T'; table_hdr[2] = 'A'; table_hdr[3] = 'B';
-    table_hdr[4] = (block_count >> 24) & 0xFF;
-    table_hdr[5] = (block_count >> 16) & 0xFF;
-    table_hdr[6] = (block_count >> 8) & 0xFF;
-    table_hdr[7] = (block_count) & 0xFF;
-    fwrite(table_hdr, 1, 8, out);
-
-    // Collect block descriptors to compute total compressed size
-    typedef struct {
-        unsigned char algo;
-        unsigned char lvl;
-        unsigned int orig_sz;
-        unsigned int comp_sz;
-    } BlockDesc;
-
-    BlockDesc* descs = (BlockDesc*)COMP_MALLOC(sizeof(BlockDesc) * block_count);
-    if (!descs) { fclose(out); return COMP_ERR_MEMORY; }
-
-    long total_comp = 0;
-
-    // Compress each block with best of candidates
-    for (long b = 0; b < block_count; b++) {
-        long start = b * block_size;
-        long end = start + block_size;
-        if (end > input_size) end = input_size;
-        long size = end - start;
-        const unsigned char* blk = input_buffer + start;
-
-        CompressionAlgorithm candidates[4];
-        int num = 0;
-        switch (file_type) {
-            case FILE_TYPE_TEXT:
-            case FILE_TYPE_CSV:
-            case FILE_TYPE_JSON:
-            case FILE_TYPE_XML:
-                candidates[0] = ALGO_HARDCORE;
-                candidates[1] = ALGO_LZ77;
-                candidates[2] = ALGO_LZW;
-                candidates[3] = ALGO_HUFFMAN;
-                num = 4;
-                break;
-            case FILE_TYPE_PDF:
-            case FILE_TYPE_DOCX:
-                candidates[0] = ALGO_HARDCORE;
-                candidates[1] = ALGO_LZ77;
-                candidates[2] = ALGO_LZW;
-                num = 3;
-                break;
-            case FILE_TYPE_IMAGE:
-                candidates[0] = ALGO_IMAGE_ADVANCED;
-                candidates[1] = ALGO_LZ77;
-                candidates[2] = ALGO_LZW;
-                candidates[3] = ALGO_HARDCORE;
-                num = 4;
-                break;
-            case FILE_TYPE_AUDIO:
-                candidates[0] = ALGO_AUDIO_ADVANCED;
-                candidates[1] = ALGO_HARDCORE;
-                candidates[2] = ALGO_LZ77;
-                num = 3;
-                break;
-            default:
-                candidates[0] = ALGO_HARDCORE;
-                candidates[1] = ALGO_LZ77;
-                candidates[2] = ALGO_LZW;
-                candidates[3] = ALGO_HUFFMAN;
-                num = 4;
+    BlockIndexEntry* entries = (BlockIndexEntry*)comp_calloc((size_t)block_count, sizeof(BlockIndexEntry));
+    if (!entries) { comp_free(blocks); fclose(out); return COMP_ERR_MEMORY; }
+
+    ThreadPool* pool = (threads == 1) ? NULL : thread_pool_create(threads);
+    BlockFileSink sink = { out, entries, 0, level, 0 };
+    CompResult result = blockwise_run_pipeline(pool, input_buffer, blocks, block_count, file_type, level,
+                                               block_budget, blockwise_file_sink, &sink);
+    thread_pool_destroy(pool);
+    long total_comp = sink.total_comp;
+
+    // Index and footer follow the last payload; the header then gets the
+    // payload total (16..23) and the index offset (32..39)
+    uint64_t index_offset = BLOCK_V5_HEADER_SIZE + (uint64_t)total_comp;
+    if (result == COMP_SUCCESS) {
+        put_be64(header + 16, (uint64_t)total_comp);
+        put_be64(header + 32, index_offset);
+        if (blockwise_write_index(out, entries, block_count, index_offset) != 0 ||
+            fseek(out, 0, SEEK_SET) != 0 || fwrite(header, 1, sizeof(header), out) != sizeof(header)) {
+            printf("Error: Failed to write block index.\n");
+            result = COMP_ERR_FILE_WRITE;
         }
-
-        unsigned char* best_out = NULL;
-        long best_sz = size + 1; // larger than original initially
-        CompressionAlgorithm best_alg = candidates[0];
-
-        for (int i = 0; i < num; i++) {
-            unsigned char* out_buf = NULL; long out_sz = 0; int r = -1;
-            switch (candidates[i]) {
-                case ALGO_HUFFMAN: r = huffman_compress(blk, size, &out_buf, &out_sz); break;
-                case ALGO_LZ77: r = lz77_compress(blk, size, &out_buf, &out_sz); break;
-                case ALGO_LZW: r = lzw_compress(blk, size, &out_buf, &out_sz); break;
-                case ALGO_AUDIO_ADVANCED: r = audio_compress(blk, size, &out_buf, &out_sz, level); break;
-                case ALGO_IMAGE_ADVANCED: r = image_compress(blk, size, &out_buf, &out_sz, level); break;
-                case ALGO_HARDCORE: r = hardcore_compress(blk, size, &out_buf, &out_sz); break;
-                default: r = -1; break;
-            }
-            // Verify hardcore payloads are decodable and size-correct to prevent invalid outputs
-            if (r == 0 && candidates[i] == ALGO_HARDCORE && out_buf && out_sz > 0) {
-                unsigned char* verify_out = NULL; long verify_sz = 0;
-                int vr = hardcore_decompress(out_buf, out_sz, &verify_out, &verify_sz);
-                if (vr != 0 || verify_sz != size) {
-                    if (verify_out) COMP_FREE(verify_out);
-                    r = -1; // reject this candidate due to invalid decode
-                } else if (verify_out) {
-                    COMP_FREE(verify_out);
-                }
-            }
-            if (r == 0 && out_buf && out_sz > 0 && out_sz < best_sz) {
-                if (best_out) COMP_FREE(best_out);
-                best_out = out_buf; best_sz = out_sz; best_alg = candidates[i];
-            } else {
-                if (out_buf) COMP_FREE(out_buf);
-            }
-        }
-
-        /* FORCE-COMPRESS – raw storage disabled */
-        // If no candidate produced output, force Hardcore as last resort
-        if (!best_out) {
-            unsigned char* out_buf = NULL; long out_sz = 0; int r = hardcore_compress(blk, size, &out_buf, &out_sz);
-            if (r == 0 && out_buf && out_sz > 0) {
-                best_out = out_buf; best_sz = out_sz; best_alg = ALGO_HARDCORE;
-            } else {
-                if (out_buf) COMP_FREE(out_buf);
-                // As an absolute fallback, try LZ77
-                r = lz77_compress(blk, size, &out_buf, &out_sz);
-                if (r == 0 && out_buf && out_sz > 0) { best_out = out_buf; best_sz = out_sz; best_alg = ALGO_LZ77; }
-            }
-        }
-
-        // Write block descriptor (10 bytes) then data
-        unsigned char desc[10];
-        desc[0] = (unsigned char)best_alg;
-        desc[1] = (unsigned char)level;
-        desc[2] = (size >> 24) & 0xFF;
-        desc[3] = (size >> 16) & 0xFF;
-        desc[4] = (size >> 8) & 0xFF;
-        desc[5] = (size) & 0xFF;
-        desc[6] = (best_sz >> 24) & 0xFF;
-        desc[7] = (best_sz >> 16) & 0xFF;
-        desc[8] = (best_sz >> 8) & 0xFF;
-        desc[9] = (best_sz) & 0xFF;
-        fwrite(desc, 1, 10, out);
-        fwrite(best_out, 1, best_sz, out);
-
-        descs[b].algo = desc[0];
-        descs[b].lvl = desc[1];
-        descs[b].orig_sz = size;
-        descs[b].comp_sz = best_sz;
-        total_comp += best_sz;
-        COMP_FREE(best_out);
-    }
-
-    // Update compressed size in header
-    long cur_pos = ftell(out);
-    // Seek and rewrite header compressed size 16..23
-    fseek(out, 16, SEEK_SET);
-    for (int i = 0; i < 8; i++) {
-        unsigned char c = (total_comp >> ((7 - i) * 8)) & 0xFF;
-        fwrite(&c, 1, 1, out);
     }
-    fseek(out, cur_pos, SEEK_SET);
-
-    fclose(out);
+    comp_free(entries);
+    comp_free(blocks);
+    if (fclose(out) != 0 && result == COMP_SUCCESS) result = COMP_ERR_FILE_WRITE;
+    if (result != COMP_SUCCESS) {
+        remove(output_path);
+        return result;
+    }
 
     // Fill stats
     stats->original_size = input_size;
@@ -850,6 +1632,7 @@ CompResult compress_file_blockwise(const unsigned char* input_buffer, long input
     stats->compression_ratio = (double)total_comp / (double)input_size * 100.0;
     stats->algorithm_used = ALGO_BLOCKWISE;
     stats->compression_level = level;
+    stats->memory_usage = stats_peak_bytes(max_memory) / 1024.0 / 1024.0;
 
     // Post-compression minimal-reduction warning
     if (total_comp >= input_size - 64) {
@@ -864,13 +1647,14 @@ CompResult compress_file_blockwise(const unsigned char* input_buffer, long input
 // Enhanced compression function with level support
 CompResult compress_file_with_level(const char* input_path, const char* output_path, 
                            CompressionAlgorithm algo, CompressionLevel level, 
-                           CompressionStats* stats) {
-    unsigned char* input_buffer = NULL;
+                           int threads, size_t max_memory, CompressionStats* stats) {
+    CompInput input;
     unsigned char* output_buffer = NULL;
-    long input_size, output_size;
+    long output_size;
     double start_time, end_time;
     
     // Reset memory tracking
+    comp_alloc_reset_peak();
     start_time = get_time_ms();
     
     // Initialize stats
@@ -879,24 +1663,20 @@ CompResult compress_file_with_level(const char* input_path, const char* output_p
     stats->algorithm_used = algo;
     stats->compression_level = level;
     
-    const char* input_filename = strrchr(input_path, '\\');
-    if (!input_filename) input_filename = strrchr(input_path, '/');
-    if (!input_filename) input_filename = input_path;
-    else input_filename++;
-    
-    const char* output_filename = strrchr(output_path, '\\');
-    if (!output_filename) output_filename = strrchr(output_path, '/');
-    if (!output_filename) output_filename = output_path;
-    else output_filename++;
-    
-    strncpy(stats->original_filename, input_filename, MAX_FILENAME_LENGTH - 1);
-    strncpy(stats->compressed_filename, output_filename, MAX_FILENAME_LENGTH - 1);
+    stats_set_filenames(stats, input_path, output_path);
+    CompResult budget = budget_check_input(input_path, max_memory);
+    if (budget != COMP_SUCCESS) return budget;
     
     // Read input file
     printf("Reading input file...\n");
-    if (read_file(input_path, &input_buffer, &input_size) != 0) {
+    // Hardcore and blockwise make several passes; the rest read front to back
+    CompInputAccess access = (algo == ALGO_HARDCORE || algo == ALGO_BLOCKWISE || level >= COMPRESSION_LEVEL_HIGH)
+                             ? COMP_INPUT_RANDOM : COMP_INPUT_SEQUENTIAL;
+    if (open_input_file(input_path, access, &input) != 0) {
         return COMP_ERR_FILE_READ;
     }
+    const unsigned char* input_buffer = input.data;
+    long input_size = (long)input.size;
     
     stats->original_size = input_size;
     printf("Input file size: %ld bytes\n", input_size);
@@ -906,12 +1686,24 @@ CompResult compress_file_with_level(const char* input_path, const char* output_p
     int result = -1;
     
     // Auto-select hardcore compression for better results if level is high enough
-    if (level >= COMPRESSION_LEVEL_HIGH && algo != ALGO_HARDCORE && 
-        algo != ALGO_AUDIO_ADVANCED && algo != ALGO_IMAGE_ADVANCED) {
+    // (unless it would not fit the memory budget)
+    if (level >= COMPRESSION_LEVEL_HIGH && algo != ALGO_HARDCORE && algo != ALGO_BLOCKWISE &&
+        algo != ALGO_AUDIO_ADVANCED && algo != ALGO_IMAGE_ADVANCED &&
+        (max_memory == 0 || (size_t)input_size + hardcore_memory_cost(input_size) <= max_memory)) {
         printf("Auto-selecting hardcore compression for better space savings (40-60%%)...\n");
         algo = ALGO_HARDCORE;
         stats->algorithm_used = ALGO_HARDCORE;
     }
+
+    // A whole-input codec that would not fit the budget gives way to the
+    // blockwise container, which sizes its blocks to the budget
+    if (max_memory > 0 && algo != ALGO_BLOCKWISE &&
+        (size_t)input_size + codec_memory_cost(algo, level, input_size) > max_memory) {
+        printf("Algorithm %d needs %.1f MB for this input; using blockwise compression to stay within the memory budget\n",
+               algo, ((size_t)input_size + codec_memory_cost(algo, level, input_size)) / (1024.0 * 1024.0));
+        algo = ALGO_BLOCKWISE;
+        stats->algorithm_used = ALGO_BLOCKWISE;
+    }
     
     switch (algo) {
         case ALGO_HUFFMAN:
@@ -921,7 +1713,9 @@ CompResult compress_file_with_level(const char* input_path, const char* output_p
 
         case ALGO_LZ77:
             printf("Applying LZ77 compression...\n");
-            result = lz77_compress(input_buffer, input_size, &output_buffer, &output_size);
+            result = (level >= COMPRESSION_LEVEL_NORMAL)
+                ? lz77_compress_v2(input_buffer, input_size, &output_buffer, &output_size, level)
+                : lz77_compress_level(input_buffer, input_size, &output_buffer, &output_size, level);
             break;
 
         case ALGO_LZW:
@@ -947,25 +1741,39 @@ CompResult compress_file_with_level(const char* input_path, const char* output_p
             if (result == 0) {
                 printf("Writing hardcore compressed file...\n");
                 if (write_file(output_path, output_buffer, output_size) != 0) {
-                    COMP_FREE(input_buffer);
+                    comp_input_close(&input);
                     COMP_FREE(output_buffer);
                     return COMP_ERR_FILE_WRITE;
                 }
                 stats->compressed_size = output_size;
                 stats->compression_ratio = (double)output_size / input_size * 100.0;
                 stats->compression_speed = (input_size / 1024.0 / 1024.0) / ((end_time - start_time) / 1000.0);
-                stats->memory_usage = atomic_load(&g_memory_pool.peak_usage) / 1024.0 / 1024.0;
+                stats->memory_usage = stats_peak_bytes(max_memory) / 1024.0 / 1024.0;
                 /* FORCE: never store raw – continue compressing */
-                COMP_FREE(input_buffer);
+                comp_input_close(&input);
                 COMP_FREE(output_buffer);
                 printf("Hardcore compression completed successfully!\n");
                 return COMP_SUCCESS;
             }
             break;
 
+        case ALGO_BLOCKWISE: {
+            // The v4 container is written block by block, so it bypasses the v2 header below
+            printf("Applying blockwise compression (per-block algorithm selection)...\n");
+            FileType file_type = detect_file_type_enhanced(input_path, input_buffer, input_size);
+            CompResult br = compress_file_blockwise(input_buffer, input_size, output_path, file_type,
+                                                    level, threads, max_memory, stats);
+            end_time = get_time_ms();
+            if (br == COMP_SUCCESS) {
+                stats->compression_speed = (input_size / 1024.0 / 1024.0) / ((end_time - start_time) / 1000.0);
+            }
+            comp_input_close(&input);
+            return br;
+        }
+
         default:
             printf("Error: Unknown compression algorithm.\n");
-            COMP_FREE(input_buffer);
+            comp_input_close(&input);
             return COMP_ERR_INVALID_ALGORITHM;
     }
     
@@ -973,7 +1781,7 @@ CompResult compress_file_with_level(const char* input_path, const char* output_p
     
     if (result != 0) {
         printf("Error: Compression failed.\n");
-        COMP_FREE(input_buffer);
+        comp_input_close(&input);
         if (output_buffer) COMP_FREE(output_buffer);
         return COMP_ERR_COMPRESSION_FAILED;
     }
@@ -982,7 +1790,8 @@ CompResult compress_file_with_level(const char* input_path, const char* output_p
     stats->compressed_size = output_size;
     stats->compression_ratio = (double)output_size / input_size * 100.0;
     stats->compression_speed = (input_size / 1024.0 / 1024.0) / ((end_time - start_time) / 1000.0);
-    stats->memory_usage = atomic_load(&g_memory_pool.peak_usage) / 1024.0 / 1024.0;
+    size_t peak_bytes = stats_peak_bytes(max_memory);
+    stats->memory_usage = peak_bytes / 1024.0 / 1024.0;
 
     /* FORCE: never store raw – continue compressing */
     
@@ -1044,7 +1853,7 @@ CompResult compress_file_with_level(const char* input_path, const char* output_p
     }
     
     // Peak memory usage (4 bytes, in KB)
-    uint32_t memory_kb = (uint32_t)(atomic_load(&g_memory_pool.peak_usage) / 1024);
+    uint32_t memory_kb = (uint32_t)(peak_bytes / 1024);
     for (int i = 0; i < 4; i++) {
         header[28 + i] = (memory_kb >> ((3 - i) * 8)) & 0xFF;
     }
@@ -1063,7 +1872,7 @@ CompResult compress_file_with_level(const char* input_path, const char* output_p
     FILE* output_file = fopen(output_path, "wb");
     if (!output_file) {
         printf("Error: Cannot create output file.\n");
-        COMP_FREE(input_buffer);
+        comp_input_close(&input);
         COMP_FREE(output_buffer);
         return COMP_ERR_FILE_WRITE;
     }
@@ -1073,7 +1882,7 @@ CompResult compress_file_with_level(const char* input_path, const char* output_p
     fclose(output_file);
     
     // Cleanup
-    COMP_FREE(input_buffer);
+    comp_input_close(&input);
     COMP_FREE(output_buffer);
     
     printf("Compression completed successfully!\n");
@@ -1082,15 +1891,15 @@ CompResult compress_file_with_level(const char* input_path, const char* output_p
 
 // Backward compatibility function
 CompResult compress_file(const char* input_path, const char* output_path, CompressionAlgorithm algo, CompressionStats* stats) {
-    return compress_file_with_level(input_path, output_path, algo, COMPRESSION_LEVEL_NORMAL, stats);
+    return compress_file_with_level(input_path, output_path, algo, COMPRESSION_LEVEL_NORMAL, 0, 0, stats);
 }
 
 // Main decompression function
 CompResult decompress_file(const char* input_path, const char* output_path, CompressionStats* stats) {
-    unsigned char* input_buffer = NULL;
-    unsigned char* compressed_data = NULL;
+    CompInput input;
+    const unsigned char* compressed_data = NULL;
     unsigned char* output_buffer = NULL;
-    long input_size, compressed_size, output_size;
+    long compressed_size, output_size;
     
     // Initialize stats
     memset(stats, 0, sizeof(CompressionStats));
@@ -1098,18 +1907,20 @@ CompResult decompress_file(const char* input_path, const char* output_path, Comp
     
     // Read compressed file
     printf("Reading compressed file...\n");
-    if (read_file(input_path, &input_buffer, &input_size) != 0) {
+    if (open_input_file(input_path, COMP_INPUT_SEQUENTIAL, &input) != 0) {
         return COMP_ERR_FILE_READ;
     }
+    const unsigned char* input_buffer = input.data;
+    long input_size = (long)input.size;
     
     if (input_size < 32) {
         printf("Error: Invalid compressed file format.\n");
-        COMP_FREE(input_buffer);
+        comp_input_close(&input);
         return COMP_ERR_INVALID_FORMAT;
     }
     
     // Parse header
-    unsigned char* header = input_buffer;
+    const unsigned char* header = input_buffer;
 
     // Detect Hardcore format by magic bytes 0xAD 0xEF 0x01
     if (input_size >= 4 && header[0] == 0xAD && header[1] == 0xEF && header[2] == 0x01) {
@@ -1119,13 +1930,13 @@ CompResult decompress_file(const char* input_path, const char* output_path, Comp
 
         if (hardcore_decompress(input_buffer, input_size, &output_buffer, &output_size) != 0) {
             printf("Error: Hardcore decompression failed.\n");
-            COMP_FREE(input_buffer);
+            comp_input_close(&input);
             return COMP_ERR_DECOMPRESSION_FAILED;
         }
 
         printf("Writing decompressed file...\n");
         if (write_file(output_path, output_buffer, output_size) != 0) {
-            COMP_FREE(input_buffer);
+            comp_input_close(&input);
             COMP_FREE(output_buffer);
             return COMP_ERR_FILE_WRITE;
         }
@@ -1148,7 +1959,7 @@ CompResult decompress_file(const char* input_path, const char* output_path, Comp
         stats->compression_ratio = (double)input_size / output_size * 100.0;
         stats->algorithm_used = ALGO_HARDCORE;
 
-        COMP_FREE(input_buffer);
+        comp_input_close(&input);
         COMP_FREE(output_buffer);
 
         printf("Hardcore decompression completed successfully!\n");
@@ -1159,132 +1970,51 @@ CompResult decompress_file(const char* input_path, const char* output_path, Comp
     // Check standard magic number
     if (header[0] != 'C' || header[1] != 'O' || header[2] != 'M' || header[3] != 'P') {
         printf("Error: Unknown container magic. Expected 'COMP' or Hardcore (AD EF 01).\n");
-        COMP_FREE(input_buffer);
+        comp_input_close(&input);
         return COMP_ERR_INVALID_FORMAT;
     }
 
     unsigned char version = header[4];
     printf("Container version: %u\n", version);
 
-    if (version == 4 && (CompressionAlgorithm)header[5] == ALGO_BLOCKWISE) {
-        // Parse v4 blockwise format
-        long original_size = 0;
-        for (int i = 0; i < 8; i++) original_size = (original_size << 8) | header[8 + i];
-        long compressed_total = 0;
-        for (int i = 0; i < 8; i++) compressed_total = (compressed_total << 8) | header[16 + i];
-        long block_count = (header[24] << 24) | (header[25] << 16) | (header[26] << 8) | header[27];
-
-        printf("Blockwise: original=%ld, compressed=%ld, blocks=%ld\n", original_size, compressed_total, block_count);
-
-        // Position after header
-        long pos = 64;
-        if (pos + 8 > input_size || memcmp(input_buffer + pos, "BTAB", 4) != 0) {
-            printf("Error: Missing block table header.\n");
-            COMP_FREE(input_buffer);
-            return COMP_ERR_INVALID_FORMAT;
-        }
-        pos += 8; // skip table header
-
-        // Allocate output buffer
-        output_buffer = (unsigned char*)COMP_MALLOC(original_size);
-        if (!output_buffer) { COMP_FREE(input_buffer); return COMP_ERR_MEMORY; }
-        output_size = original_size;
-
-        long out_off = 0;
-        for (long b = 0; b < block_count; b++) {
-            if (pos + 10 > input_size) { printf("Error: Truncated block descriptor.\n"); COMP_FREE(input_buffer); COMP_FREE(output_buffer); return COMP_ERR_INVALID_FORMAT; }
-            unsigned char algo = input_buffer[pos + 0];
-            unsigned char lvl  = input_buffer[pos + 1];
-            unsigned int orig_sz = (input_buffer[pos + 2] << 24) | (input_buffer[pos + 3] << 16) | (input_buffer[pos + 4] << 8) | (input_buffer[pos + 5]);
-            unsigned int comp_sz = (input_buffer[pos + 6] << 24) | (input_buffer[pos + 7] << 16) | (input_buffer[pos + 8] << 8) | (input_buffer[pos + 9]);
-            pos += 10;
-
-            // Debug: show block descriptor
-            printf("Block %ld: algo=%u, lvl=%u, orig=%u, comp=%u\n", b, algo, lvl, orig_sz, comp_sz);
-
-            // Validate algorithm code
-            if (algo != ALGO_HUFFMAN && algo != ALGO_LZ77 && algo != ALGO_LZW &&
-                algo != ALGO_AUDIO_ADVANCED && algo != ALGO_IMAGE_ADVANCED && algo != ALGO_HARDCORE &&
-                algo != ALGO_DEFLATE && algo != ALGO_LZMA) {
-                printf("Error: Unknown block algorithm %u at block %ld.\n", algo, b);
-                COMP_FREE(input_buffer); COMP_FREE(output_buffer); return COMP_ERR_INVALID_ALGORITHM;
-            }
-            // Basic size sanity
-            if (orig_sz == 0 || comp_sz == 0) {
-                printf("Error: Invalid block sizes at block %ld (orig=%u comp=%u).\n", b, orig_sz, comp_sz);
-                COMP_FREE(input_buffer); COMP_FREE(output_buffer); return COMP_ERR_INVALID_SIZE;
-            }
-
-            if (pos + comp_sz > input_size) {
-                printf("Error: Truncated block data at block %ld.\n", b);
-                COMP_FREE(input_buffer); COMP_FREE(output_buffer); return COMP_ERR_INVALID_FORMAT;
-            }
-            const unsigned char* blk_data = input_buffer + pos;
-            pos += comp_sz;
-
-            // Decompress per algorithm or copy if stored
-            unsigned char* blk_out = NULL; long blk_out_sz = 0; int r = 0;
-            if (algo == ALGO_HUFFMAN && comp_sz == orig_sz) {
-                // Stored (no compression)
-                blk_out = (unsigned char*)COMP_MALLOC(orig_sz);
-                memcpy(blk_out, blk_data, orig_sz); blk_out_sz = orig_sz; r = 0;
-            } else {
-                switch (algo) {
-                    case ALGO_HUFFMAN: {
-                        CompResult hr = huffman_decompress(blk_data, comp_sz, &blk_out, &blk_out_sz);
-                        r = (hr == COMP_SUCCESS) ? 0 : (int)hr;
-                        break;
-                    }
-                    case ALGO_LZ77: r = lz77_decompress(blk_data, comp_sz, &blk_out, &blk_out_sz); break;
-                    case ALGO_LZW: r = lzw_decompress(blk_data, comp_sz, &blk_out, &blk_out_sz); break;
-                    case ALGO_AUDIO_ADVANCED: r = audio_decompress(blk_data, comp_sz, &blk_out, &blk_out_sz); break;
-                    case ALGO_IMAGE_ADVANCED: r = image_decompress(blk_data, comp_sz, &blk_out, &blk_out_sz); break;
-                    case ALGO_HARDCORE: r = hardcore_decompress(blk_data, comp_sz, &blk_out, &blk_out_sz); break;
-                    case ALGO_DEFLATE: {
-                        blk_out = (unsigned char*)COMP_MALLOC(orig_sz);
-                        if (!blk_out) { r = (int)COMP_ERR_MEMORY; break; }
-                        size_t produced = deflate_decompress(blk_data, comp_sz, blk_out, (size_t)orig_sz);
-                        if (produced == 0) { r = -1; } else { blk_out_sz = (long)produced; r = 0; }
-                        break;
-                    }
-                    #ifdef HAVE_LZMA
-                    case ALGO_LZMA: {
-                        blk_out = (unsigned char*)COMP_MALLOC(orig_sz);
-                        if (!blk_out) { r = (int)COMP_ERR_MEMORY; break; }
-                        size_t produced = lzma_decompress(blk_data, comp_sz, blk_out, (size_t)orig_sz);
-                        if (produced == 0) { r = -1; } else { blk_out_sz = (long)produced; r = 0; }
-                        break;
-                    }
-                    #endif
-                    default: r = -1; break;
-                }
+    if ((version == 4 || version == 5) && (CompressionAlgorithm)header[5] == ALGO_BLOCKWISE) {
+        BlockIndexEntry* entries = NULL;
+        long block_count = 0;
+        uint64_t original_size = 0;
+        if (version == 5) {
+            CompResult ir = blockwise_index_from_memory(input_buffer, input_size, &entries, &block_count, &original_size);
+            if (ir != COMP_SUCCESS) {
+                printf("Error: Invalid v5 block index (%d).\n", (int)ir);
+                comp_input_close(&input);
+                return ir;
             }
-            if (!blk_out || blk_out_sz != orig_sz) {
-                printf("Error: Block %ld decompression failed or size mismatch (%ld != %u), algo=%u, rc=%d.\n", b, blk_out_sz, orig_sz, algo, r);
-                if (blk_out) COMP_FREE(blk_out); COMP_FREE(input_buffer); COMP_FREE(output_buffer); return COMP_ERR_DECOMPRESSION_FAILED;
+        } else {
+            CompResult tr = blockwise_table_from_v4(input_buffer, input_size, &entries, &block_count, &original_size);
+            if (tr != COMP_SUCCESS) {
+                comp_input_close(&input);
+                return tr;
             }
-            memcpy(output_buffer + out_off, blk_out, blk_out_sz);
-            out_off += blk_out_sz; COMP_FREE(blk_out);
-        }
-
-        // Final validations
-        if (out_off != original_size) {
-            printf("Error: Final output size mismatch (%ld != %ld).\n", out_off, original_size);
-            COMP_FREE(input_buffer); COMP_FREE(output_buffer); return COMP_ERR_INVALID_SIZE;
         }
-        // Compressed_total counts only the sum of block payloads, not descriptors
-        long consumed_comp = pos - 64 - 8 - (10 * block_count);
-        if (compressed_total != 0 && consumed_comp != compressed_total) {
-            printf("Error: Compressed size mismatch (%ld != %ld).\n", consumed_comp, compressed_total);
-            COMP_FREE(input_buffer); COMP_FREE(output_buffer); return COMP_ERR_INVALID_SIZE;
+        printf("Blockwise v%u: original=%llu, blocks=%ld\n", version, (unsigned long long)original_size, block_count);
+
+        // Blocks decode concurrently straight into their slice of the output
+        output_buffer = (unsigned char*)comp_malloc((size_t)original_size);
+        if (!output_buffer) { comp_free(entries); comp_input_close(&input); return COMP_ERR_MEMORY; }
+        CompResult dr = blockwise_decode_all(entries, block_count, input_buffer, output_buffer, version == 5);
+        comp_free(entries);
+        if (dr != COMP_SUCCESS) {
+            comp_free(output_buffer);
+            comp_input_close(&input);
+            return dr;
         }
 
-        // Write output
-        if (write_file(output_path, output_buffer, output_size) != 0) {
-            COMP_FREE(input_buffer); COMP_FREE(output_buffer); return COMP_ERR_FILE_WRITE;
-        }
-
-        COMP_FREE(input_buffer); COMP_FREE(output_buffer);
+        int wr = write_file(output_path, output_buffer, (long)original_size);
+        comp_free(output_buffer);
+        comp_input_close(&input);
+        if (wr != 0) return COMP_ERR_FILE_WRITE;
+        stats->original_size = (long)original_size;
+        stats->compressed_size = input_size;
+        stats->algorithm_used = ALGO_BLOCKWISE;
         printf("Blockwise decompression completed.\n");
         return COMP_SUCCESS;
     }
@@ -1311,7 +2041,7 @@ CompResult decompress_file(const char* input_path, const char* output_path, Comp
         case ALGO_HARDCORE: result = hardcore_decompress(compressed_data, compressed_size, &output_buffer, &output_size); break;
         case ALGO_DEFLATE: {
             output_buffer = (unsigned char*)COMP_MALLOC(original_size);
-            if (!output_buffer) { COMP_FREE(input_buffer); return COMP_ERR_MEMORY; }
+            if (!output_buffer) { comp_input_close(&input); return COMP_ERR_MEMORY; }
             size_t produced = deflate_decompress(compressed_data, (size_t)compressed_size, output_buffer, (size_t)original_size);
             if (produced == 0) { result = -1; } else { output_size = (long)produced; result = 0; }
             break;
@@ -1319,7 +2049,7 @@ CompResult decompress_file(const char* input_path, const char* output_path, Comp
         #ifdef HAVE_LZMA
         case ALGO_LZMA: {
             output_buffer = (unsigned char*)COMP_MALLOC(original_size);
-            if (!output_buffer) { COMP_FREE(input_buffer); return COMP_ERR_MEMORY; }
+            if (!output_buffer) { comp_input_close(&input); return COMP_ERR_MEMORY; }
             size_t produced = lzma_decompress(compressed_data, (size_t)compressed_size, output_buffer, (size_t)original_size);
             if (produced == 0) { result = -1; } else { output_size = (long)produced; result = 0; }
             break;
@@ -1327,29 +2057,91 @@ CompResult decompress_file(const char* input_path, const char* output_path, Comp
         #endif
         default:
             printf("Error: Unknown compression algorithm in file.\n");
-            COMP_FREE(input_buffer);
+            comp_input_close(&input);
             return COMP_ERR_INVALID_ALGORITHM;
     }
 
     if (result != 0) {
         printf("Error: Decompression failed.\n");
-        COMP_FREE(input_buffer);
+        comp_input_close(&input);
         if (output_buffer) COMP_FREE(output_buffer);
         return COMP_ERR_DECOMPRESSION_FAILED;
     }
 
     if (output_size != original_size) {
         printf("Error: Decompressed size (%ld) doesn't match expected size (%ld).\n", output_size, original_size);
-        COMP_FREE(input_buffer);
+        comp_input_close(&input);
         if (output_buffer) COMP_FREE(output_buffer);
         return COMP_ERR_INVALID_SIZE;
     }
 
     if (write_file(output_path, output_buffer, output_size) != 0) {
-        COMP_FREE(input_buffer); COMP_FREE(output_buffer); return COMP_ERR_FILE_WRITE;
+        comp_input_close(&input); COMP_FREE(output_buffer); return COMP_ERR_FILE_WRITE;
     }
 
-    COMP_FREE(input_buffer); COMP_FREE(output_buffer);
+    comp_input_close(&input); COMP_FREE(output_buffer);
     printf("Single-block decompression completed.\n");
     return COMP_SUCCESS;
-}
\ No newline at end of file
+}
+
+// Decode [offset, offset + length) of a v5 blockwise file; the file is mapped, so only
+// the pages of the index and the covering blocks are read
+CompResult decompress_file_range(const char* input_path, uint64_t offset, uint64_t length,
+                                 unsigned char** output, long* output_size) {
+    if (!input_path || !output || !output_size || length == 0) return COMP_ERR_INVALID_PARAMS;
+    *output = NULL;
+    *output_size = 0;
+
+    CompInput input;
+    if (comp_input_open(input_path, COMP_INPUT_SPARSE, &input) != 0) return COMP_ERR_FILE_NOT_FOUND;
+    if (input.size > (size_t)LONG_MAX) { comp_input_close(&input); return COMP_ERR_INVALID_SIZE; }
+    BlockIndexEntry* entries = NULL;
+    long block_count = 0;
+    uint64_t original_size = 0;
+    CompResult r = blockwise_index_from_memory(input.data, (long)input.size, &entries, &block_count, &original_size);
+    if (r != COMP_SUCCESS) { comp_input_close(&input); return r; }
+    if (offset >= original_size) { comp_free(entries); comp_input_close(&input); return COMP_ERR_INVALID_PARAMS; }
+    if (length > original_size - offset) length = original_size - offset;
+    if (length > LONG_MAX) { comp_free(entries); comp_input_close(&input); return COMP_ERR_INVALID_SIZE; }
+
+    // First block whose end lies past offset
+    long lo = 0, hi = block_count - 1;
+    while (lo < hi) {
+        long mid = lo + (hi - lo) / 2;
+        if (entries[mid].orig_offset + entries[mid].orig_size <= offset) lo = mid + 1;
+        else hi = mid;
+    }
+
+    unsigned char* out = (unsigned char*)comp_malloc((size_t)length);
+    unsigned char* scratch = NULL;   // for the partly covered blocks at either end
+    size_t scratch_cap = 0;
+    if (!out) r = COMP_ERR_MEMORY;
+    uint64_t done = 0;
+    for (long b = lo; r == COMP_SUCCESS && done < length; b++) {
+        const BlockIndexEntry* e = &entries[b];
+        const unsigned char* payload = input.data + e->data_offset;
+        uint64_t from = offset + done - e->orig_offset;
+        uint64_t n = e->orig_size - from;
+        if (n > length - done) n = length - done;
+        if (n == e->orig_size) {
+            r = blockwise_decode_into(e, payload, out + done, 1);
+        } else {
+            if (e->orig_size > scratch_cap) {
+                unsigned char* grown = (unsigned char*)comp_realloc(scratch, (size_t)e->orig_size);
+                if (!grown) { r = COMP_ERR_MEMORY; break; }
+                scratch = grown;
+                scratch_cap = (size_t)e->orig_size;
+            }
+            r = blockwise_decode_into(e, payload, scratch, 1);
+            if (r == COMP_SUCCESS) memcpy(out + done, scratch + from, (size_t)n);
+        }
+        done += n;
+    }
+    comp_free(scratch);
+    comp_free(entries);
+    comp_input_close(&input);
+    if (r != COMP_SUCCESS) { comp_free(out); return r; }
+    *output = out;
+    *output_size = (long)length;
+    return COMP_SUCCESS;
+}
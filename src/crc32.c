@@ -4,6 +4,7 @@
  ******************************************************************************/
 
 #include "../include/decompressor.h"
+#include <pthread.h>
 
 /*============================================================================*/
 /* CONSTANTS                                                                  */
@@ -18,17 +19,13 @@
 /*============================================================================*/
 
 static uint32_t crc32_table[256];
-static bool crc32_table_initialized = false;
+static pthread_once_t crc32_table_once = PTHREAD_ONCE_INIT;
 
 /*============================================================================*/
 /* PRIVATE FUNCTIONS                                                          */
 /*============================================================================*/
 
-static void CRC32_InitializeTable(void) {
-    if (crc32_table_initialized) {
-        return;
-    }
-    
+static void CRC32_BuildTable(void) {
     for (uint32_t i = 0; i < 256; i++) {
         uint32_t crc = i;
         for (int j = 0; j < 8; j++) {
@@ -41,10 +38,14 @@ static void CRC32_InitializeTable(void) {
         crc32_table[i] = crc;
     }
     
-    crc32_table_initialized = true;
     Logger_Log(LOG_LEVEL_DEBUG, "CRC32 table initialized");
 }
 
+// Block decoders verify CRCs from several threads, so the table is built exactly once
+static void CRC32_InitializeTable(void) {
+    pthread_once(&crc32_table_once, CRC32_BuildTable);
+}
+
 /*============================================================================*/
 /* PUBLIC FUNCTIONS                                                           */
 /*============================================================================*/
@@ -1,19 +1,52 @@
 // Drop-in DEFLATE wrapper using vendored miniz
 #include <stdint.h>
 #include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/comp_alloc.h"
 // Explicitly include vendored miniz headers via relative path
 #include "../third_party/miniz/miniz.h"
 #include "../third_party/miniz/miniz_tdef.h"
 #include "../third_party/miniz/miniz_tinfl.h"
 
+typedef struct {
+    uint8_t* buf;
+    size_t cap;
+    size_t len;
+} deflate_out;
+
+static mz_bool deflate_out_put(const void* buf, int len, void* user) {
+    deflate_out* o = (deflate_out*)user;
+    if ((size_t)len > o->cap - o->len) return MZ_FALSE;
+    memcpy(o->buf + o->len, buf, (size_t)len);
+    o->len += (size_t)len;
+    return MZ_TRUE;
+}
+
 // Compresses `in` into `out` with zlib header using miniz tdefl API.
 // Returns number of bytes written to `out`, or 0 on error.
 size_t deflate_compress(const uint8_t* in, size_t in_len, uint8_t* out, size_t out_cap, int level) {
     if (!in || !out || out_cap == 0) return 0;
     int lvl = (level > 0) ? level : MZ_DEFAULT_LEVEL;
     int comp_flags = (int)tdefl_create_comp_flags_from_zip_params(lvl, 15 /* zlib */, MZ_DEFAULT_STRATEGY) | TDEFL_WRITE_ZLIB_HEADER;
-    size_t written = tdefl_compress_mem_to_mem(out, out_cap, in, in_len, comp_flags);
-    return written ? written : 0;
+    // Our own compressor state rather than tdefl_compress_mem_to_mem's
+    // internal malloc, so the allocator counts it
+    tdefl_compressor* comp = (tdefl_compressor*)comp_malloc(sizeof(tdefl_compressor));
+    if (!comp) return 0;
+    deflate_out o = { out, out_cap, 0 };
+    size_t written = 0;
+    if (tdefl_init(comp, deflate_out_put, &o, comp_flags) == TDEFL_STATUS_OKAY &&
+        tdefl_compress_buffer(comp, in, in_len, TDEFL_FINISH) == TDEFL_STATUS_DONE) {
+        written = o.len;
+    }
+    comp_free(comp);
+    return written;
+}
+
+// Bytes deflate_compress allocates: one compressor state whatever the input size
+size_t deflate_memory_cost(size_t in_len) {
+    (void)in_len;
+    return sizeof(tdefl_compressor);
 }
 
 // Decompresses `in` into `out` using miniz tinfl API, expecting zlib header.
@@ -23,4 +56,97 @@ size_t deflate_decompress(const uint8_t* in, size_t in_len, uint8_t* out, size_t
     size_t written = tinfl_decompress_mem_to_mem(out, out_cap, in, in_len, TINFL_FLAG_PARSE_ZLIB_HEADER);
     if (written == TINFL_DECOMPRESS_MEM_TO_MEM_FAILED) return 0;
     return written;
-}
\ No newline at end of file
+}
+
+// ===== Streaming DEFLATE =====
+// Constant-memory zlib streams for callers that cannot hold the whole input
+// (see comp_stream.c). Output reaches put() as soon as tdefl/tinfl produce
+// it; put returns non-zero on success, like tdefl_put_buf_func_ptr.
+typedef int (*deflate_put_fn)(const void* buf, int len, void* user);
+
+typedef struct deflate_stream {
+    tdefl_compressor comp;
+    deflate_put_fn put;
+    void* user;
+} deflate_stream;
+
+typedef struct inflate_stream {
+    tinfl_decompressor inflator;
+    uint8_t dict[TINFL_LZ_DICT_SIZE];   // wrapping output window
+    size_t dict_pos;
+    int done;
+    deflate_put_fn put;
+    void* user;
+} inflate_stream;
+
+static mz_bool deflate_stream_put(const void* buf, int len, void* user) {
+    deflate_stream* s = (deflate_stream*)user;
+    return s->put(buf, len, s->user) ? MZ_TRUE : MZ_FALSE;
+}
+
+deflate_stream* deflate_stream_create(int level, deflate_put_fn put, void* user) {
+    if (!put) return NULL;
+    deflate_stream* s = (deflate_stream*)comp_malloc(sizeof(deflate_stream));
+    if (!s) return NULL;
+    s->put = put;
+    s->user = user;
+    int lvl = (level > 0) ? level : MZ_DEFAULT_LEVEL;
+    int comp_flags = (int)tdefl_create_comp_flags_from_zip_params(lvl, 15 /* zlib */, MZ_DEFAULT_STRATEGY) | TDEFL_WRITE_ZLIB_HEADER;
+    if (tdefl_init(&s->comp, deflate_stream_put, s, comp_flags) != TDEFL_STATUS_OKAY) {
+        comp_free(s);
+        return NULL;
+    }
+    return s;
+}
+
+// Compress in[0, len); flush is 0 (none), 1 (sync: everything fed so far
+// reaches put) or 2 (finish: closes the zlib stream). Returns 0 or -1.
+int deflate_stream_write(deflate_stream* s, const uint8_t* in, size_t len, int flush) {
+    if (!s || (!in && len)) return -1;
+    tdefl_flush f = (flush == 2) ? TDEFL_FINISH : (flush == 1) ? TDEFL_SYNC_FLUSH : TDEFL_NO_FLUSH;
+    tdefl_status st = tdefl_compress_buffer(&s->comp, in, len, f);
+    if (flush == 2) return (st == TDEFL_STATUS_DONE) ? 0 : -1;
+    return (st == TDEFL_STATUS_OKAY) ? 0 : -1;
+}
+
+void deflate_stream_destroy(deflate_stream* s) {
+    comp_free(s);
+}
+
+inflate_stream* inflate_stream_create(deflate_put_fn put, void* user) {
+    if (!put) return NULL;
+    inflate_stream* s = (inflate_stream*)comp_malloc(sizeof(inflate_stream));
+    if (!s) return NULL;
+    tinfl_init(&s->inflator);
+    s->dict_pos = 0;
+    s->done = 0;
+    s->put = put;
+    s->user = user;
+    return s;
+}
+
+// Decode in[0, len) and pass the output to put. *consumed is how much of in
+// belongs to the zlib stream (less than len only once it ends). Returns 1 at
+// the end of the stream (Adler-32 checked), 0 for more input, -1 on error.
+int inflate_stream_write(inflate_stream* s, const uint8_t* in, size_t len, size_t* consumed) {
+    if (!s || (!in && len) || !consumed) return -1;
+    *consumed = 0;
+    if (s->done) return 1;
+    for (;;) {
+        size_t in_size = len - *consumed;
+        size_t out_size = TINFL_LZ_DICT_SIZE - s->dict_pos;
+        tinfl_status st = tinfl_decompress(&s->inflator, in + *consumed, &in_size, s->dict, s->dict + s->dict_pos,
+                                           &out_size, TINFL_FLAG_PARSE_ZLIB_HEADER | TINFL_FLAG_HAS_MORE_INPUT);
+        *consumed += in_size;
+        if (out_size && !s->put(s->dict + s->dict_pos, (int)out_size, s->user)) return -1;
+        s->dict_pos = (s->dict_pos + out_size) & (TINFL_LZ_DICT_SIZE - 1);
+        if (st == TINFL_STATUS_DONE) { s->done = 1; return 1; }
+        if (st < TINFL_STATUS_DONE) return -1;
+        if (st == TINFL_STATUS_NEEDS_MORE_INPUT) return 0;
+        // TINFL_STATUS_HAS_MORE_OUTPUT: the window wrapped, keep draining
+    }
+}
+
+void inflate_stream_destroy(inflate_stream* s) {
+    comp_free(s);
+}
@@ -116,8 +116,8 @@ static bool AnalyzeCompHeader(FILE* file, FileAnalysis* analysis) {
             analysis->block_count = 1; // Single block
             analysis->has_block_table = false;
             
-        } else if (analysis->version == 4) {
-            // V4 header format
+        } else if (analysis->version == 4 || analysis->version == 5) {
+            // V4 header format (v5 shares it and keeps its block table in a trailing index)
             if (fread(&analysis->algorithm, sizeof(uint8_t), 1, file) != 1) {
                 strcpy(analysis->error_details, "Failed to read algorithm");
                 return false;
@@ -155,10 +155,10 @@ static bool AnalyzeCompHeader(FILE* file, FileAnalysis* analysis) {
             }
             analysis->block_count = be32toh(block_count_be);
             
-            // Check for BLK4 marker
+            // Check for BLK4/BLK5 marker
             char blk_marker[4];
             if (fread(blk_marker, 4, 1, file) == 1) {
-                if (memcmp(blk_marker, "BLK4", 4) == 0) {
+                if (memcmp(blk_marker, analysis->version == 5 ? "BLK5" : "BLK4", 4) == 0) {
                     analysis->has_block_table = true;
                     if (analysis->algorithm == 255) {
                         analysis->is_hardcore_container = false; // It's blockwise
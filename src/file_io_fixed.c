@@ -4,6 +4,7 @@
  ******************************************************************************/
 
 #include "../include/decompressor.h"
+#include "../include/comp_input.h"
 #include <sys/stat.h>
 #include <errno.h>
 
@@ -68,49 +69,37 @@ DecompStatus FileIO_ReadCompressedFile(const char* filepath, uint8_t** buffer, s
     
     Logger_Log(LOG_LEVEL_DEBUG, "Reading compressed file: %s", filepath);
     
-    // Get file size first
+    // Open file
     FILE* file = fopen(filepath, "rb");
     if (!file) {
         Logger_Log(LOG_LEVEL_ERROR, "Failed to open file: %s", filepath);
         return DECOMP_STATUS_IO_ERROR;
     }
     
-    fseek(file, 0, SEEK_END);
-    long file_size = ftell(file);
-    fseek(file, 0, SEEK_SET);
+    // Read file content (buffered, so pipes work as well as regular files)
+    uint8_t* data = NULL;
+    size_t bytes_read = 0;
+    int read_rc = comp_input_read_all(file, &data, &bytes_read);
+    fclose(file);
     
-    if (file_size <= 0) {
-        Logger_Log(LOG_LEVEL_ERROR, "Invalid file size: %ld", file_size);
-        fclose(file);
+    if (read_rc != 0) {
+        Logger_Log(LOG_LEVEL_ERROR, "Failed to read complete file: %s", filepath);
         return DECOMP_STATUS_IO_ERROR;
     }
     
-    if (file_size > DECOMP_MAX_REASONABLE) {
-        Logger_Log(LOG_LEVEL_ERROR, "File too large: %ld bytes", file_size);
-        fclose(file);
+    if (bytes_read == 0) {
+        Logger_Log(LOG_LEVEL_ERROR, "Invalid file size: %zu", bytes_read);
+        free(data);
         return DECOMP_STATUS_IO_ERROR;
     }
     
-    // Allocate buffer
-    *buffer = (uint8_t*)malloc(file_size);
-    if (!*buffer) {
-        Logger_Log(LOG_LEVEL_ERROR, "Failed to allocate buffer for file: %s", filepath);
-        fclose(file);
-        return DECOMP_STATUS_MEMORY_ERROR;
-    }
-    
-    // Read file content
-    size_t bytes_read = fread(*buffer, 1, file_size, file);
-    fclose(file);
-    
-    if (bytes_read != (size_t)file_size) {
-        Logger_Log(LOG_LEVEL_ERROR, "Failed to read complete file: %s (read %zu of %ld bytes)",
-                  filepath, bytes_read, file_size);
-        free(*buffer);
-        *buffer = NULL;
+    if (bytes_read > (size_t)DECOMP_MAX_REASONABLE) {
+        Logger_Log(LOG_LEVEL_ERROR, "File too large: %zu bytes", bytes_read);
+        free(data);
         return DECOMP_STATUS_IO_ERROR;
     }
     
+    *buffer = data;
     *size = bytes_read;
     
     Logger_Log(LOG_LEVEL_INFO, "Successfully read file: %s (%zu bytes)", filepath, bytes_read);
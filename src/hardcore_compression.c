@@ -3,6 +3,7 @@
 // Implements LZMA-style compression with optimized preprocessing
 
 #include "../include/compressor.h"
+#include "range_coder.h"
 #include <stdio.h>
 #include <limits.h>
 #include <stdlib.h>
@@ -25,52 +26,9 @@
   #endif
 #endif
 
-// Advanced compression constants
+// Window of the version 1 literal coder (algorithm 3)
 #define DICT_SIZE_BITS 12
 #define DICT_SIZE (1 << DICT_SIZE_BITS)
-#define MATCH_MIN_LEN 3
-#define MATCH_MAX_LEN 273
-#define LOOKAHEAD_SIZE 258
-#define HASH_BITS 15
-#define HASH_SIZE (1 << HASH_BITS)
-#define HASH_MASK (HASH_SIZE - 1)
-
-// LZMA-style range encoder constants
-#define RC_TOP_VALUE (1U << 24)
-#define RC_BOT_VALUE (1U << 16)
-#define RC_MODEL_TOTAL_BITS 11
-#define RC_BIT_MODEL_TOTAL (1 << RC_MODEL_TOTAL_BITS)
-#define RC_MOVE_BITS 5
-
-// Probability models for range coding
-typedef struct {
-    unsigned short prob;
-} RangeBitModel;
-
-typedef struct {
-    unsigned int low;
-    unsigned int range;
-    unsigned char* buffer;
-    long buffer_pos;
-    long buffer_size;
-    unsigned int cache;
-    unsigned int cache_size;
-} RangeEncoder;
-
-typedef struct {
-    unsigned int code;
-    unsigned int range;
-    const unsigned char* buffer;
-    long buffer_pos;
-    long buffer_size;
-} RangeDecoder;
-
-// LZ match structure
-typedef struct {
-    int length;
-    int distance;
-    int is_match;
-} LZMatch;
 
 // File analysis structure
 typedef struct {
@@ -81,139 +39,6 @@ typedef struct {
     int recommended_algorithm;
 } FileAnalysis;
 
-// Initialize range encoder
-static void range_encoder_init(RangeEncoder* rc, unsigned char* buffer, long buffer_size) {
-    rc->low = 0;
-    rc->range = 0xFFFFFFFF;
-    rc->buffer = buffer;
-    rc->buffer_pos = 0;
-    rc->buffer_size = buffer_size;
-    rc->cache = 0;
-    rc->cache_size = 1;
-}
-
-// Encode bit with range encoder
-static void range_encode_bit(RangeEncoder* rc, RangeBitModel* model, int bit) {
-    unsigned int bound = (rc->range >> RC_MODEL_TOTAL_BITS) * model->prob;
-    
-    if (bit == 0) {
-        rc->range = bound;
-        model->prob += (RC_BIT_MODEL_TOTAL - model->prob) >> RC_MOVE_BITS;
-    } else {
-        rc->low += bound;
-        rc->range -= bound;
-        model->prob -= model->prob >> RC_MOVE_BITS;
-    }
-    
-    // Normalize
-    while (rc->range < RC_BOT_VALUE) {
-        if (rc->low < (0xFF << 24)) {
-            if (rc->buffer_pos < rc->buffer_size) {
-                rc->buffer[rc->buffer_pos++] = rc->cache + (rc->low >> 24);
-            }
-            rc->cache = 0xFF & (rc->low >> 16);
-        } else {
-            if (rc->buffer_pos < rc->buffer_size) {
-                rc->buffer[rc->buffer_pos++] = rc->cache + 1;
-            }
-            rc->cache = 0xFF & ((rc->low >> 16) - 1);
-        }
-        rc->low = (rc->low & 0xFFFF) << 8;
-        rc->range <<= 8;
-    }
-    // Debugging requirement: encode state validity
-#ifndef NDEBUG
-    assert(rc->low < rc->range);
-#endif
-}
-
-// Flush range encoder
-static void range_encoder_flush(RangeEncoder* rc) {
-    for (int i = 0; i < 5; i++) {
-        if (rc->buffer_pos < rc->buffer_size) {
-            rc->buffer[rc->buffer_pos++] = (rc->low >> 24) & 0xFF;
-        }
-        rc->low <<= 8;
-    }
-}
-
-// Initialize range decoder
-static void range_decoder_init(RangeDecoder* rc, const unsigned char* buffer, long buffer_size) {
-    rc->buffer = buffer;
-    rc->buffer_pos = 0;
-    rc->buffer_size = buffer_size;
-    rc->code = 0;
-    rc->range = 0xFFFFFFFF;
-    
-    for (int i = 0; i < 5; i++) {
-        rc->code = (rc->code << 8) | (rc->buffer_pos < buffer_size ? buffer[rc->buffer_pos++] : 0);
-    }
-}
-
-// Decode bit with range decoder
-static int range_decode_bit(RangeDecoder* rc, RangeBitModel* model) {
-    unsigned int bound = (rc->range >> RC_MODEL_TOTAL_BITS) * model->prob;
-    int bit;
-    
-    if (rc->code < bound) {
-        rc->range = bound;
-        model->prob += (RC_BIT_MODEL_TOTAL - model->prob) >> RC_MOVE_BITS;
-        bit = 0;
-    } else {
-        rc->code -= bound;
-        rc->range -= bound;
-        model->prob -= model->prob >> RC_MOVE_BITS;
-        bit = 1;
-    }
-    
-    // Normalize
-    while (rc->range < RC_BOT_VALUE) {
-        rc->code = (rc->code << 8) | (rc->buffer_pos < rc->buffer_size ? rc->buffer[rc->buffer_pos++] : 0);
-        rc->range <<= 8;
-    }
-    
-    return bit;
-}
-
-// Calculate hash for LZ matching
-static unsigned int calculate_hash(const unsigned char* data, int pos) {
-    return ((data[pos] << 8) ^ data[pos + 1] ^ (data[pos + 2] << 4)) & HASH_MASK;
-}
-
-// Find LZ matches using hash chains
-static LZMatch find_best_match(const unsigned char* data, long data_size, long pos, 
-                              int* hash_table, int* prev_table) {
-    LZMatch match = {0, 0, 0};
-    
-    if (pos + MATCH_MIN_LEN >= data_size) return match;
-    
-    unsigned int hash = calculate_hash(data, pos);
-    int chain_pos = hash_table[hash];
-    int max_chain_length = 128; // Limit chain length for performance
-    
-    while (chain_pos >= 0 && max_chain_length-- > 0) {
-        int distance = pos - chain_pos;
-        if (distance > DICT_SIZE || distance <= 0) break;
-        
-        // Check if we have a match
-        int len = 0;
-        while (len < MATCH_MAX_LEN && pos + len < data_size && 
-               data[pos + len] == data[chain_pos + len]) {
-            len++;
-        }
-        
-        if (len >= MATCH_MIN_LEN && len > match.length) {
-            match.length = len;
-            match.distance = distance;
-            match.is_match = 1;
-        }
-        
-        chain_pos = prev_table[chain_pos];
-    }
-    
-    return match;
-}
-
 // Analyze file characteristics for optimal compression
 static FileAnalysis analyze_file(const unsigned char* data, long size) {
     FileAnalysis analysis = {0};
@@ -262,71 +87,566 @@ static FileAnalysis analyze_file(const unsigned char* data, long size) {
     return analysis;
 }
 
-// Advanced LZMA-style compression
-static int lzma_compress(const unsigned char* input, long input_size, 
-                        unsigned char** output, long* output_size) {
-    if (!input || input_size <= 0 || !output || !output_size) {
+// ===== LZ + range coder engine (algorithm 4) =====
+// LZMA-style coding: literal / match / rep-match decisions under a
+// 12-state history model, literals coded against the byte at rep0 after a
+// match, lengths through choice + low/mid/high bit trees, distances as a
+// 6-bit slot plus reverse-tree or direct and 4-bit aligned bits, and the
+// last four distances reusable as rep0-rep3. Matches come from a
+// hash-chain finder with one step of lazy evaluation.
+//   dict log (1 byte) | original size (LE64) | range-coded data
+
+#define LZRC_DICT_LOG 22
+#define LZRC_MIN_DICT_LOG 12
+#define LZRC_MAX_DICT_LOG 26
+#define LZRC_HASH_BITS 20
+#define LZRC_CHAIN_DEPTH 48
+#define LZRC_NICE_LEN 128
+#define LZRC_HEADER 9
+
+#define LZRC_STATES 12
+#define LZRC_LC 3                  // literal context: high bits of the previous byte
+#define LZRC_PB 2                  // position bits for match/length contexts
+#define LZRC_POS_STATES (1 << LZRC_PB)
+#define LZRC_MIN_LEN 2
+#define LZRC_MAX_LEN 273
+#define LZRC_LEN_LOW_BITS 3
+#define LZRC_LEN_MID_BITS 3
+#define LZRC_LEN_HIGH_BITS 8
+#define LZRC_LEN_STATES 4
+#define LZRC_SLOT_BITS 6
+#define LZRC_END_POS_SLOT 14       // slots below this code their footer with a model
+#define LZRC_ALIGN_BITS 4
+
+#define LZRC_PROB_INIT (RC_BIT_MODEL_TOTAL / 2)
+
+typedef struct {
+    uint16_t choice;
+    uint16_t choice2;
+    uint16_t low[LZRC_POS_STATES][1 << LZRC_LEN_LOW_BITS];
+    uint16_t mid[LZRC_POS_STATES][1 << LZRC_LEN_MID_BITS];
+    uint16_t high[1 << LZRC_LEN_HIGH_BITS];
+} LzrcLenModel;
+
+typedef struct {
+    uint16_t is_match[LZRC_STATES][LZRC_POS_STATES];
+    uint16_t is_rep[LZRC_STATES];
+    uint16_t is_rep_g0[LZRC_STATES];
+    uint16_t is_rep_g1[LZRC_STATES];
+    uint16_t is_rep_g2[LZRC_STATES];
+    uint16_t is_rep0_long[LZRC_STATES][LZRC_POS_STATES];
+    uint16_t literal[1 << LZRC_LC][0x300];
+    uint16_t slot[LZRC_LEN_STATES][1 << LZRC_SLOT_BITS];
+    uint16_t special[LZRC_END_POS_SLOT][1 << 5];   // reverse trees for slots 4-13
+    uint16_t align[1 << LZRC_ALIGN_BITS];
+    LzrcLenModel match_len;
+    LzrcLenModel rep_len;
+} LzrcModel;
+
+static void lzrc_model_init(LzrcModel* m) {
+    uint16_t* p = (uint16_t*)m;
+    for (size_t i = 0; i < sizeof(LzrcModel) / sizeof(uint16_t); i++) p[i] = LZRC_PROB_INIT;
+}
+
+static inline int lzrc_state_literal(int s) { return s < 4 ? 0 : (s < 10 ? s - 3 : s - 6); }
+static inline int lzrc_state_match(int s) { return s < 7 ? 7 : 10; }
+static inline int lzrc_state_rep(int s) { return s < 7 ? 8 : 11; }
+static inline int lzrc_state_short_rep(int s) { return s < 7 ? 9 : 11; }
+
+static inline int lzrc_pos_slot(uint32_t dist) {
+    if (dist < 4) return (int)dist;
+    int n = 31 - __builtin_clz(dist);
+    return 2 * n + (int)((dist >> (n - 1)) & 1);
+}
+
+// Carry-propagating encoder: 33-bit low, pending 0xFF run in cache_size
+typedef struct {
+    uint64_t low;
+    uint32_t range;
+    unsigned char cache;
+    uint64_t cache_size;
+    unsigned char* out;
+    long pos;
+    long cap;
+    int overflow;
+} LzrcEncoder;
+
+static void lzrc_shift_low(LzrcEncoder* rc) {
+    if ((uint32_t)rc->low < 0xFF000000u || (rc->low >> 32) != 0) {
+        unsigned char carry = (unsigned char)(rc->low >> 32);
+        unsigned char temp = rc->cache;
+        do {
+            if (rc->pos < rc->cap) rc->out[rc->pos++] = (unsigned char)(temp + carry);
+            else rc->overflow = 1;
+            temp = 0xFF;
+        } while (--rc->cache_size != 0);
+        rc->cache = (unsigned char)(rc->low >> 24);
+    }
+    rc->cache_size++;
+    rc->low = (rc->low & 0x00FFFFFFu) << 8;
+}
+
+static inline void lzrc_encode_bit(LzrcEncoder* rc, uint16_t* prob, int bit) {
+    uint32_t bound = (rc->range >> RC_MODEL_TOTAL_BITS) * *prob;
+    if (!bit) {
+        rc->range = bound;
+        *prob += (RC_BIT_MODEL_TOTAL - *prob) >> RC_MOVE_BITS;
+    } else {
+        rc->low += bound;
+        rc->range -= bound;
+        *prob -= *prob >> RC_MOVE_BITS;
+    }
+    while (rc->range < RC_TOP_VALUE) {
+        rc->range <<= 8;
+        lzrc_shift_low(rc);
+    }
+}
+
+static void lzrc_encode_direct(LzrcEncoder* rc, uint32_t value, int bits) {
+    while (bits-- > 0) {
+        rc->range >>= 1;
+        if ((value >> bits) & 1) rc->low += rc->range;
+        while (rc->range < RC_TOP_VALUE) {
+            rc->range <<= 8;
+            lzrc_shift_low(rc);
+        }
+    }
+}
+
+static void lzrc_encode_tree(LzrcEncoder* rc, uint16_t* probs, int bits, uint32_t symbol) {
+    uint32_t m = 1;
+    while (bits-- > 0) {
+        int bit = (symbol >> bits) & 1;
+        lzrc_encode_bit(rc, &probs[m], bit);
+        m = (m << 1) | (uint32_t)bit;
+    }
+}
+
+static void lzrc_encode_reverse(LzrcEncoder* rc, uint16_t* probs, int bits, uint32_t symbol) {
+    uint32_t m = 1;
+    for (int i = 0; i < bits; i++) {
+        int bit = symbol & 1;
+        lzrc_encode_bit(rc, &probs[m], bit);
+        m = (m << 1) | (uint32_t)bit;
+        symbol >>= 1;
+    }
+}
+
+static void lzrc_encode_len(LzrcEncoder* rc, LzrcLenModel* lm, int len, int pos_state) {
+    len -= LZRC_MIN_LEN;
+    if (len < 8) {
+        lzrc_encode_bit(rc, &lm->choice, 0);
+        lzrc_encode_tree(rc, lm->low[pos_state], LZRC_LEN_LOW_BITS, (uint32_t)len);
+    } else if (len < 16) {
+        lzrc_encode_bit(rc, &lm->choice, 1);
+        lzrc_encode_bit(rc, &lm->choice2, 0);
+        lzrc_encode_tree(rc, lm->mid[pos_state], LZRC_LEN_MID_BITS, (uint32_t)(len - 8));
+    } else {
+        lzrc_encode_bit(rc, &lm->choice, 1);
+        lzrc_encode_bit(rc, &lm->choice2, 1);
+        lzrc_encode_tree(rc, lm->high, LZRC_LEN_HIGH_BITS, (uint32_t)(len - 16));
+    }
+}
+
+// dist is the match distance minus one
+static void lzrc_encode_dist(LzrcEncoder* rc, LzrcModel* m, uint32_t dist, int len) {
+    int len_state = len - LZRC_MIN_LEN < LZRC_LEN_STATES - 1 ? len - LZRC_MIN_LEN : LZRC_LEN_STATES - 1;
+    int slot = lzrc_pos_slot(dist);
+    lzrc_encode_tree(rc, m->slot[len_state], LZRC_SLOT_BITS, (uint32_t)slot);
+    if (slot < 4) return;
+    int footer = (slot >> 1) - 1;
+    uint32_t base = (uint32_t)(2 | (slot & 1)) << footer;
+    uint32_t reduced = dist - base;
+    if (slot < LZRC_END_POS_SLOT) {
+        lzrc_encode_reverse(rc, m->special[slot], footer, reduced);
+    } else {
+        lzrc_encode_direct(rc, reduced >> LZRC_ALIGN_BITS, footer - LZRC_ALIGN_BITS);
+        lzrc_encode_reverse(rc, m->align, LZRC_ALIGN_BITS, reduced & ((1u << LZRC_ALIGN_BITS) - 1));
+    }
+}
+
+static void lzrc_encode_literal(LzrcEncoder* rc, LzrcModel* m, const unsigned char* data, long pos,
+                                int state, uint32_t rep0) {
+    unsigned char prev = pos > 0 ? data[pos - 1] : 0;
+    uint16_t* probs = m->literal[prev >> (8 - LZRC_LC)];
+    uint32_t symbol = data[pos] | 0x100u;
+    if (state < 7) {
+        lzrc_encode_tree(rc, probs, 8, data[pos]);
+        return;
+    }
+    // After a match, code the bits against the byte the match would continue
+    // with until the first difference
+    uint32_t match_byte = data[pos - rep0 - 1];
+    uint32_t offs = 0x100;
+    do {
+        match_byte <<= 1;
+        lzrc_encode_bit(rc, &probs[offs + (match_byte & offs) + (symbol >> 8)], (symbol >> 7) & 1);
+        symbol <<= 1;
+        offs &= ~(match_byte ^ symbol);
+    } while (symbol < 0x10000);
+}
+
+typedef struct {
+    int32_t* head;
+    int32_t* chain;
+    long dict_mask;
+} LzrcFinder;
+
+static inline uint32_t lzrc_hash4(const unsigned char* p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return (v * 2654435761u) >> (32 - LZRC_HASH_BITS);
+}
+
+static inline void lzrc_insert(LzrcFinder* f, const unsigned char* data, long n, long pos) {
+    if (pos + 4 > n) return;
+    uint32_t h = lzrc_hash4(data + pos);
+    f->chain[pos & f->dict_mask] = f->head[h];
+    f->head[h] = (int32_t)pos;
+}
+
+static inline int lzrc_match_len(const unsigned char* a, const unsigned char* b, int limit) {
+    int len = 0;
+    while (len < limit && a[len] == b[len]) len++;
+    return len;
+}
+
+// Longest match for pos among earlier positions inserted into the chains
+static int lzrc_find(const LzrcFinder* f, const unsigned char* data, long n, long pos, int limit, uint32_t* dist) {
+    if (pos + 4 > n) return 0;
+    int best = 0;
+    long cand = f->head[lzrc_hash4(data + pos)];
+    for (int depth = LZRC_CHAIN_DEPTH; cand >= 0 && depth > 0; depth--) {
+        long d = pos - cand;
+        if (d <= 0 || d > f->dict_mask) break;
+        if (data[cand + best] == data[pos + best]) {
+            int len = lzrc_match_len(data + cand, data + pos, limit);
+            if (len > best) {
+                best = len;
+                *dist = (uint32_t)d;
+                if (len >= LZRC_NICE_LEN || len >= limit) break;
+            }
+        }
+        cand = f->chain[cand & f->dict_mask];
+    }
+    return best;
+}
+
+static int lzrc_compress(const unsigned char* input, long input_size, unsigned char** output, long* output_size) {
+    if (!input || input_size <= 0 || !output || !output_size) return COMP_ERROR_COMPRESSION;
+
+    int dict_log = LZRC_MIN_DICT_LOG;
+    while (dict_log < LZRC_DICT_LOG && (1L << dict_log) < input_size) dict_log++;
+    long dict = 1L << dict_log;
+
+    LzrcModel* m = (LzrcModel*)comp_malloc(sizeof(LzrcModel));
+    LzrcFinder f;
+    f.head = (int32_t*)comp_malloc(sizeof(int32_t) << LZRC_HASH_BITS);
+    f.chain = (int32_t*)comp_malloc(sizeof(int32_t) * (size_t)dict);
+    f.dict_mask = dict - 1;
+    long cap = input_size + input_size / 8 + 1024;
+    unsigned char* out = (unsigned char*)comp_malloc((size_t)cap);
+    if (!m || !f.head || !f.chain || !out) {
+        comp_free(m);
+        comp_free(f.head);
+        comp_free(f.chain);
+        comp_free(out);
         return COMP_ERROR_COMPRESSION;
     }
+    lzrc_model_init(m);
+    memset(f.head, 0xFF, sizeof(int32_t) << LZRC_HASH_BITS);
+
+    out[0] = (unsigned char)dict_log;
+    for (int i = 0; i < 8; i++) out[1 + i] = (unsigned char)((uint64_t)input_size >> (8 * i));
+    LzrcEncoder rc = { 0, 0xFFFFFFFFu, 0, 1, out + LZRC_HEADER, 0, cap - LZRC_HEADER, 0 };
+
+    const unsigned char* data = input;
+    long n = input_size;
+    int state = 0;
+    uint32_t reps[4] = { 1, 1, 1, 1 };   // distances, not minus one
+    long pos = 0;
+    while (pos < n && !rc.overflow) {
+        int pos_state = (int)(pos & (LZRC_POS_STATES - 1));
+        int limit = n - pos < LZRC_MAX_LEN ? (int)(n - pos) : LZRC_MAX_LEN;
+
+        int rep_len = 0, rep_idx = 0;
+        for (int r = 0; r < 4; r++) {
+            if (reps[r] > (uint32_t)pos) continue;
+            int len = lzrc_match_len(data + pos - reps[r], data + pos, limit);
+            if (len > rep_len) {
+                rep_len = len;
+                rep_idx = r;
+            }
+        }
+        uint32_t dist = 0;
+        int len = lzrc_find(&f, data, n, pos, limit, &dist);
+        // A three-byte match far away rarely beats three literals
+        if (len == 3 && dist > (1u << 14)) len = 0;
+
+        if (rep_len >= LZRC_MIN_LEN && rep_len + 1 >= len) {
+            lzrc_encode_bit(&rc, &m->is_match[state][pos_state], 1);
+            lzrc_encode_bit(&rc, &m->is_rep[state], 1);
+            if (rep_idx == 0) {
+                lzrc_encode_bit(&rc, &m->is_rep_g0[state], 0);
+                lzrc_encode_bit(&rc, &m->is_rep0_long[state][pos_state], 1);
+            } else {
+                lzrc_encode_bit(&rc, &m->is_rep_g0[state], 1);
+                if (rep_idx == 1) {
+                    lzrc_encode_bit(&rc, &m->is_rep_g1[state], 0);
+                } else {
+                    lzrc_encode_bit(&rc, &m->is_rep_g1[state], 1);
+                    lzrc_encode_bit(&rc, &m->is_rep_g2[state], rep_idx - 2);
+                }
+                uint32_t d = reps[rep_idx];
+                for (int r = rep_idx; r > 0; r--) reps[r] = reps[r - 1];
+                reps[0] = d;
+            }
+            lzrc_encode_len(&rc, &m->rep_len, rep_len, pos_state);
+            state = lzrc_state_rep(state);
+            for (long k = 0; k < rep_len; k++) lzrc_insert(&f, data, n, pos + k);
+            pos += rep_len;
+            continue;
+        }
+
+        if (len >= 3 && len < LZRC_NICE_LEN && pos + 1 < n) {
+            // Lazy step: defer to a clearly longer match at the next byte
+            uint32_t next_dist = 0;
+            int next_limit = n - pos - 1 < LZRC_MAX_LEN ? (int)(n - pos - 1) : LZRC_MAX_LEN;
+            lzrc_insert(&f, data, n, pos);
+            int next = lzrc_find(&f, data, n, pos + 1, next_limit, &next_dist);
+            if (next > len + 1 || (next == len + 1 && next_dist <= dist)) len = 0;
+            f.head[lzrc_hash4(data + pos)] = f.chain[pos & f.dict_mask];   // undo; re-inserted below
+        }
+
+        if (len >= 3) {
+            lzrc_encode_bit(&rc, &m->is_match[state][pos_state], 1);
+            lzrc_encode_bit(&rc, &m->is_rep[state], 0);
+            lzrc_encode_len(&rc, &m->match_len, len, pos_state);
+            lzrc_encode_dist(&rc, m, dist - 1, len);
+            reps[3] = reps[2];
+            reps[2] = reps[1];
+            reps[1] = reps[0];
+            reps[0] = dist;
+            state = lzrc_state_match(state);
+            for (long k = 0; k < len; k++) lzrc_insert(&f, data, n, pos + k);
+            pos += len;
+            continue;
+        }
+
+        lzrc_encode_bit(&rc, &m->is_match[state][pos_state], 0);
+        lzrc_encode_literal(&rc, m, data, pos, state, reps[0] - 1);
+        state = lzrc_state_literal(state);
+        lzrc_insert(&f, data, n, pos);
+        pos++;
+    }
+    for (int i = 0; i < 5; i++) lzrc_shift_low(&rc);
 
-    // Allocate output buffer (worst case: input size + 20% overhead)
-    long max_output_size = input_size + (input_size / 5) + 1024;
-    unsigned char* compressed = (unsigned char*)tracked_malloc(max_output_size);
-    if (!compressed) {
+    comp_free(m);
+    comp_free(f.head);
+    comp_free(f.chain);
+    if (rc.overflow) {
+        comp_free(out);
         return COMP_ERROR_COMPRESSION;
     }
+    *output = out;
+    *output_size = LZRC_HEADER + rc.pos;
+    return COMP_OK;
+}
 
-    // Initialize range encoder; reserve 4 bytes for original size header
-    RangeEncoder rc;
-    range_encoder_init(&rc, compressed + 4, max_output_size - 4);
+typedef struct {
+    uint32_t range;
+    uint32_t code;
+    const unsigned char* in;
+    long pos;
+    long size;
+} LzrcDecoder;
+
+static inline void lzrc_normalize(LzrcDecoder* rd) {
+    if (rd->range < RC_TOP_VALUE) {
+        rd->range <<= 8;
+        rd->code = (rd->code << 8) | (rd->pos < rd->size ? rd->in[rd->pos] : 0);
+        rd->pos++;
+    }
+}
 
-    // Literal-bit probability model
-    RangeBitModel literal_models[256];
-    for (int i = 0; i < 256; i++) {
-        literal_models[i].prob = RC_BIT_MODEL_TOTAL / 2;
+static inline int lzrc_decode_bit(LzrcDecoder* rd, uint16_t* prob) {
+    uint32_t bound = (rd->range >> RC_MODEL_TOTAL_BITS) * *prob;
+    int bit;
+    if (rd->code < bound) {
+        rd->range = bound;
+        *prob += (RC_BIT_MODEL_TOTAL - *prob) >> RC_MOVE_BITS;
+        bit = 0;
+    } else {
+        rd->range -= bound;
+        rd->code -= bound;
+        *prob -= *prob >> RC_MOVE_BITS;
+        bit = 1;
     }
+    lzrc_normalize(rd);
+    return bit;
+}
 
-    // 4 KiB sliding window
-    unsigned char window[DICT_SIZE];
-    memset(window, 0, sizeof(window));
-    int wpos = 0;
+static uint32_t lzrc_decode_direct(LzrcDecoder* rd, int bits) {
+    uint32_t v = 0;
+    while (bits-- > 0) {
+        rd->range >>= 1;
+        uint32_t bit = rd->code >= rd->range;
+        if (bit) rd->code -= rd->range;
+        v = (v << 1) | bit;
+        lzrc_normalize(rd);
+    }
+    return v;
+}
 
-    // Encode literals using simple context (prev byte)
-    for (long pos = 0; pos < input_size; pos++) {
-        unsigned char literal = input[pos];
-        unsigned char prev = window[(wpos - 1) & (DICT_SIZE - 1)];
-        unsigned char partial = 0;
-        for (int i = 7; i >= 0; i--) {
-            int bit = (literal >> i) & 1;
-            unsigned int ctx = (unsigned int)((partial ^ prev) & 0xFF);
-            range_encode_bit(&rc, &literal_models[ctx], bit);
-            partial |= (bit << i);
+static uint32_t lzrc_decode_tree(LzrcDecoder* rd, uint16_t* probs, int bits) {
+    uint32_t m = 1;
+    for (int i = 0; i < bits; i++) m = (m << 1) | (uint32_t)lzrc_decode_bit(rd, &probs[m]);
+    return m - (1u << bits);
+}
+
+static uint32_t lzrc_decode_reverse(LzrcDecoder* rd, uint16_t* probs, int bits) {
+    uint32_t m = 1, symbol = 0;
+    for (int i = 0; i < bits; i++) {
+        uint32_t bit = (uint32_t)lzrc_decode_bit(rd, &probs[m]);
+        m = (m << 1) | bit;
+        symbol |= bit << i;
+    }
+    return symbol;
+}
+
+static int lzrc_decode_len(LzrcDecoder* rd, LzrcLenModel* lm, int pos_state) {
+    if (!lzrc_decode_bit(rd, &lm->choice)) {
+        return LZRC_MIN_LEN + (int)lzrc_decode_tree(rd, lm->low[pos_state], LZRC_LEN_LOW_BITS);
+    }
+    if (!lzrc_decode_bit(rd, &lm->choice2)) {
+        return LZRC_MIN_LEN + 8 + (int)lzrc_decode_tree(rd, lm->mid[pos_state], LZRC_LEN_MID_BITS);
+    }
+    return LZRC_MIN_LEN + 16 + (int)lzrc_decode_tree(rd, lm->high, LZRC_LEN_HIGH_BITS);
+}
+
+static int lzrc_decompress(const unsigned char* input, long input_size, unsigned char** output, long* output_size) {
+    if (!input || input_size < LZRC_HEADER + 5 || !output || !output_size) return -1;
+    int dict_log = input[0];
+    uint64_t size = 0;
+    for (int i = 0; i < 8; i++) size |= (uint64_t)input[1 + i] << (8 * i);
+    // Long rep matches cost well under a bit each, but no stream expands
+    // more than 2^14 times
+    if (dict_log < LZRC_MIN_DICT_LOG || dict_log > LZRC_MAX_DICT_LOG || size == 0 ||
+        (size >> 14) > (uint64_t)input_size) {
+        return -1;
+    }
+    long n = (long)size;
+    unsigned char* out = (unsigned char*)comp_malloc((size_t)n);
+    LzrcModel* m = (LzrcModel*)comp_malloc(sizeof(LzrcModel));
+    if (!out || !m) {
+        comp_free(out);
+        comp_free(m);
+        return -1;
+    }
+    lzrc_model_init(m);
+
+    LzrcDecoder rd = { 0xFFFFFFFFu, 0, input + LZRC_HEADER, 0, input_size - LZRC_HEADER };
+    for (int i = 0; i < 5; i++) rd.code = (rd.code << 8) | rd.in[rd.pos++];
+
+    int state = 0;
+    uint32_t reps[4] = { 1, 1, 1, 1 };
+    long pos = 0;
+    while (pos < n) {
+        int pos_state = (int)(pos & (LZRC_POS_STATES - 1));
+        if (!lzrc_decode_bit(&rd, &m->is_match[state][pos_state])) {
+            unsigned char prev = pos > 0 ? out[pos - 1] : 0;
+            uint16_t* probs = m->literal[prev >> (8 - LZRC_LC)];
+            uint32_t symbol = 1;
+            if (state < 7) {
+                while (symbol < 0x100) symbol = (symbol << 1) | (uint32_t)lzrc_decode_bit(&rd, &probs[symbol]);
+            } else {
+                if (reps[0] > (uint32_t)pos) goto fail;
+                uint32_t match_byte = out[pos - reps[0]];
+                uint32_t offs = 0x100;
+                while (symbol < 0x100) {
+                    match_byte <<= 1;
+                    uint32_t bit = match_byte & offs;
+                    if (lzrc_decode_bit(&rd, &probs[offs + bit + symbol])) {
+                        symbol = (symbol << 1) | 1;
+                        offs &= bit;
+                    } else {
+                        symbol <<= 1;
+                        offs &= ~bit;
+                    }
+                }
+            }
+            out[pos++] = (unsigned char)symbol;
+            state = lzrc_state_literal(state);
+            continue;
         }
-        window[wpos] = literal;
-        wpos = (wpos + 1) & (DICT_SIZE - 1);
 
-        // FORCE-COMPRESS: do not fall back to raw storage
-        if (rc.buffer_pos + 5 >= rc.buffer_size) {
-            tracked_free(compressed, max_output_size);
-            return COMP_ERROR_COMPRESSION;
+        int len;
+        if (lzrc_decode_bit(&rd, &m->is_rep[state])) {
+            if (!lzrc_decode_bit(&rd, &m->is_rep_g0[state])) {
+                if (!lzrc_decode_bit(&rd, &m->is_rep0_long[state][pos_state])) {
+                    // Short rep: one byte at rep0
+                    if (reps[0] > (uint32_t)pos) goto fail;
+                    out[pos] = out[pos - reps[0]];
+                    pos++;
+                    state = lzrc_state_short_rep(state);
+                    continue;
+                }
+            } else {
+                int idx = 1;
+                if (lzrc_decode_bit(&rd, &m->is_rep_g1[state])) {
+                    idx = 2 + lzrc_decode_bit(&rd, &m->is_rep_g2[state]);
+                }
+                uint32_t d = reps[idx];
+                for (int r = idx; r > 0; r--) reps[r] = reps[r - 1];
+                reps[0] = d;
+            }
+            len = lzrc_decode_len(&rd, &m->rep_len, pos_state);
+            state = lzrc_state_rep(state);
+        } else {
+            len = lzrc_decode_len(&rd, &m->match_len, pos_state);
+            int len_state = len - LZRC_MIN_LEN < LZRC_LEN_STATES - 1 ? len - LZRC_MIN_LEN : LZRC_LEN_STATES - 1;
+            int slot = (int)lzrc_decode_tree(&rd, m->slot[len_state], LZRC_SLOT_BITS);
+            uint32_t dist = (uint32_t)slot;
+            if (slot >= 4) {
+                int footer = (slot >> 1) - 1;
+                dist = (uint32_t)(2 | (slot & 1)) << footer;
+                if (slot < LZRC_END_POS_SLOT) {
+                    dist += lzrc_decode_reverse(&rd, m->special[slot], footer);
+                } else {
+                    dist += lzrc_decode_direct(&rd, footer - LZRC_ALIGN_BITS) << LZRC_ALIGN_BITS;
+                    dist += lzrc_decode_reverse(&rd, m->align, LZRC_ALIGN_BITS);
+                }
+            }
+            reps[3] = reps[2];
+            reps[2] = reps[1];
+            reps[1] = reps[0];
+            reps[0] = dist + 1;
+            state = lzrc_state_match(state);
         }
-    }
 
-    // Flush encoder
-    range_encoder_flush(&rc);
+        uint32_t d = reps[0];
+        if (d == 0 || d > (uint32_t)pos || (long)len > n - pos) goto fail;
+        const unsigned char* src = out + pos - d;
+        unsigned char* dst = out + pos;
+        for (int k = 0; k < len; k++) dst[k] = src[k];
+        pos += len;
+    }
+    // The encoder flushes four bytes beyond what the decoder must read
+    if (rd.pos > rd.size) goto fail;
 
-    // Write 4-byte LE original size header
-    compressed[0] = (unsigned char)(input_size & 0xFF);
-    compressed[1] = (unsigned char)((input_size >> 8) & 0xFF);
-    compressed[2] = (unsigned char)((input_size >> 16) & 0xFF);
-    compressed[3] = (unsigned char)((input_size >> 24) & 0xFF);
+    comp_free(m);
+    *output = out;
+    *output_size = n;
+    return 0;
 
-    *output = compressed;
-    *output_size = rc.buffer_pos + 4;
-    return COMP_OK;
+fail:
+    comp_free(m);
+    comp_free(out);
+    return -1;
 }
 
-// LZMA-style decompression
+// Version 1 "LZMA-style" streams (algorithm 3): literals only, each bit
+// range-coded with an order-1 context
 static int lzma_decompress(const unsigned char* input, long input_size, 
                           unsigned char** output, long* output_size) {
     if (!input || !output || !output_size || input_size <= 0) {
@@ -388,6 +708,28 @@ static int lzma_decompress(const unsigned char* input, long input_size,
 }
 
 // Main hardcore compression function
+// Peak bytes hardcore_compress allocates beyond the input. The stage is
+// picked from the content, so this is the most expensive of the three,
+// plus the copy that prefixes the algorithm identifier.
+size_t hardcore_memory_cost(long input_size) {
+    if (input_size <= 0) return 0;
+    int dict_log = LZRC_MIN_DICT_LOG;
+    while (dict_log < LZRC_DICT_LOG && (1L << dict_log) < input_size) dict_log++;
+    size_t lzrc = sizeof(LzrcModel) + (sizeof(int32_t) << LZRC_HASH_BITS) + sizeof(int32_t) * ((size_t)1 << dict_log) +
+                  (size_t)(input_size + input_size / 8 + 1024);
+    size_t cost = rans_memory_cost(input_size);
+    size_t bwt = bwt_mtf_huffman_memory_cost(input_size, 0);
+    if (bwt > cost) cost = bwt;
+    if (lzrc > cost) cost = lzrc;
+    return cost + (size_t)(input_size + input_size / 8 + 1024);
+}
+
+// Peak bytes hardcore_decompress allocates to restore original_size bytes
+// from a single-block stream; the BWT inverse is the most expensive stage
+size_t hardcore_decompress_memory_cost(long original_size) {
+    return bwt_mtf_huffman_decode_memory_cost(original_size);
+}
+
 int hardcore_compress(const unsigned char* input, long input_size, unsigned char** output, long* output_size) {
     if (!input || input_size <= 0 || !output || !output_size) return COMP_ERROR_COMPRESSION;
     
@@ -401,16 +743,18 @@ int hardcore_compress(const unsigned char* input, long input_size, unsigned char
     unsigned char* compressed_data = NULL;
     long compressed_size = 0;
     int result = COMP_ERROR_COMPRESSION;
+    int algorithm;
     
     // Choose optimal compression algorithm based on analysis
     if (analysis.recommended_algorithm == 1 && analysis.repetition_factor > 30) {
-        // Use simple RLE + Huffman for highly repetitive data
-        printf("Using RLE + Huffman compression...\n");
-        {
-            CompResult rc = huffman_compress(input, input_size, &compressed_data, &compressed_size);
-            result = (rc == COMP_SUCCESS) ? COMP_OK : COMP_ERROR_COMPRESSION;
-        }
+        algorithm = 5;
+        // Skewed, repetitive data: rANS codes its dominant symbols in a
+        // fraction of a bit where Huffman (algorithm 1) needs a whole one
+        printf("Using rANS compression...\n");
+        result = (rans_compress(input, input_size, &compressed_data, &compressed_size) == 0)
+            ? COMP_OK : COMP_ERROR_COMPRESSION;
     } else if (analysis.recommended_algorithm == 2 && analysis.text_ratio > 80) {
+        algorithm = 2;
         // Use BWT + MTF + Huffman for text data
         printf("Using BWT + MTF + Huffman compression...\n");
         {
@@ -418,9 +762,10 @@ int hardcore_compress(const unsigned char* input, long input_size, unsigned char
             result = (rc == 0) ? COMP_OK : COMP_ERROR_COMPRESSION;
         }
     } else {
-        // Use LZMA-style compression for general data
+        algorithm = 4;
+        // Use LZ + range coding for general data
         printf("Using LZMA-style compression...\n");
-        result = lzma_compress(input, input_size, &compressed_data, &compressed_size);
+        result = lzrc_compress(input, input_size, &compressed_data, &compressed_size);
     }
     
     if (result != COMP_OK) {
@@ -439,7 +784,7 @@ int hardcore_compress(const unsigned char* input, long input_size, unsigned char
     final_output[0] = 0xAD; // Magic number
     final_output[1] = 0xEF; // Magic number
     final_output[2] = 0x01; // Version
-    final_output[3] = (unsigned char)analysis.recommended_algorithm;
+    final_output[3] = (unsigned char)algorithm;
     
     // Copy compressed data
     memcpy(final_output + 4, compressed_data, compressed_size);
@@ -504,6 +849,14 @@ int hardcore_decompress(const unsigned char* input, long input_size, unsigned ch
             printf("Using LZMA-style decompression...\n");
             result = lzma_decompress(compressed_data, compressed_data_size, output, output_size);
             break;
+        case 4:
+            printf("Using LZ + range coder decompression...\n");
+            result = lzrc_decompress(compressed_data, compressed_data_size, output, output_size);
+            break;
+        case 5:
+            printf("Using rANS decompression...\n");
+            result = rans_decompress(compressed_data, compressed_data_size, output, output_size);
+            break;
         default:
             printf("Unknown compression algorithm: %d\n", algorithm);
             return -1;
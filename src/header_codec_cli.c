@@ -8,23 +8,7 @@
 #include <string.h>
 
 #include "audio_doc_codec.h"
-
-static uint8_t* read_file(const char* path, size_t* out_len){
-    *out_len = 0;
-    FILE* f = fopen(path, "rb");
-    if (!f) return NULL;
-    if (fseek(f, 0, SEEK_END) != 0){ fclose(f); return NULL; }
-    long sz = ftell(f);
-    if (sz < 0){ fclose(f); return NULL; }
-    rewind(f);
-    uint8_t* buf = (uint8_t*)malloc((size_t)sz);
-    if (!buf){ fclose(f); return NULL; }
-    size_t rd = fread(buf, 1, (size_t)sz, f);
-    fclose(f);
-    if (rd != (size_t)sz){ free(buf); return NULL; }
-    *out_len = (size_t)sz;
-    return buf;
-}
+#include "../include/comp_input.h"
 
 static int ensure_dir_suffix(char* out, size_t cap){
     size_t n = strlen(out);
@@ -75,8 +59,9 @@ int main(int argc, char** argv){
     if ((!mode_compress && !mode_decompress) || !in_path){ usage(); return 2; }
     if (mode_compress && mode_decompress){ fprintf(stderr, "Specify either -c or -d, not both.\n"); return 2; }
 
-    size_t in_len = 0; uint8_t* in_buf = read_file(in_path, &in_len);
-    if (!in_buf){ fprintf(stderr, "Failed to read input: %s\n", in_path); return 1; }
+    CompInput input;
+    if (comp_input_open(in_path, COMP_INPUT_SEQUENTIAL, &input) != 0){ fprintf(stderr, "Failed to read input: %s\n", in_path); return 1; }
+    const uint8_t* in_buf = input.data; size_t in_len = input.size;
 
     // Prepare output directory prefix
     char out_prefix[1024] = {0};
@@ -86,13 +71,13 @@ int main(int argc, char** argv){
     if (mode_compress){
         size_t out_cap = in_len * 2 + 65536;
         uint8_t* out_buf = (uint8_t*)malloc(out_cap);
-        if (!out_buf){ fprintf(stderr, "OOM allocating %zu bytes\n", out_cap); free(in_buf); return 1; }
+        if (!out_buf){ fprintf(stderr, "OOM allocating %zu bytes\n", out_cap); comp_input_close(&input); return 1; }
         size_t cmp_len = mp3_compress(in_buf, in_len, out_buf, out_cap);
-        if (!cmp_len){ fprintf(stderr, "Compression failed.\n"); free(out_buf); free(in_buf); return 1; }
+        if (!cmp_len){ fprintf(stderr, "Compression failed.\n"); free(out_buf); comp_input_close(&input); return 1; }
         char base[512]; basename_no_ext(in_path, base, sizeof(base));
         char out_path[1536]; snprintf(out_path, sizeof(out_path), "%s%s.comp", out_prefix, base);
         FILE* f = fopen(out_path, "wb");
-        if (!f){ fprintf(stderr, "Failed to open output: %s\n", out_path); free(out_buf); free(in_buf); return 1; }
+        if (!f){ fprintf(stderr, "Failed to open output: %s\n", out_path); free(out_buf); comp_input_close(&input); return 1; }
         fwrite(out_buf, 1, cmp_len, f); fclose(f);
         double ratio = (double)cmp_len / (double)in_len;
         printf("Compressed '%s' -> '%s' (%zu -> %zu bytes, ratio %.4f)\n", in_path, out_path, in_len, cmp_len, ratio);
@@ -100,9 +85,9 @@ int main(int argc, char** argv){
     } else if (mode_decompress){
         size_t out_cap = in_len * 4 + 65536;
         uint8_t* out_buf = (uint8_t*)malloc(out_cap);
-        if (!out_buf){ fprintf(stderr, "OOM allocating %zu bytes\n", out_cap); free(in_buf); return 1; }
+        if (!out_buf){ fprintf(stderr, "OOM allocating %zu bytes\n", out_cap); comp_input_close(&input); return 1; }
         size_t dec_len = mp3_decompress(in_buf, in_len, out_buf, out_cap);
-        if (!dec_len){ fprintf(stderr, "Decompression failed.\n"); free(out_buf); free(in_buf); return 1; }
+        if (!dec_len){ fprintf(stderr, "Decompression failed.\n"); free(out_buf); comp_input_close(&input); return 1; }
         // Output path: if input ends with .comp, strip it; else append .dec.mp3
         const char* in = in_path; size_t n = strlen(in);
         char out_path[1536];
@@ -116,12 +101,12 @@ int main(int argc, char** argv){
             snprintf(out_path, sizeof(out_path), "%s%s.dec.mp3", out_prefix, base);
         }
         FILE* f = fopen(out_path, "wb");
-        if (!f){ fprintf(stderr, "Failed to open output: %s\n", out_path); free(out_buf); free(in_buf); return 1; }
+        if (!f){ fprintf(stderr, "Failed to open output: %s\n", out_path); free(out_buf); comp_input_close(&input); return 1; }
         fwrite(out_buf, 1, dec_len, f); fclose(f);
         printf("Decompressed '%s' -> '%s' (%zu bytes)\n", in_path, out_path, dec_len);
         free(out_buf);
     }
 
-    free(in_buf);
+    comp_input_close(&input);
     return rc;
 }
\ No newline at end of file
@@ -2,7 +2,7 @@
 
 // Create a new Huffman node
 HuffmanNode* create_huffman_node(unsigned char data, unsigned int frequency) {
-    HuffmanNode* node = (HuffmanNode*)malloc(sizeof(HuffmanNode));
+    HuffmanNode* node = (HuffmanNode*)comp_malloc(sizeof(HuffmanNode));
     if (!node) return NULL;
     
     node->data = data;
@@ -20,8 +20,8 @@ typedef struct {
 } MinHeap;
 
 MinHeap* create_min_heap(int capacity) {
-    MinHeap* heap = (MinHeap*)malloc(sizeof(MinHeap));
-    heap->nodes = (HuffmanNode**)malloc(capacity * sizeof(HuffmanNode*));
+    MinHeap* heap = (MinHeap*)comp_malloc(sizeof(MinHeap));
+    heap->nodes = (HuffmanNode**)comp_malloc(capacity * sizeof(HuffmanNode*));
     heap->size = 0;
     heap->capacity = capacity;
     return heap;
@@ -100,8 +100,8 @@ HuffmanNode* build_huffman_tree(unsigned int* frequencies) {
     }
     
     HuffmanNode* root = extract_min(heap);
-    free(heap->nodes);
-    free(heap);
+    comp_free(heap->nodes);
+    comp_free(heap);
     
     return root;
 }
@@ -135,211 +135,847 @@ void generate_huffman_codes(HuffmanNode* root, char codes[256][256], char* curre
     }
 }
 
-// Write bits to output buffer
-typedef struct {
-    unsigned char* buffer;
-    long size;
-    long capacity;
-    int bit_count;
-    unsigned char current_byte;
-} BitWriter;
-
-BitWriter* create_bit_writer(long initial_capacity) {
-    BitWriter* writer = (BitWriter*)malloc(sizeof(BitWriter));
-    writer->buffer = (unsigned char*)malloc(initial_capacity);
-    writer->size = 0;
-    writer->capacity = initial_capacity;
-    writer->bit_count = 0;
-    writer->current_byte = 0;
-    return writer;
-}
-
-void write_bit(BitWriter* writer, int bit) {
-    writer->current_byte = (writer->current_byte << 1) | (bit & 1);
-    writer->bit_count++;
-    
-    if (writer->bit_count == 8) {
-        if (writer->size >= writer->capacity) {
-            writer->capacity *= 2;
-            writer->buffer = (unsigned char*)realloc(writer->buffer, writer->capacity);
+// ===== Canonical stream (v2) =====
+// Layout: FF FE 02 | original size (LEB128) | code-length table | MSB-first codes
+// Four-stream variant: FF FE 03 | size | lengths | jump table | 4 streams.
+// The jump table holds the byte sizes of streams 0-2 (BE32); stream k codes
+// the k-th quarter of the input, so four bit readers can run independently.
+// The code-length table is a mode byte followed by either 128 bytes of packed
+// 4-bit lengths (HUFF_LENS_PACKED) or (length << 4 | run - 1) tokens covering
+// all 256 symbols (HUFF_LENS_RLE), whichever is shorter. A legacy frequency
+// header can only start with FF FE if byte 0xFF occurs over 0xFE000000 times.
+#define HUFF_V2_MAGIC0 0xFF
+#define HUFF_V2_MAGIC1 0xFE
+#define HUFF_STREAM_CANONICAL 0x02
+#define HUFF_MAX_CODE_LEN 15
+#define HUFF_LENS_PACKED 0
+#define HUFF_LENS_RLE 1
+#define HUFF_STREAM_4X 0x03
+#define HUFF_4X_MAX_LEN 11      // whole code fits one 2048-entry (4 KiB) table
+#define HUFF_4X_JUMP_SIZE 12
+#define HUFF_HEADER_MAX (3 + 10 + 1 + 256 + HUFF_4X_JUMP_SIZE)
+// Largest alphabet huffman_limited_lengths accepts (the BWT run coder uses
+// up to 257 symbols)
+#define HUFF_MAX_ALPHABET 258
+#define HUFF_MAX_NODES (2 * HUFF_MAX_ALPHABET - 1)
+
+// Worst-case size of a huffman_compress / huffman_compress_4x stream
+long huffman_compress_bound(long input_size) {
+    if (input_size < 0) return 0;
+    return HUFF_HEADER_MAX + (input_size / 8) * HUFF_MAX_CODE_LEN + HUFF_MAX_CODE_LEN + 8;
+}
+
+// Peak bytes huffman_compress and huffman_compress_4x allocate beyond the
+// input: the bound-sized output plus the tree and code tables
+size_t huffman_memory_cost(long input_size) {
+    if (input_size <= 0) return 0;
+    return (size_t)huffman_compress_bound(input_size) + 64 * 1024;
+}
+
+// Package-merge: optimal lengths under a max_len cap. `weight` is sorted
+// ascending; list d holds the leaves merged with pairs packaged from list
+// d + 1, and the first 2n - 2 items of list 1 decide the lengths. Packages
+// always form a prefix of a selection, so only counts are tracked.
+static void huffman_package_merge(const uint64_t* weight, int n, int max_len, int* depth) {
+    static const int max_items = HUFF_MAX_NODES;
+    uint64_t list[2][HUFF_MAX_NODES];
+    int is_pkg[HUFF_MAX_CODE_LEN + 1][HUFF_MAX_NODES];
+    int list_len = n;
+    int cur = 0;
+
+    // List max_len: leaves only
+    for (int i = 0; i < n; i++) {
+        list[cur][i] = weight[i];
+        is_pkg[max_len][i] = 0;
+    }
+    for (int d = max_len - 1; d >= 1; d--) {
+        int npkg = list_len / 2;
+        int li = 0, pi = 0, out = 0;
+        int nxt = cur ^ 1;
+        while ((li < n || pi < npkg) && out < max_items) {
+            uint64_t pw = (pi < npkg) ? list[cur][2 * pi] + list[cur][2 * pi + 1] : 0;
+            if (li < n && (pi >= npkg || weight[li] <= pw)) {
+                list[nxt][out] = weight[li++];
+                is_pkg[d][out++] = 0;
+            } else {
+                list[nxt][out] = pw;
+                is_pkg[d][out++] = 1;
+                pi++;
+            }
+        }
+        list_len = out;
+        cur = nxt;
+    }
+
+    for (int i = 0; i < n; i++) depth[i] = 0;
+    int take = 2 * n - 2;
+    for (int d = 1; d <= max_len && take > 0; d++) {
+        int leaves = 0, pkgs = 0;
+        for (int i = 0; i < take; i++) {
+            if (is_pkg[d][i]) pkgs++;
+            else leaves++;
         }
-        writer->buffer[writer->size++] = writer->current_byte;
-        writer->bit_count = 0;
-        writer->current_byte = 0;
+        // The selected leaves are the `leaves` lightest symbols
+        for (int i = 0; i < leaves; i++) depth[i]++;
+        take = 2 * pkgs;
     }
 }
 
-void flush_bits(BitWriter* writer) {
-    if (writer->bit_count > 0) {
-        writer->current_byte <<= (8 - writer->bit_count);
-        if (writer->size >= writer->capacity) {
-            writer->capacity *= 2;
-            writer->buffer = (unsigned char*)realloc(writer->buffer, writer->capacity);
+// Optimal code lengths for symbols [0, nsym) from an index-based two-queue
+// Huffman merge, limited to max_len bits
+void huffman_limited_lengths(const unsigned int* frequencies, int nsym, int max_len, unsigned char* lens) {
+    int syms[HUFF_MAX_ALPHABET];
+    int n = 0;
+    if (nsym > HUFF_MAX_ALPHABET) nsym = HUFF_MAX_ALPHABET;
+    if (max_len > HUFF_MAX_CODE_LEN) max_len = HUFF_MAX_CODE_LEN;
+    memset(lens, 0, (size_t)nsym);
+    for (int s = 0; s < nsym; s++) {
+        if (frequencies[s] > 0) syms[n++] = s;
+    }
+    if (n == 0) return;
+    if (n == 1) {
+        lens[syms[0]] = 1;
+        return;
+    }
+
+    // Insertion sort by ascending frequency (stable on symbol value)
+    for (int i = 1; i < n; i++) {
+        int s = syms[i];
+        int j = i - 1;
+        while (j >= 0 && frequencies[syms[j]] > frequencies[s]) {
+            syms[j + 1] = syms[j];
+            j--;
         }
-        writer->buffer[writer->size++] = writer->current_byte;
+        syms[j + 1] = s;
+    }
+
+    // Leaves occupy [0, n); internal nodes are created in nondecreasing
+    // weight order at [n, 2n - 1), so two FIFO queues replace the heap
+    uint64_t weight[HUFF_MAX_NODES];
+    int parent[HUFF_MAX_NODES];
+    int depth[HUFF_MAX_NODES];
+    for (int i = 0; i < n; i++) weight[i] = frequencies[syms[i]];
+    int leaf = 0, node = n;
+    for (int next = n; next < 2 * n - 1; next++) {
+        int pick[2];
+        for (int k = 0; k < 2; k++) {
+            if (leaf < n && (node >= next || weight[leaf] <= weight[node])) {
+                pick[k] = leaf++;
+            } else {
+                pick[k] = node++;
+            }
+        }
+        weight[next] = weight[pick[0]] + weight[pick[1]];
+        parent[pick[0]] = next;
+        parent[pick[1]] = next;
+    }
+    depth[2 * n - 2] = 0;
+    for (int i = 2 * n - 3; i >= 0; i--) depth[i] = depth[parent[i]] + 1;
+
+    if (depth[0] > max_len) {
+        // The rarest leaf is the deepest; recompute under the cap
+        uint64_t sorted_weight[HUFF_MAX_ALPHABET];
+        for (int i = 0; i < n; i++) sorted_weight[i] = frequencies[syms[i]];
+        huffman_package_merge(sorted_weight, n, max_len, depth);
     }
+    for (int i = 0; i < n; i++) lens[syms[i]] = (unsigned char)depth[i];
 }
 
-// Huffman compression function
-CompResult huffman_compress(const unsigned char* input, long input_size, unsigned char** output, long* output_size) {
-    if (!input || input_size <= 0) return COMP_ERR_INVALID_PARAMS;
-    
-    // Calculate character frequencies
+// Assign canonical codes: shorter codes first, ties broken by symbol value
+static void huffman_canonical_codes(const unsigned char* lens, uint32_t* codes) {
+    int bl_count[HUFF_MAX_CODE_LEN + 1] = {0};
+    uint32_t next_code[HUFF_MAX_CODE_LEN + 1];
+    for (int s = 0; s < 256; s++) bl_count[lens[s]]++;
+    bl_count[0] = 0;
+    uint32_t code = 0;
+    for (int bits = 1; bits <= HUFF_MAX_CODE_LEN; bits++) {
+        code = (code + bl_count[bits - 1]) << 1;
+        next_code[bits] = code;
+    }
+    for (int s = 0; s < 256; s++) {
+        codes[s] = lens[s] ? next_code[lens[s]]++ : 0;
+    }
+}
+
+static long huffman_write_lengths(const unsigned char* lens, unsigned char* out) {
+    long tokens = 0;
+    for (int s = 0; s < 256; ) {
+        int run = 1;
+        while (s + run < 256 && run < 16 && lens[s + run] == lens[s]) run++;
+        tokens++;
+        s += run;
+    }
+    if (tokens < 128) {
+        long pos = 0;
+        out[pos++] = HUFF_LENS_RLE;
+        for (int s = 0; s < 256; ) {
+            int run = 1;
+            while (s + run < 256 && run < 16 && lens[s + run] == lens[s]) run++;
+            out[pos++] = (unsigned char)((lens[s] << 4) | (run - 1));
+            s += run;
+        }
+        return pos;
+    }
+    out[0] = HUFF_LENS_PACKED;
+    for (int i = 0; i < 128; i++) {
+        out[1 + i] = (unsigned char)((lens[2 * i] << 4) | lens[2 * i + 1]);
+    }
+    return 129;
+}
+
+// Returns bytes consumed, or -1 if the table is truncated or not a valid
+// prefix code
+static long huffman_read_lengths(const unsigned char* in, long in_size, unsigned char* lens) {
+    long pos = 0;
+    if (in_size < 1) return -1;
+    if (in[pos] == HUFF_LENS_PACKED) {
+        if (in_size < 129) return -1;
+        for (int i = 0; i < 128; i++) {
+            lens[2 * i] = in[1 + i] >> 4;
+            lens[2 * i + 1] = in[1 + i] & 0x0F;
+        }
+        pos = 129;
+    } else if (in[pos] == HUFF_LENS_RLE) {
+        pos++;
+        int s = 0;
+        while (s < 256) {
+            if (pos >= in_size) return -1;
+            unsigned char t = in[pos++];
+            int run = (t & 0x0F) + 1;
+            if (s + run > 256) return -1;
+            memset(lens + s, t >> 4, run);
+            s += run;
+        }
+    } else {
+        return -1;
+    }
+
+    long kraft = 0;
+    int used = 0;
+    for (int s = 0; s < 256; s++) {
+        if (lens[s]) {
+            kraft += 1L << (HUFF_MAX_CODE_LEN - lens[s]);
+            used++;
+        }
+    }
+    if (used == 0 || kraft > (1L << HUFF_MAX_CODE_LEN)) return -1;
+    return pos;
+}
+
+// Emit codes through a 64-bit accumulator, 32 bits at a time. Each table
+// entry packs (code << 8) | length so a symbol costs one load.
+static long huffman_pack_codes(const unsigned char* in, long n, const uint32_t* enc,
+                               unsigned char* out, long pos) {
+    uint64_t acc = 0;
+    int nbits = 0;
+    long i = 0;
+    for (; i + 1 < n; i += 2) {
+        // Two codes (<= 30 bits) fit on top of < 32 pending bits
+        uint32_t e0 = enc[in[i]];
+        uint32_t e1 = enc[in[i + 1]];
+        acc = (acc << (e0 & 0xFF)) | (e0 >> 8);
+        acc = (acc << (e1 & 0xFF)) | (e1 >> 8);
+        nbits += (int)(e0 & 0xFF) + (int)(e1 & 0xFF);
+        if (nbits >= 32) {
+            nbits -= 32;
+            uint32_t w = (uint32_t)(acc >> nbits);
+            out[pos] = (unsigned char)(w >> 24);
+            out[pos + 1] = (unsigned char)(w >> 16);
+            out[pos + 2] = (unsigned char)(w >> 8);
+            out[pos + 3] = (unsigned char)w;
+            pos += 4;
+        }
+    }
+    for (; i < n; i++) {
+        uint32_t e = enc[in[i]];
+        acc = (acc << (e & 0xFF)) | (e >> 8);
+        nbits += (int)(e & 0xFF);
+    }
+    while (nbits >= 8) {
+        nbits -= 8;
+        out[pos++] = (unsigned char)(acc >> nbits);
+    }
+    if (nbits > 0) out[pos++] = (unsigned char)(acc << (8 - nbits));
+    return pos;
+}
+
+// Count symbols and derive canonical (code << 8 | length) entries
+static void huffman_build_encoder(const unsigned char* input, long input_size, int max_len,
+                                  unsigned char* lens, uint32_t* enc) {
     unsigned int frequencies[256] = {0};
+    uint32_t codes[256];
     for (long i = 0; i < input_size; i++) {
         frequencies[input[i]]++;
     }
-    
-    // Build Huffman tree
-    HuffmanNode* root = build_huffman_tree(frequencies);
-    if (!root) return COMP_ERR_COMPRESSION_FAILED;
-    
-    // Generate Huffman codes
-    char codes[256][256];
-    memset(codes, 0, sizeof(codes));
-    char current_code[256];
-    generate_huffman_codes(root, codes, current_code, 0);
-    
-    // Create bit writer
-    BitWriter* writer = create_bit_writer(input_size);
-    
-    // Write header: frequencies for reconstruction
-    unsigned char* header = (unsigned char*)malloc(256 * 5); // char + 4-byte frequency
-    int header_size = 0;
-    
-    for (int i = 0; i < 256; i++) {
-        if (frequencies[i] > 0) {
-            header[header_size++] = (unsigned char)i;
-            header[header_size++] = (frequencies[i] >> 24) & 0xFF;
-            header[header_size++] = (frequencies[i] >> 16) & 0xFF;
-            header[header_size++] = (frequencies[i] >> 8) & 0xFF;
-            header[header_size++] = frequencies[i] & 0xFF;
-        }
+    huffman_limited_lengths(frequencies, 256, max_len, lens);
+    huffman_canonical_codes(lens, codes);
+    for (int s = 0; s < 256; s++) enc[s] = (codes[s] << 8) | lens[s];
+}
+
+static long huffman_write_header(unsigned char* out, unsigned char mode, long input_size, const unsigned char* lens) {
+    long pos = 0;
+    out[pos++] = HUFF_V2_MAGIC0;
+    out[pos++] = HUFF_V2_MAGIC1;
+    out[pos++] = mode;
+    unsigned long v = (unsigned long)input_size;
+    while (v >= 0x80) {
+        out[pos++] = (unsigned char)(v | 0x80);
+        v >>= 7;
     }
-    
-    // Write end marker
-    header[header_size++] = 0xFF;
-    header[header_size++] = 0xFF;
-    header[header_size++] = 0xFF;
-    header[header_size++] = 0xFF;
-    header[header_size++] = 0xFF;
-    
-    // Encode the input using Huffman codes
-    for (long i = 0; i < input_size; i++) {
-        char* code = codes[input[i]];
-        for (int j = 0; code[j]; j++) {
-            write_bit(writer, code[j] - '0');
+    out[pos++] = (unsigned char)v;
+    pos += huffman_write_lengths(lens, out + pos);
+    return pos;
+}
+
+// Huffman compression into caller memory of at least huffman_compress_bound bytes
+CompResult huffman_compress_into(const unsigned char* input, long input_size, unsigned char* dst, long dst_cap,
+                                 long* written) {
+    if (!input || input_size <= 0 || !dst || !written) return COMP_ERR_INVALID_PARAMS;
+    if (dst_cap < huffman_compress_bound(input_size)) return COMP_ERR_BUFFER_OVERFLOW;
+
+    unsigned char lens[256];
+    uint32_t enc[256];
+    huffman_build_encoder(input, input_size, HUFF_MAX_CODE_LEN, lens, enc);
+
+    long pos = huffman_write_header(dst, HUFF_STREAM_CANONICAL, input_size, lens);
+    *written = huffman_pack_codes(input, input_size, enc, dst, pos);
+    return COMP_SUCCESS;
+}
+
+// Run an into-encoder on a freshly allocated bound-sized buffer
+static CompResult huffman_compress_alloc(const unsigned char* input, long input_size, unsigned char** output,
+                                         long* output_size,
+                                         CompResult (*into)(const unsigned char*, long, unsigned char*, long, long*)) {
+    if (!input || input_size <= 0) return COMP_ERR_INVALID_PARAMS;
+    long cap = huffman_compress_bound(input_size);
+    unsigned char* out = (unsigned char*)comp_malloc(cap);
+    if (!out) return COMP_ERR_MEMORY;
+    CompResult r = into(input, input_size, out, cap, output_size);
+    if (r != COMP_SUCCESS) {
+        comp_free(out);
+        return r;
+    }
+    *output = out;
+    return COMP_SUCCESS;
+}
+
+// Huffman compression function
+CompResult huffman_compress(const unsigned char* input, long input_size, unsigned char** output, long* output_size) {
+    return huffman_compress_alloc(input, input_size, output, output_size, huffman_compress_into);
+}
+
+// Four-stream Huffman: codes limited to HUFF_4X_MAX_LEN bits, input split in
+// quarters, each quarter packed into its own bitstream
+CompResult huffman_compress_4x_into(const unsigned char* input, long input_size, unsigned char* dst, long dst_cap,
+                                    long* written) {
+    if (!input || input_size <= 0 || !dst || !written) return COMP_ERR_INVALID_PARAMS;
+    if (dst_cap < huffman_compress_bound(input_size)) return COMP_ERR_BUFFER_OVERFLOW;
+
+    unsigned char lens[256];
+    uint32_t enc[256];
+    huffman_build_encoder(input, input_size, HUFF_4X_MAX_LEN, lens, enc);
+
+    unsigned char* out = dst;
+    long pos = huffman_write_header(out, HUFF_STREAM_4X, input_size, lens);
+    long jump = pos;
+    pos += HUFF_4X_JUMP_SIZE;
+
+    long seg = (input_size + 3) / 4;
+    for (int k = 0; k < 4; k++) {
+        long start = k * seg;
+        long len = input_size - start;
+        if (len > seg) len = seg;
+        if (len < 0) len = 0;
+        long stream_start = pos;
+        pos = huffman_pack_codes(input + start, len, enc, out, pos);
+        if (k < 3) {
+            uint32_t sz = (uint32_t)(pos - stream_start);
+            out[jump + 4 * k] = (unsigned char)(sz >> 24);
+            out[jump + 4 * k + 1] = (unsigned char)(sz >> 16);
+            out[jump + 4 * k + 2] = (unsigned char)(sz >> 8);
+            out[jump + 4 * k + 3] = (unsigned char)sz;
         }
     }
-    
-    flush_bits(writer);
-    
-    // Combine header and compressed data
-    *output_size = header_size + writer->size;
-    *output = (unsigned char*)malloc(*output_size);
-    memcpy(*output, header, header_size);
-    memcpy(*output + header_size, writer->buffer, writer->size);
-    
-    // Cleanup
-    free(header);
-    free(writer->buffer);
-    free(writer);
-    free_huffman_tree(root);
-    
+
+    *written = pos;
     return COMP_SUCCESS;
 }
 
-// Huffman decompression function
-CompResult huffman_decompress(const unsigned char* input, long input_size, unsigned char** output, long* output_size) {
-    if (!input || input_size <= 0) return COMP_ERR_INVALID_PARAMS;
-    
-    // Read header to reconstruct frequency table
-    unsigned int frequencies[256] = {0};
-    int pos = 0;
-    
+CompResult huffman_compress_4x(const unsigned char* input, long input_size, unsigned char** output, long* output_size) {
+    return huffman_compress_alloc(input, input_size, output, output_size, huffman_compress_4x_into);
+}
+
+// ===== Table-driven decoder =====
+// Both stream versions carry MSB-first prefix codes: canonical codes rebuilt
+// from the length table (v2), or codes taken directly from the heap-built
+// tree (legacy frequency header). Either way the decoder recovers (code,
+// length) per symbol and decodes through a two-level lookup table fed by a
+// 64-bit bit buffer: one table hit per symbol instead of one pointer hop per
+// bit.
+#define HUFF_PRIMARY_BITS 11
+#define HUFF_PRIMARY_SIZE (1 << HUFF_PRIMARY_BITS)
+#define HUFF_MAX_TABLE_LEN 24   // deeper (pathological) trees use the tree walk
+#define HUFF_REFILL_BITS 56
+#define HUFF_ENTRY_SUB 0x80000000u
+
+// Table entry layout:
+//   leaf : (symbol << 8) | bits consumed at this level (0 = invalid code)
+//   link : HUFF_ENTRY_SUB | (secondary offset << 8) | secondary index bits
+typedef struct {
+    uint32_t* entries;      // primary table followed by all secondary tables
+    int max_len;
+} HuffDecodeTable;
+
+// Parse the frequency header written by huffman_compress; returns the offset
+// of the first payload byte
+static long huffman_read_freq_header(const unsigned char* input, long input_size, unsigned int* frequencies) {
+    long pos = 0;
+
     while (pos < input_size - 4) {
-        if (input[pos] == 0xFF && input[pos+1] == 0xFF && 
+        if (input[pos] == 0xFF && input[pos+1] == 0xFF &&
             input[pos+2] == 0xFF && input[pos+3] == 0xFF && input[pos+4] == 0xFF) {
             pos += 5;
             break;
         }
-        
+
         unsigned char ch = input[pos++];
-        unsigned int freq = (input[pos] << 24) | (input[pos+1] << 16) | 
-                           (input[pos+2] << 8) | input[pos+3];
+        unsigned int freq = ((unsigned int)input[pos] << 24) | ((unsigned int)input[pos+1] << 16) |
+                           ((unsigned int)input[pos+2] << 8) | input[pos+3];
         pos += 4;
         frequencies[ch] = freq;
     }
-    
-    // Rebuild Huffman tree
-    HuffmanNode* root = build_huffman_tree(frequencies);
-    if (!root) return COMP_ERR_DECOMPRESSION_FAILED;
-    
-    // Calculate original size
-    long original_size = 0;
-    for (int i = 0; i < 256; i++) {
-        original_size += frequencies[i];
+    return pos;
+}
+
+// Walk the tree once to recover each symbol's code; fails if any code is
+// longer than the table decoder supports
+static int huffman_collect_codes(const HuffmanNode* node, uint32_t code, int depth,
+                                 uint32_t* codes, unsigned char* lens) {
+    if (!node->left && !node->right) {
+        if (depth == 0) {
+            // Single-symbol stream: the encoder emits a lone '0' per byte
+            codes[node->data] = 0;
+            lens[node->data] = 1;
+            return 1;
+        }
+        if (depth > HUFF_MAX_TABLE_LEN) return 0;
+        codes[node->data] = code;
+        lens[node->data] = (unsigned char)depth;
+        return 1;
     }
-    
-    *output = (unsigned char*)malloc(original_size);
-    *output_size = 0;
-    
-    // Decode the compressed data
-    HuffmanNode* current = root;
-    for (long i = pos; i < input_size && *output_size < original_size; i++) {
-        unsigned char byte = input[i];
-        for (int bit = 7; bit >= 0 && *output_size < original_size; bit--) {
+    if (depth >= HUFF_MAX_TABLE_LEN) return 0;
+    if (node->left && !huffman_collect_codes(node->left, code << 1, depth + 1, codes, lens)) return 0;
+    if (node->right && !huffman_collect_codes(node->right, (code << 1) | 1, depth + 1, codes, lens)) return 0;
+    return 1;
+}
+
+static int huffman_build_decode_table(const uint32_t* codes, const unsigned char* lens, HuffDecodeTable* table) {
+    // Size one secondary table per primary prefix that has longer codes
+    unsigned char sub_bits[HUFF_PRIMARY_SIZE];
+    uint32_t sub_off[HUFF_PRIMARY_SIZE];
+    memset(sub_bits, 0, sizeof(sub_bits));
+    int max_len = 0;
+    for (int s = 0; s < 256; s++) {
+        int len = lens[s];
+        if (len > max_len) max_len = len;
+        if (len > HUFF_PRIMARY_BITS) {
+            uint32_t prefix = codes[s] >> (len - HUFF_PRIMARY_BITS);
+            if (len - HUFF_PRIMARY_BITS > sub_bits[prefix]) {
+                sub_bits[prefix] = (unsigned char)(len - HUFF_PRIMARY_BITS);
+            }
+        }
+    }
+    size_t total = HUFF_PRIMARY_SIZE;
+    for (int p = 0; p < HUFF_PRIMARY_SIZE; p++) {
+        if (sub_bits[p]) {
+            sub_off[p] = (uint32_t)total;
+            total += (size_t)1 << sub_bits[p];
+        }
+    }
+
+    uint32_t* entries = (uint32_t*)comp_calloc(total, sizeof(uint32_t));
+    if (!entries) return -1;
+    for (int p = 0; p < HUFF_PRIMARY_SIZE; p++) {
+        if (sub_bits[p]) entries[p] = HUFF_ENTRY_SUB | (sub_off[p] << 8) | sub_bits[p];
+    }
+    for (int s = 0; s < 256; s++) {
+        int len = lens[s];
+        if (len == 0) continue;
+        size_t first, span;
+        uint32_t entry;
+        if (len <= HUFF_PRIMARY_BITS) {
+            first = (size_t)codes[s] << (HUFF_PRIMARY_BITS - len);
+            span = (size_t)1 << (HUFF_PRIMARY_BITS - len);
+            entry = ((uint32_t)s << 8) | (uint32_t)len;
+        } else {
+            int extra = len - HUFF_PRIMARY_BITS;
+            uint32_t prefix = codes[s] >> extra;
+            uint32_t low = codes[s] & ((1u << extra) - 1);
+            first = sub_off[prefix] + ((size_t)low << (sub_bits[prefix] - extra));
+            span = (size_t)1 << (sub_bits[prefix] - extra);
+            entry = ((uint32_t)s << 8) | (uint32_t)extra;
+        }
+        for (size_t i = 0; i < span; i++) entries[first + i] = entry;
+    }
+
+    table->entries = entries;
+    table->max_len = max_len;
+    return 0;
+}
+
+static inline uint64_t huffman_load_be64(const unsigned char* p) {
+    return ((uint64_t)p[0] << 56) | ((uint64_t)p[1] << 48) | ((uint64_t)p[2] << 40) | ((uint64_t)p[3] << 32) |
+           ((uint64_t)p[4] << 24) | ((uint64_t)p[5] << 16) | ((uint64_t)p[6] << 8) | (uint64_t)p[7];
+}
+
+// Decode up to out_count symbols; returns the number decoded (short on a
+// truncated stream, like the tree walk) or -1 on an invalid code
+static long huffman_decode_with_table(const HuffDecodeTable* table, const unsigned char* in, long in_size,
+                                      unsigned char* out, long out_count) {
+    const uint32_t* tab = table->entries;
+    const uint64_t total_bits = (uint64_t)in_size * 8;
+    const int per_refill = HUFF_REFILL_BITS / table->max_len;
+    uint64_t bitbuf = 0;     // MSB-aligned; bits below bitcnt mirror the next input byte
+    int bitcnt = 0;
+    long pos = 0;            // counts zero padding past the end as well
+    long produced = 0;
+
+    while (produced < out_count) {
+        if (pos + 8 <= in_size) {
+            bitbuf |= huffman_load_be64(in + pos) >> bitcnt;
+            pos += (63 - bitcnt) >> 3;
+            bitcnt |= HUFF_REFILL_BITS;
+        } else {
+            while (bitcnt <= HUFF_REFILL_BITS) {
+                if (pos < in_size) bitbuf |= (uint64_t)in[pos] << (HUFF_REFILL_BITS - bitcnt);
+                pos++;
+                bitcnt += 8;
+            }
+        }
+
+        for (int k = 0; k < per_refill && produced < out_count; k++) {
+            uint32_t e = tab[bitbuf >> (64 - HUFF_PRIMARY_BITS)];
+            if (e & HUFF_ENTRY_SUB) {
+                uint32_t idx = (uint32_t)((bitbuf << HUFF_PRIMARY_BITS) >> (64 - (e & 0xFF)));
+                e = tab[((e & ~HUFF_ENTRY_SUB) >> 8) + idx];
+                bitbuf <<= HUFF_PRIMARY_BITS;
+                bitcnt -= HUFF_PRIMARY_BITS;
+            }
+            int len = (int)(e & 0xFF);
+            if (len == 0) return -1;
+            bitbuf <<= len;
+            bitcnt -= len;
+            if ((uint64_t)pos * 8 - (uint64_t)bitcnt > total_bits) return produced;
+            out[produced++] = (unsigned char)(e >> 8);
+        }
+    }
+    return produced;
+}
+
+// Reference bit-at-a-time decoder: follows tree pointers from the root
+static long huffman_decode_tree_walk(const HuffmanNode* root, const unsigned char* in, long in_size,
+                                     unsigned char* out, long out_count) {
+    long produced = 0;
+    const HuffmanNode* current = root;
+    int single = (!root->left && !root->right);
+    for (long i = 0; i < in_size && produced < out_count; i++) {
+        unsigned char byte = in[i];
+        for (int bit = 7; bit >= 0 && produced < out_count; bit--) {
+            if (single) {
+                out[produced++] = root->data;
+                continue;
+            }
             int bit_value = (byte >> bit) & 1;
-            
+
             if (bit_value == 0) {
                 current = current->left;
             } else {
                 current = current->right;
             }
-            
+
             // If we reach a leaf node
             if (!current->left && !current->right) {
-                (*output)[(*output_size)++] = current->data;
+                out[produced++] = current->data;
                 current = root;
             }
         }
     }
-    
-    free_huffman_tree(root);
-    return COMP_SUCCESS;
+    return produced;
 }
 
-// Free Huffman tree memory
-void free_huffman_tree(HuffmanNode* root) {
-    if (!root) return;
+// Reference bit-at-a-time decoder for canonical codes: grows the code one
+// bit at a time and compares it against the first code of each length
+static long huffman_decode_canonical_bitwise(const unsigned char* lens, const unsigned char* in, long in_size,
+                                             unsigned char* out, long out_count) {
+    int count[HUFF_MAX_CODE_LEN + 1] = {0};
+    unsigned char sorted[256];
+    int n = 0;
+    for (int len = 1; len <= HUFF_MAX_CODE_LEN; len++) {
+        for (int s = 0; s < 256; s++) {
+            if (lens[s] == len) {
+                sorted[n++] = (unsigned char)s;
+                count[len]++;
+            }
+        }
+    }
 
-    free_huffman_tree(root->left);
-    free_huffman_tree(root->right);
-    free(root);
+    long produced = 0;
+    long bitpos = 0;
+    const long total_bits = in_size * 8;
+    while (produced < out_count) {
+        int code = 0, first = 0, index = 0, len = 1;
+        for (; len <= HUFF_MAX_CODE_LEN; len++) {
+            if (bitpos >= total_bits) return produced;
+            code |= (in[bitpos >> 3] >> (7 - (bitpos & 7))) & 1;
+            bitpos++;
+            if (code - first < count[len]) break;
+            index += count[len];
+            first = (first + count[len]) << 1;
+            code <<= 1;
+        }
+        if (len > HUFF_MAX_CODE_LEN) return -1;
+        out[produced++] = sorted[index + (code - first)];
+    }
+    return produced;
 }
 
-// Optimized Huffman decompression for hardcore pipeline
-// This version uses tracked_malloc for memory management
-CompResult huffman_decompress_optimized(const unsigned char* input, long input_size, unsigned char** output, long* output_size) {
-    if (!input || input_size <= 0) return COMP_ERR_INVALID_PARAMS;
+// ===== Four-stream decoder =====
+// Codes are at most 11 bits, so one 2048-entry table of (symbol << 8 | len)
+// resolves every symbol in a single lookup and a 56-bit refill covers five.
+#define HUFF_4X_TABLE_SIZE (1 << HUFF_4X_MAX_LEN)
+#define HUFF_4X_PER_REFILL (HUFF_REFILL_BITS / HUFF_4X_MAX_LEN)
 
-    // Read header to reconstruct frequency table
-    unsigned int frequencies[256] = {0};
-    int pos = 0;
+typedef struct {
+    const unsigned char* in;
+    long size;
+    long pos;
+    uint64_t bitbuf;
+    int bitcnt;
+} HuffBitReader;
 
-    while (pos < input_size - 4) {
-        if (input[pos] == 0xFF && input[pos+1] == 0xFF &&
-            input[pos+2] == 0xFF && input[pos+3] == 0xFF && input[pos+4] == 0xFF) {
-            pos += 5;
-            break;
+static void huffman_build_4x_table(const unsigned char* lens, uint16_t* tab) {
+    uint32_t codes[256];
+    huffman_canonical_codes(lens, codes);
+    memset(tab, 0, HUFF_4X_TABLE_SIZE * sizeof(uint16_t));
+    for (int s = 0; s < 256; s++) {
+        int len = lens[s];
+        if (len == 0) continue;
+        uint32_t first = codes[s] << (HUFF_4X_MAX_LEN - len);
+        uint32_t span = 1u << (HUFF_4X_MAX_LEN - len);
+        for (uint32_t i = 0; i < span; i++) tab[first + i] = (uint16_t)((s << 8) | len);
+    }
+}
+
+static inline void huffman_reader_refill(HuffBitReader* r) {
+    if (r->pos + 8 <= r->size) {
+        r->bitbuf |= huffman_load_be64(r->in + r->pos) >> r->bitcnt;
+        r->pos += (63 - r->bitcnt) >> 3;
+        r->bitcnt |= HUFF_REFILL_BITS;
+    } else {
+        while (r->bitcnt <= HUFF_REFILL_BITS) {
+            if (r->pos < r->size) r->bitbuf |= (uint64_t)r->in[r->pos] << (HUFF_REFILL_BITS - r->bitcnt);
+            r->pos++;
+            r->bitcnt += 8;
         }
+    }
+}
 
-        unsigned char ch = input[pos++];
-        unsigned int freq = (input[pos] << 24) | (input[pos+1] << 16) |
-                           (input[pos+2] << 8) | input[pos+3];
-        pos += 4;
-        frequencies[ch] = freq;
+// Decode one symbol; an unused table slot yields length 0
+static inline uint16_t huffman_reader_decode(HuffBitReader* r, const uint16_t* tab) {
+    uint16_t e = tab[r->bitbuf >> (64 - HUFF_4X_MAX_LEN)];
+    int len = e & 0xFF;
+    r->bitbuf <<= len;
+    r->bitcnt -= len;
+    return e;
+}
+
+// Finish one stream symbol by symbol; 0 on success, -1 on a bad code or if
+// the stream ends early
+static int huffman_reader_finish(HuffBitReader* r, const uint16_t* tab, unsigned char* out, long count) {
+    const uint64_t total_bits = (uint64_t)r->size * 8;
+    for (long i = 0; i < count; i++) {
+        if (r->bitcnt < HUFF_4X_MAX_LEN) huffman_reader_refill(r);
+        uint16_t e = huffman_reader_decode(r, tab);
+        if ((e & 0xFF) == 0) return -1;
+        if ((uint64_t)r->pos * 8 - (uint64_t)r->bitcnt > total_bits) return -1;
+        out[i] = (unsigned char)(e >> 8);
+    }
+    return 0;
+}
+
+// Decode the four streams in lockstep so their table lookups overlap
+static int huffman_decode_4x(const unsigned char* lens, const unsigned char* const* streams,
+                             const long* sizes, unsigned char* out, long out_count) {
+    uint16_t tab[HUFF_4X_TABLE_SIZE];
+    huffman_build_4x_table(lens, tab);
+
+    long seg = (out_count + 3) / 4;
+    HuffBitReader r[4];
+    unsigned char* dst[4];
+    long left[4];
+    for (int k = 0; k < 4; k++) {
+        long start = k * seg;
+        left[k] = (out_count - start < seg) ? out_count - start : seg;
+        if (left[k] < 0) left[k] = 0;
+        dst[k] = out + (start < out_count ? start : out_count);
+        r[k].in = streams[k];
+        r[k].size = sizes[k];
+        r[k].pos = 0;
+        r[k].bitbuf = 0;
+        r[k].bitcnt = 0;
+    }
+
+    // Fast loop: every reader has 8 readable bytes and room for 5 symbols.
+    // Stream 3 is the shortest, so it bounds the iteration count.
+    HuffBitReader r0 = r[0], r1 = r[1], r2 = r[2], r3 = r[3];
+    unsigned char *o0 = dst[0], *o1 = dst[1], *o2 = dst[2], *o3 = dst[3];
+    long n = left[3] / HUFF_4X_PER_REFILL;
+    int bad = 0;
+    while (n-- > 0 &&
+           r0.pos + 8 <= r0.size && r1.pos + 8 <= r1.size &&
+           r2.pos + 8 <= r2.size && r3.pos + 8 <= r3.size) {
+        huffman_reader_refill(&r0);
+        huffman_reader_refill(&r1);
+        huffman_reader_refill(&r2);
+        huffman_reader_refill(&r3);
+        for (int i = 0; i < HUFF_4X_PER_REFILL; i++) {
+            uint16_t e0 = huffman_reader_decode(&r0, tab);
+            uint16_t e1 = huffman_reader_decode(&r1, tab);
+            uint16_t e2 = huffman_reader_decode(&r2, tab);
+            uint16_t e3 = huffman_reader_decode(&r3, tab);
+            bad |= !(e0 & 0xFF) | !(e1 & 0xFF) | !(e2 & 0xFF) | !(e3 & 0xFF);
+            *o0++ = (unsigned char)(e0 >> 8);
+            *o1++ = (unsigned char)(e1 >> 8);
+            *o2++ = (unsigned char)(e2 >> 8);
+            *o3++ = (unsigned char)(e3 >> 8);
+        }
+        if (bad) return -1;
+    }
+    r[0] = r0; r[1] = r1; r[2] = r2; r[3] = r3;
+    unsigned char* cur[4] = { o0, o1, o2, o3 };
+
+    for (int k = 0; k < 4; k++) {
+        long done = (long)(cur[k] - dst[k]);
+        if (huffman_reader_finish(&r[k], tab, cur[k], left[k] - done) != 0) return -1;
     }
+    return 0;
+}
+
+static void huffman_release(void* (*alloc)(size_t), void* ptr) {
+    if (!alloc) return;   // caller's buffer
+    if (alloc == malloc) comp_free(ptr);
+    else tracked_free(ptr, 0);
+}
+
+static CompResult huffman_decompress_canonical(const unsigned char* input, long input_size,
+                                               unsigned char** output, long* output_size,
+                                               void* (*alloc)(size_t), int table_driven) {
+    if (input_size < 4 || (input[2] != HUFF_STREAM_CANONICAL && input[2] != HUFF_STREAM_4X)) {
+        return COMP_ERR_INVALID_FORMAT;
+    }
+    int four_stream = (input[2] == HUFF_STREAM_4X);
+
+    long pos = 3;
+    unsigned long original_size = 0;
+    for (int shift = 0; ; shift += 7) {
+        if (pos >= input_size || shift > 56) return COMP_ERR_INVALID_FORMAT;
+        unsigned char b = input[pos++];
+        original_size |= (unsigned long)(b & 0x7F) << shift;
+        if (!(b & 0x80)) break;
+    }
+
+    unsigned char lens[256];
+    long lens_size = huffman_read_lengths(input + pos, input_size - pos, lens);
+    if (lens_size < 0) return COMP_ERR_INVALID_FORMAT;
+    pos += lens_size;
+
+    const unsigned char* streams[4];
+    long sizes[4];
+    if (four_stream) {
+        for (int s = 0; s < 256; s++) {
+            if (lens[s] > HUFF_4X_MAX_LEN) return COMP_ERR_INVALID_FORMAT;
+        }
+        if (input_size - pos < HUFF_4X_JUMP_SIZE) return COMP_ERR_INVALID_FORMAT;
+        long rest = input_size - pos - HUFF_4X_JUMP_SIZE;
+        for (int k = 0; k < 3; k++) {
+            const unsigned char* j = input + pos + 4 * k;
+            sizes[k] = (long)(((uint32_t)j[0] << 24) | ((uint32_t)j[1] << 16) | ((uint32_t)j[2] << 8) | j[3]);
+            if (sizes[k] > rest) return COMP_ERR_INVALID_FORMAT;
+            rest -= sizes[k];
+        }
+        sizes[3] = rest;
+        pos += HUFF_4X_JUMP_SIZE;
+        streams[0] = input + pos;
+        for (int k = 1; k < 4; k++) streams[k] = streams[k - 1] + sizes[k - 1];
+    }
+
+    // Every symbol costs at least one bit
+    if (original_size == 0 || original_size > (unsigned long)(input_size - pos) * 8) {
+        return COMP_ERR_INVALID_FORMAT;
+    }
+
+    if (!alloc) {
+        if ((long)original_size > *output_size) return COMP_ERR_BUFFER_OVERFLOW;
+    } else {
+        *output = (unsigned char*)alloc(original_size);
+        if (!*output) return COMP_ERR_MEMORY;
+    }
+
+    long produced;
+    if (four_stream) {
+        produced = (long)original_size;
+        if (table_driven) {
+            if (huffman_decode_4x(lens, streams, sizes, *output, produced) != 0) produced = -1;
+        } else {
+            long seg = (produced + 3) / 4;
+            for (int k = 0; k < 4 && produced >= 0; k++) {
+                long start = k * seg;
+                long len = (long)original_size - start;
+                if (len > seg) len = seg;
+                if (len <= 0) break;
+                if (huffman_decode_canonical_bitwise(lens, streams[k], sizes[k], *output + start, len) != len) {
+                    produced = -1;
+                }
+            }
+        }
+    } else if (table_driven) {
+        uint32_t codes[256];
+        HuffDecodeTable table = {0};
+        huffman_canonical_codes(lens, codes);
+        if (huffman_build_decode_table(codes, lens, &table) != 0) {
+            huffman_release(alloc, *output);
+            *output = NULL;
+            return COMP_ERR_MEMORY;
+        }
+        produced = huffman_decode_with_table(&table, input + pos, input_size - pos, *output, (long)original_size);
+        comp_free(table.entries);
+    } else {
+        produced = huffman_decode_canonical_bitwise(lens, input + pos, input_size - pos, *output, (long)original_size);
+    }
+
+    if (produced < 0) {
+        huffman_release(alloc, *output);
+        *output = NULL;
+        return COMP_ERR_DECOMPRESSION_FAILED;
+    }
+    *output_size = produced;
+    return COMP_SUCCESS;
+}
+
+// Shared body of the public decoders; alloc selects malloc or tracked_malloc,
+// or is NULL to decode into *output, which holds *output_size bytes
+static CompResult huffman_decompress_impl(const unsigned char* input, long input_size,
+                                          unsigned char** output, long* output_size,
+                                          void* (*alloc)(size_t), int table_driven) {
+    if (!input || input_size <= 0) return COMP_ERR_INVALID_PARAMS;
+
+    if (input_size >= 3 && input[0] == HUFF_V2_MAGIC0 && input[1] == HUFF_V2_MAGIC1) {
+        return huffman_decompress_canonical(input, input_size, output, output_size, alloc, table_driven);
+    }
+
+    // Legacy stream: read header to reconstruct frequency table
+    unsigned int frequencies[256] = {0};
+    long pos = huffman_read_freq_header(input, input_size, frequencies);
 
     // Rebuild Huffman tree
     HuffmanNode* root = build_huffman_tree(frequencies);
@@ -351,34 +987,79 @@ CompResult huffman_decompress_optimized(const unsigned char* input, long input_s
         original_size += frequencies[i];
     }
 
-    *output = (unsigned char*)tracked_malloc(original_size);
-    if (!*output) {
+    // Every symbol costs at least one bit; reject corrupt frequency headers
+    if (original_size > (input_size - pos) * 8) {
         free_huffman_tree(root);
-        return COMP_ERR_MEMORY;
+        return COMP_ERR_INVALID_FORMAT;
     }
-    *output_size = 0;
-
-    // Decode the compressed data
-    HuffmanNode* current = root;
-    for (long i = pos; i < input_size && *output_size < original_size; i++) {
-        unsigned char byte = input[i];
-        for (int bit = 7; bit >= 0 && *output_size < original_size; bit--) {
-            int bit_value = (byte >> bit) & 1;
-
-            if (bit_value == 0) {
-                current = current->left;
-            } else {
-                current = current->right;
-            }
 
-            // If we reach a leaf node
-            if (!current->left && !current->right) {
-                (*output)[(*output_size)++] = current->data;
-                current = root;
-            }
+    if (!alloc) {
+        if (original_size > *output_size) {
+            free_huffman_tree(root);
+            return COMP_ERR_BUFFER_OVERFLOW;
+        }
+    } else {
+        *output = (unsigned char*)alloc(original_size > 0 ? original_size : 1);
+        if (!*output) {
+            free_huffman_tree(root);
+            return COMP_ERR_MEMORY;
         }
     }
 
+    uint32_t codes[256];
+    unsigned char lens[256];
+    HuffDecodeTable table = {0};
+    long produced;
+    memset(lens, 0, sizeof(lens));
+    if (table_driven && huffman_collect_codes(root, 0, 0, codes, lens) &&
+        huffman_build_decode_table(codes, lens, &table) == 0) {
+        produced = huffman_decode_with_table(&table, input + pos, input_size - pos, *output, original_size);
+        comp_free(table.entries);
+    } else {
+        produced = huffman_decode_tree_walk(root, input + pos, input_size - pos, *output, original_size);
+    }
     free_huffman_tree(root);
+
+    if (produced < 0) {
+        huffman_release(alloc, *output);
+        *output = NULL;
+        return COMP_ERR_DECOMPRESSION_FAILED;
+    }
+    *output_size = produced;
     return COMP_SUCCESS;
-}
\ No newline at end of file
+}
+
+// Huffman decompression function
+CompResult huffman_decompress(const unsigned char* input, long input_size, unsigned char** output, long* output_size) {
+    return huffman_decompress_impl(input, input_size, output, output_size, malloc, 1);
+}
+
+CompResult huffman_decompress_into(const unsigned char* input, long input_size, unsigned char* dst, long dst_cap,
+                                   long* written) {
+    if (!dst || !written) return COMP_ERR_INVALID_PARAMS;
+    unsigned char* out = dst;
+    long size = dst_cap;
+    CompResult r = huffman_decompress_impl(input, input_size, &out, &size, NULL, 1);
+    if (r == COMP_SUCCESS) *written = size;
+    return r;
+}
+
+// Bit-at-a-time reference decoder (kept for benchmarking and cross-checks)
+CompResult huffman_decompress_bitwise(const unsigned char* input, long input_size, unsigned char** output, long* output_size) {
+    return huffman_decompress_impl(input, input_size, output, output_size, malloc, 0);
+}
+
+// Free Huffman tree memory
+void free_huffman_tree(HuffmanNode* root) {
+    if (!root) return;
+
+    free_huffman_tree(root->left);
+    free_huffman_tree(root->right);
+    comp_free(root);
+}
+
+// Optimized Huffman decompression for hardcore pipeline
+// This version uses tracked_malloc for memory management
+CompResult huffman_decompress_optimized(const unsigned char* input, long input_size, unsigned char** output, long* output_size) {
+    return huffman_decompress_impl(input, input_size, output, output_size, tracked_malloc, 1);
+}
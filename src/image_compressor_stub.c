@@ -35,6 +35,17 @@ int image_compress(const unsigned char* input, long input_size, unsigned char**
     return 0;
 }
 
+// Peak bytes image_compress allocates beyond the input: the container
+// buffer, the filtered payload and its BCM copy, and the LZMA encoder,
+// whose binary-tree match finder needs about 11.5 bytes per dictionary
+// byte (the dictionary is the payload size, up to 128 MiB)
+size_t image_memory_cost(long input_size) {
+    if (input_size <= 0) return 0;
+    size_t n = (size_t)input_size;
+    size_t dict = n < (128u << 20) ? n : (128u << 20);
+    return (n + (n >> 1) + 65536) + 2 * (n + 4096) + dict * 23 / 2 + (4u << 20);
+}
+
 int image_decompress(const unsigned char* input, long input_size, unsigned char** output, long* output_size) {
     if (!input || input_size <= 0 || !output || !output_size) return -1;
 #ifdef HAVE_LZMA
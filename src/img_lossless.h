@@ -10,6 +10,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include "mtf.h"
 
 // ---- LZMA SDK minimal interface (avoid wrapper to control dict size) ----
 #ifdef HAVE_LZMA
@@ -226,7 +227,7 @@ static int parse_png_rgb24(const uint8_t* in, size_t in_len, uint32_t* w, uint32
     }
     if (!gotIHDR || idat_total == 0) return 0;
     // Second pass: gather IDAT payload
-    uint8_t* cat = (uint8_t*)malloc(idat_total);
+    uint8_t* cat = (uint8_t*)comp_malloc(idat_total);
     if (!cat) return 0;
     size_t written = 0; p = 8;
     while (p + 12 <= in_len) {
@@ -263,7 +264,7 @@ static int strip_png_chunks(const uint8_t* in, size_t in_len, uint8_t** out_png,
         p += 12u + len;
     }
     // Allocate and copy
-    uint8_t* buf = (uint8_t*)malloc(essential_total);
+    uint8_t* buf = (uint8_t*)comp_malloc(essential_total);
     if (!buf) return 0;
     memcpy(buf, sig, 8);
     size_t w = 8; p = 8;
@@ -272,7 +273,7 @@ static int strip_png_chunks(const uint8_t* in, size_t in_len, uint8_t** out_png,
         const uint8_t* type = in + p + 4;
         const uint8_t* data = in + p + 8;
         const uint8_t* crc = in + p + 8 + len;
-        if (p + 12u + len > in_len) { free(buf); return 0; }
+        if (p + 12u + len > in_len) { comp_free(buf); return 0; }
         if (memcmp(type, "IHDR", 4) == 0 || memcmp(type, "PLTE", 4) == 0 || memcmp(type, "IDAT", 4) == 0 || memcmp(type, "IEND", 4) == 0) {
             // write length (BE), type, data, crc
             buf[w + 0] = (uint8_t)((len >> 24) & 0xFF);
@@ -297,14 +298,14 @@ static int png_refilter(const uint8_t* png, size_t png_len, uint8_t** out_rows,
     if (!parse_png_rgb24(png, png_len, &w, &h, &stride, &idat, &idat_len)) return 0;
     size_t scanline_size = (size_t)stride + 1u;
     size_t expect_size = (size_t)h * scanline_size;
-    uint8_t* scan = (uint8_t*)malloc(expect_size);
-    if (!scan) { free((void*)idat); return 0; }
+    uint8_t* scan = (uint8_t*)comp_malloc(expect_size);
+    if (!scan) { comp_free((void*)idat); return 0; }
     size_t got = deflate_decompress(idat, idat_len, scan, expect_size);
-    free((void*)idat);
-    if (got != expect_size) { free(scan); return 0; }
+    comp_free((void*)idat);
+    if (got != expect_size) { comp_free(scan); return 0; }
     // Reverse existing filters to raw rows
-    uint8_t* raw = (uint8_t*)malloc((size_t)stride * h);
-    if (!raw) { free(scan); return 0; }
+    uint8_t* raw = (uint8_t*)comp_malloc((size_t)stride * h);
+    if (!raw) { comp_free(scan); return 0; }
     const uint8_t* prev = NULL; uint8_t* dst = raw;
     for (uint32_t y=0; y<h; y++) {
         const uint8_t* rowp = scan + y * scanline_size + 1;
@@ -312,38 +313,38 @@ static int png_refilter(const uint8_t* png, size_t png_len, uint8_t** out_rows,
         reverse_filter_row(f, rowp, prev, stride, 3, dst);
         prev = dst; dst += stride;
     }
-    free(scan);
+    comp_free(scan);
     // Apply our filter selection per row
     size_t rows_out = (size_t)h * ((size_t)stride + 1u);
-    uint8_t* rows = (uint8_t*)malloc(rows_out);
-    if (!rows) { free(raw); return 0; }
-    uint8_t* outp = rows; const uint8_t* prev2 = NULL; uint8_t* curdec = (uint8_t*)malloc((size_t)stride);
-    if (!curdec) { free(rows); free(raw); return 0; }
+    uint8_t* rows = (uint8_t*)comp_malloc(rows_out);
+    if (!rows) { comp_free(raw); return 0; }
+    uint8_t* outp = rows; const uint8_t* prev2 = NULL; uint8_t* curdec = (uint8_t*)comp_malloc((size_t)stride);
+    if (!curdec) { comp_free(rows); comp_free(raw); return 0; }
     for (uint32_t y=0; y<h; y++) {
         const uint8_t* r = raw + (size_t)y * stride;
         select_and_apply_filter(r, prev2, stride, 3, outp);
         reverse_filter_row(outp[0], outp + 1, prev2, stride, 3, curdec);
         prev2 = curdec; outp += 1 + stride;
     }
-    free(curdec);
-    free(raw);
+    comp_free(curdec);
+    comp_free(raw);
     *out_rows = rows; *out_len = rows_out; return 1;
 }
 
 // ---- LZMA helpers ----
-static void* SzAllocFn(struct ISzAlloc *p, size_t size) { (void)p; return malloc(size); }
-static void SzFreeFn(struct ISzAlloc *p, void *address) { (void)p; free(address); }
+static void* SzAllocFn(struct ISzAlloc *p, size_t size) { (void)p; return comp_malloc(size); }
+static void SzFreeFn(struct ISzAlloc *p, void *address) { (void)p; comp_free(address); }
 // ---- Pre-LZMA transform: byte-wise delta + MTF (BCM-like) ----
 #define BCM_BLOCK_BYTES (1u<<20)
 static size_t delta_encode_buf(const uint8_t* in, size_t n, uint8_t* out){ uint8_t prev=0; for(size_t i=0;i<n;i++){ uint8_t d=(uint8_t)(in[i]-prev); out[i]=d; prev=in[i]; } return n; }
 static size_t delta_decode_buf(const uint8_t* in, size_t n, uint8_t* out){ uint8_t prev=0; for(size_t i=0;i<n;i++){ uint8_t v=(uint8_t)(in[i]+prev); out[i]=v; prev=v; } return n; }
-static size_t mtf_encode_block(const uint8_t* in, size_t n, uint8_t* out){ uint8_t list[256]; for(int i=0;i<256;i++) list[i]=(uint8_t)i; for(size_t i=0;i<n;i++){ uint8_t c=in[i]; int idx=0; while(list[idx]!=c) idx++; out[i]=(uint8_t)idx; memmove(&list[1],&list[0],idx); list[0]=c; } return n; }
-static size_t mtf_decode_block(const uint8_t* in, size_t n, uint8_t* out){ uint8_t list[256]; for(int i=0;i<256;i++) list[i]=(uint8_t)i; for(size_t i=0;i<n;i++){ int idx=in[i]; uint8_t c=list[idx]; out[i]=c; memmove(&list[1],&list[0],idx); list[0]=c; } return n; }
-static int bcm_encode(const uint8_t* filtered, size_t len, uint8_t* out, size_t* out_len){ if(!filtered||!out||!out_len) return 0; uint8_t* tmp=(uint8_t*)malloc(len); if(!tmp) return 0; size_t pos=0; while(pos<len){ size_t blen=(len-pos>BCM_BLOCK_BYTES)?BCM_BLOCK_BYTES:(len-pos); delta_encode_buf(filtered+pos,blen,tmp+pos); mtf_encode_block(tmp+pos,blen,out+pos); pos+=blen; } free(tmp); *out_len=len; return 1; }
-static int bcm_decode(const uint8_t* in, size_t len, uint8_t* out){ if(!in||!out) return 0; uint8_t* tmp=(uint8_t*)malloc(len); if(!tmp) return 0; size_t pos=0; while(pos<len){ size_t blen=(len-pos>BCM_BLOCK_BYTES)?BCM_BLOCK_BYTES:(len-pos); mtf_decode_block(in+pos,blen,tmp+pos); delta_decode_buf(tmp+pos,blen,out+pos); pos+=blen; } free(tmp); return 1; }
+static size_t mtf_encode_block(const uint8_t* in, size_t n, uint8_t* out){ mtf_encode_bytes(in,(long)n,out); return n; }
+static size_t mtf_decode_block(const uint8_t* in, size_t n, uint8_t* out){ mtf_decode_bytes(in,(long)n,out); return n; }
+static int bcm_encode(const uint8_t* filtered, size_t len, uint8_t* out, size_t* out_len){ if(!filtered||!out||!out_len) return 0; uint8_t* tmp=(uint8_t*)comp_malloc(len); if(!tmp) return 0; size_t pos=0; while(pos<len){ size_t blen=(len-pos>BCM_BLOCK_BYTES)?BCM_BLOCK_BYTES:(len-pos); delta_encode_buf(filtered+pos,blen,tmp+pos); mtf_encode_block(tmp+pos,blen,out+pos); pos+=blen; } comp_free(tmp); *out_len=len; return 1; }
+static int bcm_decode(const uint8_t* in, size_t len, uint8_t* out){ if(!in||!out) return 0; uint8_t* tmp=(uint8_t*)comp_malloc(len); if(!tmp) return 0; size_t pos=0; while(pos<len){ size_t blen=(len-pos>BCM_BLOCK_BYTES)?BCM_BLOCK_BYTES:(len-pos); mtf_decode_block(in+pos,blen,tmp+pos); delta_decode_buf(tmp+pos,blen,out+pos); pos+=blen; } comp_free(tmp); return 1; }
 // forward declaration to avoid implicit declaration
 static size_t lzma_compress_img(const uint8_t* in, size_t in_len, uint8_t* out, size_t out_cap);
-static size_t pack_and_lzma(const uint8_t* payload, size_t payload_size, uint8_t* out, size_t out_cap){ if(!payload||payload_size<sizeof(ImgHeader)) return 0; uint8_t* pre=(uint8_t*)malloc(payload_size); if(!pre) return 0; memcpy(pre,payload,sizeof(ImgHeader)); size_t bcm_len=0; if(!bcm_encode(payload+sizeof(ImgHeader), payload_size-sizeof(ImgHeader), pre+sizeof(ImgHeader), &bcm_len)){ free(pre); return 0; } size_t produced=lzma_compress_img(pre, sizeof(ImgHeader)+bcm_len, out, out_cap); free(pre); return produced; }
+static size_t pack_and_lzma(const uint8_t* payload, size_t payload_size, uint8_t* out, size_t out_cap){ if(!payload||payload_size<sizeof(ImgHeader)) return 0; uint8_t* pre=(uint8_t*)comp_malloc(payload_size); if(!pre) return 0; memcpy(pre,payload,sizeof(ImgHeader)); size_t bcm_len=0; if(!bcm_encode(payload+sizeof(ImgHeader), payload_size-sizeof(ImgHeader), pre+sizeof(ImgHeader), &bcm_len)){ comp_free(pre); return 0; } size_t produced=lzma_compress_img(pre, sizeof(ImgHeader)+bcm_len, out, out_cap); comp_free(pre); return produced; }
 
 #ifdef HAVE_LZMA
 static size_t lzma_compress_img(const uint8_t* in, size_t in_len, uint8_t* out, size_t out_cap) {
@@ -400,15 +401,15 @@ static size_t img_compress(const uint8_t* in, size_t in_len, uint8_t* out, size_
         fmt = 1;
         size_t rowsz = (size_t)stride;
         size_t payload_size = sizeof(ImgHeader) + h * (rowsz + 1);
-        uint8_t* payload = (uint8_t*)malloc(payload_size);
+        uint8_t* payload = (uint8_t*)comp_malloc(payload_size);
         if (!payload) return 0;
         write_img_header(payload, w, h, stride, fmt);
         uint8_t* outp = payload + sizeof(ImgHeader);
         // assemble top-down rows without padding (BGR maintained)
-        uint8_t* curbuf = (uint8_t*)malloc(rowsz);
-        uint8_t* prev_row = (uint8_t*)malloc(rowsz);
-        uint8_t* curdec = (uint8_t*)malloc(rowsz);
-        if (!curbuf || !prev_row || !curdec) { free(curbuf); free(prev_row); free(curdec); free(payload); return 0; }
+        uint8_t* curbuf = (uint8_t*)comp_malloc(rowsz);
+        uint8_t* prev_row = (uint8_t*)comp_malloc(rowsz);
+        uint8_t* curdec = (uint8_t*)comp_malloc(rowsz);
+        if (!curbuf || !prev_row || !curdec) { comp_free(curbuf); comp_free(prev_row); comp_free(curdec); comp_free(payload); return 0; }
         for (uint32_t y=0; y<h; y++) {
             uint32_t src_y = top_down ? y : (h - 1 - y);
             const uint8_t* src_row = pix + (size_t)src_y * file_row_stride;
@@ -444,11 +445,11 @@ static size_t img_compress(const uint8_t* in, size_t in_len, uint8_t* out, size_
             memcpy(prev_row, curdec, rowsz);
             outp += 1 + rowsz;
         }
-        free(curbuf);
-        free(prev_row);
-        free(curdec);
+        comp_free(curbuf);
+        comp_free(prev_row);
+        comp_free(curdec);
         size_t produced = pack_and_lzma(payload, payload_size, out, out_cap);
-        free(payload);
+        comp_free(payload);
         return produced;
     }
 
@@ -457,14 +458,14 @@ static size_t img_compress(const uint8_t* in, size_t in_len, uint8_t* out, size_
         fmt = 3;
         size_t rowsz = (size_t)stride;
         size_t payload_size = sizeof(ImgHeader) + h * (rowsz + 1);
-        uint8_t* payload = (uint8_t*)malloc(payload_size);
+        uint8_t* payload = (uint8_t*)comp_malloc(payload_size);
         if (!payload) return 0;
         write_img_header(payload, w, h, stride, fmt);
         uint8_t* outp = payload + sizeof(ImgHeader);
-        uint8_t* curbuf = (uint8_t*)malloc(rowsz);
-        uint8_t* prev_row = (uint8_t*)malloc(rowsz);
-        uint8_t* curdec = (uint8_t*)malloc(rowsz);
-        if (!curbuf || !prev_row || !curdec) { free(curbuf); free(prev_row); free(curdec); free(payload); return 0; }
+        uint8_t* curbuf = (uint8_t*)comp_malloc(rowsz);
+        uint8_t* prev_row = (uint8_t*)comp_malloc(rowsz);
+        uint8_t* curdec = (uint8_t*)comp_malloc(rowsz);
+        if (!curbuf || !prev_row || !curdec) { comp_free(curbuf); comp_free(prev_row); comp_free(curdec); comp_free(payload); return 0; }
         for (uint32_t y=0; y<h; y++) {
             uint32_t src_y = top_down ? y : (h - 1 - y);
             const uint8_t* src_row = pix + (size_t)src_y * stride;
@@ -475,11 +476,11 @@ static size_t img_compress(const uint8_t* in, size_t in_len, uint8_t* out, size_
             memcpy(prev_row, curdec, rowsz);
             outp += 1 + rowsz;
         }
-        free(curbuf);
-        free(prev_row);
-        free(curdec);
+        comp_free(curbuf);
+        comp_free(prev_row);
+        comp_free(curdec);
         size_t produced = pack_and_lzma(payload, payload_size, out, out_cap);
-        free(payload);
+        comp_free(payload);
         return produced;
     }
 
@@ -493,10 +494,10 @@ static size_t img_compress(const uint8_t* in, size_t in_len, uint8_t* out, size_
             return 0;
         }
         if (!png_refilter(tmp1, tmp1_len, &tmp2, &tmp2_len)) {
-            free(tmp1);
+            comp_free(tmp1);
             return 0;
         }
-        uint8_t* bcm_buf = (uint8_t*)malloc(tmp2_len);
+        uint8_t* bcm_buf = (uint8_t*)comp_malloc(tmp2_len);
         size_t bcm_len = 0;
         bcm_encode(tmp2, tmp2_len, bcm_buf, &bcm_len);   // 1 MiB blocks
         size_t produced = lzma_compress(bcm_buf, bcm_len, out, out_cap, 9); // 512 MiB dict via wrapper
@@ -506,19 +507,19 @@ static size_t img_compress(const uint8_t* in, size_t in_len, uint8_t* out, size_
             if (ratio > 0.40) {
                 // Escape literal percent to avoid -Wformat parsing issues
                 fprintf(stderr, "\xE2\x9A\xA0\xEF\xB8\x8F Image > 40%% – stripping metadata & re-filtering...\n");
-                free(tmp1); free(tmp2); free(bcm_buf);
+                comp_free(tmp1); comp_free(tmp2); comp_free(bcm_buf);
                 tmp1 = NULL; tmp2 = NULL; bcm_buf = NULL; tmp1_len = 0; tmp2_len = 0; bcm_len = 0;
                 if (strip_png_chunks(in, in_len, &tmp1, &tmp1_len) && png_refilter(tmp1, tmp1_len, &tmp2, &tmp2_len)) {
-                    bcm_buf = (uint8_t*)malloc(tmp2_len);
+                    bcm_buf = (uint8_t*)comp_malloc(tmp2_len);
                     bcm_len = 0;
                     bcm_encode(tmp2, tmp2_len, bcm_buf, &bcm_len);   // 1 MiB blocks
                     produced = lzma_compress(bcm_buf, bcm_len, out, out_cap, 9); // 512 MiB dict via wrapper
                 }
             }
         }
-        free(tmp1);
-        free(tmp2);
-        free(bcm_buf);
+        comp_free(tmp1);
+        comp_free(tmp2);
+        comp_free(bcm_buf);
         return produced;
     }
 
@@ -532,21 +533,21 @@ static size_t img_decompress(const uint8_t* cmp, size_t cmp_len, uint8_t* out, s
     if (!cmp || !out) return 0;
     // First, LZMA-decompress to temporary buffer (we don't know payload size; try out_cap)
     // Strategy: allocate a working buffer equal to out_cap + header + space; if insufficient, fail.
-    uint8_t* payload = (uint8_t*)malloc(out_cap + sizeof(ImgHeader));
+    uint8_t* payload = (uint8_t*)comp_malloc(out_cap + sizeof(ImgHeader));
     if (!payload) return 0;
     size_t got = lzma_decompress_img(cmp, cmp_len, payload, out_cap + sizeof(ImgHeader));
     // debug: guard against small got
     // fprintf(stderr, "img_decompress: cmp_len=%zu, got=%zu, cap=%zu\n", (size_t)cmp_len, (size_t)got, (size_t)(out_cap + sizeof(ImgHeader)));
-    if (got < sizeof(ImgHeader)) { free(payload); return 0; }
-    ImgHeader hdr; if (!read_img_header(payload, got, &hdr)) { free(payload); return 0; }
+    if (got < sizeof(ImgHeader)) { comp_free(payload); return 0; }
+    ImgHeader hdr; if (!read_img_header(payload, got, &hdr)) { comp_free(payload); return 0; }
     uint32_t w = hdr.width, h = hdr.height, stride = hdr.stride;
     size_t needed = (size_t)w * (size_t)h * 3u;
-    if (needed > out_cap) { free(payload); return 0; }
+    if (needed > out_cap) { comp_free(payload); return 0; }
     const uint8_t* p = payload + sizeof(ImgHeader);
     size_t sl = (size_t)h * ((size_t)stride + 1u);
-    uint8_t* filt = (uint8_t*)malloc(sl);
-    if (!filt) { free(payload); return 0; }
-    if (!bcm_decode(p, sl, filt)) { free(filt); free(payload); return 0; }
+    uint8_t* filt = (uint8_t*)comp_malloc(sl);
+    if (!filt) { comp_free(payload); return 0; }
+    if (!bcm_decode(p, sl, filt)) { comp_free(filt); comp_free(payload); return 0; }
     p = filt;
     uint8_t* prev = NULL; uint8_t* dst = out;
     for (uint32_t y=0; y<h; y++) {
@@ -554,8 +555,8 @@ static size_t img_decompress(const uint8_t* cmp, size_t cmp_len, uint8_t* out, s
         reverse_filter_row(f, r, prev, stride, 3, dst);
         prev = dst; dst += stride; p += 1 + stride;
     }
-    free(filt);
-    free(payload);
+    comp_free(filt);
+    comp_free(payload);
     return needed;
 }
 
@@ -649,37 +650,37 @@ size_t img_reencode_lossless(const uint8_t* in, size_t in_len,
             if (type == 0x49484452 /*IHDR*/ && len >= 13) {
                 w = rd32be(data); h = rd32be(data + 4); bit_depth = data[8]; color_type = data[9];
             } else if (type == 0x49444154 /*IDAT*/ && len > 0) {
-                uint8_t* n = (uint8_t*)malloc(idat_total + len);
-                if (!n) { free(idat); return 0; }
-                if (idat) { memcpy(n, idat, idat_total); free(idat); }
+                uint8_t* n = (uint8_t*)comp_malloc(idat_total + len);
+                if (!n) { comp_free(idat); return 0; }
+                if (idat) { memcpy(n, idat, idat_total); comp_free(idat); }
                 memcpy(n + idat_total, data, len); idat = n; idat_total += len;
             }
             pos = next;
             if (type == 0x49454E44 /*IEND*/) break;
         }
-        if (!idat || w == 0 || h == 0) { free(idat); return 0; }
+        if (!idat || w == 0 || h == 0) { comp_free(idat); return 0; }
         (void)bit_depth; // currently unused in row estimation; kept for future color-type logic
         // Inflate IDAT
         size_t est = (size_t)h * ((size_t)w * ((color_type==2||color_type==6)?3:1) + 1) + 1024;
-        uint8_t* rows = (uint8_t*)malloc(est);
-        if (!rows) { free(idat); return 0; }
+        uint8_t* rows = (uint8_t*)comp_malloc(est);
+        if (!rows) { comp_free(idat); return 0; }
         size_t got = deflate_decompress(idat, idat_total, rows, est);
-        free(idat);
-        if (got == 0) { free(rows); return 0; }
+        comp_free(idat);
+        if (got == 0) { comp_free(rows); return 0; }
         // Apply Paeth to each row
         size_t stride = (size_t)w * ((color_type==2||color_type==6)?3:1);
-        uint8_t* filt = (uint8_t*)malloc((size_t)h * (stride + 1));
-        if (!filt) { free(rows); return 0; }
+        uint8_t* filt = (uint8_t*)comp_malloc((size_t)h * (stride + 1));
+        if (!filt) { comp_free(rows); return 0; }
         uint8_t* prev = NULL; uint8_t* outp = filt;
         for (uint32_t y = 0; y < h; y++) {
             const uint8_t* row = rows + y * (stride + 1) + 1; // skip original filter byte
             select_and_apply_filter(row, prev, stride, 3, outp);
             prev = outp + 1; outp += stride + 1;
         }
-        free(rows);
+        comp_free(rows);
         // Recompress filtered rows
         size_t zlen = deflate_compress(filt, (size_t)h * (stride + 1), out, out_cap, 9);
-        free(filt);
+        comp_free(filt);
         return zlen;
     }
     // HEIC/WebP: extract tile-like blocks, reorder by residual estimate, compress with LZMA-9
@@ -687,7 +688,7 @@ size_t img_reencode_lossless(const uint8_t* in, size_t in_len,
         // Chunk input into 4KiB blocks and compute residual (sum of absolute deltas)
         const size_t blk = 4096; size_t n = (in_len + blk - 1) / blk;
         typedef struct { size_t off; size_t len; uint64_t score; } B;
-        B* arr = (B*)malloc(n * sizeof(B)); if (!arr) return 0;
+        B* arr = (B*)comp_malloc(n * sizeof(B)); if (!arr) return 0;
         for (size_t i = 0; i < n; i++) {
             size_t off = i * blk; size_t len = (off + blk <= in_len) ? blk : (in_len - off);
             uint64_t s = 0; for (size_t j = 1; j < len; j++) s += (uint64_t)(abs((int)in[off + j] - (int)in[off + j - 1]));
@@ -700,12 +701,12 @@ size_t img_reencode_lossless(const uint8_t* in, size_t in_len,
             }
         }
         // Build reordered buffer
-        uint8_t* tmp = (uint8_t*)malloc(in_len + n * sizeof(uint32_t)); if (!tmp) { free(arr); return 0; }
+        uint8_t* tmp = (uint8_t*)comp_malloc(in_len + n * sizeof(uint32_t)); if (!tmp) { comp_free(arr); return 0; }
         size_t wr = 0; for (size_t i = 0; i < n; i++) { memcpy(tmp + wr, in + arr[i].off, arr[i].len); wr += arr[i].len; }
-        free(arr);
+        comp_free(arr);
         // LZMA-9 compress
         size_t zlen = lzma_compress(tmp, wr, out, out_cap, 9);
-        free(tmp);
+        comp_free(tmp);
         return zlen;
     }
     // Fallback: return 0
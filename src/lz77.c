@@ -3,6 +3,7 @@
 // Forward declaration for alternative LZW implementation defined in missing_functions.c
 int lzw_decompress_mfunc(const unsigned char* input, long input_size, unsigned char** output, long* output_size);
 #include <string.h>
+#include <limits.h>
 
 #define WINDOW_SIZE 4096
 #define LOOKAHEAD_SIZE 18
@@ -16,7 +17,83 @@ typedef struct {
     unsigned char next_char;
 } LZ77Match;
 
-// Find the longest match in the sliding window
+// Hash-chain match finder: heads of 3-byte hash buckets plus one link per
+// window slot back to the previous position with the same hash
+#define LZ77_HASH_BITS 15
+#define LZ77_HASH_SIZE (1 << LZ77_HASH_BITS)
+#define LZ77_WINDOW_MASK (WINDOW_SIZE - 1)
+
+// Search effort per CompressionLevel: chain links followed per position and
+// the match length at which the search stops early
+typedef struct {
+    int max_chain;
+    int nice_length;
+} LZ77LevelParams;
+
+static LZ77LevelParams lz77_level_params(CompressionLevel level) {
+    switch (level) {
+        case COMPRESSION_LEVEL_FAST:  return (LZ77LevelParams){ 4, 8 };
+        case COMPRESSION_LEVEL_HIGH:  return (LZ77LevelParams){ 128, MAX_MATCH_LENGTH };
+        case COMPRESSION_LEVEL_ULTRA: return (LZ77LevelParams){ WINDOW_SIZE, MAX_MATCH_LENGTH };
+        case COMPRESSION_LEVEL_NORMAL:
+        default:                      return (LZ77LevelParams){ 32, MAX_MATCH_LENGTH };
+    }
+}
+
+typedef struct {
+    int32_t* head;   // LZ77_HASH_SIZE entries, -1 when empty
+    int32_t* prev;   // WINDOW_SIZE entries indexed by position & LZ77_WINDOW_MASK
+} LZ77MatchFinder;
+
+static inline uint32_t lz77_hash3(const unsigned char* p) {
+    uint32_t v = ((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 8) | p[2];
+    return (v * 2654435761u) >> (32 - LZ77_HASH_BITS);
+}
+
+static inline void lz77_insert(LZ77MatchFinder* mf, const unsigned char* data, long pos) {
+    uint32_t h = lz77_hash3(data + pos);
+    mf->prev[pos & LZ77_WINDOW_MASK] = mf->head[h];
+    mf->head[h] = (int32_t)pos;
+}
+
+// Longest match for current_pos among chained candidates; the nearest
+// candidate wins ties so short offsets keep the 2-byte token form
+static LZ77Match lz77_find_match_chain(const LZ77MatchFinder* mf, const unsigned char* data, long data_size,
+                                       long current_pos, const LZ77LevelParams* params) {
+    LZ77Match match = {0, 0, data[current_pos]};
+    if (current_pos + MIN_MATCH_LENGTH > data_size) return match;
+
+    long max_len = data_size - current_pos;
+    if (max_len > MAX_MATCH_LENGTH) max_len = MAX_MATCH_LENGTH;
+    long window_start = (current_pos >= WINDOW_SIZE) ? current_pos - WINDOW_SIZE : 0;
+    const unsigned char* cur = data + current_pos;
+    int best_length = MIN_MATCH_LENGTH - 1;
+    int chain = params->max_chain;
+
+    long cand = mf->head[lz77_hash3(cur)];
+    while (cand >= window_start && cand < current_pos && chain-- > 0) {
+        const unsigned char* ref = data + cand;
+        // Cheap reject: the byte that would extend the best match must agree
+        if (ref[best_length] == cur[best_length] && ref[0] == cur[0]) {
+            int length = 0;
+            while (length < max_len && ref[length] == cur[length]) length++;
+            if (length > best_length) {
+                best_length = length;
+                match.offset = (int)(current_pos - cand);
+                if (length >= params->nice_length || length == max_len) break;
+            }
+        }
+        long next = mf->prev[cand & LZ77_WINDOW_MASK];
+        if (next >= cand) break;   // slot was recycled by a newer position
+        cand = next;
+    }
+
+    if (best_length >= MIN_MATCH_LENGTH) match.length = best_length;
+    else match.offset = 0;
+    return match;
+}
+
+// Find the longest match in the sliding window (exhaustive reference search)
 LZ77Match find_longest_match(const unsigned char* data, long data_size, long current_pos) {
     LZ77Match match = {0, 0, 0};
     
@@ -65,7 +142,7 @@ void write_lz77_token(unsigned char** output, long* output_size, long* output_ca
     // Ensure buffer has enough space
     while (*output_size + 4 >= *output_capacity) {
         *output_capacity *= 2;
-        *output = (unsigned char*)realloc(*output, *output_capacity);
+        *output = (unsigned char*)comp_realloc(*output, *output_capacity);
     }
     
     if (length == 0) {
@@ -92,48 +169,492 @@ void write_lz77_token(unsigned char** output, long* output_size, long* output_ca
     }
 }
 
-// LZ77 compression function (optimized for better compression ratio)
-int lz77_compress(const unsigned char* input, long input_size, unsigned char** output, long* output_size) {
+// Peak bytes lz77_compress_level allocates beyond the input
+size_t lz77_memory_cost(long input_size) {
+    if (input_size <= 0) return 0;
+    return (size_t)(5 + 2 * input_size + 4) + LZ77_HASH_SIZE * sizeof(int32_t) + WINDOW_SIZE * sizeof(int32_t);
+}
+
+// LZ77 compression with level-dependent search effort
+int lz77_compress_level(const unsigned char* input, long input_size, unsigned char** output, long* output_size,
+                        CompressionLevel level) {
     if (!input || input_size <= 0) return -1;
     // FORCE-COMPRESS: Always generate compressed output, even for small inputs
-    
-    long output_capacity = input_size / 2; // Start smaller
-    *output = (unsigned char*)malloc(output_capacity);
+
+    // Worst case is two bytes per input byte (escaped literals), so the
+    // token writer never has to grow the buffer
+    long output_capacity = 5 + 2 * input_size + 4;
+    *output = (unsigned char*)comp_malloc(output_capacity);
+    if (!*output) return -1;
     *output_size = 0;
-    
-    // Write compression flag and original size (4 bytes for size)
-    while (*output_size + 5 >= output_capacity) {
-        output_capacity *= 2;
-        *output = (unsigned char*)realloc(*output, output_capacity);
+
+    LZ77MatchFinder mf;
+    mf.head = (int32_t*)comp_malloc(LZ77_HASH_SIZE * sizeof(int32_t));
+    mf.prev = (int32_t*)comp_malloc(WINDOW_SIZE * sizeof(int32_t));
+    if (!mf.head || !mf.prev) {
+        comp_free(mf.head);
+        comp_free(mf.prev);
+        comp_free(*output);
+        *output = NULL;
+        return -1;
     }
-    
+    memset(mf.head, 0xFF, LZ77_HASH_SIZE * sizeof(int32_t));
+    memset(mf.prev, 0xFF, WINDOW_SIZE * sizeof(int32_t));
+    LZ77LevelParams params = lz77_level_params(level);
+
     (*output)[(*output_size)++] = 0x01; // Flag for compressed
     // Write original size in 4 bytes (supports files up to 4GB)
     for (int i = 3; i >= 0; i--) {
         (*output)[(*output_size)++] = (input_size >> (i * 8)) & 0xFF;
     }
-    
+
+    // Positions with fewer than 3 bytes left cannot start a match or be hashed
+    const long hash_end = input_size - (MIN_MATCH_LENGTH - 1);
     long current_pos = 0;
-    
+
     while (current_pos < input_size) {
-        LZ77Match match = find_longest_match(input, input_size, current_pos);
-        
+        LZ77Match match = lz77_find_match_chain(&mf, input, input_size, current_pos, &params);
+
         if (match.length >= MIN_MATCH_LENGTH) {
             // Found a match - encode it
-            write_lz77_token(output, output_size, &output_capacity, 
+            write_lz77_token(output, output_size, &output_capacity,
                            match.offset, match.length, 0);
-            current_pos += match.length;
+            long end = current_pos + match.length;
+            for (; current_pos < end; current_pos++) {
+                if (current_pos < hash_end) lz77_insert(&mf, input, current_pos);
+            }
         } else {
             // No match found, output literal
-            write_lz77_token(output, output_size, &output_capacity, 
+            write_lz77_token(output, output_size, &output_capacity,
                            0, 0, input[current_pos]);
+            if (current_pos < hash_end) lz77_insert(&mf, input, current_pos);
             current_pos++;
         }
     }
-    
+
+    comp_free(mf.head);
+    comp_free(mf.prev);
+
     // FORCE-COMPRESS: Keep compressed output even if not smaller
     // Minimal-reduction warning is handled by higher-level compressor logic
-    
+
+    return 0;
+}
+
+// Reference compressor using the exhaustive window search (benchmarks only)
+int lz77_compress_reference(const unsigned char* input, long input_size, unsigned char** output, long* output_size) {
+    if (!input || input_size <= 0) return -1;
+    long output_capacity = 5 + 2 * input_size + 4;
+    *output = (unsigned char*)comp_malloc(output_capacity);
+    if (!*output) return -1;
+    *output_size = 0;
+    (*output)[(*output_size)++] = 0x01;
+    for (int i = 3; i >= 0; i--) {
+        (*output)[(*output_size)++] = (input_size >> (i * 8)) & 0xFF;
+    }
+    long current_pos = 0;
+    while (current_pos < input_size) {
+        LZ77Match match = find_longest_match(input, input_size, current_pos);
+        if (match.length >= MIN_MATCH_LENGTH) {
+            write_lz77_token(output, output_size, &output_capacity, match.offset, match.length, 0);
+            current_pos += match.length;
+        } else {
+            write_lz77_token(output, output_size, &output_capacity, 0, 0, input[current_pos]);
+            current_pos++;
+        }
+    }
+    return 0;
+}
+
+// LZ77 compression function at the default (normal) search effort
+int lz77_compress(const unsigned char* input, long input_size, unsigned char** output, long* output_size) {
+    return lz77_compress_level(input, input_size, output, output_size, COMPRESSION_LEVEL_NORMAL);
+}
+
+// ===== LZ77 v2: wide window, long matches =====
+// Layout: 0x02 | window log | original size (LEB128) | sequences
+// Sequence: token (literal run << 4 | match length - 4, each nibble 15 =
+// "LEB128 extension follows") | literal run extension | literals |
+// offset (LEB128) | match length extension. The final sequence stops after
+// its literals once the original size is reached.
+#define LZ77_V2_FLAG 0x02
+#define LZ77_V2_MIN_MATCH 4
+#define LZ77_V2_MAX_MATCH 65535
+#define LZ77_V2_MIN_WINDOW_LOG 16
+#define LZ77_V2_MAX_WINDOW_LOG 20
+#define LZ77_V2_HASH_BITS 16
+#define LZ77_V2_HASH_SIZE (1 << LZ77_V2_HASH_BITS)
+
+typedef struct {
+    int window_log;
+    int max_chain;
+    int nice_length;
+    int lazy_steps;   // 0 greedy, 1 or 2 positions of lookahead before committing
+} LZ77V2Params;
+
+static LZ77V2Params lz77_v2_params(CompressionLevel level) {
+    switch (level) {
+        case COMPRESSION_LEVEL_FAST:  return (LZ77V2Params){ 16, 4, 16, 0 };
+        case COMPRESSION_LEVEL_HIGH:  return (LZ77V2Params){ 19, 48, 128, 2 };
+        case COMPRESSION_LEVEL_ULTRA: return (LZ77V2Params){ 20, 128, 256, 2 };
+        case COMPRESSION_LEVEL_NORMAL:
+        default:                      return (LZ77V2Params){ 18, 16, 64, 1 };
+    }
+}
+
+typedef struct {
+    int32_t* head;
+    int32_t* prev;
+    long window;
+    long mask;
+    long next_insert;   // first position not yet in the chains
+} LZ77V2Finder;
+
+static inline uint32_t lz77_v2_hash4(const unsigned char* p) {
+    uint32_t v = ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+    return (v * 2654435761u) >> (32 - LZ77_V2_HASH_BITS);
+}
+
+// Insert every position before `pos` that still has 4 bytes to hash
+static inline void lz77_v2_insert_upto(LZ77V2Finder* mf, const unsigned char* data, long data_size, long pos) {
+    long limit = data_size - (LZ77_V2_MIN_MATCH - 1);
+    if (pos > limit) pos = limit;
+    for (long p = mf->next_insert; p < pos; p++) {
+        uint32_t h = lz77_v2_hash4(data + p);
+        mf->prev[p & mf->mask] = mf->head[h];
+        mf->head[h] = (int32_t)p;
+    }
+    if (pos > mf->next_insert) mf->next_insert = pos;
+}
+
+// Length of the common prefix of a and b, compared a word at a time
+static inline long lz77_common_length(const unsigned char* a, const unsigned char* b, long max_len) {
+    long n = 0;
+    while (n + 8 <= max_len) {
+        uint64_t x, y;
+        memcpy(&x, a + n, 8);
+        memcpy(&y, b + n, 8);
+        if (x != y) break;
+        n += 8;
+    }
+    while (n < max_len && a[n] == b[n]) n++;
+    return n;
+}
+
+static LZ77Match lz77_v2_find_match(LZ77V2Finder* mf, const unsigned char* data, long data_size,
+                                    long pos, const LZ77V2Params* params, int max_chain) {
+    LZ77Match match = {0, 0, 0};
+    if (pos + LZ77_V2_MIN_MATCH > data_size) return match;
+    lz77_v2_insert_upto(mf, data, data_size, pos);
+
+    long max_len = data_size - pos;
+    if (max_len > LZ77_V2_MAX_MATCH) max_len = LZ77_V2_MAX_MATCH;
+    long window_start = (pos >= mf->window) ? pos - mf->window : 0;
+    const unsigned char* cur = data + pos;
+    long best_length = LZ77_V2_MIN_MATCH - 1;
+    int chain = max_chain;
+
+    long cand = mf->head[lz77_v2_hash4(cur)];
+    while (cand >= window_start && cand < pos && chain-- > 0) {
+        const unsigned char* ref = data + cand;
+        if (ref[best_length] == cur[best_length] && ref[0] == cur[0] && ref[1] == cur[1]) {
+            long length = lz77_common_length(ref, cur, max_len);
+            if (length > best_length) {
+                best_length = length;
+                match.offset = (int)(pos - cand);
+                if (length >= params->nice_length || length == max_len) break;
+            }
+        }
+        long next = mf->prev[cand & mf->mask];
+        if (next >= cand) break;
+        cand = next;
+    }
+    if (best_length >= LZ77_V2_MIN_MATCH) match.length = (int)best_length;
+    else match.offset = 0;
+    return match;
+}
+
+static inline long lz77_put_varint(unsigned char* out, long pos, unsigned long v) {
+    while (v >= 0x80) {
+        out[pos++] = (unsigned char)(v | 0x80);
+        v >>= 7;
+    }
+    out[pos++] = (unsigned char)v;
+    return pos;
+}
+
+// Emit one sequence; match_length 0 marks the trailing literal-only sequence
+static long lz77_v2_put_sequence(unsigned char* out, long pos, const unsigned char* literals, long literal_count,
+                                 long offset, long match_length) {
+    long ml = match_length ? match_length - LZ77_V2_MIN_MATCH : 0;
+    unsigned char token = (unsigned char)(((literal_count < 15 ? literal_count : 15) << 4) | (ml < 15 ? ml : 15));
+    out[pos++] = token;
+    if (literal_count >= 15) pos = lz77_put_varint(out, pos, (unsigned long)(literal_count - 15));
+    memcpy(out + pos, literals, literal_count);
+    pos += literal_count;
+    if (match_length) {
+        pos = lz77_put_varint(out, pos, (unsigned long)offset);
+        if (ml >= 15) pos = lz77_put_varint(out, pos, (unsigned long)(ml - 15));
+    }
+    return pos;
+}
+
+// Worst case: a sequence whose literal run needs an extension covers at
+// least 19 bytes and grows them by at most one, plus header and tail
+long lz77_compress_bound(long input_size) {
+    if (input_size < 0) return 0;
+    return input_size + input_size / 16 + 32;
+}
+
+// Window for the level, no wider than the input needs
+static int lz77_v2_window_log(long input_size, CompressionLevel level) {
+    int window_log = lz77_v2_params(level).window_log;
+    while (window_log > LZ77_V2_MIN_WINDOW_LOG && (1L << (window_log - 1)) >= input_size) window_log--;
+    return window_log;
+}
+
+// Peak bytes lz77_compress_v2 allocates beyond the input: output, hash
+// heads and one chain link per window position
+size_t lz77_v2_memory_cost(long input_size, CompressionLevel level) {
+    if (input_size <= 0) return 0;
+    return (size_t)lz77_compress_bound(input_size) + LZ77_V2_HASH_SIZE * sizeof(int32_t) +
+           ((size_t)1 << lz77_v2_window_log(input_size, level)) * sizeof(int32_t);
+}
+
+// LZ77 v2 compression: window, chain depth, nice length and lazy
+// evaluation depth follow the compression level
+int lz77_compress_into(const unsigned char* input, long input_size, unsigned char* dst, long dst_cap,
+                       long* written, CompressionLevel level) {
+    return lz77_compress_into_arena(input, input_size, dst, dst_cap, written, level, NULL);
+}
+
+// Same, with the match-finder tables taken from arena when one is given;
+// they stay allocated until the caller resets it
+int lz77_compress_into_arena(const unsigned char* input, long input_size, unsigned char* dst, long dst_cap,
+                             long* written, CompressionLevel level, CompArena* arena) {
+    if (!input || input_size <= 0 || !dst || !written) return -1;
+    if (dst_cap < lz77_compress_bound(input_size)) return -1;
+
+    LZ77V2Params params = lz77_v2_params(level);
+    int window_log = lz77_v2_window_log(input_size, level);
+
+    LZ77V2Finder mf;
+    mf.window = 1L << window_log;
+    mf.mask = mf.window - 1;
+    mf.next_insert = 0;
+    if (arena) {
+        mf.head = (int32_t*)comp_arena_alloc(arena, LZ77_V2_HASH_SIZE * sizeof(int32_t));
+        mf.prev = (int32_t*)comp_arena_alloc(arena, mf.window * sizeof(int32_t));
+        if (!mf.head || !mf.prev) return -1;
+    } else {
+        mf.head = (int32_t*)comp_malloc(LZ77_V2_HASH_SIZE * sizeof(int32_t));
+        mf.prev = (int32_t*)comp_malloc(mf.window * sizeof(int32_t));
+        if (!mf.head || !mf.prev) {
+            comp_free(mf.head);
+            comp_free(mf.prev);
+            return -1;
+        }
+    }
+    unsigned char* out = dst;
+    memset(mf.head, 0xFF, LZ77_V2_HASH_SIZE * sizeof(int32_t));
+
+    long op = 0;
+    out[op++] = LZ77_V2_FLAG;
+    out[op++] = (unsigned char)window_log;
+    op = lz77_put_varint(out, op, (unsigned long)input_size);
+
+    long anchor = 0;   // first byte not yet covered by a sequence
+    long pos = 0;
+    while (pos < input_size) {
+        LZ77Match cur = lz77_v2_find_match(&mf, input, input_size, pos, &params, params.max_chain);
+        // A 4-byte match behind a 3-byte offset saves nothing
+        if (cur.length == LZ77_V2_MIN_MATCH && cur.offset >= (1 << 14)) cur.length = 0;
+        if (cur.length < LZ77_V2_MIN_MATCH) {
+            pos++;
+            continue;
+        }
+
+        // Lazy evaluation: give up this match for a longer one starting at
+        // one of the next positions; a decent match only gets a quarter of
+        // the chain budget to beat
+        for (int step = 0; step < params.lazy_steps && cur.length < params.nice_length; step++) {
+            int chain = (cur.length >= 16) ? (params.max_chain >> 2) + 1 : params.max_chain;
+            LZ77Match next = lz77_v2_find_match(&mf, input, input_size, pos + 1, &params, chain);
+            if (next.length <= cur.length) break;
+            pos++;
+            cur = next;
+        }
+
+        op = lz77_v2_put_sequence(out, op, input + anchor, pos - anchor, cur.offset, cur.length);
+        pos += cur.length;
+        anchor = pos;
+    }
+    if (anchor < input_size) {
+        op = lz77_v2_put_sequence(out, op, input + anchor, input_size - anchor, 0, 0);
+    }
+
+    if (!arena) {
+        comp_free(mf.head);
+        comp_free(mf.prev);
+    }
+    *written = op;
+    return 0;
+}
+
+int lz77_compress_v2(const unsigned char* input, long input_size, unsigned char** output, long* output_size,
+                     CompressionLevel level) {
+    if (!input || input_size <= 0) return -1;
+    long cap = lz77_compress_bound(input_size);
+    unsigned char* out = (unsigned char*)comp_malloc(cap);
+    if (!out) return -1;
+    if (lz77_compress_into(input, input_size, out, cap, output_size, level) != 0) {
+        comp_free(out);
+        return -1;
+    }
+    *output = out;
+    return 0;
+}
+
+static inline int lz77_get_varint(const unsigned char* in, long in_size, long* pos, unsigned long* v) {
+    unsigned long result = 0;
+    for (int shift = 0; shift <= 56; shift += 7) {
+        if (*pos >= in_size) return -1;
+        unsigned char b = in[(*pos)++];
+        result |= (unsigned long)(b & 0x7F) << shift;
+        if (!(b & 0x80)) {
+            *v = result;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+// ===== Decoder copy primitives =====
+// Output buffers carry LZ77_WILDCOPY_SLACK spare bytes so matches and short
+// literal runs can be copied in whole 16-byte chunks past their end.
+#define LZ77_WILDCOPY_SLACK 32
+
+static inline void lz77_copy16(unsigned char* dst, const unsigned char* src) {
+    memcpy(dst, src, 16);
+}
+
+// Copy a match of len bytes from offset bytes back. The caller guarantees
+// op + len <= size, so any overrun lands in the slack.
+static inline void lz77_copy_match(unsigned char* dst, long offset, long len) {
+    const unsigned char* src = dst - offset;
+    if (offset >= 16) {
+        // Each chunk reads bytes written before it starts. Most matches are
+        // short, so the first two chunks are unconditional (32 bytes of
+        // slack are reserved for them).
+        unsigned char* end = dst + len;
+        lz77_copy16(dst, src);
+        lz77_copy16(dst + 16, src + 16);
+        dst += 32;
+        src += 32;
+        while (dst < end) {
+            lz77_copy16(dst, src);
+            dst += 16;
+            src += 16;
+        }
+        return;
+    }
+    if (offset == 1) {
+        memset(dst, src[0], len);
+        return;
+    }
+    // Overlapping: lay down the first 16 bytes one at a time, then copy 8
+    // bytes at a time from a whole number of periods back (8..15 bytes)
+    for (int i = 0; i < 16; i++) dst[i] = src[i];
+    long period = offset * ((8 + offset - 1) / offset);
+    for (long k = 16; k < len; k += 8) {
+        memcpy(dst + k, dst + k - period, 8);
+    }
+}
+
+// Byte-exact match copy for the end of a caller's buffer, which has no slack
+static inline void lz77_copy_match_exact(unsigned char* dst, long offset, long len) {
+    const unsigned char* src = dst - offset;
+    for (long i = 0; i < len; i++) dst[i] = src[i];
+}
+
+// Parse a v2 header; *ip is left at the first sequence
+static int lz77_v2_header(const unsigned char* input, long input_size, long* ip, long* size) {
+    *ip = 1;
+    if (*ip >= input_size) return -1;
+    int window_log = input[(*ip)++];
+    if (window_log < LZ77_V2_MIN_WINDOW_LOG || window_log > LZ77_V2_MAX_WINDOW_LOG) return -1;
+    unsigned long v;
+    if (lz77_get_varint(input, input_size, ip, &v) != 0 || v == 0 || v > (unsigned long)LONG_MAX) return -1;
+    // Every match costs at least a token and an offset byte, which caps the
+    // expansion a stream of this size can describe
+    if (v / LZ77_V2_MAX_MATCH > (unsigned long)input_size) return -1;
+    *size = (long)v;
+    return 0;
+}
+
+// Decode v2 sequences into out[0..total); out holds cap bytes, and the
+// chunked copies are used wherever they cannot run past it
+static int lz77_decode_v2(const unsigned char* input, long input_size, long ip, unsigned char* out, long total,
+                          long cap) {
+    long op = 0;
+    while (op < total) {
+        if (ip >= input_size) return -1;
+        unsigned char token = input[ip++];
+        unsigned long lit = token >> 4;
+        if (lit == 15) {
+            unsigned long ext;
+            if (lz77_get_varint(input, input_size, &ip, &ext) != 0) return -1;
+            lit += ext;
+        }
+        if (lit > (unsigned long)(input_size - ip) || lit > (unsigned long)(total - op)) return -1;
+        if (lit <= 16 && ip + 16 <= input_size && op + 16 <= cap) {
+            lz77_copy16(out + op, input + ip);
+        } else {
+            memcpy(out + op, input + ip, lit);
+        }
+        ip += (long)lit;
+        op += (long)lit;
+        if (op == total) break;
+
+        unsigned long offset, len = token & 0x0F;
+        if (ip + 2 <= input_size && input[ip] < 0x80) {
+            offset = input[ip++];
+        } else if (ip + 2 <= input_size && input[ip + 1] < 0x80) {
+            offset = (input[ip] & 0x7Fu) | ((unsigned long)input[ip + 1] << 7);
+            ip += 2;
+        } else if (lz77_get_varint(input, input_size, &ip, &offset) != 0) {
+            return -1;
+        }
+        if (len == 15) {
+            unsigned long ext;
+            if (lz77_get_varint(input, input_size, &ip, &ext) != 0) return -1;
+            len += ext;
+        }
+        len += LZ77_V2_MIN_MATCH;
+        if (len > LZ77_V2_MAX_MATCH || offset == 0 || offset > (unsigned long)op || len > (unsigned long)(total - op)) return -1;
+
+        if (op + (long)len + LZ77_WILDCOPY_SLACK <= cap) {
+            lz77_copy_match(out + op, (long)offset, (long)len);
+        } else {
+            lz77_copy_match_exact(out + op, (long)offset, (long)len);
+        }
+        op += (long)len;
+    }
+    return 0;
+}
+
+static int lz77_decompress_v2(const unsigned char* input, long input_size, unsigned char** output, long* output_size) {
+    long ip, total;
+    if (lz77_v2_header(input, input_size, &ip, &total) != 0) return -1;
+
+    unsigned char* out = (unsigned char*)tracked_malloc(total + LZ77_WILDCOPY_SLACK);
+    if (!out) return -1;
+    if (lz77_decode_v2(input, input_size, ip, out, total, total + LZ77_WILDCOPY_SLACK) != 0) {
+        tracked_free(out, total);
+        return -1;
+    }
+    *output = out;
+    *output_size = total;
     return 0;
 }
 
@@ -157,9 +678,10 @@ int read_lz77_token(const unsigned char* input, long input_size, long* pos,
         *next_char = input[(*pos)++];
     } else if (first_byte == 0xFF) {
         // Long match: 0xFF + length + offset(2bytes)
-        if (*pos + 3 >= input_size) return -1;
-        *length = input[(*pos)++] + MIN_MATCH_LENGTH;
-        *offset = (input[(*pos)++] << 8) | input[(*pos)++];
+        if (*pos + 3 > input_size) return -1;
+        *length = input[*pos] + MIN_MATCH_LENGTH;
+        *offset = (input[*pos + 1] << 8) | input[*pos + 2];
+        *pos += 3;
         *next_char = 0; // Not used in new format
     } else {
         // Short match: 0x81 + length(4bits) + offset(1byte)
@@ -172,82 +694,108 @@ int read_lz77_token(const unsigned char* input, long input_size, long* pos,
     return 0;
 }
 
-// Optimized LZ77 decompression with enhanced sliding window
-int lz77_decompress_optimized(const unsigned char* input, long input_size, unsigned char** output, long* output_size) {
-    if (!input || input_size < 5) return -1;
-    
-    // Check compression flag
-    unsigned char compression_flag = input[0];
-    
+// Original size from a v1 header (flag 0x01 + BE32 size)
+static int lz77_v1_header(const unsigned char* input, long input_size, long* size) {
+    if (input_size < 5) return -1;
     // FORCE-COMPRESS: reject raw stored blocks
-    if (compression_flag == 0x00) {
-        return -1;
-    }
-    
-    // Read original size from header (4 bytes)
-    *output_size = 0;
+    if (input[0] == 0x00) return -1;
+
+    long total = 0;
     for (int i = 0; i < 4; i++) {
-        *output_size = (*output_size << 8) | input[i + 1];
+        total = (total << 8) | input[i + 1];
     }
+    // The longest v1 token (4 bytes) expands to 258 bytes
+    if (total <= 0 || total / 65 > input_size) return -1;
+    *size = total;
+    return 0;
+}
+
+// Decode v1 tokens into out[0..total); out holds cap bytes
+static int lz77_decode_v1(const unsigned char* input, long input_size, unsigned char* out, long total, long cap) {
+    long op = 0;
+    long ip = 5; // Skip header (1 byte flag + 4 bytes size)
     
-    // Pre-allocate output buffer with extra safety margin
-    *output = (unsigned char*)tracked_malloc(*output_size + 1024);
-    if (!*output) return -1;
-    
-    long current_pos = 0;
-    long input_pos = 5; // Skip header (1 byte flag + 4 bytes size)
-    
-    // Optimized token processing with batch operations
-    while (input_pos < input_size && current_pos < *output_size) {
-        int offset, length;
-        unsigned char next_char;
+    while (op < total) {
+        if (ip >= input_size) return -1;
+        unsigned char first_byte = input[ip++];
         
-        // Use the standard function instead of the optimized one that's not defined
-        if (read_lz77_token(input, input_size, &input_pos, &offset, &length, &next_char) != 0) {
-            return -1;
+        if (first_byte < 0x80) {
+            // Direct literal character
+            out[op++] = first_byte;
+            continue;
         }
         
-        if (length == 0) {
-            // Literal character - direct copy
-            if (current_pos >= *output_size) return -1;
-            (*output)[current_pos++] = next_char;
+        long offset, length;
+        if (first_byte == 0x80) {
+            // Escaped literal character (>= 128)
+            if (ip >= input_size) return -1;
+            out[op++] = input[ip++];
+            continue;
+        } else if (first_byte == 0xFF) {
+            // Long match: 0xFF + length + offset(2bytes)
+            if (ip + 3 > input_size) return -1;
+            length = input[ip] + MIN_MATCH_LENGTH;
+            offset = ((long)input[ip + 1] << 8) | input[ip + 2];
+            ip += 3;
         } else {
-            // Copy from sliding window with optimized memory operations
-            long copy_start = current_pos - offset;
-            
-            // Validate back-reference
-            if (offset <= 0 || copy_start < 0 || copy_start >= current_pos) {
-                return -1;
-            }
-            if (current_pos + length > *output_size) {
-                // Prevent writing beyond declared original size
-                return -1;
-            }
-
-            if (copy_start >= 0 && copy_start < current_pos) {
-                // Optimized copying for overlapping regions
-                if (offset >= length) {
-                    // Non-overlapping copy - use fast memcpy
-                    memcpy(*output + current_pos, *output + copy_start, length);
-                    current_pos += length;
-                } else {
-                    // Overlapping copy - optimized byte-by-byte with pattern detection
-                    for (int i = 0; i < length; i++) {
-                        (*output)[current_pos] = (*output)[copy_start + (i % offset)];
-                        current_pos++;
-                    }
-                }
-            } else {
-                // Handle edge case - skip invalid reference
-                return -1;
-            }
+            // Short match: 0x81 + length(4bits) + offset(1byte)
+            if (ip >= input_size) return -1;
+            length = ((first_byte & 0x1E) >> 1) + MIN_MATCH_LENGTH;
+            offset = input[ip++];
+        }
+        
+        // One bounds check per token covers the whole copy
+        if (offset <= 0 || offset > op || length > total - op) return -1;
+        if (op + length + LZ77_WILDCOPY_SLACK <= cap) {
+            lz77_copy_match(out + op, offset, length);
+        } else {
+            lz77_copy_match_exact(out + op, offset, length);
         }
+        op += length;
     }
-    
-    // Adjust output size to actual decompressed size
-    if (current_pos != *output_size) {
+    return 0;
+}
+
+// LZ77 decompression: dispatches v2 streams, decodes v1 tokens into an
+// output buffer sized once from the header
+int lz77_decompress_optimized(const unsigned char* input, long input_size, unsigned char** output, long* output_size) {
+    if (!input || input_size < 3) return -1;
+    if (input[0] == LZ77_V2_FLAG) {
+        return lz77_decompress_v2(input, input_size, output, output_size);
+    }
+
+    long total;
+    if (lz77_v1_header(input, input_size, &total) != 0) return -1;
+    unsigned char* out = (unsigned char*)tracked_malloc(total + LZ77_WILDCOPY_SLACK);
+    if (!out) return -1;
+    if (lz77_decode_v1(input, input_size, out, total, total + LZ77_WILDCOPY_SLACK) != 0) {
+        tracked_free(out, total);
         return -1;
     }
+    *output = out;
+    *output_size = total;
+    return 0;
+}
+
+long lz77_decompressed_size(const unsigned char* input, long input_size) {
+    if (!input || input_size < 3) return -1;
+    long ip, total;
+    int r = (input[0] == LZ77_V2_FLAG) ? lz77_v2_header(input, input_size, &ip, &total)
+                                       : lz77_v1_header(input, input_size, &total);
+    return r == 0 ? total : -1;
+}
+
+int lz77_decompress_into(const unsigned char* input, long input_size, unsigned char* dst, long dst_cap,
+                         long* written) {
+    if (!input || !dst || !written || input_size < 3) return -1;
+    long ip = 0, total;
+    int v2 = (input[0] == LZ77_V2_FLAG);
+    int r = v2 ? lz77_v2_header(input, input_size, &ip, &total) : lz77_v1_header(input, input_size, &total);
+    if (r != 0 || total > dst_cap) return -1;
+    r = v2 ? lz77_decode_v2(input, input_size, ip, dst, total, dst_cap)
+           : lz77_decode_v1(input, input_size, dst, total, dst_cap);
+    if (r != 0) return -1;
+    *written = total;
     return 0;
 }
 
@@ -271,9 +819,10 @@ int read_lz77_token_optimized(const unsigned char* input, long input_size, long*
         *next_char = input[(*pos)++];
     } else if (first_byte == 0xFF) {
         // Long match: 0xFF + length + offset(2bytes)
-        if (*pos + 3 >= input_size) return -1;
-        *length = input[(*pos)++] + MIN_MATCH_LENGTH;
-        *offset = (input[(*pos)++] << 8) | input[(*pos)++];
+        if (*pos + 3 > input_size) return -1;
+        *length = input[*pos] + MIN_MATCH_LENGTH;
+        *offset = (input[*pos + 1] << 8) | input[*pos + 2];
+        *pos += 3;
         *next_char = 0; // Not used in new format
     } else {
         // Short match: 0x81 + length(4bits) + offset(1byte)
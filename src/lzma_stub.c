@@ -7,6 +7,11 @@ size_t lzma_compress(const uint8_t* in, size_t in_len, uint8_t* out, size_t out_
     return 0;
 }
 
+size_t lzma_memory_cost(size_t in_len) {
+    (void)in_len;
+    return 0;
+}
+
 size_t lzma_decompress(const uint8_t* in, size_t in_len, uint8_t* out, size_t out_cap) {
     (void)in; (void)in_len; (void)out; (void)out_cap;
     return 0;
@@ -1,6 +1,7 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include "../include/comp_alloc.h"
 
 // Minimal types mirroring LZMA SDK prototypes
 typedef unsigned char Byte;
@@ -23,12 +24,12 @@ typedef struct ISzAlloc {
 
 static void *SzAlloc(ISzAlloc *p, size_t size) {
     (void)p;
-    return malloc(size);
+    return comp_malloc(size);
 }
 
 static void SzFree(ISzAlloc *p, void *address) {
     (void)p;
-    free(address);
+    comp_free(address);
 }
 
 // Encoder properties (layout must match LZMA SDK)
@@ -59,6 +60,7 @@ size_t lzma_compress(const uint8_t* in, size_t in_len,
 
 size_t lzma_decompress(const uint8_t* in, size_t in_len,
                        uint8_t* out, size_t out_cap);
+size_t lzma_memory_cost(size_t in_len);
 
 #define ONE_MB (1024u * 1024u)
 #define DICT_SMALL (64u * 1024u * 1024u)
@@ -103,6 +105,14 @@ size_t lzma_compress(const uint8_t* in, size_t in_len,
     return (size_t)(propsSize + destLen);
 }
 
+// Peak bytes lzma_compress allocates: the encoder sizes its match finder
+// from the dictionary, not the input, at roughly 11.5 bytes per dictionary
+// byte for the level 9 binary-tree finder
+size_t lzma_memory_cost(size_t in_len) {
+    size_t dict = (in_len >= (16u * 1024u * 1024u)) ? DICT_LARGE : DICT_SMALL;
+    return dict * 23 / 2 + 4 * ONE_MB;
+}
+
 size_t lzma_decompress(const uint8_t* in, size_t in_len,
                        uint8_t* out, size_t out_cap) {
     if (!in || !out) return 0;
@@ -1,7 +1,155 @@
 #include "../include/compressor.h"
 
-// FORCE-COMPRESS: LZW stub disabled; do not allow raw passthrough
+// LZW stream: version byte | max code width | original size (LEB128) | codes
+// Codes are packed MSB-first. Code 256 clears the dictionary and new
+// entries start at 257. The width starts at 9 bits and grows to 16 as the
+// dictionary fills, so each code is as wide as the largest code that could
+// appear at that point. The decoder in missing_functions.c mirrors this.
+#define LZW_VERSION 0x01
+#define LZW_MIN_BITS 9
+#define LZW_MAX_BITS 16
+#define LZW_CLEAR_CODE 256
+#define LZW_FIRST_CODE 257
+#define LZW_MAX_CODES (1 << LZW_MAX_BITS)
+
+// Open-addressing dictionary keyed by (prefix code << 8 | byte); twice the
+// code space keeps the load factor at or below one half
+#define LZW_HASH_BITS (LZW_MAX_BITS + 1)
+#define LZW_HASH_SIZE (1 << LZW_HASH_BITS)
+
+// Once the dictionary is full, compare the ratio since the last reset at
+// this input interval and clear it when the ratio drops
+#define LZW_CHECK_INTERVAL (16 * 1024)
+
+typedef struct {
+    uint32_t* keys;      // key + 1, 0 = empty slot
+    uint16_t* codes;
+    int next_code;
+} LZWDict;
+
+typedef struct {
+    unsigned char* out;
+    long pos;
+    uint64_t acc;
+    int bits;
+} LZWBitWriter;
+
+static inline uint32_t lzw_hash(uint32_t key) {
+    return (key * 2654435761u) >> (32 - LZW_HASH_BITS);
+}
+
+static void lzw_dict_reset(LZWDict* dict) {
+    memset(dict->keys, 0, LZW_HASH_SIZE * sizeof(uint32_t));
+    dict->next_code = LZW_FIRST_CODE;
+}
+
+// Returns the slot for key: either holding it or the empty slot where it
+// would be inserted
+static inline uint32_t lzw_dict_probe(const LZWDict* dict, uint32_t key) {
+    uint32_t slot = lzw_hash(key);
+    while (dict->keys[slot] && dict->keys[slot] != key + 1) {
+        slot = (slot + 1) & (LZW_HASH_SIZE - 1);
+    }
+    return slot;
+}
+
+static inline int lzw_code_width(int next_code) {
+    int width = LZW_MIN_BITS;
+    while (width < LZW_MAX_BITS && (next_code - 1) >> width) width++;
+    return width;
+}
+
+static inline void lzw_put_code(LZWBitWriter* bw, uint32_t code, int width) {
+    bw->acc = (bw->acc << width) | code;
+    bw->bits += width;
+    while (bw->bits >= 8) {
+        bw->bits -= 8;
+        bw->out[bw->pos++] = (unsigned char)(bw->acc >> bw->bits);
+    }
+}
+
+// Worst case: one 16-bit code per input byte
+static long lzw_bound(long input_size) {
+    return 2 + 10 + input_size * 2 + 8;
+}
+
+// Peak bytes lzw_compress allocates beyond the input
+size_t lzw_memory_cost(long input_size) {
+    if (input_size <= 0) return 0;
+    return (size_t)lzw_bound(input_size) + LZW_HASH_SIZE * (sizeof(uint32_t) + sizeof(uint16_t));
+}
+
 int lzw_compress(const unsigned char* input, long input_size, unsigned char** output, long* output_size) {
-    (void)input; (void)input_size; (void)output; (void)output_size;
-    return -1;
-}
\ No newline at end of file
+    if (!input || input_size <= 0 || !output || !output_size) return -1;
+
+    LZWDict dict;
+    dict.keys = (uint32_t*)comp_malloc(LZW_HASH_SIZE * sizeof(uint32_t));
+    dict.codes = (uint16_t*)comp_malloc(LZW_HASH_SIZE * sizeof(uint16_t));
+    unsigned char* out = (unsigned char*)comp_malloc(lzw_bound(input_size));
+    if (!dict.keys || !dict.codes || !out) {
+        comp_free(dict.keys);
+        comp_free(dict.codes);
+        comp_free(out);
+        return -1;
+    }
+    lzw_dict_reset(&dict);
+
+    LZWBitWriter bw = { out, 0, 0, 0 };
+    out[bw.pos++] = LZW_VERSION;
+    out[bw.pos++] = LZW_MAX_BITS;
+    unsigned long v = (unsigned long)input_size;
+    while (v >= 0x80) {
+        out[bw.pos++] = (unsigned char)(v | 0x80);
+        v >>= 7;
+    }
+    out[bw.pos++] = (unsigned char)v;
+
+    // Ratio bookkeeping since the last reset (input bytes per output byte, x256)
+    long reset_in = 0;
+    long reset_out_bits = 0;
+    long next_check = 0;
+    long last_ratio = 0;
+
+    uint32_t prefix = input[0];
+    for (long i = 1; i < input_size; i++) {
+        unsigned char c = input[i];
+        uint32_t key = (prefix << 8) | c;
+        uint32_t slot = lzw_dict_probe(&dict, key);
+        if (dict.keys[slot]) {
+            prefix = dict.codes[slot];
+            continue;
+        }
+
+        int width = lzw_code_width(dict.next_code);
+        lzw_put_code(&bw, prefix, width);
+        reset_out_bits += width;
+        if (dict.next_code < LZW_MAX_CODES) {
+            dict.keys[slot] = key + 1;
+            dict.codes[slot] = (uint16_t)dict.next_code++;
+            if (dict.next_code == LZW_MAX_CODES) next_check = i + LZW_CHECK_INTERVAL;
+        } else if (i >= next_check) {
+            // Dictionary is full: keep it while the ratio holds, otherwise
+            // start over so it can adapt to the current data
+            long ratio = ((i - reset_in) * 256 * 8) / (reset_out_bits ? reset_out_bits : 1);
+            if (ratio < last_ratio) {
+                lzw_put_code(&bw, LZW_CLEAR_CODE, width);
+                lzw_dict_reset(&dict);
+                reset_in = i;
+                reset_out_bits = 0;
+                last_ratio = 0;
+            } else {
+                last_ratio = ratio;
+                next_check = i + LZW_CHECK_INTERVAL;
+            }
+        }
+        prefix = c;
+    }
+    lzw_put_code(&bw, prefix, lzw_code_width(dict.next_code));
+    if (bw.bits > 0) out[bw.pos++] = (unsigned char)(bw.acc << (8 - bw.bits));
+
+    comp_free(dict.keys);
+    comp_free(dict.codes);
+    *output = out;
+    *output_size = bw.pos;
+    return 0;
+}
@@ -1,5 +1,13 @@
 #include "../include/compressor.h"
+#include "../include/comp_stream.h"
 #include <setjmp.h>
+#include <errno.h>
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#else
+#include <unistd.h>
+#endif
 
 // Forward declaration for GUI
 int StartGUI();
@@ -8,11 +16,97 @@ int StartGUI();
 extern jmp_buf g_panic_buf;
 extern void comp_check_leaks(void);
 
+// Byte count with an optional K, M or G suffix (binary units); 0 if malformed
+static size_t parse_memory_size(const char* text) {
+    char* end = NULL;
+    unsigned long long value = strtoull(text, &end, 10);
+    if (end == text) return 0;
+    switch (*end) {
+        case 'k': case 'K': value <<= 10; end++; break;
+        case 'm': case 'M': value <<= 20; end++; break;
+        case 'g': case 'G': value <<= 30; end++; break;
+        default: break;
+    }
+    return (*end == '\0') ? (size_t)value : 0;
+}
+
+// Unsigned decimal or 0x-prefixed number filling the whole argument;
+// returns 0, or -1 if malformed (strtoull alone takes "abc" as 0 and
+// wraps "-1")
+static int parse_u64_arg(const char* text, unsigned long long* value) {
+    char* end = NULL;
+    while (*text == ' ' || *text == '\t') text++;
+    if (*text == '-' || *text == '+') return -1;
+    errno = 0;
+    *value = strtoull(text, &end, 0);
+    return (end == text || *end != '\0' || errno == ERANGE) ? -1 : 0;
+}
+
+// Algorithm name accepted by --stream-compress; -1 if unknown
+static int parse_stream_algo(const char* name) {
+    if (strcmp(name, "deflate") == 0) return ALGO_DEFLATE;
+    if (strcmp(name, "lz77") == 0) return ALGO_LZ77;
+    if (strcmp(name, "blockwise") == 0) return ALGO_BLOCKWISE;
+    return -1;
+}
+
+// Open a stream endpoint; "-" is stdin or stdout. When the stream goes to
+// stdout, the descriptor is moved aside and stdout is pointed at stderr, so
+// progress messages from the codecs cannot end up inside the stream.
+static FILE* open_stream_endpoint(const char* path, int for_output) {
+    if (strcmp(path, "-") != 0) return fopen(path, for_output ? "wb" : "rb");
+#ifdef _WIN32
+    _setmode(_fileno(for_output ? stdout : stdin), _O_BINARY);
+    if (!for_output) return stdin;
+    fflush(stdout);
+    int fd = _dup(_fileno(stdout));
+    if (fd < 0) return NULL;
+    _dup2(_fileno(stderr), _fileno(stdout));
+    return _fdopen(fd, "wb");
+#else
+    if (!for_output) return stdin;
+    fflush(stdout);
+    int fd = dup(STDOUT_FILENO);
+    if (fd < 0) return NULL;
+    dup2(STDERR_FILENO, STDOUT_FILENO);
+    return fdopen(fd, "wb");
+#endif
+}
+
+// --stream-compress / --stream-decompress: input to output in constant
+// memory; messages go to stderr so either end may be a pipe
+static int run_stream(int algo, const char* input, const char* output, int threads) {
+    FILE* in = open_stream_endpoint(input, 0);
+    if (!in) {
+        fprintf(stderr, "✗ Cannot open %s\n", input);
+        return 1;
+    }
+    FILE* out = open_stream_endpoint(output, 1);
+    if (!out) {
+        fprintf(stderr, "✗ Cannot open %s\n", output);
+        if (in != stdin) fclose(in);
+        return 1;
+    }
+    CompressionStats stats;
+    CompResult r;
+    if (algo < 0) {
+        r = decomp_stream_file(in, out, &stats);
+    } else {
+        FileType type = (strcmp(input, "-") == 0) ? FILE_TYPE_UNKNOWN : detect_file_type(input);
+        r = comp_stream_file(in, out, (CompressionAlgorithm)algo, COMPRESSION_LEVEL_HIGH, type, threads, &stats);
+    }
+    if (in != stdin) fclose(in);
+    if (fclose(out) != 0 && r == COMP_SUCCESS) r = COMP_ERR_FILE_WRITE;
+    if (r != COMP_SUCCESS) {
+        fprintf(stderr, "✗ Stream %s failed (error %d)\n", algo < 0 ? "decompression" : "compression", (int)r);
+        return 1;
+    }
+    fprintf(stderr, "✓ %ld -> %ld bytes (%.2f%%)\n", algo < 0 ? stats.compressed_size : stats.original_size,
+            algo < 0 ? stats.original_size : stats.compressed_size, stats.compression_ratio);
+    return 0;
+}
+
 int main(int argc, char* argv[]) {
-    printf("\n=== Professional File Compressor v2.0 ===\n");
-    printf("Advanced Lossless Compression with Multi-Level Settings\n");
-    printf("Supported formats: TXT, PDF, XML, Audio, CSV, JSON, Images\n\n");
-    
     // Set up panic recovery point
     if (setjmp(g_panic_buf) != 0) {
         printf("\n*** PANIC RECOVERY ***\n");
@@ -25,10 +119,78 @@ int main(int argc, char* argv[]) {
     // Register leak detector to run on exit
     atexit(comp_check_leaks);
     
-    // Check for GUI mode
-    if (argc > 1 && strcmp(argv[1], "--gui") == 0) {
-        return StartGUI();
+    // Command-line options: --gui, -j N / --threads N (blockwise workers, 0 = one per CPU),
+    // --max-memory SIZE (cap on compression memory, e.g. 256M),
+    // --extract ARCHIVE OFFSET LENGTH OUTPUT (byte range of a blockwise v5 archive),
+    // --stream-compress deflate|lz77|blockwise INPUT OUTPUT, --stream-decompress INPUT OUTPUT
+    // (constant-memory streams; "-" is stdin/stdout)
+    int threads = 0;
+    size_t max_memory = 0;
+    int stream_algo = -2;   // -2 none, -1 decompress, else the algorithm
+    const char* stream_input = NULL;
+    const char* stream_output = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--gui") == 0) {
+            return StartGUI();
+        } else if (strcmp(argv[i], "--extract") == 0 && i + 4 < argc) {
+            unsigned long long offset = 0, length = 0;
+            if (parse_u64_arg(argv[i + 2], &offset) != 0 || parse_u64_arg(argv[i + 3], &length) != 0) {
+                printf("✗ Invalid offset '%s' or length '%s' (use a non-negative byte count)\n",
+                       argv[i + 2], argv[i + 3]);
+                return 1;
+            }
+            unsigned char* range = NULL;
+            long range_size = 0;
+            CompResult r = decompress_file_range(argv[i + 1], offset, length, &range, &range_size);
+            if (r != COMP_SUCCESS) {
+                printf("✗ Range extraction failed (error %d)\n", (int)r);
+                return 1;
+            }
+            int wr = write_file(argv[i + 4], range, range_size);
+            comp_free(range);
+            if (wr != 0) {
+                printf("✗ Failed to write %s\n", argv[i + 4]);
+                return 1;
+            }
+            printf("✓ Extracted %ld bytes at offset %llu to %s\n", range_size, offset, argv[i + 4]);
+            return 0;
+        } else if (strcmp(argv[i], "--stream-compress") == 0 && i + 3 < argc) {
+            stream_algo = parse_stream_algo(argv[i + 1]);
+            if (stream_algo < 0) {
+                fprintf(stderr, "✗ Unknown stream algorithm '%s' (use deflate, lz77 or blockwise)\n", argv[i + 1]);
+                return 1;
+            }
+            stream_input = argv[i + 2];
+            stream_output = argv[i + 3];
+            i += 3;
+        } else if (strcmp(argv[i], "--stream-decompress") == 0 && i + 2 < argc) {
+            stream_algo = -1;
+            stream_input = argv[i + 1];
+            stream_output = argv[i + 2];
+            i += 2;
+        } else if (strncmp(argv[i], "-j", 2) == 0 && argv[i][2] != '\0') {
+            threads = atoi(argv[i] + 2);
+        } else if ((strcmp(argv[i], "-j") == 0 || strcmp(argv[i], "--threads") == 0) && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--max-memory") == 0 && i + 1 < argc) {
+            max_memory = parse_memory_size(argv[++i]);
+            if (max_memory == 0) {
+                printf("✗ Invalid memory size '%s' (use bytes or a K, M or G suffix)\n", argv[i]);
+                return 1;
+            }
+        } else {
+            printf("Usage: %s [--gui] [-j threads] [--max-memory size] [--extract archive offset length output]\n"
+                   "       %s [-j threads] --stream-compress deflate|lz77|blockwise input output\n"
+                   "       %s --stream-decompress input output    (\"-\" = stdin/stdout)\n",
+                   argv[0], argv[0], argv[0]);
+            return strcmp(argv[i], "--help") == 0 ? 0 : 1;
+        }
     }
+    if (stream_algo != -2) return run_stream(stream_algo, stream_input, stream_output, threads);
+
+    printf("\n=== Professional File Compressor v2.0 ===\n");
+    printf("Advanced Lossless Compression with Multi-Level Settings\n");
+    printf("Supported formats: TXT, PDF, XML, Audio, CSV, JSON, Images\n\n");
     
     int choice;
     char input_path[MAX_PATH_LENGTH];
@@ -82,7 +244,7 @@ int main(int argc, char* argv[]) {
                     printf("This will test multiple algorithms and select the best one.\n");
                     printf("Compression ratio validation ensures no file size increases.\n\n");
                     
-                    if (compress_file_intelligent(dest_path, output_path, level, &stats) == 0) {
+                    if (compress_file_intelligent(dest_path, output_path, level, max_memory, &stats) == 0) {
                         printf("\n✓ File compressed successfully with intelligent algorithm selection!\n");
                         print_compression_stats(&stats);
                     } else {
@@ -90,7 +252,7 @@ int main(int argc, char* argv[]) {
                     }
                 } else if (mode_choice == 2) {
                     // Use hardcore compression
-                    if (compress_file_with_level(dest_path, output_path, algo, level, &stats) == 0) {
+                    if (compress_file_with_level(dest_path, output_path, algo, level, threads, max_memory, &stats) == 0) {
                         printf("\n✓ File compressed successfully with HARDCORE compression!\n");
                         print_compression_stats(&stats);
                     } else {
@@ -105,7 +267,8 @@ int main(int argc, char* argv[]) {
                     printf("4. Audio Advanced (for audio files)\n");
                     printf("5. Image Advanced (for image files)\n");
                     printf("6. HARDCORE (maximum compression)\n");
-                    printf("Enter choice (1-6): ");
+                    printf("7. Blockwise (best algorithm per block, multi-threaded)\n");
+                    printf("Enter choice (1-7): ");
                     
                     int algo_choice = get_user_choice();
                     switch (algo_choice) {
@@ -115,10 +278,11 @@ int main(int argc, char* argv[]) {
                         case 4: algo = ALGO_AUDIO_ADVANCED; break;
                         case 5: algo = ALGO_IMAGE_ADVANCED; break;
                         case 6: algo = ALGO_HARDCORE; break;
+                        case 7: algo = ALGO_BLOCKWISE; break;
                         default: algo = ALGO_HARDCORE; break;
                     }
                     
-                    if (compress_file_with_level(dest_path, output_path, algo, level, &stats) == 0) {
+                    if (compress_file_with_level(dest_path, output_path, algo, level, threads, max_memory, &stats) == 0) {
                         printf("\n✓ File compressed successfully!\n");
                         print_compression_stats(&stats);
                     } else {
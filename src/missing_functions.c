@@ -1,8 +1,120 @@
 #include "../include/compressor.h"
 
-// Provide minimal implementation of lzw_decompress_mfunc referenced by lz77.c
+// LZW decoder for the stream written by lzw_compress (src/lzw_compress_stub.c)
+#define LZW_VERSION 0x01
+#define LZW_MIN_BITS 9
+#define LZW_MAX_BITS 16
+#define LZW_CLEAR_CODE 256
+#define LZW_FIRST_CODE 257
+#define LZW_MAX_CODES (1 << LZW_MAX_BITS)
+
+// Dictionary entry: the string is prefix's string followed by suffix
+typedef struct {
+    uint16_t prefix;
+    unsigned char suffix;
+    unsigned char first;    // first byte of the string
+    uint32_t length;
+} LZWEntry;
+
+static inline int lzw_code_width(int next_code) {
+    int width = LZW_MIN_BITS;
+    while (width < LZW_MAX_BITS && (next_code - 1) >> width) width++;
+    return width;
+}
+
 int lzw_decompress_mfunc(const unsigned char* input, long input_size, unsigned char** output, long* output_size) {
-    (void)input; (void)input_size; (void)output; (void)output_size;
-    /* FORCE-COMPRESS – raw storage disabled */
+    if (!input || input_size < 3 || !output || !output_size) return -1;
+    if (input[0] != LZW_VERSION || input[1] != LZW_MAX_BITS) return -1;
+
+    long ip = 2;
+    unsigned long size = 0;
+    for (int shift = 0; ; shift += 7) {
+        if (ip >= input_size || shift > 56) return -1;
+        unsigned char b = input[ip++];
+        size |= (unsigned long)(b & 0x7F) << shift;
+        if (!(b & 0x80)) break;
+    }
+    // A code of at least 9 bits expands to fewer than LZW_MAX_CODES bytes
+    if (size == 0 || size / LZW_MAX_CODES > (unsigned long)(input_size - ip) * 8 / LZW_MIN_BITS + 1) return -1;
+
+    LZWEntry* dict = (LZWEntry*)comp_malloc(LZW_MAX_CODES * sizeof(LZWEntry));
+    unsigned char* out = (unsigned char*)comp_malloc(size);
+    if (!dict || !out) {
+        comp_free(dict);
+        comp_free(out);
+        return -1;
+    }
+    for (int c = 0; c < 256; c++) {
+        dict[c].prefix = 0;
+        dict[c].suffix = (unsigned char)c;
+        dict[c].first = (unsigned char)c;
+        dict[c].length = 1;
+    }
+
+    const long total = (long)size;
+    long op = 0;
+    uint64_t acc = 0;
+    int bits = 0;
+    int next_code = LZW_FIRST_CODE;
+    int prev = -1;
+
+    while (op < total) {
+        // The encoder has one more entry than we do once a code is pending
+        int enc_next = next_code + (prev >= 0);
+        if (enc_next > LZW_MAX_CODES) enc_next = LZW_MAX_CODES;
+        int width = lzw_code_width(enc_next);
+        while (bits < width) {
+            if (ip >= input_size) goto fail;
+            acc = (acc << 8) | input[ip++];
+            bits += 8;
+        }
+        bits -= width;
+        int code = (int)((acc >> bits) & ((1u << width) - 1));
+
+        if (code == LZW_CLEAR_CODE) {
+            next_code = LZW_FIRST_CODE;
+            prev = -1;
+            continue;
+        }
+
+        unsigned char first;
+        if (code < next_code) {
+            first = dict[code].first;
+        } else if (code == next_code && prev >= 0) {
+            // The code being defined by this very step: prev + first(prev)
+            first = dict[prev].first;
+        } else {
+            goto fail;
+        }
+
+        if (prev >= 0 && next_code < LZW_MAX_CODES) {
+            LZWEntry* e = &dict[next_code++];
+            e->prefix = (uint16_t)prev;
+            e->suffix = first;
+            e->first = dict[prev].first;
+            e->length = dict[prev].length + 1;
+        }
+
+        // Write the string back to front by walking the prefix links
+        uint32_t len = dict[code].length;
+        if (len > (unsigned long)(total - op)) goto fail;
+        unsigned char* p = out + op + len;
+        int c = code;
+        for (uint32_t k = 0; k < len; k++) {
+            *--p = dict[c].suffix;
+            c = dict[c].prefix;
+        }
+        op += len;
+        prev = code;
+    }
+
+    comp_free(dict);
+    *output = out;
+    *output_size = total;
+    return 0;
+
+fail:
+    comp_free(dict);
+    comp_free(out);
     return -1;
-}
\ No newline at end of file
+}
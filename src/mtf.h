@@ -0,0 +1,80 @@
+// Move-to-front kernel shared by the BWT pipeline (bwt.c) and the BCM image
+// transform (img_lossless.h)
+//  - the rank lookup compares 16 list entries per step (SSE2) or 8 per word
+//  - rank 0 leaves the list alone and rank 1 is a swap; only deeper ranks
+//    pay for the memmove
+
+#ifndef MTF_H
+#define MTF_H
+
+#include <stdint.h>
+#include <string.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Position of c in list; list holds every byte value that can occur
+static inline int mtf_find_rank(const unsigned char* list, unsigned char c) {
+#if defined(__SSE2__)
+    const __m128i key = _mm_set1_epi8((char)c);
+    for (int i = 0; ; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(list + i));
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(v, key));
+        if (mask) return i + __builtin_ctz((unsigned)mask);
+    }
+#else
+    // Word at a time: the zero-byte test on list ^ c finds the first match
+    const uint64_t ones = 0x0101010101010101ULL;
+    const uint64_t key = ones * c;
+    for (int i = 0; ; i += 8) {
+        uint64_t w;
+        memcpy(&w, list + i, 8);
+        w ^= key;
+        uint64_t zero = (w - ones) & ~w & (ones << 7);
+        if (zero) {
+            for (int k = 0; k < 8; k++) {
+                if (list[i + k] == c) return i + k;
+            }
+        }
+    }
+#endif
+}
+
+// Move list[rank] to the front
+static inline void mtf_promote(unsigned char* list, int rank) {
+    unsigned char c = list[rank];
+    if (rank == 1) {
+        list[1] = list[0];
+    } else if (rank > 1) {
+        memmove(list + 1, list, (size_t)rank);
+    }
+    list[0] = c;
+}
+
+// MTF over the full byte alphabet; out may not alias in
+static inline void mtf_encode_bytes(const unsigned char* in, long n, unsigned char* out) {
+    unsigned char list[256];
+    for (int i = 0; i < 256; i++) list[i] = (unsigned char)i;
+    for (long i = 0; i < n; i++) {
+        unsigned char c = in[i];
+        if (list[0] == c) {
+            out[i] = 0;
+            continue;
+        }
+        int rank = mtf_find_rank(list, c);
+        out[i] = (unsigned char)rank;
+        mtf_promote(list, rank);
+    }
+}
+
+static inline void mtf_decode_bytes(const unsigned char* in, long n, unsigned char* out) {
+    unsigned char list[256];
+    for (int i = 0; i < 256; i++) list[i] = (unsigned char)i;
+    for (long i = 0; i < n; i++) {
+        int rank = in[i];
+        if (rank) mtf_promote(list, rank);
+        out[i] = list[0];
+    }
+}
+
+#endif // MTF_H
@@ -14,6 +14,11 @@
 #define COMP_HEADER_SIZE_V4     128
 #define COMP_MIN_FILE_SIZE      16
 
+/* v5 blockwise layout: 64-byte header, payloads, index, 16-byte footer */
+#define COMP_V5_INDEX_HEADER    8
+#define COMP_V5_ENTRY_SIZE      32
+#define COMP_V5_FOOTER_SIZE     16
+
 /*============================================================================*/
 /* PRIVATE STRUCTURES                                                         */
 /*============================================================================*/
@@ -37,6 +42,7 @@ typedef struct {
 
 static DecompStatus ParseV3Header(FILE* file, InternalCompHeader* header);
 static DecompStatus ParseV4Header(FILE* file, InternalCompHeader* header);
+static DecompStatus ParseV5Index(FILE* file, BlockMetadata* blocks, int* block_count);
 static bool ValidateHeaderIntegrity(const InternalCompHeader* header);
 static DecompStatus DetectCorruptionType(const uint8_t* data, size_t size);
 static void LogHeaderInfo(const InternalCompHeader* header);
@@ -107,6 +113,8 @@ DecompStatus Parser_ParseHeader(FILE* file, CompHeader* header) {
             status = ParseV3Header(file, &internal_header);
             break;
         case 4:
+        case 5:
+            // v5 keeps the v4 header layout; only the marker and index offset differ
             status = ParseV4Header(file, &internal_header);
             break;
         default:
@@ -192,7 +200,7 @@ static DecompStatus ParseV3Header(FILE* file, InternalCompHeader* header) {
 /*============================================================================*/
 
 static DecompStatus ParseV4Header(FILE* file, InternalCompHeader* header) {
-    Logger_Log(LOG_LEVEL_DEBUG, "Parsing V4 header (64-byte layout)");
+    Logger_Log(LOG_LEVEL_DEBUG, "Parsing V%d header (64-byte layout)", header->version);
     
     // Read algorithm (blockwise), then level and file type (discarded)
     uint8_t algo = 0, level = 0, ftype = 0;
@@ -229,14 +237,14 @@ static DecompStatus ParseV4Header(FILE* file, InternalCompHeader* header) {
     }
     header->block_count = (be32[0] << 24) | (be32[1] << 16) | (be32[2] << 8) | be32[3];
 
-    // Marker: 'BLK4'
+    // Marker: 'BLK4' or 'BLK5'
     char marker[4];
     if (fread(marker, 1, 4, file) != 4) {
-        Logger_Log(LOG_LEVEL_ERROR, "Failed to read BLK4 marker");
+        Logger_Log(LOG_LEVEL_ERROR, "Failed to read block marker");
         return DECOMP_STATUS_IO_ERROR;
     }
-    if (!(marker[0] == 'B' && marker[1] == 'L' && marker[2] == 'K' && marker[3] == '4')) {
-        Logger_Log(LOG_LEVEL_ERROR, "Invalid BLK4 marker");
+    if (!(marker[0] == 'B' && marker[1] == 'L' && marker[2] == 'K' && marker[3] == '0' + header->version)) {
+        Logger_Log(LOG_LEVEL_ERROR, "Invalid BLK%d marker", header->version);
         return DECOMP_STATUS_CORRUPTED_HEADER;
     }
 
@@ -263,7 +271,19 @@ DecompStatus Parser_ParseBlockMetadata(FILE* file, BlockMetadata* blocks, int* b
     }
     
     Logger_Log(LOG_LEVEL_DEBUG, "Parsing block metadata");
-    
+
+    // v5 keeps its descriptors in a trailing index
+    long table_pos = ftell(file);
+    uint8_t prefix[5];
+    if (fseek(file, 0, SEEK_SET) != 0 || fread(prefix, 1, 5, file) != 5) {
+        Logger_Log(LOG_LEVEL_ERROR, "Failed to read container version");
+        return DECOMP_STATUS_IO_ERROR;
+    }
+    if (prefix[4] == 5) {
+        return ParseV5Index(file, blocks, block_count);
+    }
+    fseek(file, table_pos, SEEK_SET);
+
     // Read block table header: 'BTAB' + count (big-endian)
     char tmagic[4];
     if (fread(tmagic, 1, 4, file) != 4) {
@@ -319,6 +339,77 @@ DecompStatus Parser_ParseBlockMetadata(FILE* file, BlockMetadata* blocks, int* b
     return DECOMP_STATUS_SUCCESS;
 }
 
+static uint64_t ReadBE64(const uint8_t* p) {
+    uint64_t v = 0;
+    for (int i = 0; i < 8; i++) v = (v << 8) | p[i];
+    return v;
+}
+
+static uint32_t ReadBE32(const uint8_t* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+// Locate the index through the footer and load it with a single read
+static DecompStatus ParseV5Index(FILE* file, BlockMetadata* blocks, int* block_count) {
+    uint8_t footer[COMP_V5_FOOTER_SIZE];
+    if (fseek(file, 0, SEEK_END) != 0) return DECOMP_STATUS_IO_ERROR;
+    long file_size = ftell(file);
+    if (file_size < 64 + COMP_V5_FOOTER_SIZE ||
+        fseek(file, file_size - COMP_V5_FOOTER_SIZE, SEEK_SET) != 0 ||
+        fread(footer, 1, sizeof(footer), file) != sizeof(footer)) {
+        Logger_Log(LOG_LEVEL_ERROR, "Failed to read v5 footer");
+        return DECOMP_STATUS_TRUNCATED_DATA;
+    }
+    if (memcmp(footer + 12, "CIX5", 4) != 0) {
+        Logger_Log(LOG_LEVEL_ERROR, "Invalid v5 footer magic");
+        return DECOMP_STATUS_CORRUPTED_HEADER;
+    }
+    uint64_t index_offset = ReadBE64(footer);
+    if (index_offset < 64 || index_offset + COMP_V5_INDEX_HEADER + COMP_V5_FOOTER_SIZE > (uint64_t)file_size) {
+        Logger_Log(LOG_LEVEL_ERROR, "v5 index offset out of range: %llu", (unsigned long long)index_offset);
+        return DECOMP_STATUS_CORRUPTED_HEADER;
+    }
+
+    size_t index_size = (size_t)((uint64_t)file_size - COMP_V5_FOOTER_SIZE - index_offset);
+    uint8_t* index = (uint8_t*)malloc(index_size);
+    if (!index) return DECOMP_STATUS_MEMORY_ERROR;
+    if (fseek(file, (long)index_offset, SEEK_SET) != 0 || fread(index, 1, index_size, file) != index_size) {
+        Logger_Log(LOG_LEVEL_ERROR, "Failed to read v5 block index");
+        free(index);
+        return DECOMP_STATUS_IO_ERROR;
+    }
+
+    DecompStatus status = DECOMP_STATUS_SUCCESS;
+    uint32_t num_blocks = ReadBE32(index + 4);
+    if (CRC32_Calculate(index, index_size) != ReadBE32(footer + 8)) {
+        Logger_Log(LOG_LEVEL_ERROR, "v5 block index CRC mismatch");
+        status = DECOMP_STATUS_INTEGRITY_FAILURE;
+    } else if (memcmp(index, "BIDX", 4) != 0 ||
+               index_size != COMP_V5_INDEX_HEADER + (size_t)num_blocks * COMP_V5_ENTRY_SIZE) {
+        Logger_Log(LOG_LEVEL_ERROR, "Invalid v5 block index");
+        status = DECOMP_STATUS_CORRUPTED_HEADER;
+    } else if (num_blocks > DECOMP_MAX_BLOCKS) {
+        Logger_Log(LOG_LEVEL_ERROR, "Too many blocks: %u (max: %d)", num_blocks, DECOMP_MAX_BLOCKS);
+        status = DECOMP_STATUS_CORRUPTED_HEADER;
+    } else {
+        *block_count = (int)num_blocks;
+        for (uint32_t i = 0; i < num_blocks; i++) {
+            const uint8_t* e = index + COMP_V5_INDEX_HEADER + (size_t)i * COMP_V5_ENTRY_SIZE;
+            BlockMetadata* block = &blocks[i];
+            block->block_id = i;
+            block->algorithm = e[0];
+            block->checksum = ReadBE32(e + 4);
+            block->data_offset = ReadBE64(e + 8);
+            block->original_size = ReadBE64(e + 16);
+            block->compressed_size = ReadBE64(e + 24);
+            Logger_Log(LOG_LEVEL_TRACE, "Block %u: orig=%lu, comp=%lu, algo=%u, offset=%lu",
+                       i, block->original_size, block->compressed_size, block->algorithm, block->data_offset);
+        }
+    }
+    free(index);
+    return status;
+}
+
 /*============================================================================*/
 /* FORMAT DETECTION                                                           */
 /*============================================================================*/
@@ -405,8 +496,8 @@ bool Parser_ValidateHeader(const CompHeader* header) {
         return false;
     }
 
-    // Version must be strictly 3 or 4
-    if (header->version != 3 && header->version != 4) {
+    // Version must be 3, 4 or 5
+    if (header->version < 3 || header->version > 5) {
         Logger_Log(LOG_LEVEL_ERROR, "Invalid version: %d", header->version);
         return false;
     }
@@ -499,7 +590,7 @@ static DecompStatus DetectCorruptionType(const uint8_t* data, size_t size) {
     }
     
     uint8_t version = data[4];
-    if (version != 3 && version != 4) {
+    if (version < 3 || version > 5) {
         return DECOMP_STATUS_UNSUPPORTED_VERSION;
     }
     
@@ -517,7 +608,7 @@ static void LogHeaderInfo(const InternalCompHeader* header) {
     Logger_Log(LOG_LEVEL_INFO, "  Original Extension: %s", header->original_extension);
     Logger_Log(LOG_LEVEL_INFO, "  Timestamp: %ld", header->timestamp);
     
-    if (header->version == 4) {
+    if (header->version >= 4) {
         Logger_Log(LOG_LEVEL_INFO, "  Block Count: %u", header->block_count);
         Logger_Log(LOG_LEVEL_INFO, "  Flags: 0x%08X", header->flags);
     }
@@ -3,6 +3,7 @@
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include "../include/comp_alloc.h"
 
 // Forward declarations for DEFLATE via miniz wrapper (enabled when MINIZ_ENABLED=1)
 #ifdef USE_MINIZ
@@ -161,7 +162,7 @@ size_t pdf_compress(const uint8_t* pdf, size_t pdf_len, uint8_t* out, size_t out
 
     ObjRec* objs = NULL;
     int obj_cap = 64, obj_cnt = 0;
-    objs = (ObjRec*)malloc(sizeof(ObjRec) * obj_cap);
+    objs = (ObjRec*)comp_malloc(sizeof(ObjRec) * obj_cap);
     if (!objs) return 0;
     memset(objs, 0, sizeof(ObjRec) * obj_cap);
 
@@ -222,8 +223,8 @@ size_t pdf_compress(const uint8_t* pdf, size_t pdf_len, uint8_t* out, size_t out
         // Expand object list if needed
         if (obj_cnt >= obj_cap) {
             int new_cap = obj_cap * 2;
-            ObjRec* tmp = (ObjRec*)realloc(objs, sizeof(ObjRec) * new_cap);
-            if (!tmp) { free(objs); return 0; }
+            ObjRec* tmp = (ObjRec*)comp_realloc(objs, sizeof(ObjRec) * new_cap);
+            if (!tmp) { comp_free(objs); return 0; }
             objs = tmp; obj_cap = new_cap;
         }
         ObjRec* rec = &objs[obj_cnt++];
@@ -248,16 +249,16 @@ size_t pdf_compress(const uint8_t* pdf, size_t pdf_len, uint8_t* out, size_t out
         if (has_flate && stream_start && stream_len > 0) {
             // Try decompress with generous cap (8x compressed size)
             size_t raw_cap = stream_len * 8 + 65536;
-            uint8_t* raw = (uint8_t*)malloc(raw_cap);
-            if (!raw) { free(objs); return 0; }
+            uint8_t* raw = (uint8_t*)comp_malloc(raw_cap);
+            if (!raw) { comp_free(objs); return 0; }
             size_t raw_len = deflate_decompress(stream_start, stream_len, raw, raw_cap);
             if (raw_len == 0) {
                 // If failed, keep original compressed stream
-                rec->new_stream = (uint8_t*)malloc(stream_len);
-                if (!rec->new_stream) { free(raw); free(objs); return 0; }
+                rec->new_stream = (uint8_t*)comp_malloc(stream_len);
+                if (!rec->new_stream) { comp_free(raw); comp_free(objs); return 0; }
                 memcpy(rec->new_stream, stream_start, stream_len);
                 rec->new_stream_len = stream_len;
-                free(raw);
+                comp_free(raw);
             } else {
                 // Decide if image and high-PPI; if so, apply per-row Paeth filter
                 int w=0,h=0,b=8,c=1;
@@ -270,7 +271,7 @@ size_t pdf_compress(const uint8_t* pdf, size_t pdf_len, uint8_t* out, size_t out
                     size_t row_bytes = (size_t)w * (size_t)bpp;
                     size_t need = ((size_t)h) * (row_bytes + 1);
                     if (need < raw_len && need > 0) {
-                        filtered = (uint8_t*)malloc(need);
+                        filtered = (uint8_t*)comp_malloc(need);
                         if (filtered) {
                             const uint8_t* prev = NULL;
                             size_t src_off = 0, dst_off = 0;
@@ -287,13 +288,13 @@ size_t pdf_compress(const uint8_t* pdf, size_t pdf_len, uint8_t* out, size_t out
                 }
                 // Recompress with level 9
                 size_t cmp_cap = to_comp_len + to_comp_len/10 + 65536;
-                uint8_t* cmp = (uint8_t*)malloc(cmp_cap);
-                if (!cmp) { if (filtered) free(filtered); free(raw); free(objs); return 0; }
+                uint8_t* cmp = (uint8_t*)comp_malloc(cmp_cap);
+                if (!cmp) { if (filtered) comp_free(filtered); comp_free(raw); comp_free(objs); return 0; }
                 size_t cmp_len = deflate_compress(to_comp, to_comp_len, cmp, cmp_cap, 9);
                 if (cmp_len == 0) {
                     // Fallback: keep original
-                    rec->new_stream = (uint8_t*)malloc(stream_len);
-                    if (!rec->new_stream) { if (filtered) free(filtered); free(cmp); free(raw); free(objs); return 0; }
+                    rec->new_stream = (uint8_t*)comp_malloc(stream_len);
+                    if (!rec->new_stream) { if (filtered) comp_free(filtered); comp_free(cmp); comp_free(raw); comp_free(objs); return 0; }
                     memcpy(rec->new_stream, stream_start, stream_len);
                     rec->new_stream_len = stream_len;
                 } else {
@@ -301,15 +302,15 @@ size_t pdf_compress(const uint8_t* pdf, size_t pdf_len, uint8_t* out, size_t out
                     // filtered buffer re-used only as source, free if allocated
                     cmp = NULL;
                 }
-                if (filtered) free(filtered);
-                free(raw);
+                if (filtered) comp_free(filtered);
+                comp_free(raw);
             }
         }
 #else
         // Without miniz, pass through original stream unmodified
         if (has_flate && stream_start && stream_len > 0) {
-            rec->new_stream = (uint8_t*)malloc(stream_len);
-            if (!rec->new_stream) { free(objs); return 0; }
+            rec->new_stream = (uint8_t*)comp_malloc(stream_len);
+            if (!rec->new_stream) { comp_free(objs); return 0; }
             memcpy(rec->new_stream, stream_start, stream_len);
             rec->new_stream_len = stream_len;
         }
@@ -331,18 +332,18 @@ size_t pdf_compress(const uint8_t* pdf, size_t pdf_len, uint8_t* out, size_t out
     // Begin writing reconstructed PDF
     size_t off = 0;
     if (!buf_append(out, out_cap, &off, pdf, 8)) { // copy header line (first 8 bytes enough: %PDF-1.x)
-        for (int k = 0; k < obj_cnt; k++) { if (objs[k].new_stream) free(objs[k].new_stream); }
-        free(objs); return 0;
+        for (int k = 0; k < obj_cnt; k++) { if (objs[k].new_stream) comp_free(objs[k].new_stream); }
+        comp_free(objs); return 0;
     }
     if (!buf_append(out, out_cap, &off, "\n", 1)) {
-        for (int k = 0; k < obj_cnt; k++) { if (objs[k].new_stream) free(objs[k].new_stream); }
-        free(objs); return 0;
+        for (int k = 0; k < obj_cnt; k++) { if (objs[k].new_stream) comp_free(objs[k].new_stream); }
+        comp_free(objs); return 0;
     }
 
-    size_t* obj_offsets = (size_t*)malloc(sizeof(size_t) * (size_t)obj_cnt);
+    size_t* obj_offsets = (size_t*)comp_malloc(sizeof(size_t) * (size_t)obj_cnt);
     if (!obj_offsets) {
-        for (int k = 0; k < obj_cnt; k++) { if (objs[k].new_stream) free(objs[k].new_stream); }
-        free(objs); return 0;
+        for (int k = 0; k < obj_cnt; k++) { if (objs[k].new_stream) comp_free(objs[k].new_stream); }
+        comp_free(objs); return 0;
     }
 
     char linebuf[128];
@@ -407,9 +408,9 @@ size_t pdf_compress(const uint8_t* pdf, size_t pdf_len, uint8_t* out, size_t out
     }
 
     // Cleanup
-    for (int k = 0; k < obj_cnt; k++) { if (objs[k].new_stream) free(objs[k].new_stream); }
-    free(objs);
-    free(obj_offsets);
+    for (int k = 0; k < obj_cnt; k++) { if (objs[k].new_stream) comp_free(objs[k].new_stream); }
+    comp_free(objs);
+    comp_free(obj_offsets);
     return off;
 }
 
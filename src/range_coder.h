@@ -0,0 +1,69 @@
+// Binary range decoder shared by hardcore_compression.c (version 1 literal
+// streams, algorithm 3) and the entropy-coder benchmark (codec_bench.c)
+//  - 11-bit adaptive probabilities moved 1/32 of the way per bit
+//  - the decoder refills a byte at a time once the range drops below
+//    RC_BOT_VALUE; an encoder for it must normalise at the same bound
+// The LZ + range coder engine (algorithm 4) uses the same constants with
+// the LZMA bound, RC_TOP_VALUE.
+
+#ifndef RANGE_CODER_H
+#define RANGE_CODER_H
+
+#define RC_TOP_VALUE (1U << 24)
+#define RC_BOT_VALUE (1U << 16)
+#define RC_MODEL_TOTAL_BITS 11
+#define RC_BIT_MODEL_TOTAL (1 << RC_MODEL_TOTAL_BITS)
+#define RC_MOVE_BITS 5
+
+// Probability models for range coding
+typedef struct {
+    unsigned short prob;
+} RangeBitModel;
+
+typedef struct {
+    unsigned int code;
+    unsigned int range;
+    const unsigned char* buffer;
+    long buffer_pos;
+    long buffer_size;
+} RangeDecoder;
+
+// Initialize range decoder
+static inline void range_decoder_init(RangeDecoder* rc, const unsigned char* buffer, long buffer_size) {
+    rc->buffer = buffer;
+    rc->buffer_pos = 0;
+    rc->buffer_size = buffer_size;
+    rc->code = 0;
+    rc->range = 0xFFFFFFFF;
+    
+    for (int i = 0; i < 5; i++) {
+        rc->code = (rc->code << 8) | (rc->buffer_pos < buffer_size ? buffer[rc->buffer_pos++] : 0);
+    }
+}
+
+// Decode bit with range decoder
+static inline int range_decode_bit(RangeDecoder* rc, RangeBitModel* model) {
+    unsigned int bound = (rc->range >> RC_MODEL_TOTAL_BITS) * model->prob;
+    int bit;
+    
+    if (rc->code < bound) {
+        rc->range = bound;
+        model->prob += (RC_BIT_MODEL_TOTAL - model->prob) >> RC_MOVE_BITS;
+        bit = 0;
+    } else {
+        rc->code -= bound;
+        rc->range -= bound;
+        model->prob -= model->prob >> RC_MOVE_BITS;
+        bit = 1;
+    }
+    
+    // Normalize
+    while (rc->range < RC_BOT_VALUE) {
+        rc->code = (rc->code << 8) | (rc->buffer_pos < rc->buffer_size ? rc->buffer[rc->buffer_pos++] : 0);
+        rc->range <<= 8;
+    }
+    
+    return bit;
+}
+
+#endif // RANGE_CODER_H
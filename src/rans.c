@@ -0,0 +1,470 @@
+#include "../include/compressor.h"
+#include <limits.h>
+
+// Order-0 rANS with four interleaved states
+// Stream: version byte | original size (LEB128) | chunks
+// Chunk:  mode byte, then
+//   raw:      the bytes as they are (used when coding would not shrink them)
+//   static:   32-byte used-symbol bitmap | LEB128 frequency per used symbol |
+//             payload size BE32 | payload
+//   adaptive: payload size BE32 | payload
+// Payload: four BE32 states | BE16 renormalisation words
+// A static chunk carries its own table. An adaptive chunk carries none: both
+// sides start from flat counts and rebuild the table from the symbols seen
+// so far every RANS_ADAPT_STEP symbols, which follows data whose statistics
+// drift within a chunk. The encoder codes both and keeps the smaller,
+// favouring static, which decodes about twice as fast. Symbol i of a chunk
+// goes through state i & 3; the encoder runs back to front so the decoder
+// reads the payload front to back.
+// States live in [RANS_L, 2^32) and move 16 bits at a time, so a decode
+// step needs at most one read and the refill is branch-free.
+#define RANS_VERSION 0x02
+#define RANS_PROB_BITS 12
+#define RANS_PROB_SCALE (1u << RANS_PROB_BITS)
+#define RANS_L (1u << 16)            // lower bound of the state interval
+#define RANS_CHUNK_SIZE (256L * 1024)
+#define RANS_STATES 4
+
+#define RANS_MODE_RAW 0
+#define RANS_MODE_STATIC 1
+#define RANS_MODE_ADAPTIVE 2
+
+#define RANS_ADAPT_STEP 2048          // symbols per adaptive table; a multiple of RANS_STATES
+#define RANS_ADAPT_LIMIT (1u << 12)   // counts are halved when their total passes this
+#define RANS_ADAPT_TABLES ((RANS_CHUNK_SIZE + RANS_ADAPT_STEP - 1) / RANS_ADAPT_STEP)
+
+// Decode table entry for every slot of [0, RANS_PROB_SCALE):
+// symbol << 24 | (freq - 1) << 12 | (slot - cum)
+static inline uint32_t rans_pack_entry(int sym, uint32_t freq, uint32_t bias) {
+    return ((uint32_t)sym << 24) | ((freq - 1) << RANS_PROB_BITS) | bias;
+}
+
+// Scale counts to frequencies that sum to RANS_PROB_SCALE, keeping every
+// present symbol at 1 or more
+static void rans_normalize(const uint32_t* count, long total, uint32_t* freq) {
+    uint32_t sum = 0;
+    int largest = -1;
+    for (int s = 0; s < 256; s++) {
+        freq[s] = 0;
+        if (!count[s]) continue;
+        uint32_t f = (uint32_t)(((uint64_t)count[s] * RANS_PROB_SCALE) / (uint64_t)total);
+        freq[s] = f ? f : 1;
+        sum += freq[s];
+        if (largest < 0 || count[s] > count[largest]) largest = s;
+    }
+    if (sum < RANS_PROB_SCALE) {
+        freq[largest] += RANS_PROB_SCALE - sum;
+        return;
+    }
+    // Rounding singletons up can overshoot; take the excess from the
+    // largest frequencies, a little at a time, which costs the least
+    while (sum > RANS_PROB_SCALE) {
+        int best = 0;
+        for (int s = 1; s < 256; s++) {
+            if (freq[s] > freq[best]) best = s;
+        }
+        uint32_t take = freq[best] / 8 + 1;
+        if (take > sum - RANS_PROB_SCALE) take = sum - RANS_PROB_SCALE;
+        freq[best] -= take;
+        sum -= take;
+    }
+}
+
+static inline long rans_put_varint(unsigned char* out, long pos, unsigned long v) {
+    while (v >= 0x80) {
+        out[pos++] = (unsigned char)(v | 0x80);
+        v >>= 7;
+    }
+    out[pos++] = (unsigned char)v;
+    return pos;
+}
+
+static inline int rans_get_varint(const unsigned char* in, long size, long* pos, unsigned long* value) {
+    unsigned long v = 0;
+    for (int shift = 0; ; shift += 7) {
+        if (*pos >= size || shift > 56) return -1;
+        unsigned char b = in[(*pos)++];
+        v |= (unsigned long)(b & 0x7F) << shift;
+        if (!(b & 0x80)) break;
+    }
+    *value = v;
+    return 0;
+}
+
+static inline void rans_put_be32(unsigned char* p, uint32_t v) {
+    p[0] = (unsigned char)(v >> 24);
+    p[1] = (unsigned char)(v >> 16);
+    p[2] = (unsigned char)(v >> 8);
+    p[3] = (unsigned char)v;
+}
+
+static inline uint32_t rans_get_be32(const unsigned char* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+// Encode one symbol into x, emitting a renormalisation word downwards from *ptr
+static inline void rans_encode_symbol(uint32_t* x, unsigned char** ptr, uint32_t freq, uint32_t cum) {
+    uint32_t v = *x;
+    // 64-bit so that a symbol owning the whole scale does not wrap
+    const uint64_t x_max = ((uint64_t)(RANS_L >> RANS_PROB_BITS) << 16) * freq;
+    if (v >= x_max) {
+        *ptr -= 2;
+        (*ptr)[0] = (unsigned char)(v >> 8);
+        (*ptr)[1] = (unsigned char)v;
+        v >>= 16;
+    }
+    *x = ((v / freq) << RANS_PROB_BITS) + (v % freq) + cum;
+}
+
+// Worst case per chunk: the mode and table, the size and states, and one
+// word per symbol
+static long rans_chunk_bound(long n) {
+    return 1 + 32 + 256 * 2 + 4 + RANS_STATES * 4 + n * 2;
+}
+
+// ===== Adaptive model =====
+// Counts start flat and grow by one per symbol; the table for the next
+// RANS_ADAPT_STEP symbols is normalised from them, so every symbol keeps a
+// slot. Halving the counts once they pass RANS_ADAPT_LIMIT lets old
+// statistics fade.
+
+typedef struct {
+    uint32_t count[256];
+    uint32_t total;
+} RansAdaptModel;
+
+static void rans_adapt_init(RansAdaptModel* m) {
+    for (int s = 0; s < 256; s++) m->count[s] = 1;
+    m->total = 256;
+}
+
+static void rans_adapt_update(RansAdaptModel* m, const unsigned char* sym, long n) {
+    for (long i = 0; i < n; i++) m->count[sym[i]]++;
+    m->total += (uint32_t)n;
+    if (m->total > RANS_ADAPT_LIMIT) {
+        m->total = 0;
+        for (int s = 0; s < 256; s++) {
+            m->count[s] = (m->count[s] + 1) >> 1;
+            m->total += m->count[s];
+        }
+    }
+}
+
+// ===== Encoder =====
+
+// Code in[0, n) back to front into the bytes before end. Symbol i uses
+// entry i / step of the freq and cum tables (256 entries each); returns the
+// payload size and sets *start to its first byte.
+static long rans_encode_payload(const unsigned char* in, long n, const uint16_t* freq, const uint16_t* cum,
+                                long step, unsigned char* end, unsigned char** start) {
+    unsigned char* ptr = end;
+    uint32_t x[RANS_STATES];
+    for (int k = 0; k < RANS_STATES; k++) x[k] = RANS_L;
+    for (long i = n - 1; i >= 0; i--) {
+        long t = (i / step) * 256 + in[i];
+        rans_encode_symbol(&x[i & (RANS_STATES - 1)], &ptr, freq[t], cum[t]);
+    }
+    for (int k = RANS_STATES - 1; k >= 0; k--) {
+        ptr -= 4;
+        rans_put_be32(ptr, x[k]);
+    }
+    *start = ptr;
+    return (long)(end - ptr);
+}
+
+// Code one chunk at out; returns the number of bytes written, at most
+// 1 + n. scratch holds rans_chunk_bound(n) bytes: each coded form is built
+// there (table at the front, payload at the back) and copied to out only
+// if it beats what out holds. tables holds the adaptive freq and cum
+// tables, RANS_ADAPT_TABLES * 256 entries each.
+static long rans_encode_chunk(const unsigned char* in, long n, unsigned char* out, unsigned char* scratch,
+                              uint16_t* tables) {
+    long best = 1 + n;          // the raw form, written last if nothing beats it
+    unsigned char* end = scratch + rans_chunk_bound(n);
+    unsigned char* payload;
+
+    // Static: one table for the chunk
+    uint32_t count[256] = {0};
+    for (long i = 0; i < n; i++) count[in[i]]++;
+    uint32_t freq32[256];
+    rans_normalize(count, n, freq32);
+    uint16_t freq[256], cum[256];
+    uint32_t c = 0;
+    for (int s = 0; s < 256; s++) {
+        freq[s] = (uint16_t)freq32[s];
+        cum[s] = (uint16_t)c;
+        c += freq32[s];
+    }
+    // The table alone can outgrow 1 + n on a small chunk
+    scratch[0] = RANS_MODE_STATIC;
+    unsigned char* bitmap = scratch + 1;
+    memset(bitmap, 0, 32);
+    for (int s = 0; s < 256; s++) {
+        if (freq[s]) bitmap[s >> 3] |= (unsigned char)(1u << (s & 7));
+    }
+    long pos = 33;
+    for (int s = 0; s < 256; s++) {
+        if (freq[s]) pos = rans_put_varint(scratch, pos, freq[s]);
+    }
+    long size = rans_encode_payload(in, n, freq, cum, n, end, &payload);
+    if (pos + 4 + size < best) {
+        memcpy(out, scratch, (size_t)pos);
+        rans_put_be32(out + pos, (uint32_t)size);
+        memcpy(out + pos + 4, payload, (size_t)size);
+        best = pos + 4 + size;
+    }
+
+    // Adaptive: replay the model forwards to get every step's table, then
+    // code backwards with them
+    uint16_t* afreq = tables;
+    uint16_t* acum = tables + RANS_ADAPT_TABLES * 256;
+    RansAdaptModel m;
+    rans_adapt_init(&m);
+    for (long off = 0, t = 0; off < n; off += RANS_ADAPT_STEP, t += 256) {
+        rans_normalize(m.count, m.total, freq32);
+        c = 0;
+        for (int s = 0; s < 256; s++) {
+            afreq[t + s] = (uint16_t)freq32[s];
+            acum[t + s] = (uint16_t)c;
+            c += freq32[s];
+        }
+        rans_adapt_update(&m, in + off, n - off < RANS_ADAPT_STEP ? n - off : RANS_ADAPT_STEP);
+    }
+    // Rebuilding the table every step halves decode speed, so adaptive has
+    // to save more than 1/32 of the chunk to be chosen
+    size = rans_encode_payload(in, n, afreq, acum, RANS_ADAPT_STEP, end, &payload);
+    if (1 + 4 + size + best / 32 < best) {
+        out[0] = RANS_MODE_ADAPTIVE;
+        rans_put_be32(out + 1, (uint32_t)size);
+        memcpy(out + 5, payload, (size_t)size);
+        best = 1 + 4 + size;
+    }
+
+    if (best == 1 + n) {
+        out[0] = RANS_MODE_RAW;
+        memcpy(out + 1, in, (size_t)n);
+    }
+    return best;
+}
+
+// Output, scratch and adaptive tables for input_size bytes
+size_t rans_memory_cost(long input_size) {
+    if (input_size <= 0) return 0;
+    long chunks = (input_size + RANS_CHUNK_SIZE - 1) / RANS_CHUNK_SIZE;
+    long first = input_size < RANS_CHUNK_SIZE ? input_size : RANS_CHUNK_SIZE;
+    return (size_t)(1 + 10 + chunks + input_size) + (size_t)rans_chunk_bound(first) +
+           2 * RANS_ADAPT_TABLES * 256 * sizeof(uint16_t);
+}
+
+int rans_compress(const unsigned char* input, long input_size, unsigned char** output, long* output_size) {
+    if (!input || input_size <= 0 || !output || !output_size) return -1;
+
+    // A chunk never takes more than its raw form
+    long chunks = (input_size + RANS_CHUNK_SIZE - 1) / RANS_CHUNK_SIZE;
+    long cap = 1 + 10 + chunks + input_size;
+    long scratch_size = rans_chunk_bound(input_size < RANS_CHUNK_SIZE ? input_size : RANS_CHUNK_SIZE);
+    unsigned char* out = (unsigned char*)comp_malloc(cap);
+    unsigned char* scratch = (unsigned char*)comp_malloc(scratch_size);
+    uint16_t* tables = (uint16_t*)comp_malloc(2 * RANS_ADAPT_TABLES * 256 * sizeof(uint16_t));
+    if (!out || !scratch || !tables) {
+        comp_free(out);
+        comp_free(scratch);
+        comp_free(tables);
+        return -1;
+    }
+
+    long pos = 0;
+    out[pos++] = RANS_VERSION;
+    pos = rans_put_varint(out, pos, (unsigned long)input_size);
+    for (long off = 0; off < input_size; off += RANS_CHUNK_SIZE) {
+        long n = input_size - off < RANS_CHUNK_SIZE ? input_size - off : RANS_CHUNK_SIZE;
+        pos += rans_encode_chunk(input + off, n, out + pos, scratch, tables);
+    }
+    comp_free(scratch);
+    comp_free(tables);
+
+    *output = out;
+    *output_size = pos;
+    return 0;
+}
+
+// ===== Decoder =====
+
+// Slot table for freq, which sums to RANS_PROB_SCALE
+static void rans_build_slots(const uint32_t* freq, uint32_t* table) {
+    uint32_t slot = 0;
+    for (int s = 0; s < 256; s++) {
+        uint32_t e = rans_pack_entry(s, freq[s], 0);
+        for (uint32_t k = 0; k < freq[s]; k++) table[slot + k] = e + k;
+        slot += freq[s];
+    }
+}
+
+// Read a static chunk's table and build its slot table; returns 0, or -1
+// for a bad table
+static int rans_read_table(const unsigned char* in, long size, long* pos, uint32_t* table) {
+    if (size - *pos < 32) return -1;
+    const unsigned char* bitmap = in + *pos;
+    *pos += 32;
+    uint32_t freq[256];
+    uint32_t sum = 0;
+    for (int s = 0; s < 256; s++) {
+        freq[s] = 0;
+        if (!(bitmap[s >> 3] & (1u << (s & 7)))) continue;
+        unsigned long f;
+        if (rans_get_varint(in, size, pos, &f) != 0) return -1;
+        if (f == 0 || f > RANS_PROB_SCALE - sum) return -1;
+        freq[s] = (uint32_t)f;
+        sum += (uint32_t)f;
+    }
+    if (sum != RANS_PROB_SCALE) return -1;
+    rans_build_slots(freq, table);
+    return 0;
+}
+
+#define RANS_DECODE_STEP(xv, dst)                                                   \
+    do {                                                                            \
+        uint32_t e = table[(xv) & (RANS_PROB_SCALE - 1)];                           \
+        (dst) = (unsigned char)(e >> 24);                                           \
+        (xv) = (((e >> RANS_PROB_BITS) & (RANS_PROB_SCALE - 1)) + 1) *              \
+               ((xv) >> RANS_PROB_BITS) + (e & (RANS_PROB_SCALE - 1));              \
+    } while (0)
+
+// Pull in a word when the state fell below RANS_L; shift and mask instead
+// of a branch, which would mispredict on every other symbol
+#define RANS_REFILL(xv, ptr)                                                        \
+    do {                                                                            \
+        uint32_t need = (xv) < RANS_L;                                              \
+        uint32_t w = ((uint32_t)(ptr)[0] << 8) | (ptr)[1];                          \
+        (xv) = ((xv) << (need << 4)) | (w & (0u - need));                           \
+        (ptr) += need << 1;                                                         \
+    } while (0)
+
+// Decode out[start, stop) with one slot table, carrying the states in x
+// and the read position in *pp; start is a multiple of RANS_STATES
+static int rans_decode_run(const uint32_t* table, uint32_t* x, const unsigned char** pp,
+                           const unsigned char* end, unsigned char* out, long start, long stop) {
+    uint32_t x0 = x[0], x1 = x[1], x2 = x[2], x3 = x[3];
+    const unsigned char* p = *pp;
+
+    // A symbol needs at most one word per state, so groups with 8 bytes
+    // of input left skip the bounds checks
+    long i = start;
+    for (; i + 4 <= stop && end - p >= 8; i += 4) {
+        RANS_DECODE_STEP(x0, out[i]);
+        RANS_DECODE_STEP(x1, out[i + 1]);
+        RANS_DECODE_STEP(x2, out[i + 2]);
+        RANS_DECODE_STEP(x3, out[i + 3]);
+        RANS_REFILL(x0, p);
+        RANS_REFILL(x1, p);
+        RANS_REFILL(x2, p);
+        RANS_REFILL(x3, p);
+    }
+    x[0] = x0;
+    x[1] = x1;
+    x[2] = x2;
+    x[3] = x3;
+    for (; i < stop; i++) {
+        uint32_t* xs = &x[i & (RANS_STATES - 1)];
+        RANS_DECODE_STEP(*xs, out[i]);
+        if (*xs < RANS_L) {
+            if (end - p < 2) return -1;
+            RANS_REFILL(*xs, p);
+        }
+    }
+    *pp = p;
+    return 0;
+}
+
+// Decode n symbols from payload[0, size) into out. A static chunk brings
+// its slot table; an adaptive one rebuilds table every RANS_ADAPT_STEP
+// symbols.
+static int rans_decode_chunk(const unsigned char* payload, long size, int adaptive, uint32_t* table,
+                             unsigned char* out, long n) {
+    if (size < RANS_STATES * 4) return -1;
+    uint32_t x[RANS_STATES];
+    for (int k = 0; k < RANS_STATES; k++) {
+        x[k] = rans_get_be32(payload + 4 * k);
+        if (x[k] < RANS_L) return -1;
+    }
+    const unsigned char* p = payload + RANS_STATES * 4;
+    const unsigned char* end = payload + size;
+
+    if (!adaptive) {
+        if (rans_decode_run(table, x, &p, end, out, 0, n) != 0) return -1;
+    } else {
+        RansAdaptModel m;
+        rans_adapt_init(&m);
+        for (long off = 0; off < n; off += RANS_ADAPT_STEP) {
+            long stop = n - off < RANS_ADAPT_STEP ? n : off + RANS_ADAPT_STEP;
+            uint32_t freq[256];
+            rans_normalize(m.count, m.total, freq);
+            rans_build_slots(freq, table);
+            if (rans_decode_run(table, x, &p, end, out, off, stop) != 0) return -1;
+            rans_adapt_update(&m, out + off, stop - off);
+        }
+    }
+    // Every state must be back where the encoder started
+    if (p != end) return -1;
+    for (int k = 0; k < RANS_STATES; k++) {
+        if (x[k] != RANS_L) return -1;
+    }
+    return 0;
+}
+
+int rans_decompress(const unsigned char* input, long input_size, unsigned char** output, long* output_size) {
+    if (!input || input_size < 2 || !output || !output_size) return -1;
+    if (input[0] != RANS_VERSION) return -1;
+    long pos = 1;
+    unsigned long size;
+    if (rans_get_varint(input, input_size, &pos, &size) != 0) return -1;
+    // Every chunk but the last is full, and a full chunk costs at least
+    // its mode, payload size and states
+    if (size == 0 || size > (unsigned long)LONG_MAX ||
+        (size - 1) / RANS_CHUNK_SIZE > (unsigned long)(input_size - pos) / (1 + 4 + RANS_STATES * 4)) {
+        return -1;
+    }
+
+    const long total = (long)size;
+    unsigned char* out = (unsigned char*)comp_malloc(total);
+    uint32_t* table = (uint32_t*)comp_malloc(RANS_PROB_SCALE * sizeof(uint32_t));
+    if (!out || !table) {
+        comp_free(out);
+        comp_free(table);
+        return -1;
+    }
+
+    for (long off = 0; off < total; off += RANS_CHUNK_SIZE) {
+        long n = total - off < RANS_CHUNK_SIZE ? total - off : RANS_CHUNK_SIZE;
+        if (pos >= input_size) goto fail;
+        int mode = input[pos++];
+        if (mode == RANS_MODE_RAW) {
+            if (input_size - pos < n) goto fail;
+            memcpy(out + off, input + pos, (size_t)n);
+            pos += n;
+            continue;
+        }
+        if (mode == RANS_MODE_STATIC) {
+            if (rans_read_table(input, input_size, &pos, table) != 0) goto fail;
+        } else if (mode != RANS_MODE_ADAPTIVE) {
+            goto fail;
+        }
+        if (input_size - pos < 4) goto fail;
+        long payload = (long)rans_get_be32(input + pos);
+        pos += 4;
+        if (payload > input_size - pos) goto fail;
+        if (rans_decode_chunk(input + pos, payload, mode == RANS_MODE_ADAPTIVE, table, out + off, n) != 0) goto fail;
+        pos += payload;
+    }
+    if (pos != input_size) goto fail;
+
+    comp_free(table);
+    *output = out;
+    *output_size = total;
+    return 0;
+
+fail:
+    comp_free(table);
+    comp_free(out);
+    return -1;
+}
@@ -1,10 +1,16 @@
 // Realtime clone-and-compress server
 // - AF_UNIX socket at /tmp/comp.sock
-// - Parent limits concurrency to `nproc --all` (fallback to sysconf)
-// - Child reads: [8-byte big-endian path_len] + [path bytes]
-// - Compresses using intelligent_compress_file() with O_DIRECT I/O
-// - Writes COMP v2 header + payload using O_DIRECT, padding to alignment then ftruncate
+// - A pool of `nproc --all` worker threads (fallback to sysconf) serves the
+//   connections the main thread accepts, one connection per worker at a time
+// - Workers read requests: [8-byte big-endian path_len] + [path bytes], any
+//   number per connection until the client closes it
+// - Compresses using intelligent_compress_file() over the input as read by rt_io
+// - Writes COMP v2 header + payload to <path>.comp
 // - Responds: [1-byte CompResult] + [8-byte big-endian compressed_size]
+// - I/O goes through io_uring when available (see rt_io.h); a request sent
+//   before the previous response has its input read during that compression
+// - Workers live as long as the server, each with its own I/O engine and an
+//   arena for the LZ77 match finder, so nothing is set up per request
 
 #define _GNU_SOURCE
 #include <sys/types.h>
@@ -16,57 +22,49 @@
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <pthread.h>
-#include <sys/wait.h>
 #include <signal.h>
 #include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
+#include <limits.h>
 #include <time.h>
 
 #include "../include/compressor.h"
-
-#ifndef O_DIRECT
-#define O_DIRECT 0
-#endif
+#include "../include/comp_input.h"
+#include "../include/rt_io.h"
 
 #define SOCK_PATH "/tmp/comp.sock"
-#define MAX_PATH_BYTES 4096
+#define MAX_PATH_BYTES (RT_IO_PATH_MAX - 1)  // longest path rt_io_read_begin takes
 #define METRICS_PORT 9100
-
-static volatile sig_atomic_t g_active_children = 0;
+#define COMP_FILE_HEADER_SIZE 64   // v2 COMP header in front of every payload
+#define WORKER_ARENA_CHUNK (2 * 1024 * 1024)  // NORMAL-level LZ77 tables with room to spare
+
+// Accepted connections waiting for a worker
+typedef struct {
+    int* fds;
+    int cap;
+    int head;
+    int count;
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+} ConnQueue;
+
+// State a worker keeps from one connection to the next
+typedef struct {
+    ConnQueue* queue;
+    RtIo* io;
+    CompArena* arena;
+} Worker;
 
 // Prometheus metrics (atomic)
 static volatile unsigned long long g_bytes_saved_total = 0ULL;
-static volatile double g_lz77_latency_seconds_last = 0.0;
-static volatile double g_lz77_latency_seconds_sum = 0.0;
+static volatile unsigned long long g_lz77_latency_ns_last = 0ULL;
+static volatile unsigned long long g_lz77_latency_ns_sum = 0ULL;
 static volatile unsigned long long g_lz77_latency_count = 0ULL;
 
-static void sigchld_handler(int signo) {
-    (void)signo;
-    int status;
-    // Reap all finished children
-    while (waitpid(-1, &status, WNOHANG) > 0) {
-        if (g_active_children > 0) g_active_children--;
-    }
-}
-
-static int read_full(int fd, void* buf, size_t len) {
-    unsigned char* p = (unsigned char*)buf;
-    size_t off = 0;
-    while (off < len) {
-        ssize_t r = read(fd, p + off, len - off);
-        if (r == 0) return -1; // EOF
-        if (r < 0) {
-            if (errno == EINTR) continue;
-            return -1;
-        }
-        off += (size_t)r;
-    }
-    return 0;
-}
-
 static int write_full(int fd, const void* buf, size_t len) {
     const unsigned char* p = (const unsigned char*)buf;
     size_t off = 0;
@@ -103,77 +101,6 @@ static void be64_encode(uint64_t v, unsigned char b[8]) {
     b[7] = (unsigned char)(v & 0xFF);
 }
 
-static size_t direct_alignment(void) {
-    long ps = sysconf(_SC_PAGESIZE);
-    if (ps <= 0) ps = 4096;
-    return (size_t)ps;
-}
-
-static int read_file_direct_or_fallback(const char* path, unsigned char** out_buf, long* out_size) {
-    *out_buf = NULL; *out_size = 0;
-    int fd = open(path, O_RDONLY | O_DIRECT);
-    struct stat st;
-    if (fd < 0) {
-        // Fallback: normal read
-        unsigned char* buf = NULL; long sz = 0;
-        if (read_file(path, &buf, &sz) != 0) return -1;
-        *out_buf = buf; *out_size = sz;
-        return 0;
-    }
-    if (fstat(fd, &st) != 0) { close(fd); return -1; }
-    long size = (long)st.st_size;
-    size_t align = direct_alignment();
-    size_t padded = ((size + align - 1) / align) * align;
-    unsigned char* buf = NULL;
-    if (posix_memalign((void**)&buf, align, padded) != 0) { close(fd); return -1; }
-    memset(buf, 0, padded);
-    long read_total = 0;
-    while (read_total < size) {
-        ssize_t r = read(fd, buf + read_total, (size_t)(size - read_total));
-        if (r < 0) {
-            if (errno == EINTR) continue;
-            // If direct read fails mid-way, fallback via normal read
-            free(buf); close(fd);
-            unsigned char* fbuf = NULL; long fsz = 0;
-            if (read_file(path, &fbuf, &fsz) != 0) return -1;
-            *out_buf = fbuf; *out_size = fsz;
-            return 0;
-        }
-        if (r == 0) break;
-        read_total += (long)r;
-    }
-    close(fd);
-    *out_buf = buf;
-    *out_size = size;
-    return 0;
-}
-
-static int direct_write_all(int fd, const unsigned char* data, long size) {
-    size_t align = direct_alignment();
-    size_t padded = ((size + align - 1) / align) * align;
-    unsigned char* wbuf = NULL;
-    if (posix_memalign((void**)&wbuf, align, padded) != 0) return -1;
-    memset(wbuf, 0, padded);
-    memcpy(wbuf, data, (size_t)size);
-    size_t off = 0;
-    while (off < padded) {
-        ssize_t w = write(fd, wbuf + off, padded - off);
-        if (w < 0) {
-            if (errno == EINTR) continue;
-            free(wbuf);
-            return -1;
-        }
-        off += (size_t)w;
-    }
-    // shrink to actual size
-    if (ftruncate(fd, (off_t)size) != 0) {
-        free(wbuf);
-        return -1;
-    }
-    free(wbuf);
-    return 0;
-}
-
 // Minimal HTTP metrics server (Prometheus text format)
 static void* metrics_thread_func(void* arg) {
     (void)arg;
@@ -211,7 +138,7 @@ static void* metrics_thread_func(void* arg) {
 
         // Snapshot metrics atomically
         unsigned long long bytes_saved = __atomic_load_n(&g_bytes_saved_total, __ATOMIC_RELAXED);
-        double lz77_last = __atomic_load_n(&g_lz77_latency_seconds_last, __ATOMIC_RELAXED);
+        double lz77_last = (double)__atomic_load_n(&g_lz77_latency_ns_last, __ATOMIC_RELAXED) / 1e9;
 
         char body[512];
         int blen = snprintf(body, sizeof(body),
@@ -238,22 +165,26 @@ static void* metrics_thread_func(void* arg) {
     return NULL;
 }
 
-// Clone-and-compress with algorithm selection and O_DIRECT I/O
-static CompResult intelligent_compress_file(const char* input_path, char* out_path, size_t out_path_cap, uint64_t* out_comp_size) {
+// Clone-and-compress with algorithm selection; in is the request's input as
+// read by the engine, and the output goes out through it as well. The LZ77
+// match finder allocates from arena, which the caller resets between requests.
+static CompResult intelligent_compress_file(RtIo* io, CompArena* arena, const char* input_path, const CompInput* in,
+                                            char* out_path, size_t out_path_cap, uint64_t* out_comp_size) {
     CompResult ret = COMP_OK;
-    unsigned char* input = NULL;
+    const unsigned char* input = NULL;
     long input_size = 0;
     unsigned char* output = NULL;
     long output_size = 0;
-    time_t start_ms = 0, end_ms = 0;
+    size_t ring_cap = 0;
+    unsigned char* ring_buf = rt_io_output_buffer(io, &ring_cap);
+    unsigned char* file_buf = NULL;
+    size_t file_cap = 0;
 
-    if (!input_path || !out_path || !out_comp_size) return COMP_ERROR_INVALID_PARAM;
+    if (!input_path || !in || !out_path || !out_comp_size) return COMP_ERROR_INVALID_PARAM;
 
-    // Read input using O_DIRECT if possible
-    if (read_file_direct_or_fallback(input_path, &input, &input_size) != 0 || !input || input_size <= 0) {
-        ret = COMP_ERROR_FILE_READ;
-        goto fail;
-    }
+    if (in->size == 0 || in->size > (size_t)LONG_MAX) return COMP_ERROR_FILE_READ;
+    input = in->data;
+    input_size = (long)in->size;
 
     // Compute metrics and decide algorithm
     double entropy = 0.0, ascii_ratio = 0.0, repeat_freq = 0.0; int is_binary = 0;
@@ -264,46 +195,66 @@ static CompResult intelligent_compress_file(const char* input_path, char* out_pa
     double chunk_ratio = 100.0; long chunk_size_out = 0;
     (void)Compressor_Test_CheckEarly(algo, input, input_size, &chunk_ratio, &chunk_size_out);
 
+    // Header and payload share one aligned buffer: the engine's registered
+    // output buffer when it fits, else one allocated to size. Huffman and
+    // LZ77 encode straight into it behind the header; the other codecs
+    // allocate their own output, which is copied in afterwards.
+    long into_cap = (algo == ALGO_HUFFMAN) ? huffman_compress_bound(input_size)
+                  : (algo == ALGO_LZ77)    ? lz77_compress_bound(input_size) : 0;
+    if (into_cap > 0) {
+        file_cap = rt_io_direct_size((size_t)(COMP_FILE_HEADER_SIZE + into_cap));
+        if (file_cap <= ring_cap) {
+            file_buf = ring_buf;
+        } else if (posix_memalign((void**)&file_buf, rt_io_direct_align(), file_cap) != 0) {
+            file_buf = NULL;
+            ret = COMP_ERROR_MEMORY;
+            goto fail;
+        }
+    }
+
     // Compress buffer using selected algorithm (measure latency)
     struct timespec t0, t1;
     clock_gettime(CLOCK_MONOTONIC, &t0);
     int rc = -1;
+    unsigned char* payload = file_buf ? file_buf + COMP_FILE_HEADER_SIZE : NULL;
     switch (algo) {
-        case ALGO_HUFFMAN: rc = huffman_compress(input, input_size, &output, &output_size); break;
-        case ALGO_LZ77:    rc = lz77_compress(input, input_size, &output, &output_size);    break;
+        case ALGO_HUFFMAN: rc = huffman_compress_into(input, input_size, payload, into_cap, &output_size); break;
+        case ALGO_LZ77:    rc = lz77_compress_into_arena(input, input_size, payload, into_cap, &output_size,
+                                                         COMPRESSION_LEVEL_NORMAL, arena); break;
         case ALGO_LZW:     rc = lzw_compress(input, input_size, &output, &output_size);     break;
         case ALGO_HARDCORE:rc = hardcore_compress(input, input_size, &output, &output_size);break;
         default:           rc = -1; break;
     }
     clock_gettime(CLOCK_MONOTONIC, &t1);
-    double latency = (double)(t1.tv_sec - t0.tv_sec) + (double)(t1.tv_nsec - t0.tv_nsec) / 1e9;
+    unsigned long long latency_ns = (unsigned long long)(t1.tv_sec - t0.tv_sec) * 1000000000ULL +
+                                    (unsigned long long)(t1.tv_nsec - t0.tv_nsec);
     if (algo == ALGO_LZ77) {
-        __atomic_store_n(&g_lz77_latency_seconds_last, latency, __ATOMIC_RELAXED);
-        (void)__atomic_fetch_add(&g_lz77_latency_seconds_sum, latency, __ATOMIC_RELAXED);
+        __atomic_store_n(&g_lz77_latency_ns_last, latency_ns, __ATOMIC_RELAXED);
+        (void)__atomic_fetch_add(&g_lz77_latency_ns_sum, latency_ns, __ATOMIC_RELAXED);
         (void)__atomic_fetch_add(&g_lz77_latency_count, 1ULL, __ATOMIC_RELAXED);
     }
-    if (rc != 0 || !output || output_size <= 0) {
+    if (rc != 0 || (!payload && !output) || output_size <= 0) {
         ret = COMP_ERROR_COMPRESSION_FAILED;
         goto fail;
     }
+    if (!payload) {
+        file_cap = rt_io_direct_size((size_t)(COMP_FILE_HEADER_SIZE + output_size));
+        if (file_cap <= ring_cap) {
+            file_buf = ring_buf;
+        } else if (posix_memalign((void**)&file_buf, rt_io_direct_align(), file_cap) != 0) {
+            file_buf = NULL;
+            ret = COMP_ERROR_MEMORY;
+            goto fail;
+        }
+        memcpy(file_buf + COMP_FILE_HEADER_SIZE, output, (size_t)output_size);
+    }
 
     // Compose output path: alongside input, append .comp
-    const char* slash = strrchr(input_path, '/');
-    const char* base = slash ? (slash + 1) : input_path;
-    char dir[1024];
-    if (slash) {
-        size_t dlen = (size_t)(slash - input_path);
-        if (dlen >= sizeof(dir)) dlen = sizeof(dir) - 1;
-        memcpy(dir, input_path, dlen);
-        dir[dlen] = '\0';
-        snprintf(out_path, out_path_cap, "%.*s/%s.comp", (int)dlen, input_path, base);
-    } else {
-        snprintf(out_path, out_path_cap, "%s.comp", base);
-    }
+    snprintf(out_path, out_path_cap, "%s.comp", input_path);
 
-    // Build v2 COMP header (64 bytes)
-    unsigned char header[64];
-    memset(header, 0, sizeof(header));
+    // Build v2 COMP header (64 bytes) in front of the payload
+    unsigned char* header = file_buf;
+    memset(header, 0, COMP_FILE_HEADER_SIZE);
     header[0] = 'C'; header[1] = 'O'; header[2] = 'M'; header[3] = 'P';
     header[4] = 2; // version
     header[5] = (unsigned char)algo;
@@ -311,39 +262,19 @@ static CompResult intelligent_compress_file(const char* input_path, char* out_pa
     header[7] = 0;
     for (int i = 0; i < 8; i++) header[8 + i]  = (unsigned char)((((uint64_t)input_size)   >> ((7 - i) * 8)) & 0xFF);
     for (int i = 0; i < 8; i++) header[16 + i] = (unsigned char)((((uint64_t)output_size)  >> ((7 - i) * 8)) & 0xFF);
-    uint32_t comp_time_ms = 0; // simplified
+    uint32_t comp_time_ms = (uint32_t)(latency_ns / 1000000ULL);
     for (int i = 0; i < 4; i++) header[24 + i] = (unsigned char)((comp_time_ms >> ((3 - i) * 8)) & 0xFF);
-    uint32_t mem_kb = 0; // simplified, could pull from memory pool
+    // Workers share the allocator's peak, so record the codec's own cost
+    uint32_t mem_kb = (uint32_t)(codec_memory_cost(algo, COMPRESSION_LEVEL_NORMAL, input_size) / 1024);
     for (int i = 0; i < 4; i++) header[28 + i] = (unsigned char)((mem_kb >> ((3 - i) * 8)) & 0xFF);
 
-    // Prepare single contiguous buffer: header + payload
-    long combined_size = (long)sizeof(header) + output_size;
-    unsigned char* combined = (unsigned char*)malloc((size_t)combined_size);
-    if (!combined) { ret = COMP_ERROR_MEMORY; goto fail; }
-    memcpy(combined, header, sizeof(header));
-    memcpy(combined + sizeof(header), output, (size_t)output_size);
-
-    // Open output with O_DIRECT (fallback to normal write if needed)
-    int ofd = open(out_path, O_CREAT | O_TRUNC | O_WRONLY | O_DIRECT, 0644);
-    if (ofd < 0) {
-        // Fallback to normal write if O_DIRECT unsupported
-        ofd = open(out_path, O_CREAT | O_TRUNC | O_WRONLY, 0644);
-    }
-    if (ofd < 0) { free(combined); ret = COMP_ERROR_FILE_WRITE; goto fail; }
-
-    if (direct_write_all(ofd, combined, combined_size) != 0) {
-        // Fallback: rewrite without O_DIRECT
-        close(ofd);
-        ofd = open(out_path, O_CREAT | O_TRUNC | O_WRONLY, 0644);
-        if (ofd < 0) { free(combined); ret = COMP_ERROR_FILE_WRITE; goto fail; }
-        if (write_full(ofd, combined, (size_t)combined_size) != 0) { close(ofd); free(combined); ret = COMP_ERROR_FILE_WRITE; goto fail; }
-        close(ofd);
-    } else {
-        close(ofd);
+    long file_size = COMP_FILE_HEADER_SIZE + output_size;
+    if (rt_io_write_file(io, out_path, file_buf, (size_t)file_size, file_cap) != 0) {
+        ret = COMP_ERROR_FILE_WRITE;
+        goto fail;
     }
 
-    *out_comp_size = (uint64_t)combined_size;
-    free(combined);
+    *out_comp_size = (uint64_t)file_size;
 
     // Update bytes saved counter atomically
     long saved = input_size - output_size;
@@ -353,11 +284,75 @@ static CompResult intelligent_compress_file(const char* input_path, char* out_pa
     ret = COMP_OK;
 
 fail:
-    if (input) COMP_FREE(input);
     if (output) COMP_FREE(output);
+    if (file_buf != ring_buf) free(file_buf);
     return ret;
 }
 
+// One request off the connection: the path, NUL-terminated into path
+static int recv_request(RtIo* io, char path[MAX_PATH_BYTES + 1]) {
+    unsigned char len_buf[8];
+    if (rt_io_recv_full(io, len_buf, sizeof(len_buf)) != 0) return -1;
+    uint64_t path_len = be64_decode(len_buf);
+    if (path_len == 0 || path_len > MAX_PATH_BYTES) return -1;
+    if (rt_io_recv_full(io, path, (size_t)path_len) != 0) return -1;
+    path[path_len] = '\0';
+    return 0;
+}
+
+// Serve requests on cfd until the client closes it. Inputs alternate
+// between the engine's read slots: when the next request is already
+// waiting, its read is queued before the current compression starts. A
+// request whose read cannot be queued is answered with a read error.
+static void serve_connection(Worker* w, int cfd) {
+    RtIo* io = w->io;
+    char path[RT_IO_SLOTS][MAX_PATH_BYTES + 1];
+    int queued[RT_IO_SLOTS] = {0};
+    if (rt_io_attach(io, cfd) != 0) return;
+    int cur = 0;
+    if (recv_request(io, path[cur]) != 0) {
+        rt_io_detach(io);
+        return;
+    }
+    queued[cur] = rt_io_read_begin(io, cur, path[cur]) == 0;
+    for (;;) {
+        CompInput in;
+        int read_ok = queued[cur] && rt_io_read_end(io, cur, &in) == 0;
+
+        int next = (cur + 1) % RT_IO_SLOTS;
+        int have_next = 0, closed = 0;
+        if (rt_io_conn_ready(io)) {
+            if (recv_request(io, path[next]) == 0) {
+                queued[next] = rt_io_read_begin(io, next, path[next]) == 0;
+                have_next = 1;
+            } else {
+                closed = 1;
+            }
+        }
+
+        char out_path[MAX_PATH_BYTES + 16];
+        uint64_t comp_size = 0;
+        CompResult status = read_ok ? intelligent_compress_file(io, w->arena, path[cur], &in, out_path,
+                                                                sizeof(out_path), &comp_size)
+                                    : COMP_ERROR_FILE_READ;
+        if (read_ok) comp_input_close(&in);
+        comp_arena_reset(w->arena);
+
+        // Respond to client
+        unsigned char resp[9];
+        resp[0] = (unsigned char)status;
+        be64_encode(comp_size, resp + 1);
+        if (rt_io_send_full(io, resp, sizeof(resp)) != 0) break;
+
+        if (!have_next) {
+            if (closed || recv_request(io, path[next]) != 0) break;
+            queued[next] = rt_io_read_begin(io, next, path[next]) == 0;
+        }
+        cur = next;
+    }
+    rt_io_detach(io);
+}
+
 static int get_max_procs(void) {
     // Prefer external `nproc --all`
     FILE* f = popen("nproc --all", "r");
@@ -375,13 +370,54 @@ static int get_max_procs(void) {
     return (int)n;
 }
 
+// ===== Worker pool =====
+
+static int conn_queue_init(ConnQueue* q, int cap) {
+    q->fds = (int*)malloc(sizeof(int) * (size_t)cap);
+    if (!q->fds) return -1;
+    q->cap = cap;
+    q->head = 0;
+    q->count = 0;
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_cond_init(&q->not_empty, NULL);
+    pthread_cond_init(&q->not_full, NULL);
+    return 0;
+}
+
+// Blocks while the queue is full, which holds further accepts back
+static void conn_queue_push(ConnQueue* q, int fd) {
+    pthread_mutex_lock(&q->lock);
+    while (q->count == q->cap) pthread_cond_wait(&q->not_full, &q->lock);
+    q->fds[(q->head + q->count) % q->cap] = fd;
+    q->count++;
+    pthread_cond_signal(&q->not_empty);
+    pthread_mutex_unlock(&q->lock);
+}
+
+static int conn_queue_pop(ConnQueue* q) {
+    pthread_mutex_lock(&q->lock);
+    while (q->count == 0) pthread_cond_wait(&q->not_empty, &q->lock);
+    int fd = q->fds[q->head];
+    q->head = (q->head + 1) % q->cap;
+    q->count--;
+    pthread_cond_signal(&q->not_full);
+    pthread_mutex_unlock(&q->lock);
+    return fd;
+}
+
+static void* worker_main(void* arg) {
+    Worker* w = (Worker*)arg;
+    for (;;) {
+        int cfd = conn_queue_pop(w->queue);
+        serve_connection(w, cfd);
+        close(cfd);
+    }
+    return NULL;
+}
+
 int main(void) {
-    // Install SIGCHLD handler for concurrency accounting
-    struct sigaction sa; memset(&sa, 0, sizeof(sa));
-    sa.sa_handler = sigchld_handler;
-    sigemptyset(&sa.sa_mask);
-    sa.sa_flags = SA_RESTART | SA_NOCLDSTOP;
-    sigaction(SIGCHLD, &sa, NULL);
+    // A client that goes away mid-response must not take the server with it
+    signal(SIGPIPE, SIG_IGN);
 
     // Prepare socket file
     unlink(SOCK_PATH);
@@ -398,67 +434,62 @@ int main(void) {
     }
     if (listen(sfd, 128) < 0) { perror("listen"); close(sfd); return 1; }
 
-    int max_procs = get_max_procs();
-    fprintf(stderr, "[realtime] listening on %s (max children=%d)\n", SOCK_PATH, max_procs);
+    // Start metrics HTTP server thread (detached)
+    pthread_t mtid;
+    if (pthread_create(&mtid, NULL, metrics_thread_func, NULL) == 0) {
+        pthread_detach(mtid);
+    }
 
-    for (;;) {
-        // Back-pressure: wait until capacity is available before accept
-        while (g_active_children >= max_procs) {
-            // Block until a child exits
-            int status;
-            if (waitpid(-1, &status, 0) > 0) {
-                if (g_active_children > 0) g_active_children--;
-            }
+    // One worker per CPU; at most as many accepted connections again wait
+    // in the queue, the rest stay in the listen backlog
+    int max_procs = get_max_procs();
+    ConnQueue queue;
+    Worker* workers = (Worker*)calloc((size_t)max_procs, sizeof(Worker));
+    if (!workers || conn_queue_init(&queue, max_procs) != 0) {
+        fprintf(stderr, "[realtime] out of memory\n");
+        close(sfd);
+        return 1;
+    }
+    int started = 0;
+    for (int i = 0; i < max_procs; i++) {
+        Worker* w = &workers[i];
+        w->queue = &queue;
+        w->io = rt_io_create(max_procs);
+        w->arena = comp_arena_create(WORKER_ARENA_CHUNK);
+        pthread_t tid;
+        if (!w->io || !w->arena || pthread_create(&tid, NULL, worker_main, w) != 0) {
+            rt_io_destroy(w->io);
+            comp_arena_destroy(w->arena);
+            break;
         }
+        pthread_detach(tid);
+        started++;
+    }
+    if (started == 0) {
+        fprintf(stderr, "[realtime] could not start any worker\n");
+        close(sfd);
+        return 1;
+    }
+    int blocking = 0;
+    for (int i = 0; i < started; i++) {
+        if (strcmp(rt_io_backend(workers[i].io), "blocking") == 0) blocking++;
+    }
+    fprintf(stderr, "[realtime] listening on %s (workers=%d, %d on io_uring, %d on blocking I/O)\n",
+            SOCK_PATH, started, started - blocking, blocking);
 
-        int cfd = accept(sfd, NULL, NULL);
+    // Accepts are plain syscalls: an engine here would pin buffers the
+    // workers' engines need
+    for (;;) {
+        int cfd = accept4(sfd, NULL, NULL, SOCK_CLOEXEC);
         if (cfd < 0) {
             if (errno == EINTR) continue;
             perror("accept");
             continue;
         }
-
-        pid_t pid = fork();
-        if (pid < 0) {
-            perror("fork");
-            close(cfd);
-            continue;
-        }
-        if (pid == 0) {
-            // Child process: handle request
-            unsigned char len_buf[8];
-            if (read_full(cfd, len_buf, sizeof(len_buf)) != 0) { close(cfd); _exit(0); }
-            uint64_t path_len = be64_decode(len_buf);
-            if (path_len == 0 || path_len > MAX_PATH_BYTES) { close(cfd); _exit(0); }
-            char* path = (char*)malloc((size_t)path_len + 1);
-            if (!path) { close(cfd); _exit(0); }
-            if (read_full(cfd, path, (size_t)path_len) != 0) { free(path); close(cfd); _exit(0); }
-            path[path_len] = '\0';
-
-            char out_path[1024];
-            uint64_t comp_size = 0;
-            CompResult status = intelligent_compress_file(path, out_path, sizeof(out_path), &comp_size);
-
-            unsigned char status_byte = (unsigned char)status;
-            unsigned char sz_buf[8]; be64_encode(comp_size, sz_buf);
-            // Respond to client
-            (void)write_full(cfd, &status_byte, 1);
-            (void)write_full(cfd, sz_buf, sizeof(sz_buf));
-            close(cfd);
-            _exit(0);
-        } else {
-            // Parent: record child and close client fd
-            g_active_children++;
-            close(cfd);
-        }
+        conn_queue_push(&queue, cfd);
     }
 
     // Not reached
     close(sfd);
     return 0;
 }
-    // Start metrics HTTP server thread (detached)
-    pthread_t mtid;
-    if (pthread_create(&mtid, NULL, metrics_thread_func, NULL) == 0) {
-        pthread_detach(mtid);
-    }
\ No newline at end of file
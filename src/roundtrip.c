@@ -24,7 +24,7 @@ int main(void) {
     printf("Roundtrip: compress -> decompress -> compare\n");
     printf("Source: %s\n", src);
 
-    if (compress_file_intelligent(src, comp, COMPRESSION_LEVEL_NORMAL, &stats) != 0) {
+    if (compress_file_intelligent(src, comp, COMPRESSION_LEVEL_NORMAL, 0, &stats) != 0) {
         printf("Compression failed.\n");
         return 1;
     }
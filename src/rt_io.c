@@ -0,0 +1,442 @@
+// I/O engine of the realtime server: io_uring with a blocking fallback
+#define _GNU_SOURCE
+#include "../include/rt_io.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#ifdef HAVE_LIBURING
+#include <liburing.h>
+#endif
+
+#ifndef O_DIRECT
+#define O_DIRECT 0
+#endif
+
+#define RT_IO_QUEUE_DEPTH 32
+
+// Completion tags (user_data). Each operation has one tag, and a tag is
+// not reused before its completion has been reaped.
+enum {
+    OP_ACCEPT,
+    OP_RECV,
+    OP_SEND,
+    OP_OUT_OPEN,
+    OP_OUT_WRITE,
+    OP_OUT_CLOSE,
+    OP_SLOT_BASE    // then open, read, close per input slot
+};
+#define OP_SLOT(slot, step) (OP_SLOT_BASE + (slot) * 3 + (step))
+#define RT_IO_OPS OP_SLOT(RT_IO_SLOTS, 0)
+
+// Fixed-file table: the connection, one file per input slot, the output
+#define FILE_CONN 0
+#define FILE_IN(slot) (1 + (slot))
+#define FILE_OUT (1 + RT_IO_SLOTS)
+#define FILE_COUNT (2 + RT_IO_SLOTS)
+
+// Registered buffers: one per input slot, then the output buffer
+#define BUF_OUT RT_IO_SLOTS
+#define RT_IO_PINNED_BYTES ((size_t)RT_IO_SLOTS * RT_IO_INPUT_BUF + RT_IO_OUTPUT_BUF)
+
+struct RtIo {
+    int uring;
+    int fixed_bufs;                 // buffers registered with the ring
+#ifdef HAVE_LIBURING
+    struct io_uring ring;
+#endif
+    int conn_fd;                    // -1 when detached
+    unsigned char* in_buf[RT_IO_SLOTS];
+    unsigned char* out_buf;
+    char in_path[RT_IO_SLOTS][RT_IO_PATH_MAX];
+    int in_pending[RT_IO_SLOTS];
+    int in_ring[RT_IO_SLOTS];       // read queued on the ring, else mapped by read_end
+    int done[RT_IO_OPS];
+    int res[RT_IO_OPS];
+};
+
+size_t rt_io_direct_align(void) {
+    long ps = sysconf(_SC_PAGESIZE);
+    if (ps <= 0) ps = 4096;
+    return (size_t)ps;
+}
+
+size_t rt_io_direct_size(size_t size) {
+    size_t align = rt_io_direct_align();
+    return ((size + align - 1) / align) * align;
+}
+
+// ===== Blocking path =====
+
+static int read_full(int fd, void* buf, size_t len) {
+    unsigned char* p = (unsigned char*)buf;
+    size_t off = 0;
+    while (off < len) {
+        ssize_t r = read(fd, p + off, len - off);
+        if (r == 0) return -1; // EOF
+        if (r < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        off += (size_t)r;
+    }
+    return 0;
+}
+
+static int write_full(int fd, const void* buf, size_t len) {
+    const unsigned char* p = (const unsigned char*)buf;
+    size_t off = 0;
+    while (off < len) {
+        ssize_t w = write(fd, p + off, len - off);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        off += (size_t)w;
+    }
+    return 0;
+}
+
+// O_DIRECT write of an aligned buffer holding rt_io_direct_size(size) bytes;
+// the padding is zeroed and cut off again afterwards
+static int direct_write_padded(int fd, unsigned char* wbuf, size_t size) {
+    size_t padded = rt_io_direct_size(size);
+    memset(wbuf + size, 0, padded - size);
+    if (write_full(fd, wbuf, padded) != 0) return -1;
+    // shrink to actual size
+    if (ftruncate(fd, (off_t)size) != 0) return -1;
+    return 0;
+}
+
+static int blocking_write_file(const char* path, unsigned char* buf, size_t size, size_t buf_cap) {
+    // O_DIRECT first, then a plain rewrite if that is unsupported or fails
+    if (buf_cap >= rt_io_direct_size(size)) {
+        int fd = open(path, O_CREAT | O_TRUNC | O_WRONLY | O_DIRECT | O_CLOEXEC, 0644);
+        if (fd >= 0) {
+            int r = direct_write_padded(fd, buf, size);
+            close(fd);
+            if (r == 0) return 0;
+        }
+    }
+    int fd = open(path, O_CREAT | O_TRUNC | O_WRONLY | O_CLOEXEC, 0644);
+    if (fd < 0) return -1;
+    int r = write_full(fd, buf, size);
+    if (close(fd) != 0) r = -1;
+    return r;
+}
+
+// ===== io_uring path =====
+#ifdef HAVE_LIBURING
+
+static void uring_reap(RtIo* io, struct io_uring_cqe* cqe) {
+    uintptr_t op = (uintptr_t)io_uring_cqe_get_data(cqe);
+    if (op < RT_IO_OPS) {
+        io->res[op] = cqe->res;
+        io->done[op] = 1;
+    }
+    io_uring_cqe_seen(&io->ring, cqe);
+}
+
+// Wait for op; its result (negative errno on failure)
+static int uring_wait(RtIo* io, int op) {
+    while (!io->done[op]) {
+        struct io_uring_cqe* cqe;
+        int r = io_uring_wait_cqe(&io->ring, &cqe);
+        if (r == -EINTR) continue;
+        if (r < 0) return r;
+        uring_reap(io, cqe);
+    }
+    return io->res[op];
+}
+
+// Make room for a chain of n entries; every call submits what it queued,
+// so one submit always empties the queue
+static void uring_reserve(RtIo* io, unsigned n) {
+    if (io_uring_sq_space_left(&io->ring) < n) io_uring_submit(&io->ring);
+}
+
+static struct io_uring_sqe* uring_sqe(RtIo* io, int op) {
+    struct io_uring_sqe* sqe = io_uring_get_sqe(&io->ring);
+    io->done[op] = 0;
+    io_uring_sqe_set_data(sqe, (void*)(uintptr_t)op);
+    return sqe;
+}
+
+// One socket operation on the connection, waited for
+static int uring_sock_op(RtIo* io, int op, void* buf, size_t len) {
+    uring_reserve(io, 1);
+    struct io_uring_sqe* sqe = uring_sqe(io, op);
+    if (op == OP_RECV) io_uring_prep_recv(sqe, FILE_CONN, buf, len, 0);
+    else io_uring_prep_send(sqe, FILE_CONN, buf, len, MSG_NOSIGNAL);
+    sqe->flags |= IOSQE_FIXED_FILE;
+    io_uring_submit_and_wait(&io->ring, 1);
+    return uring_wait(io, op);
+}
+
+// Registered buffers are pinned, and pinned memory counts against
+// RLIMIT_MEMLOCK, which every engine in the process shares. Registering
+// only when this engine's share covers them keeps the later engines from
+// failing; the others read and write the same buffers unregistered.
+static int uring_buffers_fit(int engines) {
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_MEMLOCK, &rl) != 0) return 0;
+    if (rl.rlim_cur == RLIM_INFINITY) return 1;
+    if (engines < 1) engines = 1;
+    return rl.rlim_cur / (rlim_t)engines >= RT_IO_PINNED_BYTES;
+}
+
+static int uring_setup(RtIo* io, int engines) {
+    if (io_uring_queue_init(RT_IO_QUEUE_DEPTH, &io->ring, 0) < 0) return -1;
+    // Sparse tables are 5.19+; older kernels take the blocking path
+    if (io_uring_register_files_sparse(&io->ring, FILE_COUNT) < 0) {
+        io_uring_queue_exit(&io->ring);
+        return -1;
+    }
+    if (uring_buffers_fit(engines)) {
+        struct iovec iov[RT_IO_SLOTS + 1];
+        for (int s = 0; s < RT_IO_SLOTS; s++) {
+            iov[s].iov_base = io->in_buf[s];
+            iov[s].iov_len = RT_IO_INPUT_BUF;
+        }
+        iov[BUF_OUT].iov_base = io->out_buf;
+        iov[BUF_OUT].iov_len = RT_IO_OUTPUT_BUF;
+        io->fixed_bufs = io_uring_register_buffers(&io->ring, iov, RT_IO_SLOTS + 1) >= 0;
+    }
+    return 0;
+}
+
+#endif /* HAVE_LIBURING */
+
+// ===== Engine =====
+
+RtIo* rt_io_create(int engines) {
+    RtIo* io = (RtIo*)calloc(1, sizeof(RtIo));
+    if (!io) return NULL;
+    io->conn_fd = -1;
+    size_t align = rt_io_direct_align();
+    if (posix_memalign((void**)&io->out_buf, align, RT_IO_OUTPUT_BUF) != 0) {
+        free(io);
+        return NULL;
+    }
+#ifdef HAVE_LIBURING
+    int bufs = 1;
+    for (int s = 0; s < RT_IO_SLOTS; s++) {
+        if (posix_memalign((void**)&io->in_buf[s], align, RT_IO_INPUT_BUF) != 0) {
+            io->in_buf[s] = NULL;
+            bufs = 0;
+        }
+    }
+    io->uring = bufs && uring_setup(io, engines) == 0;
+#else
+    (void)engines;
+#endif
+    if (!io->uring) {
+        // Input buffers are only used by the ring
+        for (int s = 0; s < RT_IO_SLOTS; s++) {
+            free(io->in_buf[s]);
+            io->in_buf[s] = NULL;
+        }
+    }
+    return io;
+}
+
+void rt_io_destroy(RtIo* io) {
+    if (!io) return;
+    rt_io_detach(io);
+#ifdef HAVE_LIBURING
+    if (io->uring) io_uring_queue_exit(&io->ring);
+#endif
+    for (int s = 0; s < RT_IO_SLOTS; s++) free(io->in_buf[s]);
+    free(io->out_buf);
+    free(io);
+}
+
+const char* rt_io_backend(const RtIo* io) {
+    return (io && io->uring) ? "io_uring" : "blocking";
+}
+
+int rt_io_accept(RtIo* io, int listen_fd) {
+#ifdef HAVE_LIBURING
+    if (io->uring) {
+        uring_reserve(io, 1);
+        struct io_uring_sqe* sqe = uring_sqe(io, OP_ACCEPT);
+        io_uring_prep_accept(sqe, listen_fd, NULL, NULL, SOCK_CLOEXEC);
+        io_uring_submit_and_wait(&io->ring, 1);
+        int r = uring_wait(io, OP_ACCEPT);
+        if (r < 0) { errno = -r; return -1; }
+        return r;
+    }
+#endif
+    (void)io;
+    return accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC);
+}
+
+int rt_io_attach(RtIo* io, int fd) {
+    rt_io_detach(io);
+#ifdef HAVE_LIBURING
+    if (io->uring && io_uring_register_files_update(&io->ring, FILE_CONN, &fd, 1) != 1) return -1;
+#endif
+    io->conn_fd = fd;
+    return 0;
+}
+
+void rt_io_detach(RtIo* io) {
+    // Reads nobody collected still own their slot
+    for (int s = 0; s < RT_IO_SLOTS; s++) {
+        if (io->in_pending[s]) {
+            CompInput in;
+            if (rt_io_read_end(io, s, &in) == 0) comp_input_close(&in);
+        }
+    }
+    if (io->conn_fd < 0) return;
+#ifdef HAVE_LIBURING
+    if (io->uring) {
+        // The table holds a reference that would keep the socket open
+        int none = -1;
+        io_uring_register_files_update(&io->ring, FILE_CONN, &none, 1);
+    }
+#endif
+    io->conn_fd = -1;
+}
+
+int rt_io_recv_full(RtIo* io, void* buf, size_t len) {
+    if (io->conn_fd < 0) return -1;
+#ifdef HAVE_LIBURING
+    if (io->uring) {
+        unsigned char* p = (unsigned char*)buf;
+        size_t off = 0;
+        while (off < len) {
+            int r = uring_sock_op(io, OP_RECV, p + off, len - off);
+            if (r == -EINTR) continue;
+            if (r <= 0) return -1;
+            off += (size_t)r;
+        }
+        return 0;
+    }
+#endif
+    return read_full(io->conn_fd, buf, len);
+}
+
+int rt_io_send_full(RtIo* io, const void* buf, size_t len) {
+    if (io->conn_fd < 0) return -1;
+#ifdef HAVE_LIBURING
+    if (io->uring) {
+        const unsigned char* p = (const unsigned char*)buf;
+        size_t off = 0;
+        while (off < len) {
+            int r = uring_sock_op(io, OP_SEND, (void*)(p + off), len - off);
+            if (r == -EINTR) continue;
+            if (r <= 0) return -1;
+            off += (size_t)r;
+        }
+        return 0;
+    }
+#endif
+    return write_full(io->conn_fd, buf, len);
+}
+
+int rt_io_conn_ready(RtIo* io) {
+    if (io->conn_fd < 0) return 0;
+    // A plain peek on both paths: an armed poll would go stale as soon as a
+    // blocking recv consumed the data it fired for
+    unsigned char b;
+    ssize_t r = recv(io->conn_fd, &b, 1, MSG_PEEK | MSG_DONTWAIT);
+    return r >= 0 || (errno != EAGAIN && errno != EWOULDBLOCK);
+}
+
+int rt_io_read_begin(RtIo* io, int slot, const char* path) {
+    if (slot < 0 || slot >= RT_IO_SLOTS || !path || io->in_pending[slot]) { errno = EINVAL; return -1; }
+    size_t n = strlen(path);
+    if (n >= RT_IO_PATH_MAX) { errno = ENAMETOOLONG; return -1; }
+    memcpy(io->in_path[slot], path, n + 1);
+    io->in_pending[slot] = 1;
+    io->in_ring[slot] = 0;
+#ifdef HAVE_LIBURING
+    // Inputs the buffer cannot hold are mapped by read_end without a trip
+    // through the ring; so are paths stat rejects, to get the error there
+    struct stat st;
+    if (io->uring && stat(path, &st) == 0 && S_ISREG(st.st_mode) && st.st_size < RT_IO_INPUT_BUF) {
+        // open -> read -> close as one chain; the close is hard-linked so a
+        // short read (any file smaller than the buffer) still closes it
+        uring_reserve(io, 3);
+        struct io_uring_sqe* open_sqe = uring_sqe(io, OP_SLOT(slot, 0));
+        struct io_uring_sqe* read_sqe = uring_sqe(io, OP_SLOT(slot, 1));
+        struct io_uring_sqe* close_sqe = uring_sqe(io, OP_SLOT(slot, 2));
+        io_uring_prep_openat_direct(open_sqe, AT_FDCWD, io->in_path[slot], O_RDONLY, 0, FILE_IN(slot));
+        open_sqe->flags |= IOSQE_IO_LINK;
+        if (io->fixed_bufs) {
+            io_uring_prep_read_fixed(read_sqe, FILE_IN(slot), io->in_buf[slot], RT_IO_INPUT_BUF, 0, slot);
+        } else {
+            io_uring_prep_read(read_sqe, FILE_IN(slot), io->in_buf[slot], RT_IO_INPUT_BUF, 0);
+        }
+        read_sqe->flags |= IOSQE_FIXED_FILE | IOSQE_IO_HARDLINK;
+        io_uring_prep_close_direct(close_sqe, FILE_IN(slot));
+        io_uring_submit(&io->ring);
+        io->in_ring[slot] = 1;
+    }
+#endif
+    return 0;
+}
+
+int rt_io_read_end(RtIo* io, int slot, CompInput* in) {
+    if (slot < 0 || slot >= RT_IO_SLOTS || !io->in_pending[slot]) { errno = EINVAL; return -1; }
+    io->in_pending[slot] = 0;
+    memset(in, 0, sizeof(*in));
+#ifdef HAVE_LIBURING
+    if (io->in_ring[slot]) {
+        int opened = uring_wait(io, OP_SLOT(slot, 0));
+        int got = uring_wait(io, OP_SLOT(slot, 1));
+        uring_wait(io, OP_SLOT(slot, 2));
+        if (opened >= 0 && got >= 0 && got < RT_IO_INPUT_BUF) {
+            // Owned by the engine, so comp_input_close has nothing to free
+            in->data = io->in_buf[slot];
+            in->size = (size_t)got;
+            return 0;
+        }
+        // Grew past the buffer, or the ring could not read it: map it,
+        // which also reports the error if there is one
+    }
+#endif
+    return comp_input_open(io->in_path[slot], COMP_INPUT_RANDOM, in);
+}
+
+unsigned char* rt_io_output_buffer(RtIo* io, size_t* cap) {
+    *cap = RT_IO_OUTPUT_BUF;
+    return io->out_buf;
+}
+
+int rt_io_write_file(RtIo* io, const char* path, unsigned char* buf, size_t size, size_t buf_cap) {
+#ifdef HAVE_LIBURING
+    // Buffered writes: small outputs would pay an extra ftruncate for O_DIRECT
+    if (io->uring && size <= INT32_MAX) {
+        uring_reserve(io, 3);
+        struct io_uring_sqe* open_sqe = uring_sqe(io, OP_OUT_OPEN);
+        struct io_uring_sqe* write_sqe = uring_sqe(io, OP_OUT_WRITE);
+        struct io_uring_sqe* close_sqe = uring_sqe(io, OP_OUT_CLOSE);
+        io_uring_prep_openat_direct(open_sqe, AT_FDCWD, path, O_CREAT | O_TRUNC | O_WRONLY, 0644, FILE_OUT);
+        open_sqe->flags |= IOSQE_IO_LINK;
+        if (io->fixed_bufs && buf == io->out_buf && size <= RT_IO_OUTPUT_BUF) {
+            io_uring_prep_write_fixed(write_sqe, FILE_OUT, buf, (unsigned)size, 0, BUF_OUT);
+        } else {
+            io_uring_prep_write(write_sqe, FILE_OUT, buf, (unsigned)size, 0);
+        }
+        write_sqe->flags |= IOSQE_FIXED_FILE | IOSQE_IO_HARDLINK;
+        io_uring_prep_close_direct(close_sqe, FILE_OUT);
+        io_uring_submit_and_wait(&io->ring, 3);
+        int opened = uring_wait(io, OP_OUT_OPEN);
+        int wrote = uring_wait(io, OP_OUT_WRITE);
+        int closed = uring_wait(io, OP_OUT_CLOSE);
+        if (opened >= 0 && wrote >= 0 && (size_t)wrote == size && closed >= 0) return 0;
+        // Retry the whole file on the blocking path
+    }
+#endif
+    (void)io;
+    return blocking_write_file(path, buf, size, buf_cap);
+}
@@ -30,7 +30,7 @@ static int run_one(const char* path, const char* label, double* ratio_out, int*
     printf("\n=== %s ===\n", label);
     printf("Source: %s\n", path);
 
-    if (compress_file_intelligent(path, comp, COMPRESSION_LEVEL_HIGH, &stats) != 0) {
+    if (compress_file_intelligent(path, comp, COMPRESSION_LEVEL_HIGH, 0, &stats) != 0) {
         printf("✗ Compression failed.\n");
         return -1;
     }
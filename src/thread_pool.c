@@ -0,0 +1,232 @@
+// Fixed-size worker pool on pthreads with a FIFO task queue
+#include "../include/thread_pool.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+typedef struct PoolTask {
+    ThreadPoolTask fn;
+    void* arg;
+    struct PoolTask* next;
+} PoolTask;
+
+struct ThreadPool {
+    pthread_mutex_t lock;
+    pthread_cond_t work_ready;   // queue became non-empty or shutdown
+    pthread_cond_t idle;         // pending dropped to zero
+    PoolTask* head;
+    PoolTask* tail;
+    long pending;                // queued + running tasks
+    int shutdown;
+    int num_threads;
+    pthread_t* threads;
+};
+
+int thread_pool_cpu_count(void) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+#endif
+}
+
+static void* pool_worker(void* arg) {
+    ThreadPool* pool = (ThreadPool*)arg;
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (!pool->head && !pool->shutdown) {
+            pthread_cond_wait(&pool->work_ready, &pool->lock);
+        }
+        if (!pool->head) break;   // shutdown with an empty queue
+
+        PoolTask* task = pool->head;
+        pool->head = task->next;
+        if (!pool->head) pool->tail = NULL;
+        pthread_mutex_unlock(&pool->lock);
+
+        task->fn(task->arg);
+        free(task);
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->pending == 0) pthread_cond_broadcast(&pool->idle);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+ThreadPool* thread_pool_create(int num_threads) {
+    if (num_threads <= 0) num_threads = thread_pool_cpu_count();
+    ThreadPool* pool = (ThreadPool*)calloc(1, sizeof(ThreadPool));
+    if (!pool) return NULL;
+    pool->threads = (pthread_t*)calloc((size_t)num_threads, sizeof(pthread_t));
+    if (!pool->threads) {
+        free(pool);
+        return NULL;
+    }
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work_ready, NULL);
+    pthread_cond_init(&pool->idle, NULL);
+
+    for (int i = 0; i < num_threads; i++) {
+        if (pthread_create(&pool->threads[i], NULL, pool_worker, pool) != 0) break;
+        pool->num_threads++;
+    }
+    if (pool->num_threads == 0) {
+        thread_pool_destroy(pool);
+        return NULL;
+    }
+    return pool;
+}
+
+void thread_pool_destroy(ThreadPool* pool) {
+    if (!pool) return;
+    pthread_mutex_lock(&pool->lock);
+    pool->shutdown = 1;
+    pthread_cond_broadcast(&pool->work_ready);
+    pthread_mutex_unlock(&pool->lock);
+    for (int i = 0; i < pool->num_threads; i++) pthread_join(pool->threads[i], NULL);
+
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->work_ready);
+    pthread_cond_destroy(&pool->idle);
+    free(pool->threads);
+    free(pool);
+}
+
+int thread_pool_size(const ThreadPool* pool) {
+    return pool ? pool->num_threads : 1;
+}
+
+int thread_pool_submit(ThreadPool* pool, ThreadPoolTask fn, void* arg) {
+    if (!fn) return -1;
+    if (!pool) {
+        fn(arg);
+        return 0;
+    }
+    PoolTask* task = (PoolTask*)malloc(sizeof(PoolTask));
+    if (!task) return -1;
+    task->fn = fn;
+    task->arg = arg;
+    task->next = NULL;
+
+    pthread_mutex_lock(&pool->lock);
+    if (pool->tail) pool->tail->next = task;
+    else pool->head = task;
+    pool->tail = task;
+    pool->pending++;
+    pthread_cond_signal(&pool->work_ready);
+    pthread_mutex_unlock(&pool->lock);
+    return 0;
+}
+
+void thread_pool_wait(ThreadPool* pool) {
+    if (!pool) return;
+    pthread_mutex_lock(&pool->lock);
+    while (pool->pending > 0) pthread_cond_wait(&pool->idle, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+// ===== Parallel for =====
+// Helpers and the caller pull indices from a shared counter. The caller
+// only waits for helpers that actually started, so a loop issued from a
+// busy worker still finishes on the caller alone. Helpers that are still
+// queued when the loop ends hold a reference and free the job last.
+
+typedef struct {
+    ThreadPoolForFn fn;
+    void* ctx;
+    long count;
+    atomic_long next;
+    pthread_mutex_t lock;
+    pthread_cond_t done;
+    int active;       // helpers inside for_run
+    int retired;      // set once the caller stops waiting for helpers
+    int refs;         // caller + submitted helpers
+} ParallelFor;
+
+static void for_run(ParallelFor* job) {
+    for (;;) {
+        long i = atomic_fetch_add(&job->next, 1);
+        if (i >= job->count) break;
+        job->fn(job->ctx, i);
+    }
+}
+
+// Drop one reference; called with job->lock held, releases it
+static void for_release(ParallelFor* job) {
+    int last = (--job->refs == 0);
+    pthread_mutex_unlock(&job->lock);
+    if (last) {
+        pthread_mutex_destroy(&job->lock);
+        pthread_cond_destroy(&job->done);
+        free(job);
+    }
+}
+
+static void for_helper(void* arg) {
+    ParallelFor* job = (ParallelFor*)arg;
+    pthread_mutex_lock(&job->lock);
+    if (!job->retired) {
+        job->active++;
+        pthread_mutex_unlock(&job->lock);
+
+        for_run(job);
+
+        pthread_mutex_lock(&job->lock);
+        if (--job->active == 0) pthread_cond_signal(&job->done);
+    }
+    for_release(job);
+}
+
+void thread_pool_parallel_for(ThreadPool* pool, long count, ThreadPoolForFn fn, void* ctx) {
+    if (count <= 0 || !fn) return;
+    if (!pool || pool->num_threads <= 1 || count == 1) {
+        for (long i = 0; i < count; i++) fn(ctx, i);
+        return;
+    }
+
+    ParallelFor* job = (ParallelFor*)malloc(sizeof(ParallelFor));
+    if (!job) {
+        for (long i = 0; i < count; i++) fn(ctx, i);
+        return;
+    }
+    job->fn = fn;
+    job->ctx = ctx;
+    job->count = count;
+    atomic_init(&job->next, 0);
+    pthread_mutex_init(&job->lock, NULL);
+    pthread_cond_init(&job->done, NULL);
+    job->active = 0;
+    job->retired = 0;
+    job->refs = 1;
+
+    long helpers = count - 1;
+    if (helpers > pool->num_threads) helpers = pool->num_threads;
+    for (long h = 0; h < helpers; h++) {
+        pthread_mutex_lock(&job->lock);
+        job->refs++;
+        pthread_mutex_unlock(&job->lock);
+        if (thread_pool_submit(pool, for_helper, job) != 0) {
+            pthread_mutex_lock(&job->lock);
+            job->refs--;
+            pthread_mutex_unlock(&job->lock);
+            break;
+        }
+    }
+
+    for_run(job);
+
+    pthread_mutex_lock(&job->lock);
+    job->retired = 1;
+    while (job->active > 0) pthread_cond_wait(&job->done, &job->lock);
+    for_release(job);
+}
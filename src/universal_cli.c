@@ -14,6 +14,8 @@
 #include "../include/comp_container.h"
 #include "../include/zlib_adapter.h"
 #include "../include/img_preconditioner.h"
+#include "../include/decompressor.h"
+#include "../include/comp_input.h"
 static char* afc_strdup(const char* s) {
     if (!s) return NULL;
     size_t n = strlen(s);
@@ -24,10 +26,7 @@ static char* afc_strdup(const char* s) {
 }
 #define _strdup afc_strdup
 
-/* Use existing CRC32 implementation from project */
-uint32_t CRC32_Calculate(const unsigned char* data, size_t length);
-
-static const size_t CHUNK = 8192;
+#define CHUNK 8192
 
 static const char* get_ext_from_magic(const unsigned char* buf, size_t n) {
     if (n >= 4) {
@@ -170,35 +169,114 @@ static char* make_out_path_in_dir(const char* comp_path, const char* new_ext, co
     return out;
 }
 
+/* Streaming DEFLATE from deflate_wrapper.c */
+typedef int (*deflate_put_fn)(const void* buf, int len, void* user);
+typedef struct deflate_stream deflate_stream;
+deflate_stream* deflate_stream_create(int level, deflate_put_fn put, void* user);
+int deflate_stream_write(deflate_stream* s, const uint8_t* in, size_t len, int flush);
+void deflate_stream_destroy(deflate_stream* s);
+
+static char* make_comp_output_path(const char* input_path, const char* out_dir) {
+    /* Default compression output directory */
+    const char* dir = (out_dir && *out_dir) ? out_dir : "output";
+    ensure_dir_exists(dir);
+    return make_comp_path_in_dir(input_path, dir);
+}
+
+typedef struct {
+    FILE* fo;
+    uint64_t written;
+} stream_out_t;
+
+static int stream_out_put(const void* buf, int len, void* user) {
+    stream_out_t* so = (stream_out_t*)user;
+    if (fwrite(buf, 1, (size_t)len, so->fo) != (size_t)len) return 0;
+    so->written += (uint64_t)len;
+    return 1;
+}
+
+/* Inputs that need no preconditioning are deflated as they are read, CHUNK
+ * bytes at a time, so memory does not grow with the file. The header goes
+ * out first with zero sizes and is rewritten once sizes and CRC are known.
+ * head holds the first bytes, already read from fi for type detection. */
+static int compress_file_streamed(const char* input_path, FILE* fi, unsigned char* head, size_t head_len,
+                                  const char* ext, const char* out_dir) {
+    char* outpath = make_comp_output_path(input_path, out_dir);
+    if (!outpath) { fclose(fi); fprintf(stderr, "Path alloc failed\n"); return -1; }
+    FILE* fo = fopen(outpath, "wb");
+    if (!fo) { fclose(fi); free(outpath); fprintf(stderr, "Failed to open output\n"); return -1; }
+
+    comp_header_t hdr;
+    comp_fill_header(&hdr, COMP_ALGO_ZLIB, 0, 0, 0, ext);
+    stream_out_t so = { fo, 0 };
+    CRC32Context* crc = CRC32_CreateContext();
+    deflate_stream* ds = deflate_stream_create(9, stream_out_put, &so);   /* same level as za_compress_buffer */
+    const char* err = (!crc || !ds) ? "Memory alloc failed" : NULL;
+    if (!err && !comp_write_header(fo, &hdr)) err = "Header write failed";
+
+    uint64_t total = 0;
+    size_t n = head_len;
+    while (!err && n > 0) {
+        CRC32_UpdateContext(crc, head, n);
+        total += n;
+        if (deflate_stream_write(ds, head, n, 0) != 0) err = "Compression failed";
+        else n = fread(head, 1, CHUNK, fi);
+    }
+    if (!err && ferror(fi)) err = "Read failed";
+    if (!err && deflate_stream_write(ds, NULL, 0, 2) != 0) err = "Compression failed";
+    if (!err) {
+        comp_fill_header(&hdr, COMP_ALGO_ZLIB, total, so.written, CRC32_FinalizeContext(crc), ext);
+        if (fseek(fo, 0, SEEK_SET) != 0 || !comp_write_header(fo, &hdr)) err = "Header write failed";
+    }
+    if (fclose(fo) != 0 && !err) err = "Payload write failed";
+    fclose(fi);
+    deflate_stream_destroy(ds);
+    CRC32_DestroyContext(crc);
+    if (err) { remove(outpath); free(outpath); fprintf(stderr, "%s\n", err); return -1; }
+
+    fprintf(stdout, "[SUCCESS] Compressed %s -> %s (%llu -> %llu bytes)\n", input_path, outpath,
+            (unsigned long long)total, (unsigned long long)so.written);
+    // Emit standardized lines for GUI parsers
+    fprintf(stdout, "Output: %s\n", outpath);
+    fprintf(stdout, "Progress: 100\n");
+    free(outpath);
+    return 0;
+}
+
 static int compress_file(const char* input_path, const char* out_dir, int use_zlib) {
     FILE* fi = fopen(input_path, "rb");
     if (!fi) { fprintf(stderr, "Failed to open %s\n", input_path); return -1; }
 
-    /* Read entire file into memory for simplicity; could stream if needed */
-    fseek(fi, 0, SEEK_END);
-    long sz = ftell(fi);
-    if (sz < 0) { fclose(fi); fprintf(stderr, "ftell failed\n"); return -1; }
-    fseek(fi, 0, SEEK_SET);
-    unsigned char* inbuf = (unsigned char*)malloc((size_t)sz);
-    if (!inbuf) { fclose(fi); fprintf(stderr, "Memory alloc failed\n"); return -1; }
-    if (fread(inbuf, 1, (size_t)sz, fi) != (size_t)sz) { free(inbuf); fclose(fi); fprintf(stderr, "Read failed\n"); return -1; }
+    /* Only BMP preconditioning needs the whole file; everything else streams */
+    unsigned char head[CHUNK];
+    size_t head_len = fread(head, 1, CHUNK, fi);
+    const char* head_ext = get_ext_from_path(input_path);
+    if (!head_ext) head_ext = get_ext_from_magic(head, head_len);
+    if (strcasecmp(head_ext, "bmp") != 0) {
+        return compress_file_streamed(input_path, fi, head, head_len, head_ext, out_dir);
+    }
+
     fclose(fi);
+    CompInput in;
+    if (comp_input_open(input_path, COMP_INPUT_RANDOM, &in) != 0) { fprintf(stderr, "Read failed\n"); return -1; }
+    const unsigned char* inbuf = in.data;
+    size_t sz = in.size;
 
     const char* ext = get_ext_from_path(input_path);
     if (!ext) {
-        ext = get_ext_from_magic(inbuf, (size_t)sz);
+        ext = get_ext_from_magic(inbuf, sz);
     }
-    uint32_t crc = CRC32_Calculate(inbuf, (size_t)sz);
+    uint32_t crc = CRC32_Calculate(inbuf, sz);
 
     /* Try lossless BMP preconditioning (SUB filter) to target ~20%+ ratio */
     const unsigned char* comp_input = inbuf;
-    size_t comp_input_size = (size_t)sz;
+    size_t comp_input_size = sz;
     unsigned char* pre_buf = NULL;
     size_t pre_size = 0;
     bmp_info_t bmp;
     int is_bmp = 0;
     if (ext && (strcasecmp(ext, "bmp") == 0)) {
-        is_bmp = bmp_detect_24(inbuf, (size_t)sz < 256 ? (size_t)sz : 256, &bmp);
+        is_bmp = bmp_detect_24(inbuf, sz < 256 ? sz : 256, &bmp);
     }
     if (is_bmp) {
         /* Build IMGF payload: [prelude][header][encoded pixels] */
@@ -206,7 +284,7 @@ static int compress_file(const char* input_path, const char* out_dir, int use_zl
         size_t header_size = (size_t)bmp.header_size;
         size_t payload_cap = sizeof(imgf_prelude_t) + header_size + pixels_size;
         pre_buf = (unsigned char*)malloc(payload_cap);
-        if (!pre_buf) { free(inbuf); fprintf(stderr, "Memory alloc failed\n"); return -1; }
+        if (!pre_buf) { comp_input_close(&in); fprintf(stderr, "Memory alloc failed\n"); return -1; }
         imgf_prelude_t prel;
         memcpy(prel.magic, "IMGF", 4);
         prel.version = 1;
@@ -236,35 +314,26 @@ static int compress_file(const char* input_path, const char* out_dir, int use_zl
     /* Output buffer allocation: use a generous bound to avoid zlib/miniz BUF errors */
     size_t out_capacity = comp_input_size * 2 + 65536;
     unsigned char* outbuf = (unsigned char*)malloc(out_capacity);
-    if (!outbuf) { if (pre_buf) free(pre_buf); free(inbuf); fprintf(stderr, "Memory alloc failed\n"); return -1; }
+    if (!outbuf) { if (pre_buf) free(pre_buf); comp_input_close(&in); fprintf(stderr, "Memory alloc failed\n"); return -1; }
 
     size_t comp_size = 0;
     int rc = 0;
     comp_algo_t algo = COMP_ALGO_ZLIB;
     rc = za_compress_buffer(comp_input, comp_input_size, outbuf, out_capacity, &comp_size);
-    if (rc != 0) { free(outbuf); if (pre_buf) free(pre_buf); free(inbuf); fprintf(stderr, "Compression failed\n"); return -1; }
+    if (rc != 0) { free(outbuf); if (pre_buf) free(pre_buf); comp_input_close(&in); fprintf(stderr, "Compression failed\n"); return -1; }
 
     comp_header_t hdr;
     comp_fill_header(&hdr, algo, (uint64_t)sz, (uint64_t)comp_size, crc, ext);
 
-    char* outpath = NULL;
-    if (out_dir && *out_dir) {
-        ensure_dir_exists(out_dir);
-        outpath = make_comp_path_in_dir(input_path, out_dir);
-    } else {
-        /* Default compression output directory */
-        const char* default_comp_dir = "output";
-        ensure_dir_exists(default_comp_dir);
-        outpath = make_comp_path_in_dir(input_path, default_comp_dir);
-    }
-    if (!outpath) { free(outbuf); free(inbuf); fprintf(stderr, "Path alloc failed\n"); return -1; }
+    char* outpath = make_comp_output_path(input_path, out_dir);
+    if (!outpath) { free(outbuf); comp_input_close(&in); fprintf(stderr, "Path alloc failed\n"); return -1; }
     FILE* fo = fopen(outpath, "wb");
-    if (!fo) { free(outpath); free(outbuf); free(inbuf); fprintf(stderr, "Failed to open output\n"); return -1; }
+    if (!fo) { free(outpath); free(outbuf); comp_input_close(&in); fprintf(stderr, "Failed to open output\n"); return -1; }
 
-    if (!comp_write_header(fo, &hdr)) { fclose(fo); free(outpath); free(outbuf); free(inbuf); fprintf(stderr, "Header write failed\n"); return -1; }
-    if (fwrite(outbuf, 1, comp_size, fo) != comp_size) { fclose(fo); free(outpath); free(outbuf); free(inbuf); fprintf(stderr, "Payload write failed\n"); return -1; }
+    if (!comp_write_header(fo, &hdr)) { fclose(fo); free(outpath); free(outbuf); comp_input_close(&in); fprintf(stderr, "Header write failed\n"); return -1; }
+    if (fwrite(outbuf, 1, comp_size, fo) != comp_size) { fclose(fo); free(outpath); free(outbuf); comp_input_close(&in); fprintf(stderr, "Payload write failed\n"); return -1; }
     fclose(fo);
-    fprintf(stdout, "[SUCCESS] Compressed %s -> %s (%zu -> %zu bytes)\n", input_path, outpath, (size_t)sz, comp_size);
+    fprintf(stdout, "[SUCCESS] Compressed %s -> %s (%zu -> %zu bytes)\n", input_path, outpath, sz, comp_size);
     // Emit standardized lines for GUI parsers
     fprintf(stdout, "Output: %s\n", outpath);
     fprintf(stdout, "Progress: 100\n");
@@ -272,7 +341,7 @@ static int compress_file(const char* input_path, const char* out_dir, int use_zl
     free(outpath);
     free(outbuf);
     if (pre_buf) free(pre_buf);
-    free(inbuf);
+    comp_input_close(&in);
     return 0;
 }
 
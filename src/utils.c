@@ -1,4 +1,5 @@
 #include "../include/compressor.h"
+#include "../include/comp_input.h"
 #include <ctype.h>
 #ifdef _WIN32
 #include <direct.h>
@@ -203,7 +204,7 @@ FileType detect_file_type(const char* filename) {
     return FILE_TYPE_UNKNOWN;
 }
 
-// Read entire file into memory
+// Read entire file into memory (an owned copy; see comp_input.h for a mapping)
 int read_file(const char* filepath, unsigned char** buffer, long* size) {
     FILE* file = fopen(filepath, "rb");
     if (!file) {
@@ -211,35 +212,22 @@ int read_file(const char* filepath, unsigned char** buffer, long* size) {
         return -1;
     }
     
-    // Get file size
-    fseek(file, 0, SEEK_END);
-    *size = ftell(file);
-    fseek(file, 0, SEEK_SET);
+    size_t bytes_read = 0;
+    int r = comp_input_read_all(file, buffer, &bytes_read);
+    fclose(file);
     
-    if (*size <= 0) {
-        printf("Error: File '%s' is empty or invalid.\n", filepath);
-        fclose(file);
+    if (r != 0) {
+        printf("Error: Could not read file '%s'.\n", filepath);
         return -1;
     }
-    
-    // Allocate buffer
-    *buffer = (unsigned char*)malloc(*size);
-    if (!*buffer) {
-        printf("Error: Cannot allocate memory for file '%s'.\n", filepath);
-        fclose(file);
-        return -1;
-    }
-    
-    // Read file
-    size_t bytes_read = fread(*buffer, 1, *size, file);
-    fclose(file);
-    
-    if (bytes_read != *size) {
-        printf("Error: Could not read entire file '%s'.\n", filepath);
+    if (bytes_read == 0) {
+        printf("Error: File '%s' is empty or invalid.\n", filepath);
         free(*buffer);
+        *buffer = NULL;
         return -1;
     }
     
+    *size = (long)bytes_read;
     return 0;
 }
 